@@ -0,0 +1,443 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Times the hot Mask and MaskOperations functions on synthetic masks of several sizes and hole
+  * fractions, and writes the results as JSON.
+  *
+  * Usage: MaskBenchmarks [--megapixels 1,4,16,100] [--hole-fractions 0.05,0.25,0.5]
+  *                       [--repetitions 3] [--output MaskBenchmarks.json] [--trace MaskTrace.json]
+  *                       [--help]
+  *
+  * Each benchmark is run 'repetitions' times; the JSON records the fastest and the median time and the
+  * throughput (pixels processed per second, from the fastest time). A one line summary of each result
+  * is printed as it finishes.
+  */
+
+#include "Mask.h"
+#include "MaskGenerator.h"
+#include "MaskInstrumentation.h"
+#include "MaskOperations.h"
+#include "MaskRandomState.h"
+#include "MaskTrace.h"
+
+// ITK
+#include "itkImageRegionIterator.h"
+#include "itkVectorImage.h"
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct BenchmarkResult
+{
+  std::string Name;
+  itk::Size<2> Size;
+  double HoleFraction;
+  unsigned int Repetitions;
+  double FastestSeconds;
+  double MedianSeconds;
+  double PixelsProcessed;
+};
+
+struct BenchmarkSettings
+{
+  std::vector<double> Megapixels = {1, 4, 16, 100};
+  std::vector<double> HoleFractions = {0.05, 0.25, 0.5};
+  unsigned int Repetitions = 3;
+  std::string OutputFileName = "MaskBenchmarks.json";
+  std::string TraceFileName;
+  bool ShowHelp = false;
+};
+
+const char* const Usage =
+    "Usage: MaskBenchmarks [--megapixels 1,4,16,100] [--hole-fractions 0.05,0.25,0.5]"
+    " [--repetitions 3] [--output MaskBenchmarks.json] [--trace MaskTrace.json] [--help]";
+
+typedef itk::Image<unsigned char, 2> UnsignedCharImageType;
+typedef itk::VectorImage<float, 2> VectorImageType;
+
+std::vector<double> ParseList(const std::string& text)
+{
+  std::vector<double> values;
+  std::stringstream ss(text);
+  std::string value;
+  while(std::getline(ss, value, ','))
+  {
+    values.push_back(std::stod(value));
+  }
+  return values;
+}
+
+BenchmarkSettings ParseArguments(const int argc, char* argv[])
+{
+  BenchmarkSettings settings;
+  for(int i = 1; i < argc; ++i)
+  {
+    const std::string argument = argv[i];
+    if(argument == "--help" || argument == "-h")
+    {
+      settings.ShowHelp = true;
+      return settings;
+    }
+
+    if(i + 1 >= argc)
+    {
+      throw std::runtime_error("Missing value for " + argument);
+    }
+
+    const std::string value = argv[++i];
+    if(argument == "--megapixels")
+    {
+      settings.Megapixels = ParseList(value);
+      for(std::size_t valueId = 0; valueId < settings.Megapixels.size(); ++valueId)
+      {
+        // Written so that NaN is rejected too.
+        if(!(settings.Megapixels[valueId] > 0))
+        {
+          throw std::runtime_error("--megapixels values must be positive, got " + value);
+        }
+      }
+    }
+    else if(argument == "--hole-fractions")
+    {
+      settings.HoleFractions = ParseList(value);
+      for(std::size_t valueId = 0; valueId < settings.HoleFractions.size(); ++valueId)
+      {
+        // CreateMask never reaches a target above 1. Written so that NaN is rejected too.
+        if(!(settings.HoleFractions[valueId] >= 0 && settings.HoleFractions[valueId] <= 1))
+        {
+          throw std::runtime_error("--hole-fractions values must be in [0, 1], got " + value);
+        }
+      }
+    }
+    else if(argument == "--repetitions")
+    {
+      settings.Repetitions = std::max(std::stoi(value), 1);
+    }
+    else if(argument == "--output")
+    {
+      settings.OutputFileName = value;
+    }
+    else if(argument == "--trace")
+    {
+      settings.TraceFileName = value;
+    }
+    else
+    {
+      throw std::runtime_error("Unknown argument " + argument);
+    }
+  }
+
+  return settings;
+}
+
+/** Make a square-ish mask of about 'megapixels' million pixels whose hole is a set of random discs
+  * covering about 'holeFraction' of it.*/
+void CreateMask(const double megapixels, const double holeFraction, Mask* const mask)
+{
+  const itk::SizeValueType width = static_cast<itk::SizeValueType>(std::sqrt(megapixels * 1e6 * 4 / 3));
+  const itk::SizeValueType height = static_cast<itk::SizeValueType>(megapixels * 1e6 / width);
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{width, height}};
+  mask->SetRegions(itk::ImageRegion<2>(corner, size));
+  mask->Allocate();
+  mask->FillBuffer(HoleMaskPixelTypeEnum::VALID);
+
+  HoleMaskPixelTypeEnum* const buffer = mask->GetBufferPointer();
+  const itk::IndexValueType radius = std::max<itk::IndexValueType>(height / 40, 2);
+  const itk::SizeValueType targetHolePixels = static_cast<itk::SizeValueType>(holeFraction * width * height);
+  itk::SizeValueType numberOfHolePixels = 0;
+  MaskRandomState randomState(2012);
+  while(numberOfHolePixels < targetHolePixels)
+  {
+    const itk::IndexValueType centerX = randomState.NextUniformInteger(0, width - 1);
+    const itk::IndexValueType centerY = randomState.NextUniformInteger(0, height - 1);
+    for(itk::IndexValueType y = std::max<itk::IndexValueType>(centerY - radius, 0);
+        y <= std::min<itk::IndexValueType>(centerY + radius, height - 1) && numberOfHolePixels < targetHolePixels; ++y)
+    {
+      const itk::IndexValueType halfWidth =
+          static_cast<itk::IndexValueType>(std::sqrt(static_cast<double>(radius * radius - (y - centerY) * (y - centerY))));
+      for(itk::IndexValueType x = std::max<itk::IndexValueType>(centerX - halfWidth, 0);
+          x <= std::min<itk::IndexValueType>(centerX + halfWidth, width - 1); ++x)
+      {
+        HoleMaskPixelTypeEnum& pixel = buffer[y * width + x];
+        if(pixel != HoleMaskPixelTypeEnum::HOLE)
+        {
+          pixel = HoleMaskPixelTypeEnum::HOLE;
+          numberOfHolePixels++;
+        }
+      }
+    }
+  }
+  mask->Modified();
+}
+
+void CopyMask(const Mask* const source, Mask* const destination)
+{
+  destination->SetRegions(source->GetLargestPossibleRegion());
+  destination->Allocate();
+  std::copy(source->GetBufferPointer(), source->GetBufferPointer() + source->GetLargestPossibleRegion().GetNumberOfPixels(),
+            destination->GetBufferPointer());
+  destination->Modified();
+}
+
+void CreateVectorImage(const itk::ImageRegion<2>& region, VectorImageType* const image)
+{
+  image->SetRegions(region);
+  image->SetNumberOfComponentsPerPixel(3);
+  image->Allocate();
+
+  float* const buffer = image->GetBufferPointer();
+  const std::size_t numberOfValues = region.GetNumberOfPixels() * 3;
+  for(std::size_t valueId = 0; valueId < numberOfValues; ++valueId)
+  {
+    buffer[valueId] = static_cast<float>((valueId * 31) % 256);
+  }
+}
+
+/** Time 'operation' (after 'setup', which is not timed) 'repetitions' times.*/
+BenchmarkResult TimeOperation(const std::string& name, const Mask* const mask, const double holeFraction,
+                              const unsigned int repetitions, const double pixelsProcessed,
+                              const std::function<void()>& setup, const std::function<void()>& operation)
+{
+  typedef std::chrono::steady_clock ClockType;
+
+  std::vector<double> times;
+  for(unsigned int repetition = 0; repetition < repetitions; ++repetition)
+  {
+    setup();
+    const ClockType::time_point startTime = ClockType::now();
+    operation();
+    times.push_back(std::chrono::duration<double>(ClockType::now() - startTime).count());
+  }
+  std::sort(times.begin(), times.end());
+
+  BenchmarkResult result;
+  result.Name = name;
+  result.Size = mask->GetLargestPossibleRegion().GetSize();
+  result.HoleFraction = holeFraction;
+  result.Repetitions = repetitions;
+  result.FastestSeconds = times.front();
+  result.MedianSeconds = times[times.size() / 2];
+  result.PixelsProcessed = pixelsProcessed;
+
+  std::cerr << name << " " << result.Size[0] << "x" << result.Size[1] << " holes " << holeFraction << ": "
+            << result.FastestSeconds << " s, "
+            << pixelsProcessed / std::max(result.FastestSeconds, 1e-12) / 1e6 << " Mpixels/s" << std::endl;
+
+  return result;
+}
+
+void RunBenchmarks(const double megapixels, const double holeFraction, const unsigned int repetitions,
+                   std::vector<BenchmarkResult>& results)
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(megapixels, holeFraction, mask);
+  const itk::ImageRegion<2> region = mask->GetLargestPossibleRegion();
+  const double numberOfPixels = static_cast<double>(region.GetNumberOfPixels());
+  const std::function<void()> noSetup = []{};
+
+  // The query functions cache derived data until the mask is modified, so mark it modified before
+  // every repetition to time the real work.
+  const std::function<void()> modifyMask = [&mask]{ mask->Modified(); };
+
+  // Counts
+  results.push_back(TimeOperation("CountHolePixels", mask, holeFraction, repetitions, numberOfPixels, modifyMask,
+                                  [&mask]{ mask->CountHolePixels(); }));
+  results.push_back(TimeOperation("CountValidPixels", mask, holeFraction, repetitions, numberOfPixels, modifyMask,
+                                  [&mask]{ mask->CountValidPixels(); }));
+
+  // Region predicates on every 9x9 patch on a grid of stride 16.
+  std::vector<itk::ImageRegion<2> > patches;
+  for(itk::IndexValueType y = 0; y + 9 <= static_cast<itk::IndexValueType>(region.GetSize()[1]); y += 16)
+  {
+    for(itk::IndexValueType x = 0; x + 9 <= static_cast<itk::IndexValueType>(region.GetSize()[0]); x += 16)
+    {
+      itk::Index<2> corner = {{x, y}};
+      itk::Size<2> size = {{9, 9}};
+      patches.push_back(itk::ImageRegion<2>(corner, size));
+    }
+  }
+  const double patchPixels = static_cast<double>(patches.size()) * 81;
+  results.push_back(TimeOperation("HasHolePixels(region)", mask, holeFraction, repetitions, patchPixels, modifyMask,
+                                  [&mask, &patches]
+                                  {
+                                    for(std::size_t i = 0; i < patches.size(); ++i)
+                                    {
+                                      mask->HasHolePixels(patches[i]);
+                                    }
+                                  }));
+  results.push_back(TimeOperation("IsValid(region)", mask, holeFraction, repetitions, patchPixels, modifyMask,
+                                  [&mask, &patches]
+                                  {
+                                    for(std::size_t i = 0; i < patches.size(); ++i)
+                                    {
+                                      mask->IsValid(patches[i]);
+                                    }
+                                  }));
+
+  // Boundary extraction
+  results.push_back(TimeOperation("FindBoundaryPixels", mask, holeFraction, repetitions, numberOfPixels, modifyMask,
+                                  [&mask]{ mask->FindBoundaryPixels(HoleMaskPixelTypeEnum::HOLE); }));
+
+  // Morphology, on a fresh copy of the mask each time.
+  Mask::Pointer workMask = Mask::New();
+  const std::function<void()> copyMask = [&mask, &workMask]{ CopyMask(mask, workMask); };
+  results.push_back(TimeOperation("ExpandHole(2)", mask, holeFraction, repetitions, numberOfPixels, copyMask,
+                                  [&workMask]{ workMask->ExpandHole(2); }));
+  results.push_back(TimeOperation("ShrinkHole(2)", mask, holeFraction, repetitions, numberOfPixels, copyMask,
+                                  [&workMask]{ workMask->ShrinkHole(2); }));
+
+  // Masked image operations on a 3 component float image.
+  VectorImageType::Pointer image = VectorImageType::New();
+  CreateVectorImage(region, image);
+  VectorImageType::Pointer output = VectorImageType::New();
+  CreateVectorImage(region, output);
+
+  results.push_back(TimeOperation("MaskedBlur", mask, holeFraction, repetitions, numberOfPixels, noSetup,
+                                  [&]{ MaskOperations::MaskedBlur(image.GetPointer(), mask.GetPointer(), 2.0f,
+                                                                  output.GetPointer()); }));
+  results.push_back(TimeOperation("CopyInHoleRegion", mask, holeFraction, repetitions, numberOfPixels, noSetup,
+                                  [&]{ MaskOperations::CopyInHoleRegion(image.GetPointer(), output.GetPointer(),
+                                                                        mask.GetPointer()); }));
+
+  VectorImageType::PixelType holeColor(3);
+  holeColor.Fill(0);
+  results.push_back(TimeOperation("ApplyToImage", mask, holeFraction, repetitions, numberOfPixels, noSetup,
+                                  [&]{ mask->ApplyToImage(output.GetPointer(), holeColor); }));
+
+  // Conversions to and from images.
+  UnsignedCharImageType::Pointer binaryImage = UnsignedCharImageType::New();
+  results.push_back(TimeOperation("CreateBinaryImage", mask, holeFraction, repetitions, numberOfPixels, noSetup,
+                                  [&]{ mask->CreateBinaryImage(binaryImage, 0, 255); }));
+
+  // CreateFromImage reports its counts on std::cout. Detach std::cout's buffer while it runs so the
+  // time is spent converting, not writing to the terminal (a stream without a buffer skips formatting).
+  results.push_back(TimeOperation("CreateFromImage", mask, holeFraction, repetitions, numberOfPixels, noSetup,
+                                  [&]
+                                  {
+                                    std::streambuf* const coutBuffer = std::cout.rdbuf(nullptr);
+                                    workMask->CreateFromImage(binaryImage.GetPointer(),
+                                                              HolePixelValueWrapper<unsigned char>(0),
+                                                              ValidPixelValueWrapper<unsigned char>(255));
+                                    std::cout.rdbuf(coutBuffer);
+                                  }));
+
+  // Synthetic masks of this size and hole fraction, a different one each repetition.
+  MaskGenerator generator(2012);
+  generator.SetSize(region.GetSize());
+  generator.SetHoleFraction(static_cast<float>(holeFraction));
+  uint64_t generatedMaskId = 0;
+  results.push_back(TimeOperation("MaskGenerator::Generate", mask, holeFraction, repetitions, numberOfPixels, noSetup,
+                                  [&]{ generator.Generate(generatedMaskId++, workMask); }));
+}
+
+void WriteJSON(const std::vector<BenchmarkResult>& results, std::ostream& output)
+{
+  output << "{\n  \"benchmarks\": [\n";
+  for(std::size_t resultId = 0; resultId < results.size(); ++resultId)
+  {
+    const BenchmarkResult& result = results[resultId];
+    output << "    {\"name\": \"" << result.Name << "\""
+           << ", \"width\": " << result.Size[0]
+           << ", \"height\": " << result.Size[1]
+           << ", \"megapixels\": " << result.Size[0] * result.Size[1] / 1e6
+           << ", \"holeFraction\": " << result.HoleFraction
+           << ", \"repetitions\": " << result.Repetitions
+           << ", \"fastestSeconds\": " << result.FastestSeconds
+           << ", \"medianSeconds\": " << result.MedianSeconds
+           << ", \"pixelsPerSecond\": " << result.PixelsProcessed / std::max(result.FastestSeconds, 1e-12)
+           << "}" << (resultId + 1 < results.size() ? "," : "") << "\n";
+  }
+  output << "  ]\n}\n";
+}
+
+} // end anonymous namespace
+
+int main(int argc, char* argv[])
+{
+  BenchmarkSettings settings;
+  try
+  {
+    settings = ParseArguments(argc, argv);
+  }
+  catch(const std::exception& error)
+  {
+    std::cerr << error.what() << std::endl << Usage << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if(settings.ShowHelp)
+  {
+    std::cout << Usage << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if(!settings.TraceFileName.empty())
+  {
+    if(!MaskTrace::IsEnabled())
+    {
+      std::cerr << "--trace needs Mask to be built with Mask_EnableTracing." << std::endl;
+      return EXIT_FAILURE;
+    }
+    MaskTrace::Start();
+  }
+
+  std::vector<BenchmarkResult> results;
+  for(std::size_t sizeId = 0; sizeId < settings.Megapixels.size(); ++sizeId)
+  {
+    for(std::size_t fractionId = 0; fractionId < settings.HoleFractions.size(); ++fractionId)
+    {
+      RunBenchmarks(settings.Megapixels[sizeId], settings.HoleFractions[fractionId], settings.Repetitions, results);
+    }
+  }
+
+  std::ofstream output(settings.OutputFileName.c_str());
+  if(!output)
+  {
+    std::cerr << "Could not open " << settings.OutputFileName << " for writing." << std::endl;
+    return EXIT_FAILURE;
+  }
+  WriteJSON(results, output);
+
+  if(!settings.TraceFileName.empty())
+  {
+    MaskTrace::Stop();
+    MaskTrace::WriteChromeTrace(settings.TraceFileName);
+  }
+
+  // With instrumentation built in, also show where the time went inside the operations.
+  if(MaskInstrumentation::IsEnabled())
+  {
+    MaskInstrumentation::WriteSnapshot(MaskInstrumentation::GetSnapshot(), std::cerr);
+  }
+
+  return EXIT_SUCCESS;
+}
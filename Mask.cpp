@@ -17,6 +17,8 @@
  *=========================================================================*/
 
 #include "Mask.h"
+#include "MaskInstrumentation.h"
+#include "MaskPatchSampler.h"
 
 // Submodules
 #include <Helpers/Helpers.h>
@@ -33,8 +35,179 @@
 #include "itkLabelShapeKeepNObjectsImageFilter.h"
 #include "itkRescaleIntensityImageFilter.h"
 
+// STL
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+
+/** Compute, for every pixel of 'mask', the buffer offset of the closest pixel (Euclidean distance)
+  * for which 'isSite' is true, or -1 if there are no such pixels. This is the linear time
+  * separable algorithm of Felzenszwalb and Huttenlocher ("Distance Transforms of Sampled Functions"),
+  * modified to carry the location of the site along with the distance. */
+template <typename TSitePredicate>
+void ComputeNearestPixelMap(const Mask* const mask, TSitePredicate isSite,
+                            Mask::NearestPixelMapType& nearestPixelMap)
+{
+  const itk::ImageRegion<2> bufferedRegion = mask->GetBufferedRegion();
+  const itk::OffsetValueType width = bufferedRegion.GetSize()[0];
+  const itk::OffsetValueType height = bufferedRegion.GetSize()[1];
+  const Mask::PixelType* const buffer = mask->GetBufferPointer();
+
+  nearestPixelMap.assign(width * height, -1);
+
+  // First pass: for every pixel, the row of the closest site in the same column. This is done
+  // with a downward and an upward sweep so that the buffer is always accessed in row order.
+  std::vector<itk::OffsetValueType> columnSiteRow(width * height);
+  std::vector<itk::OffsetValueType> lastSiteRow(width, -1);
+  for(itk::OffsetValueType y = 0; y < height; ++y)
+  {
+    for(itk::OffsetValueType x = 0; x < width; ++x)
+    {
+      if(isSite(buffer[y * width + x]))
+      {
+        lastSiteRow[x] = y;
+      }
+      columnSiteRow[y * width + x] = lastSiteRow[x];
+    }
+  }
+
+  std::fill(lastSiteRow.begin(), lastSiteRow.end(), -1);
+  for(itk::OffsetValueType y = height - 1; y >= 0; --y)
+  {
+    for(itk::OffsetValueType x = 0; x < width; ++x)
+    {
+      if(isSite(buffer[y * width + x]))
+      {
+        lastSiteRow[x] = y;
+      }
+      itk::OffsetValueType& siteRow = columnSiteRow[y * width + x];
+      if(lastSiteRow[x] >= 0 && (siteRow < 0 || lastSiteRow[x] - y < y - siteRow))
+      {
+        siteRow = lastSiteRow[x];
+      }
+    }
+  }
+
+  // Second pass: in every row, each column with a site contributes the parabola
+  // (x - column)^2 + (y - siteRow)^2. Find the lower envelope of these parabolas.
+  std::vector<itk::OffsetValueType> envelopeColumns(width);
+  std::vector<double> envelopeBoundaries(width + 1);
+  for(itk::OffsetValueType y = 0; y < height; ++y)
+  {
+    const itk::OffsetValueType* const rowSiteRows = &columnSiteRow[y * width];
+
+    itk::OffsetValueType numberOfParabolas = 0;
+    for(itk::OffsetValueType column = 0; column < width; ++column)
+    {
+      if(rowSiteRows[column] < 0)
+      {
+        continue;
+      }
+
+      const double parabolaHeight =
+          static_cast<double>((y - rowSiteRows[column]) * (y - rowSiteRows[column]));
+      double intersection = 0.0;
+      while(numberOfParabolas > 0)
+      {
+        const itk::OffsetValueType previousColumn = envelopeColumns[numberOfParabolas - 1];
+        const double previousHeight =
+            static_cast<double>((y - rowSiteRows[previousColumn]) * (y - rowSiteRows[previousColumn]));
+        intersection = ((parabolaHeight + column * column) - (previousHeight + previousColumn * previousColumn)) /
+                       (2.0 * (column - previousColumn));
+        if(numberOfParabolas == 1 || intersection > envelopeBoundaries[numberOfParabolas - 1])
+        {
+          break;
+        }
+        numberOfParabolas--;
+      }
+
+      envelopeColumns[numberOfParabolas] = column;
+      envelopeBoundaries[numberOfParabolas] = (numberOfParabolas == 0) ?
+            -std::numeric_limits<double>::infinity() : intersection;
+      numberOfParabolas++;
+    }
+
+    if(numberOfParabolas == 0)
+    {
+      continue; // There are no sites at all, every entry stays -1
+    }
+
+    envelopeBoundaries[numberOfParabolas] = std::numeric_limits<double>::infinity();
+
+    itk::OffsetValueType parabolaId = 0;
+    for(itk::OffsetValueType x = 0; x < width; ++x)
+    {
+      while(envelopeBoundaries[parabolaId + 1] < x)
+      {
+        parabolaId++;
+      }
+      const itk::OffsetValueType column = envelopeColumns[parabolaId];
+      nearestPixelMap[y * width + x] = rowSiteRows[column] * width + column;
+    }
+  }
+}
+
+/** Compute the map of the pixels of 'mask' at which a (2*patchRadius+1)^2 patch lies inside the
+  * mask and contains only 'pixelType' pixels. This is an erosion by a square, done separably with
+  * run lengths so that the cost does not depend on the radius. */
+void ComputePatchCenterMap(const Mask* const mask, const HoleMaskPixelTypeEnum pixelType,
+                           const unsigned int patchRadius, Mask::PatchCenterMapType& patchCenterMap)
+{
+  const itk::ImageRegion<2> bufferedRegion = mask->GetBufferedRegion();
+  const itk::OffsetValueType width = bufferedRegion.GetSize()[0];
+  const itk::OffsetValueType height = bufferedRegion.GetSize()[1];
+  const itk::OffsetValueType radius = patchRadius;
+  const itk::OffsetValueType patchWidth = 2 * radius + 1;
+  const Mask::PixelType* const buffer = mask->GetBufferPointer();
+
+  patchCenterMap.assign(width * height, 0);
+
+  if(patchWidth > width || patchWidth > height)
+  {
+    return;
+  }
+
+  // 'rowCenters' marks the pixels whose horizontal (2*patchRadius+1) segment is entirely 'pixelType'.
+  // 'columnRunLengths' counts, for every column, how many consecutive rows ending at the current row
+  // have such a segment. A patch is complete once that count reaches the patch width.
+  std::vector<unsigned char> rowCenters(width);
+  std::vector<itk::OffsetValueType> columnRunLengths(width, 0);
+
+  for(itk::OffsetValueType y = 0; y < height; ++y)
+  {
+    const Mask::PixelType* const row = buffer + y * width;
+
+    std::fill(rowCenters.begin(), rowCenters.end(), 0);
+    itk::OffsetValueType rowRunLength = 0;
+    for(itk::OffsetValueType x = 0; x < width; ++x)
+    {
+      rowRunLength = (row[x] == pixelType) ? rowRunLength + 1 : 0;
+      if(rowRunLength >= patchWidth)
+      {
+        rowCenters[x - radius] = 1;
+      }
+    }
+
+    for(itk::OffsetValueType x = 0; x < width; ++x)
+    {
+      columnRunLengths[x] = rowCenters[x] ? columnRunLengths[x] + 1 : 0;
+      if(columnRunLengths[x] >= patchWidth)
+      {
+        patchCenterMap[(y - radius) * width + x] = 1;
+      }
+    }
+  }
+}
+
+} // end anonymous namespace
+
 void Mask::Read(const std::string& filename)
 {
+  MASK_INSTRUMENT_OPERATION("Mask::Read");
   /**
    * The format of the .mask file is:
    * hole 0
@@ -136,6 +309,7 @@ void Mask::Read(const std::string& filename)
 unsigned int Mask::CountBoundaryPixels(const itk::ImageRegion<2>& region,
                                        const Mask::PixelType& whichSideOfBoundary) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::CountBoundaryPixels");
   return FindBoundaryPixelsInRegion(region, whichSideOfBoundary).size();
 }
 
@@ -148,6 +322,8 @@ unsigned int Mask::CountBoundaryPixels(const Mask::PixelType& whichSideOfBoundar
 std::vector<itk::Index<2> > Mask::FindBoundaryPixelsInRegion(const itk::ImageRegion<2>& region,
                                                              const Mask::PixelType& whichSideOfBoundary) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::FindBoundaryPixelsInRegion");
+  MASK_INSTRUMENT_PIXELS(region.GetNumberOfPixels());
   std::vector<itk::Index<2> > boundaryPixels;
 
   itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(this, region);
@@ -165,17 +341,20 @@ std::vector<itk::Index<2> > Mask::FindBoundaryPixelsInRegion(const itk::ImageReg
 
     ++maskIterator;
   }
+  MASK_INSTRUMENT_BYTES(boundaryPixels.capacity() * sizeof(itk::Index<2>));
   return boundaryPixels;
 }
 
 /** Find hole pixels that are touching valid pixels.*/
 std::vector<itk::Index<2> > Mask::FindBoundaryPixels(const Mask::PixelType& whichSideOfBoundary) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::FindBoundaryPixels");
   return FindBoundaryPixelsInRegion(this->GetLargestPossibleRegion(), whichSideOfBoundary);
 }
 
 unsigned int Mask::CountHolePixels(const itk::ImageRegion<2>& region) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::CountHolePixels");
   return GetHolePixelsInRegion(region).size();
 }
 
@@ -186,6 +365,7 @@ bool Mask::HasValidPixels() const
 
 bool Mask::HasValidPixels(const itk::ImageRegion<2>& region) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::HasValidPixels");
   if(CountValidPixels(region) > 0)
   {
     return true;
@@ -203,6 +383,7 @@ bool Mask::HasHolePixels() const
 
 bool Mask::HasHolePixels(const itk::ImageRegion<2>& region) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::HasHolePixels");
   if(CountHolePixels(region) > 0)
   {
     return true;
@@ -215,6 +396,7 @@ bool Mask::HasHolePixels(const itk::ImageRegion<2>& region) const
 
 std::vector<itk::Index<2> > Mask::GetHolePixels() const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::GetHolePixels");
   return GetHolePixelsInRegion(this->GetLargestPossibleRegion());
 }
 
@@ -225,6 +407,7 @@ unsigned int Mask::CountHolePixels() const
 
 unsigned int Mask::CountValidPixels(const itk::ImageRegion<2>& region) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::CountValidPixels");
   return GetValidPixelsInRegion(region).size();
 }
 
@@ -235,6 +418,7 @@ unsigned int Mask::CountValidPixels() const
 
 std::vector<itk::Offset<2> > Mask::GetValidOffsetsInRegion(itk::ImageRegion<2> region) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::GetValidOffsetsInRegion");
   // Ensure the region is inside the image
   region.Crop(this->GetLargestPossibleRegion());
 
@@ -243,12 +427,15 @@ std::vector<itk::Offset<2> > Mask::GetValidOffsetsInRegion(itk::ImageRegion<2> r
 
   std::vector<itk::Offset<2> > validOffsets =
       ITKHelpers::IndicesToOffsets(indices, region.GetIndex());
+  MASK_INSTRUMENT_PIXELS(region.GetNumberOfPixels());
+  MASK_INSTRUMENT_BYTES(indices.capacity() * sizeof(itk::Index<2>) + validOffsets.capacity() * sizeof(itk::Offset<2>));
 
   return validOffsets;
 }
 
 std::vector<itk::Offset<2> > Mask::GetHoleOffsetsInRegion(itk::ImageRegion<2> region) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::GetHoleOffsetsInRegion");
   // Ensure the region is inside the image
   region.Crop(this->GetLargestPossibleRegion());
 
@@ -257,23 +444,29 @@ std::vector<itk::Offset<2> > Mask::GetHoleOffsetsInRegion(itk::ImageRegion<2> re
 
   std::vector<itk::Offset<2> > holeOffsets =
       ITKHelpers::IndicesToOffsets(indices, region.GetIndex());
+  MASK_INSTRUMENT_PIXELS(region.GetNumberOfPixels());
+  MASK_INSTRUMENT_BYTES(indices.capacity() * sizeof(itk::Index<2>) + holeOffsets.capacity() * sizeof(itk::Offset<2>));
 
   return holeOffsets;
 }
 
 std::vector<itk::Index<2> > Mask::GetValidPixels(const bool forward) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::GetValidPixels");
   return GetValidPixelsInRegion(this->GetLargestPossibleRegion(), forward);
 }
 
 std::vector<itk::Index<2> > Mask::GetValidPixelsInRegion(itk::ImageRegion<2> region,
                                                          const bool forward) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::GetValidPixelsInRegion");
   // Ensure the region is inside the image
   region.Crop(this->GetLargestPossibleRegion());
 
   std::vector<itk::Index<2> > validPixels =
       ITKHelpers::GetPixelsWithValueInRegion(this, region, HoleMaskPixelTypeEnum::VALID);
+  MASK_INSTRUMENT_PIXELS(region.GetNumberOfPixels());
+  MASK_INSTRUMENT_BYTES(validPixels.capacity() * sizeof(itk::Index<2>));
 
   if(!forward)
   {
@@ -285,11 +478,14 @@ std::vector<itk::Index<2> > Mask::GetValidPixelsInRegion(itk::ImageRegion<2> reg
 
 std::vector<itk::Index<2> > Mask::GetHolePixelsInRegion(itk::ImageRegion<2> region) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::GetHolePixelsInRegion");
   // Ensure the region is inside the image
   region.Crop(this->GetLargestPossibleRegion());
 
   std::vector<itk::Index<2> > holePixels =
       ITKHelpers::GetPixelsWithValueInRegion(this, region, HoleMaskPixelTypeEnum::HOLE);
+  MASK_INSTRUMENT_PIXELS(region.GetNumberOfPixels());
+  MASK_INSTRUMENT_BYTES(holePixels.capacity() * sizeof(itk::Index<2>));
 
   return holePixels;
 }
@@ -326,6 +522,8 @@ bool Mask::IsValid(const itk::Index<2>& index) const
 
 void Mask::InvertData()
 {
+  MASK_INSTRUMENT_OPERATION("Mask::InvertData");
+  MASK_INSTRUMENT_PIXELS(this->GetLargestPossibleRegion().GetNumberOfPixels());
   // Exchange HoleValue and ValidValue, but leave everything else alone.
   itk::ImageRegionIterator<Mask>
       maskIterator(this, this->GetLargestPossibleRegion());
@@ -344,6 +542,7 @@ void Mask::InvertData()
     }
     ++maskIterator;
   }
+  this->MarkModifiedRegion(this->GetLargestPossibleRegion());
   //std::cout << "Inverted " << invertedCounter << " in the mask." << std::endl;
 }
 
@@ -375,6 +574,8 @@ void Mask::Cleanup()
 
 void Mask::CopyHolesFrom(const Mask* const inputMask)
 {
+  MASK_INSTRUMENT_OPERATION("Mask::CopyHolesFrom");
+  MASK_INSTRUMENT_PIXELS(this->GetLargestPossibleRegion().GetNumberOfPixels());
   itk::ImageRegionConstIterator<Mask> inputIterator(inputMask, inputMask->GetLargestPossibleRegion());
   itk::ImageRegionIterator<Mask> thisIterator(this, this->GetLargestPossibleRegion());
 
@@ -387,12 +588,17 @@ void Mask::CopyHolesFrom(const Mask* const inputMask)
     ++inputIterator;
     ++thisIterator;
   }
+  this->MarkModifiedRegion(this->GetLargestPossibleRegion());
 }
 
 void Mask::ExpandHole(const unsigned int kernelRadius)
 {
+  MASK_INSTRUMENT_OPERATION("Mask::ExpandHole");
   UnsignedCharImageType::Pointer binaryHoleImage = UnsignedCharImageType::New();
-  this->CreateBinaryImage(binaryHoleImage, 255, 0);
+  {
+    MASK_TRACE_SCOPE("Mask::ExpandHole: binary conversion");
+    this->CreateBinaryImage(binaryHoleImage, 255, 0);
+  }
 
 //   std::cout << "binaryHoleImage: " << std::endl;
 //   ITKHelpers::PrintImage(binaryHoleImage.GetPointer());
@@ -406,7 +612,10 @@ void Mask::ExpandHole(const unsigned int kernelRadius)
   BinaryDilateImageFilterType::Pointer dilateFilter = BinaryDilateImageFilterType::New();
   dilateFilter->SetInput(binaryHoleImage);
   dilateFilter->SetKernel(structuringElement);
-  dilateFilter->Update();
+  {
+    MASK_TRACE_SCOPE("Mask::ExpandHole: dilate");
+    dilateFilter->Update();
+  }
 
 //   std::cout << "dilateFilter output: " << std::endl;
 //   ITKHelpers::PrintImage(dilateFilter->GetOutput());
@@ -417,8 +626,12 @@ void Mask::ExpandHole(const unsigned int kernelRadius)
 
 void Mask::ShrinkHole(const unsigned int kernelRadius)
 {
+  MASK_INSTRUMENT_OPERATION("Mask::ShrinkHole");
   UnsignedCharImageType::Pointer binaryHoleImage = UnsignedCharImageType::New();
-  this->CreateBinaryImage(binaryHoleImage, 255, 0);
+  {
+    MASK_TRACE_SCOPE("Mask::ShrinkHole: binary conversion");
+    this->CreateBinaryImage(binaryHoleImage, 255, 0);
+  }
 
 //   std::cout << "binaryHoleImage: " << std::endl;
 //   ITKHelpers::PrintImage(binaryHoleImage.GetPointer());
@@ -432,7 +645,10 @@ void Mask::ShrinkHole(const unsigned int kernelRadius)
   BinaryErodeImageFilterType::Pointer erodeFilter = BinaryErodeImageFilterType::New();
   erodeFilter->SetInput(binaryHoleImage);
   erodeFilter->SetKernel(structuringElement);
-  erodeFilter->Update();
+  {
+    MASK_TRACE_SCOPE("Mask::ShrinkHole: erode");
+    erodeFilter->Update();
+  }
 
 //   std::cout << "erodeFilter output: " << std::endl;
 //   ITKHelpers::PrintImage(erodeFilter->GetOutput());
@@ -444,8 +660,11 @@ void Mask::ShrinkHole(const unsigned int kernelRadius)
 void Mask::CreateImage(UnsignedCharImageType* const image, const unsigned char holeColor,
                        const unsigned char validColor, const unsigned char undeterminedColor)
 {
+  MASK_INSTRUMENT_OPERATION("Mask::CreateImage");
   image->SetRegions(this->GetLargestPossibleRegion());
   image->Allocate();
+  MASK_INSTRUMENT_PIXELS(this->GetLargestPossibleRegion().GetNumberOfPixels());
+  MASK_INSTRUMENT_BYTES(this->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(UnsignedCharImageType::PixelType));
 
   itk::ImageRegionIterator<UnsignedCharImageType>
       binaryImageIterator(image, image->GetLargestPossibleRegion());
@@ -471,6 +690,7 @@ void Mask::CreateImage(UnsignedCharImageType* const image, const unsigned char h
 void Mask::CreateBinaryImage(UnsignedCharImageType* const image, const unsigned char holeColor,
                             const unsigned char validColor)
 {
+  MASK_INSTRUMENT_OPERATION("Mask::CreateBinaryImage");
   CreateImage(image, holeColor, validColor, validColor);
 }
 
@@ -611,11 +831,15 @@ std::vector<itk::Offset<2> > Mask::GetHole8NeighborOffsets(const itk::Index<2>&
 void Mask::MarkAsHole(const itk::Index<2>& pixel)
 {
   this->SetPixel(pixel, HoleMaskPixelTypeEnum::HOLE);
+  itk::Size<2> pixelSize = {{1,1}};
+  this->MarkModifiedRegion(itk::ImageRegion<2>(pixel, pixelSize));
 }
 
 void Mask::MarkAsValid(const itk::Index<2>& pixel)
 {
   this->SetPixel(pixel, HoleMaskPixelTypeEnum::VALID);
+  itk::Size<2> pixelSize = {{1,1}};
+  this->MarkModifiedRegion(itk::ImageRegion<2>(pixel, pixelSize));
 }
 
 bool Mask::HasValid4Neighbor(const itk::Index<2>& pixel)
@@ -664,61 +888,336 @@ void Mask::KeepLargestHole()
 
 unsigned int Mask::CountValidPatches(const unsigned int patchRadius) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::CountValidPatches");
+  std::shared_ptr<const PatchCenterMapType> validPatchCenterMap = this->GetValidPatchCenterMap(patchRadius);
+  MASK_INSTRUMENT_PIXELS(validPatchCenterMap->size());
 
-  itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(this, this->GetLargestPossibleRegion());
+  return std::count(validPatchCenterMap->begin(), validPatchCenterMap->end(), 1);
+}
 
-  unsigned int counter = 0;
-  // std::cout << "CountValidPatches (patch radius " << patchRadius << ")..." << std::endl;
-  while(!maskIterator.IsAtEnd())
+itk::ImageRegion<2> Mask::FindFirstValidPatch(const unsigned int patchRadius)
+{
+  MASK_INSTRUMENT_OPERATION("Mask::FindFirstValidPatch");
+  std::shared_ptr<const PatchCenterMapType> validPatchCenterMap = this->GetValidPatchCenterMap(patchRadius);
+
+  PatchCenterMapType::const_iterator firstCenter =
+      std::find(validPatchCenterMap->begin(), validPatchCenterMap->end(), 1);
+
+  if(firstCenter == validPatchCenterMap->end())
+  {
+    throw std::runtime_error("No valid patches found!");
+  }
+
+  itk::Index<2> center = this->ComputeIndex(firstCenter - validPatchCenterMap->begin());
+  return ITKHelpers::GetRegionInRadiusAroundPixel(center, patchRadius);
+}
+
+void Mask::ClearCachesIfModified() const
+{
+  if(this->GetMTime() != this->CacheMTime)
+  {
+    this->NearestValidPixelMap.reset();
+    this->NearestNonHolePixelMap.reset();
+    this->PatchCenterMaps.clear();
+    this->PatchSamplers.clear();
+    this->RegionPatchSamplers.Clear();
+    this->SpanLists.Clear();
+    this->CacheMTime = this->GetMTime();
+  }
+}
+
+std::shared_ptr<const Mask::NearestPixelMapType> Mask::GetNearestValidPixelMap() const
+{
+  MASK_INSTRUMENT_OPERATION("Mask::GetNearestValidPixelMap");
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> cacheLock(this->CacheMutex);
+  this->ClearCachesIfModified();
+
+  if(!this->NearestValidPixelMap)
+  {
+    std::shared_ptr<NearestPixelMapType> nearestValidPixelMap = std::make_shared<NearestPixelMapType>();
+    ComputeNearestPixelMap(this, [](const HoleMaskPixelTypeEnum pixel)
+                                 {return pixel == HoleMaskPixelTypeEnum::VALID;},
+                           *nearestValidPixelMap);
+    MASK_INSTRUMENT_PIXELS(this->GetLargestPossibleRegion().GetNumberOfPixels());
+    MASK_INSTRUMENT_BYTES(nearestValidPixelMap->size() * sizeof(NearestPixelMapType::value_type));
+    this->NearestValidPixelMap = nearestValidPixelMap;
+  }
+
+  return this->NearestValidPixelMap;
+}
+
+std::shared_ptr<const Mask::NearestPixelMapType> Mask::GetNearestNonHolePixelMap() const
+{
+  MASK_INSTRUMENT_OPERATION("Mask::GetNearestNonHolePixelMap");
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> cacheLock(this->CacheMutex);
+  this->ClearCachesIfModified();
+
+  if(!this->NearestNonHolePixelMap)
+  {
+    std::shared_ptr<NearestPixelMapType> nearestNonHolePixelMap = std::make_shared<NearestPixelMapType>();
+    ComputeNearestPixelMap(this, [](const HoleMaskPixelTypeEnum pixel)
+                                 {return pixel != HoleMaskPixelTypeEnum::HOLE;},
+                           *nearestNonHolePixelMap);
+    MASK_INSTRUMENT_PIXELS(this->GetLargestPossibleRegion().GetNumberOfPixels());
+    MASK_INSTRUMENT_BYTES(nearestNonHolePixelMap->size() * sizeof(NearestPixelMapType::value_type));
+    this->NearestNonHolePixelMap = nearestNonHolePixelMap;
+  }
+
+  return this->NearestNonHolePixelMap;
+}
+
+bool Mask::FindNearestValidPixel(const itk::Index<2>& pixel, itk::Index<2>& nearestValidPixel) const
+{
+  std::shared_ptr<const NearestPixelMapType> nearestValidPixelMap = this->GetNearestValidPixelMap();
+
+  itk::OffsetValueType nearestOffset = (*nearestValidPixelMap)[this->ComputeOffset(pixel)];
+  if(nearestOffset < 0)
+  {
+    return false;
+  }
+
+  nearestValidPixel = this->ComputeIndex(nearestOffset);
+  return true;
+}
+
+std::shared_ptr<const Mask::PatchCenterMapType> Mask::GetPatchCenterMap(const HoleMaskPixelTypeEnum& pixelType,
+                                                                        const unsigned int patchRadius) const
+{
+  MASK_INSTRUMENT_OPERATION("Mask::GetPatchCenterMap");
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> cacheLock(this->CacheMutex);
+  this->ClearCachesIfModified();
+
+  std::shared_ptr<const PatchCenterMapType>& cachedPatchCenterMap =
+      this->PatchCenterMaps[PatchCenterMapKeyType(pixelType, patchRadius)];
+  if(!cachedPatchCenterMap)
+  {
+    std::shared_ptr<PatchCenterMapType> patchCenterMap = std::make_shared<PatchCenterMapType>();
+    ComputePatchCenterMap(this, pixelType, patchRadius, *patchCenterMap);
+    MASK_INSTRUMENT_PIXELS(this->GetLargestPossibleRegion().GetNumberOfPixels());
+    MASK_INSTRUMENT_BYTES(patchCenterMap->size() * sizeof(PatchCenterMapType::value_type));
+    cachedPatchCenterMap = patchCenterMap;
+  }
+
+  return cachedPatchCenterMap;
+}
+
+std::shared_ptr<const Mask::PatchCenterMapType> Mask::GetValidPatchCenterMap(const unsigned int patchRadius) const
+{
+  MASK_INSTRUMENT_OPERATION("Mask::GetValidPatchCenterMap");
+  return this->GetPatchCenterMap(HoleMaskPixelTypeEnum::VALID, patchRadius);
+}
+
+std::shared_ptr<const MaskPatchSampler> Mask::GetPatchSampler(const HoleMaskPixelTypeEnum& pixelType,
+                                                              const unsigned int patchRadius) const
+{
+  MASK_INSTRUMENT_OPERATION("Mask::GetPatchSampler");
+  const PatchCenterMapKeyType key(pixelType, patchRadius);
+
+  itk::ModifiedTimeType cacheMTime = 0;
   {
-    itk::ImageRegion<2> region =
-        ITKHelpers::GetRegionInRadiusAroundPixel(maskIterator.GetIndex(), patchRadius);
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> cacheLock(this->CacheMutex);
+    this->ClearCachesIfModified();
+    std::map<PatchCenterMapKeyType, std::shared_ptr<const MaskPatchSampler> >::const_iterator cachedSampler =
+        this->PatchSamplers.find(key);
+    if(cachedSampler != this->PatchSamplers.end())
+    {
+      return cachedSampler->second;
+    }
+    cacheMTime = this->CacheMTime;
+  }
+
+  // The sampler reads the patch center map, which takes CacheMutex itself, so it is built without holding it.
+  std::shared_ptr<const MaskPatchSampler> sampler =
+      std::make_shared<MaskPatchSampler>(this, pixelType, patchRadius);
 
-    if(this->IsValid(region))
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> cacheLock(this->CacheMutex);
+    this->ClearCachesIfModified();
+    if(this->CacheMTime == cacheMTime)
     {
-      counter++;
+      this->PatchSamplers.insert(std::make_pair(key, sampler));
     }
-    ++maskIterator;
   }
 
-  //std::cout << "There were " << counter << " valid patches." << std::endl;
-  return counter;
+  return sampler;
 }
 
-itk::ImageRegion<2> Mask::FindFirstValidPatch(const unsigned int patchRadius)
+std::shared_ptr<const MaskPatchSampler> Mask::GetPatchSampler(const HoleMaskPixelTypeEnum& pixelType,
+                                                              const unsigned int patchRadius,
+                                                              const itk::ImageRegion<2>& searchRegion) const
 {
-  itk::ImageRegionConstIteratorWithIndex<Mask>
-      maskIterator(this, this->GetLargestPossibleRegion());
+  MASK_INSTRUMENT_OPERATION("Mask::GetPatchSampler");
+  const RegionPatchSamplerKeyType key(pixelType, patchRadius, searchRegion.GetIndex()[0], searchRegion.GetIndex()[1],
+                                     searchRegion.GetSize()[0], searchRegion.GetSize()[1]);
 
-  while(!maskIterator.IsAtEnd())
+  itk::ModifiedTimeType cacheMTime = 0;
   {
-    itk::ImageRegion<2> region =
-        ITKHelpers::GetRegionInRadiusAroundPixel(maskIterator.GetIndex(), patchRadius);
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> cacheLock(this->CacheMutex);
+    this->ClearCachesIfModified();
+    std::shared_ptr<const MaskPatchSampler> cachedSampler = this->RegionPatchSamplers.Find(key);
+    if(cachedSampler)
+    {
+      return cachedSampler;
+    }
+    cacheMTime = this->CacheMTime;
+  }
+
+  // Built without holding CacheMutex, like the whole mask samplers.
+  std::shared_ptr<const MaskPatchSampler> sampler =
+      std::make_shared<MaskPatchSampler>(this, pixelType, patchRadius, searchRegion);
 
-    if(this->IsValid(region))
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> cacheLock(this->CacheMutex);
+    this->ClearCachesIfModified();
+    if(this->CacheMTime == cacheMTime)
     {
-      return region;
+      this->RegionPatchSamplers.Insert(key, sampler);
     }
+  }
 
-    ++maskIterator;
+  return sampler;
+}
+
+std::shared_ptr<const Mask::SpanListType> Mask::GetSpans(const HoleMaskPixelTypeEnum& pixelType,
+                                                         const itk::ImageRegion<2>& region) const
+{
+  MASK_INSTRUMENT_OPERATION("Mask::GetSpans");
+  if(!this->GetBufferedRegion().IsInside(region))
+  {
+    std::stringstream ss;
+    ss << "Mask::GetSpans: region " << region << " is not inside the mask " << this->GetBufferedRegion();
+    throw std::runtime_error(ss.str());
   }
 
-  throw std::runtime_error("No valid patches found!");
+  const SpanListKeyType key(pixelType, region.GetIndex()[0], region.GetIndex()[1],
+                            region.GetSize()[0], region.GetSize()[1]);
+
+  itk::ModifiedTimeType cacheMTime = 0;
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> cacheLock(this->CacheMutex);
+    this->ClearCachesIfModified();
+    std::shared_ptr<const SpanListType> cachedSpans = this->SpanLists.Find(key);
+    if(cachedSpans)
+    {
+      return cachedSpans;
+    }
+    cacheMTime = this->CacheMTime;
+  }
+
+  // Scan the region without holding the lock, so other lookups are not blocked meanwhile.
+  std::shared_ptr<SpanListType> spans = std::make_shared<SpanListType>();
+
+  const itk::OffsetValueType width = region.GetSize()[0];
+  const itk::OffsetValueType height = region.GetSize()[1];
+  for(itk::OffsetValueType y = 0; y < height; ++y)
+  {
+    const itk::Index<2> rowStart = {{region.GetIndex()[0], region.GetIndex()[1] + y}};
+    const PixelType* const row = this->GetBufferPointer() + this->ComputeOffset(rowStart);
+
+    itk::OffsetValueType x = 0;
+    while(x < width)
+    {
+      if(row[x] != pixelType)
+      {
+        ++x;
+        continue;
+      }
+
+      Span span;
+      span.X = x;
+      span.Y = y;
+      while(x < width && row[x] == pixelType)
+      {
+        ++x;
+      }
+      span.Length = static_cast<itk::SizeValueType>(x - span.X);
+      spans->push_back(span);
+    }
+  }
+  MASK_INSTRUMENT_PIXELS(region.GetNumberOfPixels());
+  MASK_INSTRUMENT_BYTES(spans->capacity() * sizeof(Span));
+
+  {
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> cacheLock(this->CacheMutex);
+    this->ClearCachesIfModified();
+    if(this->CacheMTime == cacheMTime)
+    {
+      this->SpanLists.Insert(key, spans);
+    }
+  }
+
+  return spans;
+}
+
+std::shared_ptr<const Mask::SpanListType> Mask::GetHoleSpans(const itk::ImageRegion<2>& region) const
+{
+  MASK_INSTRUMENT_OPERATION("Mask::GetHoleSpans");
+  return this->GetSpans(HoleMaskPixelTypeEnum::HOLE, region);
 }
 
 void Mask::SetHole(const itk::Index<2>& index)
 {
   this->SetPixel(index, HoleMaskPixelTypeEnum::HOLE);
+  itk::Size<2> pixelSize = {{1,1}};
+  this->MarkModifiedRegion(itk::ImageRegion<2>(index, pixelSize));
 }
 
 void Mask::SetValid(const itk::Index<2>& index)
 {
   this->SetPixel(index, HoleMaskPixelTypeEnum::VALID);
+  itk::Size<2> pixelSize = {{1,1}};
+  this->MarkModifiedRegion(itk::ImageRegion<2>(index, pixelSize));
 }
 
 void Mask::SetValid(const itk::ImageRegion<2>& region)
 {
   ITKHelpers::SetRegionToConstant(this, region, HoleMaskPixelTypeEnum::VALID);
+  this->MarkModifiedRegion(region);
+}
+
+void Mask::MarkModifiedRegion(const itk::ImageRegion<2>& region)
+{
+  itk::ImageRegion<2> modifiedRegion = region;
+  if(modifiedRegion.Crop(this->GetLargestPossibleRegion()) && modifiedRegion.GetNumberOfPixels() > 0)
+  {
+    if(this->ModifiedRegion.GetNumberOfPixels() == 0)
+    {
+      this->ModifiedRegion = modifiedRegion;
+    }
+    else
+    {
+      // Grow the recorded region to the bounding box of both regions.
+      itk::Index<2> corner;
+      itk::Size<2> size;
+      for(unsigned int dimension = 0; dimension < 2; ++dimension)
+      {
+        const itk::IndexValueType first = std::min(this->ModifiedRegion.GetIndex()[dimension],
+                                                   modifiedRegion.GetIndex()[dimension]);
+        const itk::IndexValueType end = std::max(this->ModifiedRegion.GetUpperIndex()[dimension],
+                                                 modifiedRegion.GetUpperIndex()[dimension]) + 1;
+        corner[dimension] = first;
+        size[dimension] = static_cast<itk::SizeValueType>(end - first);
+      }
+      this->ModifiedRegion = itk::ImageRegion<2>(corner, size);
+    }
+  }
+
+  this->Modified();
+}
+
+itk::ImageRegion<2> Mask::GetModifiedRegion() const
+{
+  return this->ModifiedRegion;
+}
+
+bool Mask::HasModifiedRegion() const
+{
+  return this->ModifiedRegion.GetNumberOfPixels() > 0;
+}
+
+void Mask::AcknowledgeModifiedRegion()
+{
+  this->ModifiedRegion = itk::ImageRegion<2>();
 }
 
 std::ostream& operator<<(std::ostream& output, const HoleMaskPixelTypeEnum &pixelType)
@@ -30,8 +30,20 @@
 #ifndef MASK_H
 #define MASK_H
 
+// STL
+#include <list>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 // ITK
 #include "itkImage.h"
+#include "itkMutexLockHolder.h"
+#include "itkSimpleFastMutexLock.h"
+
+class MaskPatchSampler;
 
 /** The pixels in the mask have only these possible values. */
 enum class HoleMaskPixelTypeEnum {HOLE, VALID, UNDETERMINED};
@@ -48,7 +60,7 @@ struct HolePixelValueWrapper
 {
   HolePixelValueWrapper(const T value) : Value(value){}
 
-  operator T()
+  operator T() const
   {
     return this->Value;
   }
@@ -64,7 +76,7 @@ struct ValidPixelValueWrapper
 {
   ValidPixelValueWrapper(const T value) : Value(value){}
 
-  operator T()
+  operator T() const
   {
     return this->Value;
   }
@@ -163,6 +175,22 @@ public:
   /** Copy the holes from a mask.*/
   void CopyHolesFrom(const Mask* const inputMask);
 
+  /** Record that the pixels of 'region' were changed, and call Modified(). The Mask functions that change
+    * pixels record their own changes; code that writes the pixels directly (e.g. a brush in an editor)
+    * should call this, so overlays can be updated in just the changed region. This is not thread-safe:
+    * code that writes pixels from several threads should record the union of their changes once afterwards. */
+  void MarkModifiedRegion(const itk::ImageRegion<2>& region);
+
+  /** Get the smallest region that contains every region recorded since the last
+    * AcknowledgeModifiedRegion(). Its size is 0 if nothing was recorded. */
+  itk::ImageRegion<2> GetModifiedRegion() const;
+
+  /** Determine if any region was recorded since the last AcknowledgeModifiedRegion().*/
+  bool HasModifiedRegion() const;
+
+  /** Forget the recorded regions, e.g. once every overlay of the mask has been updated.*/
+  void AcknowledgeModifiedRegion();
+
   /** Create holes from specified pixels in an image.*/
   template <typename TImage>
   void CreateHolesFromValue(const TImage* const inputImage,
@@ -309,7 +337,7 @@ public:
   /** Count valid pixels in a region.*/
   unsigned int CountValidPixels(const itk::ImageRegion<2>& region) const;
 
-  /** Count valid pixels in a region.*/
+  /** Count the patches of radius 'patchRadius' that are entirely inside the mask and entirely valid.*/
   unsigned int CountValidPatches(const unsigned int patchRadius) const;
 
   /** Find the first valid patch of radius 'patchRadius' in raster scan order.*/
@@ -332,8 +360,136 @@ public:
   /** Mark the pixel as a valid pixel.*/
   void MarkAsValid(const itk::Index<2>& pixel);
 
+  /** For every pixel, the offset into the mask buffer of the closest (Euclidean) valid pixel,
+    * or -1 if the mask has no valid pixels. Valid pixels map to themselves. */
+  typedef std::vector<itk::OffsetValueType> NearestPixelMapType;
+
+  /** Get the nearest valid pixel map. It is computed in linear time on first use and cached until
+    * the mask is modified. If you write to the mask buffer directly, call Modified() afterwards. */
+  std::shared_ptr<const NearestPixelMapType> GetNearestValidPixelMap() const;
+
+  /** Find the valid pixel closest to 'pixel'. Returns false if the mask has no valid pixels.*/
+  bool FindNearestValidPixel(const itk::Index<2>& pixel, itk::Index<2>& nearestValidPixel) const;
+
+  /** Get the map of the closest pixel that is not a hole (valid or undetermined). The distance from a
+    * hole pixel to this pixel is the distance to the edge of the hole. Cached like GetNearestValidPixelMap(). */
+  std::shared_ptr<const NearestPixelMapType> GetNearestNonHolePixelMap() const;
+
+  /** One entry per pixel in buffer order. An entry is 1 if the patch of a particular radius centered
+    * at that pixel is entirely inside the mask and all of its pixels have a particular value, and 0 otherwise. */
+  typedef std::vector<unsigned char> PatchCenterMapType;
+
+  /** Get the map of the centers of the patches of radius 'patchRadius' whose pixels are all 'pixelType'.
+    * It is computed in linear time (independent of the radius) by eroding the set of 'pixelType' pixels,
+    * and cached per radius until the mask is modified. */
+  std::shared_ptr<const PatchCenterMapType> GetPatchCenterMap(const HoleMaskPixelTypeEnum& pixelType,
+                                                              const unsigned int patchRadius) const;
+
+  /** Get the map of the centers of the fully valid patches of radius 'patchRadius'.*/
+  std::shared_ptr<const PatchCenterMapType> GetValidPatchCenterMap(const unsigned int patchRadius) const;
+
+  /** Get a sampler of the patches of radius 'patchRadius' anywhere in the mask whose pixels are all 'pixelType'.
+    * Building it takes linear time, so it is cached per radius until the mask is modified. */
+  std::shared_ptr<const MaskPatchSampler> GetPatchSampler(const HoleMaskPixelTypeEnum& pixelType,
+                                                          const unsigned int patchRadius) const;
+
+  /** Get a sampler of the patches of radius 'patchRadius' inside 'searchRegion' whose pixels are all 'pixelType'.
+    * Building it takes time linear in the size of the region, so the samplers of the most recently used
+    * regions are cached until the mask is modified. */
+  std::shared_ptr<const MaskPatchSampler> GetPatchSampler(const HoleMaskPixelTypeEnum& pixelType,
+                                                          const unsigned int patchRadius,
+                                                          const itk::ImageRegion<2>& searchRegion) const;
+
+  /** A run of consecutive pixels in one row of a region. X and Y are relative to the corner of the region,
+    * so a span list can be applied to any region of the same size. */
+  struct Span
+  {
+    itk::OffsetValueType X;
+    itk::OffsetValueType Y;
+    itk::SizeValueType Length;
+  };
+
+  typedef std::vector<Span> SpanListType;
+
+  /** Get the runs of 'pixelType' pixels in 'region' (which must be inside the mask), in buffer order.
+    * The lists are cached per region until the mask is modified. */
+  std::shared_ptr<const SpanListType> GetSpans(const HoleMaskPixelTypeEnum& pixelType,
+                                               const itk::ImageRegion<2>& region) const;
+
+  /** Get the runs of hole pixels in 'region'.*/
+  std::shared_ptr<const SpanListType> GetHoleSpans(const itk::ImageRegion<2>& region) const;
+
 private:
 
+  /** A map that holds at most 'maximumSize' values. Inserting into a full cache drops the least recently
+    * used value. Not thread-safe; the mask guards its caches with CacheMutex. */
+  template <typename TKey, typename TValue>
+  class RecentlyUsedCache
+  {
+  public:
+    explicit RecentlyUsedCache(const std::size_t maximumSize) : MaximumSize(maximumSize){}
+
+    /** Get the value of 'key' and mark it as the most recently used, or return TValue() if there is none.*/
+    TValue Find(const TKey& key);
+
+    void Insert(const TKey& key, const TValue& value);
+
+    void Clear();
+
+    std::size_t GetSize() const;
+
+  private:
+    typedef std::list<TKey> UseOrderType;
+
+    std::size_t MaximumSize;
+
+    /** The keys, most recently used first.*/
+    UseOrderType UseOrder;
+
+    std::map<TKey, std::pair<TValue, typename UseOrderType::iterator> > Values;
+  };
+
+  /** Discard the cached derived data if the mask has been modified since it was computed.
+    * The caller must hold CacheMutex. */
+  void ClearCachesIfModified() const;
+
+  /** Guards the cached data below, which may be built lazily from const member functions. */
+  mutable itk::SimpleFastMutexLock CacheMutex;
+
+  /** The modified time of the mask when the cached data was computed.*/
+  mutable itk::ModifiedTimeType CacheMTime = 0;
+
+  mutable std::shared_ptr<const NearestPixelMapType> NearestValidPixelMap;
+
+  mutable std::shared_ptr<const NearestPixelMapType> NearestNonHolePixelMap;
+
+  typedef std::pair<HoleMaskPixelTypeEnum, unsigned int> PatchCenterMapKeyType;
+  mutable std::map<PatchCenterMapKeyType, std::shared_ptr<const PatchCenterMapType> > PatchCenterMaps;
+
+  /** Keyed like PatchCenterMaps.*/
+  mutable std::map<PatchCenterMapKeyType, std::shared_ptr<const MaskPatchSampler> > PatchSamplers;
+
+  /** (pixel type, region corner, region size)*/
+  typedef std::tuple<HoleMaskPixelTypeEnum, itk::IndexValueType, itk::IndexValueType,
+                     itk::SizeValueType, itk::SizeValueType> SpanListKeyType;
+  mutable RecentlyUsedCache<SpanListKeyType, std::shared_ptr<const SpanListType> > SpanLists{MaximumNumberOfSpanLists};
+
+  /** (pixel type, patch radius, search region corner, search region size)*/
+  typedef std::tuple<HoleMaskPixelTypeEnum, unsigned int, itk::IndexValueType, itk::IndexValueType,
+                     itk::SizeValueType, itk::SizeValueType> RegionPatchSamplerKeyType;
+  mutable RecentlyUsedCache<RegionPatchSamplerKeyType, std::shared_ptr<const MaskPatchSampler> >
+      RegionPatchSamplers{MaximumNumberOfRegionPatchSamplers};
+
+  /** The union of the regions recorded by MarkModifiedRegion() since the last AcknowledgeModifiedRegion().*/
+  itk::ImageRegion<2> ModifiedRegion;
+
+  /** The number of span lists kept, so that visiting many regions of an unchanging mask does not grow
+    * the cache without bound. */
+  static const unsigned int MaximumNumberOfSpanLists = 4096;
+
+  /** The number of region samplers kept. Each one takes memory proportional to its region.*/
+  static const unsigned int MaximumNumberOfRegionPatchSamplers = 256;
+
   Mask(const Self &);    //purposely not implemented
   void operator=(const Self &); //purposely not implemented
 
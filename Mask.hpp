@@ -21,6 +21,10 @@
 
 #include "Mask.h" // Appease syntax parser
 
+// Custom
+#include "MaskInstrumentation.h"
+#include "MaskSelect.h"
+
 // ITK
 #include "itkImageRegionIterator.h"
 
@@ -30,6 +34,7 @@
 template<typename TImage, typename TColor>
 void Mask::ApplyToRGBImage(TImage* const image, const TColor& color) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::ApplyToRGBImage");
   // Using generics, we allow any Color class that has .red(), .green(), and .blue() member functions
   // to be used to specify the color.
   if(image->GetLargestPossibleRegion() != this->GetLargestPossibleRegion())
@@ -50,23 +55,15 @@ void Mask::ApplyToRGBImage(TImage* const image, const TColor& color) const
     holeValue[1] = color.green();
     holeValue[2] = color.blue();
   }
+  MASK_INSTRUMENT_PIXELS(this->GetLargestPossibleRegion().GetNumberOfPixels());
 
-  itk::ImageRegionConstIterator<Mask> maskIterator(this, this->GetLargestPossibleRegion());
-
-  while(!maskIterator.IsAtEnd())
-  {
-    if(this->IsHole(maskIterator.GetIndex()))
-    {
-      image->SetPixel(maskIterator.GetIndex(), holeValue);
-    }
-
-    ++maskIterator;
-  }
+  MaskSelect::Fill(this, HoleMaskPixelTypeEnum::HOLE, holeValue, image);
 }
 
 template<typename TImage>
 void Mask::ApplyToImage(TImage* const image, const typename TImage::PixelType& color) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::ApplyToImage");
   if(image->GetLargestPossibleRegion() != this->GetLargestPossibleRegion())
   {
     std::cerr << "Image and mask must be the same size!" << std::endl
@@ -81,6 +78,7 @@ template<typename TImage>
 void Mask::ApplyRegionToImageRegion(const itk::ImageRegion<2>& maskRegion, TImage* const image,
                                     const itk::ImageRegion<2>& imageRegion, const typename TImage::PixelType& color) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::ApplyRegionToImageRegion");
   if(maskRegion.GetSize() != imageRegion.GetSize())
     {
     std::cerr << "imageRegion and maskRegion must be the same size!" << std::endl
@@ -88,25 +86,15 @@ void Mask::ApplyRegionToImageRegion(const itk::ImageRegion<2>& maskRegion, TImag
               << "Mask region: " << maskRegion << std::endl;
     return;
     }
+  MASK_INSTRUMENT_PIXELS(maskRegion.GetNumberOfPixels());
 
-  itk::ImageRegionConstIterator<Mask> maskIterator(this, maskRegion);
-  itk::ImageRegionIterator<TImage> imageIterator(image, imageRegion);
-
-  while(!maskIterator.IsAtEnd())
-  {
-    if(this->IsHole(maskIterator.GetIndex()))
-    {
-      imageIterator.Set(color);
-    }
-
-    ++maskIterator;
-    ++imageIterator;
-  }
+  MaskSelect::Fill(this, maskRegion, HoleMaskPixelTypeEnum::HOLE, color, image, imageRegion);
 }
 
 template<typename TImage>
 void Mask::ApplyToScalarImage(TImage* const image, typename TImage::PixelType holeValue) const
 {
+  MASK_INSTRUMENT_OPERATION("Mask::ApplyToScalarImage");
   if(image->GetLargestPossibleRegion() != this->GetLargestPossibleRegion())
   {
     std::cerr << "Image and mask must be the same size!" << std::endl
@@ -114,26 +102,20 @@ void Mask::ApplyToScalarImage(TImage* const image, typename TImage::PixelType ho
               << "Mask region: " << this->GetLargestPossibleRegion() << std::endl;
     return;
   }
+  MASK_INSTRUMENT_PIXELS(this->GetLargestPossibleRegion().GetNumberOfPixels());
 
-  itk::ImageRegionConstIterator<Mask> maskIterator(this, this->GetLargestPossibleRegion());
-
-  while(!maskIterator.IsAtEnd())
-  {
-    if(this->IsHole(maskIterator.GetIndex()))
-    {
-      image->SetPixel(maskIterator.GetIndex(), holeValue);
-    }
-
-    ++maskIterator;
-  }
+  MaskSelect::Fill(this, HoleMaskPixelTypeEnum::HOLE, holeValue, image);
 }
 
 template<typename TImage>
 void Mask::CreateFromImage(const TImage* const image, const HolePixelValueWrapper<typename TImage::PixelType>& holeValue,
                            const ValidPixelValueWrapper<typename TImage::PixelType>& validValue)
 {
+  MASK_INSTRUMENT_OPERATION("Mask::CreateFromImage");
   this->SetRegions(image->GetLargestPossibleRegion());
   this->Allocate();
+  MASK_INSTRUMENT_PIXELS(this->GetLargestPossibleRegion().GetNumberOfPixels());
+  MASK_INSTRUMENT_BYTES(this->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(PixelType));
 
   itk::ImageRegionConstIterator<TImage> imageIterator(image, image->GetLargestPossibleRegion());
 
@@ -162,6 +144,8 @@ void Mask::CreateFromImage(const TImage* const image, const HolePixelValueWrappe
 
     ++imageIterator;
   }
+  this->MarkModifiedRegion(this->GetLargestPossibleRegion());
+
   std::cout << "Mask::CreateFromImage: There were "
                << holeCounter << " hole pixels." << std::endl
                << validCounter << " valid pixels." << std::endl
@@ -172,7 +156,9 @@ template <typename TImage>
 void Mask::CreateHolesFromValue(const TImage* const inputImage,
                                 const typename TImage::PixelType value)
 {
+  MASK_INSTRUMENT_OPERATION("Mask::CreateHolesFromValue");
   assert(inputImage->GetLargestPossibleRegion() == this->GetLargestPossibleRegion());
+  MASK_INSTRUMENT_PIXELS(this->GetLargestPossibleRegion().GetNumberOfPixels());
 
   itk::ImageRegionConstIterator<TImage> inputIterator(inputImage, inputImage->GetLargestPossibleRegion());
   itk::ImageRegionIterator<Mask> thisIterator(this, this->GetLargestPossibleRegion());
@@ -186,13 +172,16 @@ void Mask::CreateHolesFromValue(const TImage* const inputImage,
     ++inputIterator;
     ++thisIterator;
   }
+  this->MarkModifiedRegion(this->GetLargestPossibleRegion());
 }
 
 template <typename TImage>
 void Mask::CreateValidPixelsFromValue(const TImage* const inputImage,
                                       const typename TImage::PixelType value)
 {
+  MASK_INSTRUMENT_OPERATION("Mask::CreateValidPixelsFromValue");
   assert(inputImage->GetLargestPossibleRegion() == this->GetLargestPossibleRegion());
+  MASK_INSTRUMENT_PIXELS(this->GetLargestPossibleRegion().GetNumberOfPixels());
 
   itk::ImageRegionConstIterator<TImage> inputIterator(inputImage, inputImage->GetLargestPossibleRegion());
   itk::ImageRegionIterator<Mask> thisIterator(this, this->GetLargestPossibleRegion());
@@ -206,6 +195,55 @@ void Mask::CreateValidPixelsFromValue(const TImage* const inputImage,
     ++inputIterator;
     ++thisIterator;
   }
+  this->MarkModifiedRegion(this->GetLargestPossibleRegion());
+}
+
+template <typename TKey, typename TValue>
+TValue Mask::RecentlyUsedCache<TKey, TValue>::Find(const TKey& key)
+{
+  typename std::map<TKey, std::pair<TValue, typename UseOrderType::iterator> >::iterator value = this->Values.find(key);
+  if(value == this->Values.end())
+  {
+    return TValue();
+  }
+
+  this->UseOrder.splice(this->UseOrder.begin(), this->UseOrder, value->second.second);
+  return value->second.first;
+}
+
+template <typename TKey, typename TValue>
+void Mask::RecentlyUsedCache<TKey, TValue>::Insert(const TKey& key, const TValue& value)
+{
+  typename std::map<TKey, std::pair<TValue, typename UseOrderType::iterator> >::iterator existingValue =
+      this->Values.find(key);
+  if(existingValue != this->Values.end())
+  {
+    existingValue->second.first = value;
+    this->UseOrder.splice(this->UseOrder.begin(), this->UseOrder, existingValue->second.second);
+    return;
+  }
+
+  if(this->Values.size() >= this->MaximumSize && !this->UseOrder.empty())
+  {
+    this->Values.erase(this->UseOrder.back());
+    this->UseOrder.pop_back();
+  }
+
+  this->UseOrder.push_front(key);
+  this->Values.insert(std::make_pair(key, std::make_pair(value, this->UseOrder.begin())));
+}
+
+template <typename TKey, typename TValue>
+void Mask::RecentlyUsedCache<TKey, TValue>::Clear()
+{
+  this->Values.clear();
+  this->UseOrder.clear();
+}
+
+template <typename TKey, typename TValue>
+std::size_t Mask::RecentlyUsedCache<TKey, TValue>::GetSize() const
+{
+  return this->Values.size();
 }
 
 template <typename TPixel>
@@ -213,6 +251,7 @@ void Mask::ReadFromImage(const std::string& filename,
                          const HolePixelValueWrapper<TPixel>& holeValue,
                          const ValidPixelValueWrapper<TPixel>& validValue)
 {
+  MASK_INSTRUMENT_OPERATION("Mask::ReadFromImage");
   std::cout << "Reading mask from image: " << filename << std::endl;
 
   // Ensure the input image can be interpreted as a mask.
@@ -233,10 +272,15 @@ void Mask::ReadFromImage(const std::string& filename,
   typedef  itk::ImageFileReader<ImageType> ImageReaderType;
   ImageReaderType::Pointer imageReader = ImageReaderType::New();
   imageReader->SetFileName(filename);
-  imageReader->Update();
+  {
+    MASK_TRACE_SCOPE("Mask::ReadFromImage: decode");
+    imageReader->Update();
+  }
+  MASK_INSTRUMENT_BYTES(imageReader->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(ReadPixelType));
 
   this->SetRegions(imageReader->GetOutput()->GetLargestPossibleRegion());
   this->Allocate();
+  MASK_INSTRUMENT_BYTES(this->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(PixelType));
 
   CreateHolesFromValue(imageReader->GetOutput(),
                        static_cast<ReadPixelType>(holeValue.Value));
@@ -0,0 +1,157 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#include "MaskAsyncWriter.h"
+
+// STL
+#include <stdexcept>
+
+MaskAsyncWriter::MaskAsyncWriter(const std::size_t maximumQueueLength, const QueuePolicyEnum queuePolicy) :
+  MaximumQueueLength(maximumQueueLength), QueuePolicy(queuePolicy)
+{
+  if(maximumQueueLength == 0)
+  {
+    throw std::runtime_error("MaskAsyncWriter: the maximum queue length must be at least 1!");
+  }
+
+  this->WriterThread = std::thread(&MaskAsyncWriter::ProcessQueue, this);
+}
+
+MaskAsyncWriter::~MaskAsyncWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->QueueMutex);
+    this->Stopping = true;
+  }
+  this->WriteQueued.notify_one();
+
+  this->WriterThread.join();
+}
+
+bool MaskAsyncWriter::Enqueue(WriteFunctionType write)
+{
+  {
+    std::unique_lock<std::mutex> lock(this->QueueMutex);
+    if(this->Queue.size() >= this->MaximumQueueLength)
+    {
+      switch(this->QueuePolicy)
+      {
+        case QueuePolicyEnum::BLOCK:
+          this->WriteFinished.wait(lock, [this]{ return this->Queue.size() < this->MaximumQueueLength; });
+          break;
+        case QueuePolicyEnum::DROP_NEWEST:
+          this->NumberOfDroppedWrites++;
+          return false;
+        case QueuePolicyEnum::DROP_OLDEST:
+          this->Queue.pop_front();
+          this->NumberOfDroppedWrites++;
+          break;
+      }
+    }
+
+    this->Queue.push_back(std::move(write));
+  }
+  this->WriteQueued.notify_one();
+
+  return true;
+}
+
+bool MaskAsyncWriter::DropIfFull()
+{
+  std::lock_guard<std::mutex> lock(this->QueueMutex);
+  if(this->QueuePolicy == QueuePolicyEnum::DROP_NEWEST && this->Queue.size() >= this->MaximumQueueLength)
+  {
+    this->NumberOfDroppedWrites++;
+    return true;
+  }
+
+  return false;
+}
+
+void MaskAsyncWriter::Flush()
+{
+  std::unique_lock<std::mutex> lock(this->QueueMutex);
+  this->WriteFinished.wait(lock, [this]{ return this->Queue.empty() && !this->Writing; });
+
+  if(this->FirstError)
+  {
+    std::exception_ptr error = this->FirstError;
+    this->FirstError = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+std::size_t MaskAsyncWriter::GetNumberOfDroppedWrites() const
+{
+  std::lock_guard<std::mutex> lock(this->QueueMutex);
+  return this->NumberOfDroppedWrites;
+}
+
+std::size_t MaskAsyncWriter::GetMaximumQueueLength() const
+{
+  return this->MaximumQueueLength;
+}
+
+MaskAsyncWriter::QueuePolicyEnum MaskAsyncWriter::GetQueuePolicy() const
+{
+  return this->QueuePolicy;
+}
+
+void MaskAsyncWriter::ProcessQueue()
+{
+  std::unique_lock<std::mutex> lock(this->QueueMutex);
+  while(true)
+  {
+    this->WriteQueued.wait(lock, [this]{ return !this->Queue.empty() || this->Stopping; });
+    if(this->Queue.empty())
+    {
+      // Stopping, and everything that was queued has been written.
+      return;
+    }
+
+    WriteFunctionType write = std::move(this->Queue.front());
+    this->Queue.pop_front();
+    this->Writing = true;
+    lock.unlock();
+
+    // Waiting writers can queue as soon as the write is off the queue.
+    this->WriteFinished.notify_all();
+
+    std::exception_ptr error;
+    try
+    {
+      write();
+    }
+    catch(...)
+    {
+      error = std::current_exception();
+    }
+
+    // Release what the write holds (e.g. the region snapshot) before taking the lock.
+    write = nullptr;
+
+    lock.lock();
+    this->Writing = false;
+    if(error && !this->FirstError)
+    {
+      this->FirstError = error;
+    }
+    this->WriteFinished.notify_all();
+  }
+}
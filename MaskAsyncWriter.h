@@ -0,0 +1,123 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/**
+\class MaskAsyncWriter
+\brief Writes masked-region debug images on a background thread. The caller's thread only copies
+       the region (with the holes colored, see MaskOperations::ExtractMaskedRegion); the conversion to
+       RGB and the encoding happen on the writer's thread. Writes are queued in order in a bounded
+       queue, and the queue policy decides what happens when it is full: wait for room, drop the new
+       write, or drop the oldest queued write. Destroying the writer finishes the queued writes.
+*/
+
+#ifndef MaskAsyncWriter_H
+#define MaskAsyncWriter_H
+
+// Custom
+#include "Mask.h"
+
+// STL
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class MaskAsyncWriter
+{
+public:
+  /** What to do with a write when the queue is full.*/
+  enum class QueuePolicyEnum {BLOCK, DROP_NEWEST, DROP_OLDEST};
+
+  typedef std::function<void()> WriteFunctionType;
+
+  explicit MaskAsyncWriter(const std::size_t maximumQueueLength = 16,
+                           const QueuePolicyEnum queuePolicy = QueuePolicyEnum::BLOCK);
+
+  /** Finish the queued writes and stop the writer's thread. Errors from those writes are discarded.*/
+  ~MaskAsyncWriter();
+
+  MaskAsyncWriter(const MaskAsyncWriter&) = delete;
+  MaskAsyncWriter& operator=(const MaskAsyncWriter&) = delete;
+
+  /** Queue a write like MaskOperations::WriteMaskedRegion(). Returns false if the write was dropped.*/
+  template<typename TImage>
+  bool WriteMaskedRegion(const TImage* const image, const Mask* const mask, const itk::ImageRegion<2>& region,
+                         const std::string& filename, const typename TImage::PixelType& holeColor);
+
+  /** Queue a write like MaskOperations::WriteMaskedRegionPNG(). Returns false if the write was dropped.*/
+  template<typename TImage>
+  bool WriteMaskedRegionPNG(const TImage* const image, const Mask* const mask, itk::ImageRegion<2> region,
+                            const std::string& filename, const typename TImage::PixelType& holeColor);
+
+  /** Queue 'write' to be called on the writer's thread. It must not refer to anything the caller
+    * may change or free before it runs. Returns false if the write was dropped.*/
+  bool Enqueue(WriteFunctionType write);
+
+  /** Wait until every queued write has finished. Rethrows the first exception thrown by a write since
+    * the last Flush(). */
+  void Flush();
+
+  /** Get the number of writes that were dropped because the queue was full.*/
+  std::size_t GetNumberOfDroppedWrites() const;
+
+  std::size_t GetMaximumQueueLength() const;
+
+  QueuePolicyEnum GetQueuePolicy() const;
+
+private:
+  void ProcessQueue();
+
+  /** With the DROP_NEWEST policy, count a dropped write and return true if the queue is full, so the
+    * caller can skip snapshotting a region that would be dropped anyway. Otherwise return false.*/
+  bool DropIfFull();
+
+  const std::size_t MaximumQueueLength;
+
+  const QueuePolicyEnum QueuePolicy;
+
+  /** Guards everything below.*/
+  mutable std::mutex QueueMutex;
+
+  /** Signaled when a write is queued or the writer is stopping.*/
+  std::condition_variable WriteQueued;
+
+  /** Signaled when a write finishes, so there may be room in the queue or the queue may be empty.*/
+  std::condition_variable WriteFinished;
+
+  std::deque<WriteFunctionType> Queue;
+
+  /** True while the writer's thread is running a write it took off the queue.*/
+  bool Writing = false;
+
+  bool Stopping = false;
+
+  std::size_t NumberOfDroppedWrites = 0;
+
+  std::exception_ptr FirstError;
+
+  std::thread WriterThread;
+};
+
+#include "MaskAsyncWriter.hpp"
+
+#endif
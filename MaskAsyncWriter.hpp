@@ -0,0 +1,86 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef MaskAsyncWriter_HPP
+#define MaskAsyncWriter_HPP
+
+#include "MaskAsyncWriter.h" // Appease syntax parser
+
+// Custom
+#include "MaskOperations.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// STL
+#include <stdexcept>
+
+template<typename TImage>
+bool MaskAsyncWriter::WriteMaskedRegion(const TImage* const image, const Mask* const mask,
+                                        const itk::ImageRegion<2>& region, const std::string& filename,
+                                        const typename TImage::PixelType& holeColor)
+{
+  if(DropIfFull())
+  {
+    return false;
+  }
+
+  // Snapshot the region now, so the caller is free to change the image and the mask.
+  typename TImage::Pointer maskedRegion = TImage::New();
+  MaskOperations::ExtractMaskedRegion(image, mask, region, holeColor, maskedRegion.GetPointer());
+
+  return Enqueue([maskedRegion, filename]()
+  {
+    typename itk::ImageFileWriter<TImage>::Pointer writer = itk::ImageFileWriter<TImage>::New();
+    writer->SetFileName(filename);
+    writer->SetInput(maskedRegion);
+    writer->Update();
+  });
+}
+
+template<typename TImage>
+bool MaskAsyncWriter::WriteMaskedRegionPNG(const TImage* const image, const Mask* const mask,
+                                           itk::ImageRegion<2> region, const std::string& filename,
+                                           const typename TImage::PixelType& holeColor)
+{
+  region.Crop(image->GetLargestPossibleRegion());
+
+  if(region.GetSize()[0] == 0 || region.GetSize()[1] == 0 )
+  {
+    throw std::runtime_error("Cropped region is 0 in at least one dimension!");
+  }
+
+  if(DropIfFull())
+  {
+    return false;
+  }
+
+  typename TImage::Pointer maskedRegion = TImage::New();
+  MaskOperations::ExtractMaskedRegion(image, mask, region, holeColor, maskedRegion.GetPointer());
+
+  return Enqueue([maskedRegion, filename]()
+  {
+    ITKHelpers::RGBImageType::Pointer rgbImage = ITKHelpers::RGBImageType::New();
+    ITKHelpers::VectorImageToRGBImage(maskedRegion.GetPointer(), rgbImage.GetPointer());
+
+    ITKHelpers::WriteImage(rgbImage.GetPointer(), filename);
+  });
+}
+
+#endif
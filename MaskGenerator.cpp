@@ -0,0 +1,460 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "MaskGenerator.h"
+#include "MaskParallel.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+const float Pi = 3.14159265358979f;
+
+struct Point
+{
+  float X;
+  float Y;
+};
+
+/** Draw a float uniformly distributed in [minValue, maxValue).*/
+float Uniform(MaskRandomState& randomState, const float minValue, const float maxValue)
+{
+  return minValue + (maxValue - minValue) * randomState.NextUniformFloat();
+}
+
+/** Writes shapes into a mask buffer one row span at a time, counting the pixels that become holes.*/
+class SpanRasterizer
+{
+public:
+  SpanRasterizer(HoleMaskPixelTypeEnum* const buffer, const itk::Size<2>& size) :
+    Buffer(buffer), Width(static_cast<long>(size[0])), Height(static_cast<long>(size[1]))
+  {
+  }
+
+  itk::SizeValueType GetNumberOfHolePixels() const
+  {
+    return this->NumberOfHolePixels;
+  }
+
+  void FillDisc(const Point& center, const float radius)
+  {
+    FillRows(center.Y - radius, center.Y + radius, [&](const float y, float& left, float& right)
+             {
+               AddDiscSpan(center, radius, y, left, right);
+             });
+  }
+
+  void FillConvexPolygon(const Point* const points, const unsigned int numberOfPoints)
+  {
+    float top = points[0].Y;
+    float bottom = points[0].Y;
+    for(unsigned int pointId = 1; pointId < numberOfPoints; ++pointId)
+    {
+      top = std::min(top, points[pointId].Y);
+      bottom = std::max(bottom, points[pointId].Y);
+    }
+
+    FillRows(top, bottom, [&](const float y, float& left, float& right)
+             {
+               AddPolygonSpan(points, numberOfPoints, y, left, right);
+             });
+  }
+
+  /** Fill all pixels within 'radius' of the segment from 'a' to 'b'.*/
+  void FillCapsule(const Point& a, const Point& b, const float radius)
+  {
+    const float length = std::sqrt((b.X - a.X) * (b.X - a.X) + (b.Y - a.Y) * (b.Y - a.Y));
+    if(length < 1e-3f)
+    {
+      FillDisc(a, radius);
+      return;
+    }
+
+    // The band around the segment, between the two end discs.
+    const float normalX = -(b.Y - a.Y) / length * radius;
+    const float normalY = (b.X - a.X) / length * radius;
+    const Point band[4] = {{a.X + normalX, a.Y + normalY}, {b.X + normalX, b.Y + normalY},
+                           {b.X - normalX, b.Y - normalY}, {a.X - normalX, a.Y - normalY}};
+
+    // The capsule is convex, so its span on a row is the hull of the spans of its three parts.
+    FillRows(std::min(a.Y, b.Y) - radius, std::max(a.Y, b.Y) + radius,
+             [&](const float y, float& left, float& right)
+             {
+               AddDiscSpan(a, radius, y, left, right);
+               AddDiscSpan(b, radius, y, left, right);
+               AddPolygonSpan(band, 4, y, left, right);
+             });
+  }
+
+private:
+
+  /** Fill the span 'getSpan(y, left, right)' of every row between 'top' and 'bottom'. The span starts
+    * empty (left > right) and 'getSpan' grows it. */
+  template <typename TGetSpan>
+  void FillRows(const float top, const float bottom, TGetSpan getSpan)
+  {
+    const long firstRow = std::max(0L, static_cast<long>(std::ceil(top)));
+    const long lastRow = std::min(this->Height - 1, static_cast<long>(std::floor(bottom)));
+    for(long y = firstRow; y <= lastRow; ++y)
+    {
+      float left = static_cast<float>(this->Width);
+      float right = -1.0f;
+      getSpan(static_cast<float>(y), left, right);
+
+      const long firstX = std::max(0L, static_cast<long>(std::ceil(left)));
+      const long lastX = std::min(this->Width - 1, static_cast<long>(std::floor(right)));
+      HoleMaskPixelTypeEnum* const row = this->Buffer + y * this->Width;
+      for(long x = firstX; x <= lastX; ++x)
+      {
+        this->NumberOfHolePixels += (row[x] != HoleMaskPixelTypeEnum::HOLE);
+        row[x] = HoleMaskPixelTypeEnum::HOLE;
+      }
+    }
+  }
+
+  static void AddDiscSpan(const Point& center, const float radius, const float y, float& left, float& right)
+  {
+    const float dy = y - center.Y;
+    if(dy * dy <= radius * radius)
+    {
+      const float halfWidth = std::sqrt(radius * radius - dy * dy);
+      left = std::min(left, center.X - halfWidth);
+      right = std::max(right, center.X + halfWidth);
+    }
+  }
+
+  static void AddPolygonSpan(const Point* const points, const unsigned int numberOfPoints, const float y,
+                             float& left, float& right)
+  {
+    for(unsigned int pointId = 0; pointId < numberOfPoints; ++pointId)
+    {
+      const Point& p = points[pointId];
+      const Point& q = points[(pointId + 1) % numberOfPoints];
+      if(y < std::min(p.Y, q.Y) || y > std::max(p.Y, q.Y))
+      {
+        continue;
+      }
+
+      const float x = (p.Y == q.Y) ? p.X : p.X + (y - p.Y) * (q.X - p.X) / (q.Y - p.Y);
+      left = std::min(left, x);
+      right = std::max(right, x);
+      if(p.Y == q.Y)
+      {
+        right = std::max(right, q.X);
+        left = std::min(left, q.X);
+      }
+    }
+  }
+
+  HoleMaskPixelTypeEnum* const Buffer;
+  const long Width;
+  const long Height;
+  itk::SizeValueType NumberOfHolePixels = 0;
+};
+
+/** Keep a polyline vertex inside the image by reflecting the step that left it.*/
+Point StepInside(const Point& start, float& angle, const float stepLength, const itk::Size<2>& size)
+{
+  const float maxX = static_cast<float>(size[0] - 1);
+  const float maxY = static_cast<float>(size[1] - 1);
+
+  Point end = {start.X + stepLength * std::cos(angle), start.Y + stepLength * std::sin(angle)};
+  if(end.X < 0.0f || end.X > maxX)
+  {
+    angle = Pi - angle;
+    end.X = start.X + stepLength * std::cos(angle);
+  }
+  if(end.Y < 0.0f || end.Y > maxY)
+  {
+    angle = -angle;
+    end.Y = start.Y + stepLength * std::sin(angle);
+  }
+
+  end.X = std::min(std::max(end.X, 0.0f), maxX);
+  end.Y = std::min(std::max(end.Y, 0.0f), maxY);
+  return end;
+}
+
+Point RandomPoint(MaskRandomState& randomState, const itk::Size<2>& size)
+{
+  const Point point = {Uniform(randomState, 0.0f, static_cast<float>(size[0] - 1)),
+                       Uniform(randomState, 0.0f, static_cast<float>(size[1] - 1))};
+  return point;
+}
+
+/** Draw a polyline of 'numberOfVertices' vertices and total length 'length' whose direction
+  * turns by up to 'maximumTurn' radians at each vertex. */
+void DrawPolyline(MaskRandomState& randomState, SpanRasterizer& rasterizer, const itk::Size<2>& size,
+                  const unsigned int numberOfVertices, const float length, const float maximumTurn,
+                  const float radius)
+{
+  const float stepLength = length / static_cast<float>(numberOfVertices - 1);
+  Point vertex = RandomPoint(randomState, size);
+  float angle = Uniform(randomState, 0.0f, 2.0f * Pi);
+  for(unsigned int vertexId = 1; vertexId < numberOfVertices; ++vertexId)
+  {
+    const Point nextVertex = StepInside(vertex, angle, stepLength, size);
+    rasterizer.FillCapsule(vertex, nextVertex, radius);
+    vertex = nextVertex;
+    angle += Uniform(randomState, -maximumTurn, maximumTurn);
+  }
+}
+
+/** A free-form brush stroke: a wide, wandering polyline with round joints.*/
+void DrawStroke(MaskRandomState& randomState, SpanRasterizer& rasterizer, const itk::Size<2>& size,
+                const float area)
+{
+  const float width = std::max(2.0f, std::sqrt(area) * Uniform(randomState, 0.1f, 0.3f));
+  const float maximumLength = 2.0f * static_cast<float>(size[0] + size[1]);
+  const float length = std::min(area / width, maximumLength);
+  const unsigned int numberOfVertices = static_cast<unsigned int>(randomState.NextUniformInteger(4, 10));
+  DrawPolyline(randomState, rasterizer, size, numberOfVertices, length, Pi / 3.0f, width / 2.0f);
+}
+
+/** A blob: a cluster of discs that all cover the cluster center, so the blob is connected.*/
+void DrawBlob(MaskRandomState& randomState, SpanRasterizer& rasterizer, const itk::Size<2>& size,
+              const float area)
+{
+  const unsigned int numberOfDiscs = static_cast<unsigned int>(randomState.NextUniformInteger(3, 6));
+  const float radius = std::sqrt(area / (2.0f * Pi));
+  const Point center = RandomPoint(randomState, size);
+  for(unsigned int discId = 0; discId < numberOfDiscs; ++discId)
+  {
+    const float distance = Uniform(randomState, 0.0f, 0.6f * radius);
+    const float angle = Uniform(randomState, 0.0f, 2.0f * Pi);
+    const Point discCenter = {center.X + distance * std::cos(angle), center.Y + distance * std::sin(angle)};
+    rasterizer.FillDisc(discCenter, radius * Uniform(randomState, 0.7f, 1.3f));
+  }
+}
+
+/** A rectangle with a random aspect ratio (between 1:3 and 3:1) and orientation.*/
+void DrawRectangle(MaskRandomState& randomState, SpanRasterizer& rasterizer, const itk::Size<2>& size,
+                   const float area)
+{
+  const float aspectRatio = std::exp(Uniform(randomState, -std::log(3.0f), std::log(3.0f)));
+  const float width = std::sqrt(area * aspectRatio);
+  const float height = area / width;
+  const Point center = RandomPoint(randomState, size);
+  const float angle = Uniform(randomState, 0.0f, Pi);
+
+  const float alongX = std::cos(angle) * width / 2.0f;
+  const float alongY = std::sin(angle) * width / 2.0f;
+  const float acrossX = -std::sin(angle) * height / 2.0f;
+  const float acrossY = std::cos(angle) * height / 2.0f;
+  const Point corners[4] = {{center.X - alongX - acrossX, center.Y - alongY - acrossY},
+                            {center.X + alongX - acrossX, center.Y + alongY - acrossY},
+                            {center.X + alongX + acrossX, center.Y + alongY + acrossY},
+                            {center.X - alongX + acrossX, center.Y - alongY + acrossY}};
+  rasterizer.FillConvexPolygon(corners, 4);
+}
+
+/** A scratch: a long, thin, nearly straight polyline.*/
+void DrawScratch(MaskRandomState& randomState, SpanRasterizer& rasterizer, const itk::Size<2>& size,
+                 const float area)
+{
+  const float width = Uniform(randomState, 1.0f, 3.0f);
+  const float diagonal = std::sqrt(static_cast<float>(size[0] * size[0] + size[1] * size[1]));
+  const float length = std::min(area / width, 0.75f * diagonal);
+  const unsigned int numberOfVertices = static_cast<unsigned int>(randomState.NextUniformInteger(2, 4));
+  DrawPolyline(randomState, rasterizer, size, numberOfVertices, length, Pi / 12.0f, width / 2.0f);
+}
+
+} // end anonymous namespace
+
+MaskGenerator::MaskGenerator(const uint64_t seed) : Seed(seed)
+{
+  this->Size[0] = 512;
+  this->Size[1] = 512;
+  std::fill(this->ShapeWeights, this->ShapeWeights + 4, 1.0f);
+}
+
+uint64_t MaskGenerator::GetSeed() const
+{
+  return this->Seed;
+}
+
+void MaskGenerator::SetSize(const itk::Size<2>& size)
+{
+  if(size[0] == 0 || size[1] == 0)
+  {
+    std::stringstream ss;
+    ss << "MaskGenerator::SetSize: size " << size << " is empty!";
+    throw std::runtime_error(ss.str());
+  }
+
+  this->Size = size;
+}
+
+itk::Size<2> MaskGenerator::GetSize() const
+{
+  return this->Size;
+}
+
+void MaskGenerator::SetHoleFraction(const float holeFraction)
+{
+  if(holeFraction < 0.0f || holeFraction > 1.0f)
+  {
+    std::stringstream ss;
+    ss << "MaskGenerator::SetHoleFraction: hole fraction " << holeFraction << " is not in [0, 1]!";
+    throw std::runtime_error(ss.str());
+  }
+
+  this->HoleFraction = holeFraction;
+}
+
+float MaskGenerator::GetHoleFraction() const
+{
+  return this->HoleFraction;
+}
+
+void MaskGenerator::SetNumberOfComponents(const unsigned int minimumNumberOfComponents,
+                                          const unsigned int maximumNumberOfComponents)
+{
+  if(minimumNumberOfComponents == 0 || minimumNumberOfComponents > maximumNumberOfComponents)
+  {
+    std::stringstream ss;
+    ss << "MaskGenerator::SetNumberOfComponents: [" << minimumNumberOfComponents << ", "
+       << maximumNumberOfComponents << "] is not a valid range!";
+    throw std::runtime_error(ss.str());
+  }
+
+  this->MinimumNumberOfComponents = minimumNumberOfComponents;
+  this->MaximumNumberOfComponents = maximumNumberOfComponents;
+}
+
+unsigned int MaskGenerator::GetMinimumNumberOfComponents() const
+{
+  return this->MinimumNumberOfComponents;
+}
+
+unsigned int MaskGenerator::GetMaximumNumberOfComponents() const
+{
+  return this->MaximumNumberOfComponents;
+}
+
+void MaskGenerator::SetShapeWeight(const ShapeTypeEnum shapeType, const float weight)
+{
+  if(weight < 0.0f)
+  {
+    throw std::runtime_error("MaskGenerator::SetShapeWeight: weights must not be negative!");
+  }
+
+  this->ShapeWeights[static_cast<int>(shapeType)] = weight;
+}
+
+float MaskGenerator::GetShapeWeight(const ShapeTypeEnum shapeType) const
+{
+  return this->ShapeWeights[static_cast<int>(shapeType)];
+}
+
+void MaskGenerator::SetNumberOfThreads(const unsigned int numberOfThreads)
+{
+  this->NumberOfThreads = numberOfThreads;
+}
+
+MaskGenerator::ShapeTypeEnum MaskGenerator::DrawShapeType(MaskRandomState& randomState) const
+{
+  const float totalWeight = this->ShapeWeights[0] + this->ShapeWeights[1] +
+                            this->ShapeWeights[2] + this->ShapeWeights[3];
+  if(totalWeight <= 0.0f)
+  {
+    throw std::runtime_error("MaskGenerator: all of the shape weights are 0!");
+  }
+
+  float draw = randomState.NextUniformFloat() * totalWeight;
+  for(int shapeType = 0; shapeType < 3; ++shapeType)
+  {
+    if(draw < this->ShapeWeights[shapeType])
+    {
+      return static_cast<ShapeTypeEnum>(shapeType);
+    }
+    draw -= this->ShapeWeights[shapeType];
+  }
+
+  return ShapeTypeEnum::SCRATCH;
+}
+
+void MaskGenerator::Generate(const uint64_t maskId, Mask* const mask) const
+{
+  assert(mask);
+
+  itk::Index<2> corner = {{0,0}};
+  itk::ImageRegion<2> region(corner, this->Size);
+  if(mask->GetLargestPossibleRegion() != region || mask->GetBufferedRegion() != region)
+  {
+    mask->SetRegions(region);
+    mask->Allocate();
+  }
+
+  mask->FillBuffer(HoleMaskPixelTypeEnum::VALID);
+
+  // Every mask has its own stream, so it does not depend on which other masks are generated.
+  MaskRandomState randomState(this->Seed, maskId);
+  SpanRasterizer rasterizer(mask->GetBufferPointer(), this->Size);
+
+  const float targetNumberOfHolePixels = this->HoleFraction * static_cast<float>(region.GetNumberOfPixels());
+  if(targetNumberOfHolePixels >= 1.0f)
+  {
+    const unsigned int numberOfComponents = static_cast<unsigned int>(
+          randomState.NextUniformInteger(this->MinimumNumberOfComponents, this->MaximumNumberOfComponents));
+    const float componentArea = targetNumberOfHolePixels / static_cast<float>(numberOfComponents);
+
+    // Draw the chosen number of components, then keep going (up to the maximum) while overlaps
+    // have left the mask short of the target hole fraction.
+    for(unsigned int componentId = 0;
+        componentId < numberOfComponents ||
+        (componentId < this->MaximumNumberOfComponents &&
+         rasterizer.GetNumberOfHolePixels() < targetNumberOfHolePixels);
+        ++componentId)
+    {
+      switch(DrawShapeType(randomState))
+      {
+        case ShapeTypeEnum::STROKE:
+          DrawStroke(randomState, rasterizer, this->Size, componentArea);
+          break;
+        case ShapeTypeEnum::BLOB:
+          DrawBlob(randomState, rasterizer, this->Size, componentArea);
+          break;
+        case ShapeTypeEnum::RECTANGLE:
+          DrawRectangle(randomState, rasterizer, this->Size, componentArea);
+          break;
+        case ShapeTypeEnum::SCRATCH:
+          DrawScratch(randomState, rasterizer, this->Size, componentArea);
+          break;
+      }
+    }
+  }
+
+  mask->MarkModifiedRegion(region);
+}
+
+void MaskGenerator::Generate(const uint64_t firstMaskId, const std::vector<Mask*>& masks) const
+{
+  MaskParallel::ParallelFor(0, masks.size(), [&](const std::size_t firstMask, const std::size_t endMask)
+  {
+    for(std::size_t maskNumber = firstMask; maskNumber < endMask; ++maskNumber)
+    {
+      Generate(firstMaskId + maskNumber, masks[maskNumber]);
+    }
+  }, this->NumberOfThreads);
+}
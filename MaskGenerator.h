@@ -0,0 +1,99 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/**
+\class MaskGenerator
+\brief Generates random synthetic masks (free-form brush strokes, blobs, rotated rectangles and
+       thin scratches) for benchmarks and training data. Every shape is rasterized as one
+       horizontal span per row written straight into the mask buffer, so no per-pixel SetHole()
+       calls are made. A mask is a pure function of (seed, mask id), so a batch can be generated in
+       parallel, in any order, and always comes out the same.
+*/
+
+#ifndef MaskGenerator_H
+#define MaskGenerator_H
+
+// Custom
+#include "Mask.h"
+#include "MaskRandomState.h"
+
+// STL
+#include <cstdint>
+#include <vector>
+
+class MaskGenerator
+{
+public:
+  enum class ShapeTypeEnum {STROKE, BLOB, RECTANGLE, SCRATCH};
+
+  MaskGenerator(const uint64_t seed = 0);
+
+  uint64_t GetSeed() const;
+
+  /** Set the size of the generated masks (512x512 by default).*/
+  void SetSize(const itk::Size<2>& size);
+  itk::Size<2> GetSize() const;
+
+  /** Set the fraction of the mask that should be hole (0.2 by default). Each shape is sized to cover
+    * its share of this fraction; because shapes overlap, extra shapes are added (up to the maximum
+    * number of components) until the fraction is reached. Scratches are thin and their length is
+    * capped, so masks made only of scratches stay well below large fractions. */
+  void SetHoleFraction(const float holeFraction);
+  float GetHoleFraction() const;
+
+  /** Set the range the number of shapes per mask is drawn from (1 to 8 by default).*/
+  void SetNumberOfComponents(const unsigned int minimumNumberOfComponents,
+                             const unsigned int maximumNumberOfComponents);
+  unsigned int GetMinimumNumberOfComponents() const;
+  unsigned int GetMaximumNumberOfComponents() const;
+
+  /** Set the relative probability of drawing each shape type (all 1 by default). A weight of 0
+    * disables the shape type. */
+  void SetShapeWeight(const ShapeTypeEnum shapeType, const float weight);
+  float GetShapeWeight(const ShapeTypeEnum shapeType) const;
+
+  /** Set the number of threads used by the batch Generate() (0, the default, uses MaskParallel's default).*/
+  void SetNumberOfThreads(const unsigned int numberOfThreads);
+
+  /** Generate mask number 'maskId' into 'mask', reallocating it only if its size is different.*/
+  void Generate(const uint64_t maskId, Mask* const mask) const;
+
+  /** Generate masks number [firstMaskId, firstMaskId + masks.size()) into 'masks', in parallel.*/
+  void Generate(const uint64_t firstMaskId, const std::vector<Mask*>& masks) const;
+
+private:
+
+  /** Draw a shape type according to the shape weights.*/
+  ShapeTypeEnum DrawShapeType(MaskRandomState& randomState) const;
+
+  uint64_t Seed;
+
+  itk::Size<2> Size;
+
+  float HoleFraction = 0.2f;
+
+  unsigned int MinimumNumberOfComponents = 1;
+  unsigned int MaximumNumberOfComponents = 8;
+
+  /** Indexed by ShapeTypeEnum.*/
+  float ShapeWeights[4];
+
+  unsigned int NumberOfThreads = 0;
+};
+
+#endif
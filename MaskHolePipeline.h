@@ -0,0 +1,117 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/**
+\class MaskHolePipeline
+\brief Applies a chain of per-pixel operations to the hole pixels of an image in a single pass.
+       Stages are recorded with the chaining functions, e.g.
+       MaskOperations::InHole(image, mask).Add(5).Clip(0, 255).Noise(2, randomState).Apply();
+       Apply() walks the mask's cached hole spans, loads each run of components into a small contiguous
+       buffer, runs every stage over it (simple loops the compiler can vectorize) and stores it once, so
+       the components are rounded and clamped to the range of the pixel type only after the last stage.
+       The stages compute in float for float pixels and integer pixels of up to 16 bits, and in double
+       otherwise. When the last stage sets the pixels, they are copied directly. Spans are split across
+       threads, and the noise at each pixel is keyed by its buffer offset, so the result does not depend
+       on the number of threads.
+*/
+
+#ifndef MaskHolePipeline_H
+#define MaskHolePipeline_H
+
+// Custom
+#include "Mask.h"
+#include "MaskImageBuffer.h"
+#include "MaskRandomState.h"
+
+// STL
+#include <type_traits>
+#include <vector>
+
+template <typename TImage>
+class MaskHolePipeline
+{
+public:
+  typedef typename MaskImageBuffer::ImageComponents<TImage>::ComponentType ComponentType;
+
+  /** The type the stages compute in: float when it holds every ComponentType value exactly, double otherwise. */
+  typedef typename std::conditional<std::is_same<ComponentType, float>::value ||
+                                    (std::is_integral<ComponentType>::value && sizeof(ComponentType) <= 2),
+                                    float, double>::type ValueType;
+
+  /** The image and the mask must have the same region.*/
+  MaskHolePipeline(TImage* const image, const Mask* const mask);
+
+  /** Set every hole pixel to 'value'.*/
+  MaskHolePipeline& Set(const typename TImage::PixelType& value);
+
+  /** Set every component of every hole pixel to 'value'.*/
+  MaskHolePipeline& Fill(const float value);
+
+  /** Add 'value' to every component.*/
+  MaskHolePipeline& Add(const float value);
+
+  /** Multiply every component by 'value'.*/
+  MaskHolePipeline& Scale(const float value);
+
+  /** Clamp every component to [minimum, maximum].*/
+  MaskHolePipeline& Clip(const float minimum, const float maximum);
+
+  /** Add the same uniform noise in [-noiseVariance/2, noiseVariance/2) to every component of a pixel, using
+    * a stream split from 'randomState' now. This matches MaskOperations::AddNoiseInHole(). */
+  MaskHolePipeline& Noise(const float noiseVariance, MaskRandomState& randomState);
+
+  /** Run the stages over the hole pixels. The stages are kept, so Apply() can be called again.*/
+  void Apply();
+
+  /** Set the number of threads to use (0 uses MaskParallel::GetNumberOfThreads()).*/
+  void SetNumberOfThreads(const unsigned int numberOfThreads);
+
+private:
+
+  enum class StageTypeEnum {SET, ADD, SCALE, CLIP, NOISE};
+
+  struct Stage
+  {
+    StageTypeEnum Type;
+    ValueType First = 0;
+    ValueType Second = 0;
+    std::vector<ValueType> Values; // The components of a SET stage
+    std::vector<ComponentType> Components; // The components of a SET stage in the pixel type
+    MaskRandomState NoiseState;
+  };
+
+  /** Run every stage on the 'numberOfPixels' pixels in 'values', whose first pixel has buffer offset 'offset'.*/
+  void ApplyStages(const itk::OffsetValueType offset, const std::size_t numberOfPixels, ValueType* const values,
+                   std::vector<float>& noise) const;
+
+  /** Round and clamp 'value' to the range of ComponentType (integer components), or just convert it.*/
+  static ComponentType ConvertValue(const ValueType value, std::true_type isIntegral);
+  static ComponentType ConvertValue(const ValueType value, std::false_type isIntegral);
+  static ComponentType ConvertValue(const ValueType value);
+
+  TImage* Image;
+  const Mask* MaskImage;
+  unsigned int NumberOfComponents;
+  unsigned int NumberOfThreads = 0;
+  std::vector<Stage> Stages;
+};
+
+#include "MaskHolePipeline.hpp"
+
+#endif
@@ -0,0 +1,271 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef MaskHolePipeline_HPP
+#define MaskHolePipeline_HPP
+
+#include "MaskHolePipeline.h" // Appease syntax parser
+
+// Custom
+#include "MaskParallel.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+template <typename TImage>
+MaskHolePipeline<TImage>::MaskHolePipeline(TImage* const image, const Mask* const mask) :
+  Image(image), MaskImage(mask)
+{
+  if(image->GetLargestPossibleRegion() != mask->GetLargestPossibleRegion())
+  {
+    std::stringstream ss;
+    ss << "MaskHolePipeline: image region (" << image->GetLargestPossibleRegion() << ") must match mask region ("
+       << mask->GetLargestPossibleRegion() << ")";
+    throw std::runtime_error(ss.str());
+  }
+
+  this->NumberOfComponents = MaskImageBuffer::ImageComponents<TImage>::GetNumberOfComponents(image);
+}
+
+template <typename TImage>
+MaskHolePipeline<TImage>& MaskHolePipeline<TImage>::Set(const typename TImage::PixelType& value)
+{
+  Stage stage;
+  stage.Type = StageTypeEnum::SET;
+  stage.Values.resize(this->NumberOfComponents);
+  MaskImageBuffer::GetPixelComponents(value, this->NumberOfComponents, stage.Values.data());
+  stage.Components.resize(this->NumberOfComponents);
+  MaskImageBuffer::GetPixelComponents(value, this->NumberOfComponents, stage.Components.data());
+  this->Stages.push_back(stage);
+  return *this;
+}
+
+template <typename TImage>
+MaskHolePipeline<TImage>& MaskHolePipeline<TImage>::Fill(const float value)
+{
+  Stage stage;
+  stage.Type = StageTypeEnum::SET;
+  stage.Values.assign(this->NumberOfComponents, static_cast<ValueType>(value));
+  stage.Components.assign(this->NumberOfComponents, ConvertValue(static_cast<ValueType>(value)));
+  this->Stages.push_back(stage);
+  return *this;
+}
+
+template <typename TImage>
+MaskHolePipeline<TImage>& MaskHolePipeline<TImage>::Add(const float value)
+{
+  Stage stage;
+  stage.Type = StageTypeEnum::ADD;
+  stage.First = value;
+  this->Stages.push_back(stage);
+  return *this;
+}
+
+template <typename TImage>
+MaskHolePipeline<TImage>& MaskHolePipeline<TImage>::Scale(const float value)
+{
+  Stage stage;
+  stage.Type = StageTypeEnum::SCALE;
+  stage.First = value;
+  this->Stages.push_back(stage);
+  return *this;
+}
+
+template <typename TImage>
+MaskHolePipeline<TImage>& MaskHolePipeline<TImage>::Clip(const float minimum, const float maximum)
+{
+  Stage stage;
+  stage.Type = StageTypeEnum::CLIP;
+  stage.First = minimum;
+  stage.Second = maximum;
+  this->Stages.push_back(stage);
+  return *this;
+}
+
+template <typename TImage>
+MaskHolePipeline<TImage>& MaskHolePipeline<TImage>::Noise(const float noiseVariance, MaskRandomState& randomState)
+{
+  Stage stage;
+  stage.Type = StageTypeEnum::NOISE;
+  stage.First = noiseVariance;
+  stage.NoiseState = randomState.Split();
+  this->Stages.push_back(stage);
+  return *this;
+}
+
+template <typename TImage>
+void MaskHolePipeline<TImage>::SetNumberOfThreads(const unsigned int numberOfThreads)
+{
+  this->NumberOfThreads = numberOfThreads;
+}
+
+template <typename TImage>
+void MaskHolePipeline<TImage>::Apply()
+{
+  if(this->Stages.empty())
+  {
+    return;
+  }
+
+  const itk::ImageRegion<2> region = this->MaskImage->GetLargestPossibleRegion();
+  std::shared_ptr<const Mask::SpanListType> holeSpans = this->MaskImage->GetHoleSpans(region);
+  const Mask::SpanListType& spans = *holeSpans;
+
+  ComponentType* const buffer = MaskImageBuffer::ImageComponents<TImage>::GetComponentBuffer(this->Image);
+  const itk::OffsetValueType width = region.GetSize()[0];
+  const unsigned int numberOfComponents = this->NumberOfComponents;
+
+  // The earlier stages cannot affect pixels that the last stage sets, so copy its components directly.
+  if(this->Stages.back().Type == StageTypeEnum::SET)
+  {
+    const std::vector<ComponentType>& setComponents = this->Stages.back().Components;
+    MaskParallel::ParallelFor(0, spans.size(), [&](const std::size_t firstSpan, const std::size_t endSpan)
+    {
+      for(std::size_t spanId = firstSpan; spanId < endSpan; ++spanId)
+      {
+        const Mask::Span& span = spans[spanId];
+        ComponentType* components = buffer + (span.Y * width + span.X) * numberOfComponents;
+        for(itk::SizeValueType pixelId = 0; pixelId < span.Length; ++pixelId)
+        {
+          components = std::copy(setComponents.begin(), setComponents.end(), components);
+        }
+      }
+    }, this->NumberOfThreads);
+
+    this->Image->Modified();
+    return;
+  }
+
+  MaskParallel::ParallelFor(0, spans.size(), [&](const std::size_t firstSpan, const std::size_t endSpan)
+  {
+    std::vector<ValueType> values;
+    std::vector<float> noise;
+    for(std::size_t spanId = firstSpan; spanId < endSpan; ++spanId)
+    {
+      const Mask::Span& span = spans[spanId];
+      const itk::OffsetValueType offset = span.Y * width + span.X;
+      ComponentType* const components = buffer + offset * numberOfComponents;
+      const std::size_t numberOfValues = span.Length * numberOfComponents;
+
+      values.resize(numberOfValues);
+      for(std::size_t valueId = 0; valueId < numberOfValues; ++valueId)
+      {
+        values[valueId] = static_cast<ValueType>(components[valueId]);
+      }
+
+      ApplyStages(offset, span.Length, values.data(), noise);
+
+      for(std::size_t valueId = 0; valueId < numberOfValues; ++valueId)
+      {
+        components[valueId] = ConvertValue(values[valueId]);
+      }
+    }
+  }, this->NumberOfThreads);
+
+  this->Image->Modified();
+}
+
+template <typename TImage>
+void MaskHolePipeline<TImage>::ApplyStages(const itk::OffsetValueType offset, const std::size_t numberOfPixels,
+                                           ValueType* const values, std::vector<float>& noise) const
+{
+  const unsigned int numberOfComponents = this->NumberOfComponents;
+  const std::size_t numberOfValues = numberOfPixels * numberOfComponents;
+
+  for(const Stage& stage : this->Stages)
+  {
+    switch(stage.Type)
+    {
+      case StageTypeEnum::SET:
+        for(std::size_t pixelId = 0; pixelId < numberOfPixels; ++pixelId)
+        {
+          std::copy(stage.Values.begin(), stage.Values.end(), values + pixelId * numberOfComponents);
+        }
+        break;
+      case StageTypeEnum::ADD:
+        for(std::size_t valueId = 0; valueId < numberOfValues; ++valueId)
+        {
+          values[valueId] += stage.First;
+        }
+        break;
+      case StageTypeEnum::SCALE:
+        for(std::size_t valueId = 0; valueId < numberOfValues; ++valueId)
+        {
+          values[valueId] *= stage.First;
+        }
+        break;
+      case StageTypeEnum::CLIP:
+        for(std::size_t valueId = 0; valueId < numberOfValues; ++valueId)
+        {
+          values[valueId] = std::min(std::max(values[valueId], stage.First), stage.Second);
+        }
+        break;
+      case StageTypeEnum::NOISE:
+        noise.resize(numberOfPixels);
+        stage.NoiseState.GetUniformFloats(static_cast<uint64_t>(offset), numberOfPixels, noise.data());
+        for(std::size_t pixelId = 0; pixelId < numberOfPixels; ++pixelId)
+        {
+          const ValueType pixelNoise = (noise[pixelId] - .5f) * static_cast<float>(stage.First);
+          for(unsigned int component = 0; component < numberOfComponents; ++component)
+          {
+            values[pixelId * numberOfComponents + component] += pixelNoise;
+          }
+        }
+        break;
+    }
+  }
+}
+
+template <typename TImage>
+typename MaskHolePipeline<TImage>::ComponentType MaskHolePipeline<TImage>::ConvertValue(const ValueType value)
+{
+  return ConvertValue(value, std::is_integral<ComponentType>());
+}
+
+template <typename TImage>
+typename MaskHolePipeline<TImage>::ComponentType MaskHolePipeline<TImage>::ConvertValue(const ValueType value,
+                                                                                       std::true_type)
+{
+  // The upper limit may round up when converted to ValueType (e.g. 2^63 - 1 to double), so values that reach it
+  // are clamped before the cast. NaN is clamped to the lower limit.
+  const ValueType lowest = static_cast<ValueType>(std::numeric_limits<ComponentType>::lowest());
+  const ValueType highest = static_cast<ValueType>(std::numeric_limits<ComponentType>::max());
+  if(!(value > lowest))
+  {
+    return std::numeric_limits<ComponentType>::lowest();
+  }
+  if(value >= highest)
+  {
+    return std::numeric_limits<ComponentType>::max();
+  }
+  return static_cast<ComponentType>(std::round(value));
+}
+
+template <typename TImage>
+typename MaskHolePipeline<TImage>::ComponentType MaskHolePipeline<TImage>::ConvertValue(const ValueType value,
+                                                                                       std::false_type)
+{
+  return static_cast<ComponentType>(value);
+}
+
+#endif
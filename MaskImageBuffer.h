@@ -0,0 +1,195 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef MaskImageBuffer_H
+#define MaskImageBuffer_H
+
+// ITK
+#include "itkCovariantVector.h"
+#include "itkFixedArray.h"
+#include "itkImage.h"
+#include "itkRGBAPixel.h"
+#include "itkRGBPixel.h"
+#include "itkVariableLengthVector.h"
+#include "itkVector.h"
+#include "itkVectorImage.h"
+
+// STL
+#include <cstddef>
+#include <type_traits>
+
+/** Raw access to the pixel buffers of itk::Image and itk::VectorImage, so that runs of
+  * consecutive pixels in a row can be copied as one block of memory. */
+namespace MaskImageBuffer
+{
+
+/** Whether a pixel can be copied with memmove: scalars, enums (e.g. mask pixels) and the fixed size
+  * ITK pixel types of scalars. Other pixel types are copied with assignment. */
+template <typename TPixel>
+struct IsBitwiseCopyable : std::integral_constant<bool, std::is_arithmetic<TPixel>::value ||
+                                                        std::is_enum<TPixel>::value> {};
+
+template <typename TValue, unsigned int VLength>
+struct IsBitwiseCopyable<itk::FixedArray<TValue, VLength> > : std::is_arithmetic<TValue> {};
+
+template <typename TValue, unsigned int VLength>
+struct IsBitwiseCopyable<itk::CovariantVector<TValue, VLength> > : std::is_arithmetic<TValue> {};
+
+template <typename TValue, unsigned int VLength>
+struct IsBitwiseCopyable<itk::Vector<TValue, VLength> > : std::is_arithmetic<TValue> {};
+
+template <typename TValue>
+struct IsBitwiseCopyable<itk::RGBPixel<TValue> > : std::is_arithmetic<TValue> {};
+
+template <typename TValue>
+struct IsBitwiseCopyable<itk::RGBAPixel<TValue> > : std::is_arithmetic<TValue> {};
+
+/** The scalar components of a pixel type: scalars have one, fixed size ITK pixel types have their length.*/
+template <typename TPixel>
+struct PixelComponents
+{
+  typedef TPixel ComponentType;
+  static const unsigned int NumberOfComponents = 1;
+};
+
+template <typename TValue, unsigned int VLength>
+struct PixelComponents<itk::FixedArray<TValue, VLength> >
+{
+  typedef TValue ComponentType;
+  static const unsigned int NumberOfComponents = VLength;
+};
+
+template <typename TValue, unsigned int VLength>
+struct PixelComponents<itk::CovariantVector<TValue, VLength> > : PixelComponents<itk::FixedArray<TValue, VLength> > {};
+
+template <typename TValue, unsigned int VLength>
+struct PixelComponents<itk::Vector<TValue, VLength> > : PixelComponents<itk::FixedArray<TValue, VLength> > {};
+
+template <typename TValue>
+struct PixelComponents<itk::RGBPixel<TValue> > : PixelComponents<itk::FixedArray<TValue, 3> > {};
+
+template <typename TValue>
+struct PixelComponents<itk::RGBAPixel<TValue> > : PixelComponents<itk::FixedArray<TValue, 4> > {};
+
+/** View the buffer of an image as a flat array of scalar components, 'GetNumberOfComponents(image)' per pixel.*/
+template <typename TImage>
+struct ImageComponents;
+
+template <typename TPixel>
+struct ImageComponents<itk::Image<TPixel, 2> >
+{
+  typedef typename PixelComponents<TPixel>::ComponentType ComponentType;
+
+  static unsigned int GetNumberOfComponents(const itk::Image<TPixel, 2>* const)
+  {
+    return PixelComponents<TPixel>::NumberOfComponents;
+  }
+
+  static const ComponentType* GetComponentBuffer(const itk::Image<TPixel, 2>* const image)
+  {
+    return reinterpret_cast<const ComponentType*>(image->GetBufferPointer());
+  }
+
+  static ComponentType* GetComponentBuffer(itk::Image<TPixel, 2>* const image)
+  {
+    return reinterpret_cast<ComponentType*>(image->GetBufferPointer());
+  }
+};
+
+template <typename TValue>
+struct ImageComponents<itk::VectorImage<TValue, 2> >
+{
+  typedef TValue ComponentType;
+
+  static unsigned int GetNumberOfComponents(const itk::VectorImage<TValue, 2>* const image)
+  {
+    return image->GetNumberOfComponentsPerPixel();
+  }
+
+  static const ComponentType* GetComponentBuffer(const itk::VectorImage<TValue, 2>* const image)
+  {
+    return image->GetBufferPointer();
+  }
+
+  static ComponentType* GetComponentBuffer(itk::VectorImage<TValue, 2>* const image)
+  {
+    return image->GetBufferPointer();
+  }
+};
+
+/** Get the first component of the pixel at 'index', which must be inside the buffered region.*/
+template <typename TImage>
+const typename ImageComponents<TImage>::ComponentType* GetComponents(const TImage* const image,
+                                                                     const itk::Index<2>& index);
+
+template <typename TImage>
+typename ImageComponents<TImage>::ComponentType* GetComponents(TImage* const image, const itk::Index<2>& index);
+
+/** Set the components of 'pixel' from 'values' (multiplied by 'scale'). Variable length pixels are resized
+  * to 'numberOfComponents', fixed size pixels must have that many components. */
+template <typename TPixel>
+typename std::enable_if<std::is_arithmetic<TPixel>::value>::type
+SetPixelComponents(const double* const values, const unsigned int numberOfComponents, TPixel& pixel,
+                   const double scale = 1.0);
+
+template <typename TValue, unsigned int VLength>
+void SetPixelComponents(const double* const values, const unsigned int numberOfComponents,
+                        itk::FixedArray<TValue, VLength>& pixel, const double scale = 1.0);
+
+template <typename TValue>
+void SetPixelComponents(const double* const values, const unsigned int numberOfComponents,
+                        itk::VariableLengthVector<TValue>& pixel, const double scale = 1.0);
+
+/** Get the first 'numberOfComponents' components of 'pixel', converted to the type of 'values'.*/
+template <typename TPixel, typename TComponent>
+typename std::enable_if<std::is_arithmetic<TPixel>::value>::type
+GetPixelComponents(const TPixel& pixel, const unsigned int numberOfComponents, TComponent* const values);
+
+template <typename TValue, unsigned int VLength, typename TComponent>
+void GetPixelComponents(const itk::FixedArray<TValue, VLength>& pixel, const unsigned int numberOfComponents,
+                        TComponent* const values);
+
+template <typename TValue, typename TComponent>
+void GetPixelComponents(const itk::VariableLengthVector<TValue>& pixel, const unsigned int numberOfComponents,
+                        TComponent* const values);
+
+/** The number of buffer elements (TImage::InternalPixelType) that make up one pixel.*/
+template <typename TPixel>
+unsigned int GetNumberOfElementsPerPixel(const itk::Image<TPixel, 2>* const image);
+
+template <typename TValue>
+unsigned int GetNumberOfElementsPerPixel(const itk::VectorImage<TValue, 2>* const image);
+
+/** Copy 'numberOfElements' buffer elements from 'source' to 'destination'. The ranges may overlap,
+  * in which case the result is as if the source had been copied to a temporary first. */
+template <typename TElement>
+void CopyElements(const TElement* const source, TElement* const destination, const std::size_t numberOfElements);
+
+/** Copy the 'numberOfPixels' pixels of the row starting at 'sourceStart' in 'sourceImage' to the row starting at
+  * 'destinationStart' in 'destinationImage'. Both runs must lie inside a single row of the buffered regions.
+  * The images may be the same image and the runs may overlap. */
+template <typename TImage>
+void CopyPixelRun(const TImage* const sourceImage, const itk::Index<2>& sourceStart,
+                  TImage* const destinationImage, const itk::Index<2>& destinationStart,
+                  const itk::SizeValueType numberOfPixels);
+
+} // end namespace
+
+#include "MaskImageBuffer.hpp"
+
+#endif
@@ -0,0 +1,165 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef MaskImageBuffer_HPP
+#define MaskImageBuffer_HPP
+
+#include "MaskImageBuffer.h" // Appease syntax parser
+
+// STL
+#include <algorithm>
+#include <cstring>
+
+namespace MaskImageBuffer
+{
+
+template <typename TPixel>
+unsigned int GetNumberOfElementsPerPixel(const itk::Image<TPixel, 2>* const)
+{
+  return 1;
+}
+
+template <typename TValue>
+unsigned int GetNumberOfElementsPerPixel(const itk::VectorImage<TValue, 2>* const image)
+{
+  return image->GetNumberOfComponentsPerPixel();
+}
+
+/** Copy with memmove.*/
+template <typename TElement>
+void CopyElements(const TElement* const source, TElement* const destination, const std::size_t numberOfElements,
+                  std::true_type /*isBitwiseCopyable*/)
+{
+  std::memmove(destination, source, numberOfElements * sizeof(TElement));
+}
+
+/** Copy with assignment, in the order that handles overlapping ranges.*/
+template <typename TElement>
+void CopyElements(const TElement* const source, TElement* const destination, const std::size_t numberOfElements,
+                  std::false_type /*isBitwiseCopyable*/)
+{
+  if(destination > source && destination < source + numberOfElements)
+  {
+    std::copy_backward(source, source + numberOfElements, destination + numberOfElements);
+  }
+  else
+  {
+    std::copy(source, source + numberOfElements, destination);
+  }
+}
+
+template <typename TElement>
+void CopyElements(const TElement* const source, TElement* const destination, const std::size_t numberOfElements)
+{
+  if(source == destination || numberOfElements == 0)
+  {
+    return;
+  }
+
+  CopyElements(source, destination, numberOfElements,
+               std::integral_constant<bool, IsBitwiseCopyable<TElement>::value>());
+}
+
+template <typename TImage>
+void CopyPixelRun(const TImage* const sourceImage, const itk::Index<2>& sourceStart,
+                  TImage* const destinationImage, const itk::Index<2>& destinationStart,
+                  const itk::SizeValueType numberOfPixels)
+{
+  const std::size_t numberOfElementsPerPixel = GetNumberOfElementsPerPixel(destinationImage);
+
+  const typename TImage::InternalPixelType* const source =
+      sourceImage->GetBufferPointer() + sourceImage->ComputeOffset(sourceStart) * numberOfElementsPerPixel;
+  typename TImage::InternalPixelType* const destination =
+      destinationImage->GetBufferPointer() + destinationImage->ComputeOffset(destinationStart) * numberOfElementsPerPixel;
+
+  CopyElements(source, destination, numberOfPixels * numberOfElementsPerPixel);
+}
+
+template <typename TImage>
+const typename ImageComponents<TImage>::ComponentType* GetComponents(const TImage* const image,
+                                                                     const itk::Index<2>& index)
+{
+  return ImageComponents<TImage>::GetComponentBuffer(image) +
+         image->ComputeOffset(index) * ImageComponents<TImage>::GetNumberOfComponents(image);
+}
+
+template <typename TImage>
+typename ImageComponents<TImage>::ComponentType* GetComponents(TImage* const image, const itk::Index<2>& index)
+{
+  return ImageComponents<TImage>::GetComponentBuffer(image) +
+         image->ComputeOffset(index) * ImageComponents<TImage>::GetNumberOfComponents(image);
+}
+
+template <typename TPixel>
+typename std::enable_if<std::is_arithmetic<TPixel>::value>::type
+SetPixelComponents(const double* const values, const unsigned int, TPixel& pixel, const double scale)
+{
+  pixel = static_cast<TPixel>(values[0] * scale);
+}
+
+template <typename TValue, unsigned int VLength>
+void SetPixelComponents(const double* const values, const unsigned int, itk::FixedArray<TValue, VLength>& pixel,
+                        const double scale)
+{
+  for(unsigned int component = 0; component < VLength; ++component)
+  {
+    pixel[component] = static_cast<TValue>(values[component] * scale);
+  }
+}
+
+template <typename TValue>
+void SetPixelComponents(const double* const values, const unsigned int numberOfComponents,
+                        itk::VariableLengthVector<TValue>& pixel, const double scale)
+{
+  pixel.SetSize(numberOfComponents);
+  for(unsigned int component = 0; component < numberOfComponents; ++component)
+  {
+    pixel[component] = static_cast<TValue>(values[component] * scale);
+  }
+}
+
+template <typename TPixel, typename TComponent>
+typename std::enable_if<std::is_arithmetic<TPixel>::value>::type
+GetPixelComponents(const TPixel& pixel, const unsigned int, TComponent* const values)
+{
+  values[0] = static_cast<TComponent>(pixel);
+}
+
+template <typename TValue, unsigned int VLength, typename TComponent>
+void GetPixelComponents(const itk::FixedArray<TValue, VLength>& pixel, const unsigned int numberOfComponents,
+                        TComponent* const values)
+{
+  for(unsigned int component = 0; component < numberOfComponents; ++component)
+  {
+    values[component] = static_cast<TComponent>(pixel[component]);
+  }
+}
+
+template <typename TValue, typename TComponent>
+void GetPixelComponents(const itk::VariableLengthVector<TValue>& pixel, const unsigned int numberOfComponents,
+                        TComponent* const values)
+{
+  for(unsigned int component = 0; component < numberOfComponents; ++component)
+  {
+    values[component] = static_cast<TComponent>(pixel[component]);
+  }
+}
+
+} // end namespace
+
+#endif
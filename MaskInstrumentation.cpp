@@ -0,0 +1,207 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "MaskInstrumentation.h"
+
+// STL
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace MaskInstrumentation
+{
+
+namespace
+{
+/** The counters of one thread, by the address of the operation name. The mutex is only contended
+  * while a snapshot or reset reads them. */
+struct ThreadCounters
+{
+  std::mutex Mutex;
+  std::unordered_map<const char*, OperationCounters> Operations;
+};
+
+/** All of the threads that have recorded an operation, and the totals of the threads that have exited.*/
+struct Registry
+{
+  std::mutex Mutex;
+  std::vector<std::shared_ptr<ThreadCounters> > Threads;
+  SnapshotType RetiredOperations;
+};
+
+Registry& GetRegistry()
+{
+  static Registry registry;
+  return registry;
+}
+
+void AddCounters(const OperationCounters& counters, OperationCounters& total)
+{
+  total.NumberOfCalls += counters.NumberOfCalls;
+  total.Seconds += counters.Seconds;
+  total.PixelsVisited += counters.PixelsVisited;
+  total.BytesAllocated += counters.BytesAllocated;
+}
+
+/** Registers this thread's counters on first use, and folds them into the retired totals when the thread exits.*/
+struct ThreadCountersHolder
+{
+  ThreadCountersHolder() : Counters(std::make_shared<ThreadCounters>())
+  {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> registryLock(registry.Mutex);
+    registry.Threads.push_back(this->Counters);
+  }
+
+  ~ThreadCountersHolder()
+  {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> registryLock(registry.Mutex);
+    std::lock_guard<std::mutex> countersLock(this->Counters->Mutex);
+    for(const auto& operation : this->Counters->Operations)
+    {
+      AddCounters(operation.second, registry.RetiredOperations[operation.first]);
+    }
+    registry.Threads.erase(std::find(registry.Threads.begin(), registry.Threads.end(), this->Counters));
+  }
+
+  std::shared_ptr<ThreadCounters> Counters;
+};
+
+ThreadCounters& GetThreadCounters()
+{
+  thread_local ThreadCountersHolder holder;
+  return *holder.Counters;
+}
+
+thread_local ScopedOperation* CurrentOperation = nullptr;
+
+} // end anonymous namespace
+
+bool IsEnabled()
+{
+#ifdef MASK_ENABLE_INSTRUMENTATION
+  return true;
+#else
+  return false;
+#endif
+}
+
+SnapshotType GetSnapshot()
+{
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> registryLock(registry.Mutex);
+
+  SnapshotType snapshot = registry.RetiredOperations;
+  for(const std::shared_ptr<ThreadCounters>& threadCounters : registry.Threads)
+  {
+    std::lock_guard<std::mutex> countersLock(threadCounters->Mutex);
+    for(const auto& operation : threadCounters->Operations)
+    {
+      AddCounters(operation.second, snapshot[operation.first]);
+    }
+  }
+
+  return snapshot;
+}
+
+void Reset()
+{
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> registryLock(registry.Mutex);
+
+  registry.RetiredOperations.clear();
+  for(const std::shared_ptr<ThreadCounters>& threadCounters : registry.Threads)
+  {
+    std::lock_guard<std::mutex> countersLock(threadCounters->Mutex);
+    threadCounters->Operations.clear();
+  }
+}
+
+void WriteSnapshot(const SnapshotType& snapshot, std::ostream& output)
+{
+  std::size_t nameWidth = 9;
+  for(const auto& operation : snapshot)
+  {
+    nameWidth = std::max(nameWidth, operation.first.size());
+  }
+
+  const std::ios::fmtflags flags = output.flags();
+  const std::streamsize precision = output.precision();
+  output << std::fixed << std::setprecision(3);
+
+  output << std::left << std::setw(static_cast<int>(nameWidth)) << "Operation" << std::right
+         << std::setw(12) << "Calls" << std::setw(14) << "Total (ms)" << std::setw(14) << "Mean (us)"
+         << std::setw(16) << "Pixels" << std::setw(16) << "Bytes" << std::endl;
+
+  for(const auto& operation : snapshot)
+  {
+    const OperationCounters& counters = operation.second;
+    const double meanMicroseconds =
+        counters.NumberOfCalls > 0 ? counters.Seconds * 1e6 / static_cast<double>(counters.NumberOfCalls) : 0.0;
+    output << std::left << std::setw(static_cast<int>(nameWidth)) << operation.first << std::right
+           << std::setw(12) << counters.NumberOfCalls
+           << std::setw(14) << counters.Seconds * 1e3 << std::setw(14) << meanMicroseconds
+           << std::setw(16) << counters.PixelsVisited << std::setw(16) << counters.BytesAllocated << std::endl;
+  }
+
+  output.flags(flags);
+  output.precision(precision);
+}
+
+void AddPixelsVisited(const uint64_t numberOfPixels)
+{
+  if(CurrentOperation)
+  {
+    CurrentOperation->PixelsVisited += numberOfPixels;
+  }
+}
+
+void AddBytesAllocated(const uint64_t numberOfBytes)
+{
+  if(CurrentOperation)
+  {
+    CurrentOperation->BytesAllocated += numberOfBytes;
+  }
+}
+
+ScopedOperation::ScopedOperation(const char* const name) :
+  Name(name), StartTime(std::chrono::steady_clock::now()), Parent(CurrentOperation)
+{
+  CurrentOperation = this;
+}
+
+ScopedOperation::~ScopedOperation()
+{
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - this->StartTime).count();
+  CurrentOperation = this->Parent;
+
+  ThreadCounters& threadCounters = GetThreadCounters();
+  std::lock_guard<std::mutex> countersLock(threadCounters.Mutex);
+  OperationCounters& counters = threadCounters.Operations[this->Name];
+  counters.NumberOfCalls++;
+  counters.Seconds += seconds;
+  counters.PixelsVisited += this->PixelsVisited;
+  counters.BytesAllocated += this->BytesAllocated;
+}
+
+} // end MaskInstrumentation namespace
@@ -0,0 +1,120 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/**
+\namespace MaskInstrumentation
+\brief Optional counters for the Mask and MaskOperations entry points: the number of calls, the wall
+       time, the pixels visited and the bytes allocated by each operation. Configure with
+       Mask_EnableInstrumentation (which defines MASK_ENABLE_INSTRUMENTATION) to record them;
+       otherwise the MASK_INSTRUMENT_* macros expand to nothing and snapshots are empty.
+
+       Each thread records into its own counters, which GetSnapshot() sums by operation name.
+       Times are inclusive, and an operation that calls another is counted under both names. Pixels
+       and bytes are added to the innermost operation running on the calling thread.
+
+       MASK_INSTRUMENT_OPERATION also emits MaskTrace events when MASK_ENABLE_TRACING is defined,
+       independently of MASK_ENABLE_INSTRUMENTATION.
+*/
+
+#ifndef MaskInstrumentation_H
+#define MaskInstrumentation_H
+
+// Custom
+#include "MaskTrace.h"
+
+// STL
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+namespace MaskInstrumentation
+{
+
+struct OperationCounters
+{
+  uint64_t NumberOfCalls = 0;
+  double Seconds = 0.0;
+  uint64_t PixelsVisited = 0;
+  uint64_t BytesAllocated = 0;
+};
+
+/** The counters of every operation that has been called, by operation name.*/
+typedef std::map<std::string, OperationCounters> SnapshotType;
+
+/** Determine if the library was built with MASK_ENABLE_INSTRUMENTATION.*/
+bool IsEnabled();
+
+/** Get the sum of the counters of all threads (including threads that have exited) since the last Reset().*/
+SnapshotType GetSnapshot();
+
+/** Zero the counters of all threads.*/
+void Reset();
+
+/** Write 'snapshot' as a table with one operation per line.*/
+void WriteSnapshot(const SnapshotType& snapshot, std::ostream& output);
+
+/** Add to the pixels visited by the innermost operation running on this thread (if there is one).*/
+void AddPixelsVisited(const uint64_t numberOfPixels);
+
+/** Add to the bytes allocated by the innermost operation running on this thread (if there is one).*/
+void AddBytesAllocated(const uint64_t numberOfBytes);
+
+/** Records one call of the operation 'name' from construction to destruction. 'name' must be a
+  * string literal (or otherwise outlive the program's use of the counters). */
+class ScopedOperation
+{
+public:
+  explicit ScopedOperation(const char* const name);
+  ~ScopedOperation();
+
+private:
+  ScopedOperation(const ScopedOperation&); // purposely not implemented
+  void operator=(const ScopedOperation&); // purposely not implemented
+
+  friend void AddPixelsVisited(const uint64_t numberOfPixels);
+  friend void AddBytesAllocated(const uint64_t numberOfBytes);
+
+  const char* const Name;
+  const std::chrono::steady_clock::time_point StartTime;
+  uint64_t PixelsVisited = 0;
+  uint64_t BytesAllocated = 0;
+
+  /** The operation that was running on this thread when this one started.*/
+  ScopedOperation* const Parent;
+};
+
+} // end MaskInstrumentation namespace
+
+#ifdef MASK_ENABLE_INSTRUMENTATION
+  #define MASK_INSTRUMENT_COUNTERS(name) \
+    MaskInstrumentation::ScopedOperation maskInstrumentedOperation(name)
+  #define MASK_INSTRUMENT_PIXELS(numberOfPixels) \
+    MaskInstrumentation::AddPixelsVisited(static_cast<uint64_t>(numberOfPixels))
+  #define MASK_INSTRUMENT_BYTES(numberOfBytes) \
+    MaskInstrumentation::AddBytesAllocated(static_cast<uint64_t>(numberOfBytes))
+#else
+  #define MASK_INSTRUMENT_COUNTERS(name)
+  #define MASK_INSTRUMENT_PIXELS(numberOfPixels)
+  #define MASK_INSTRUMENT_BYTES(numberOfBytes)
+#endif
+
+#define MASK_INSTRUMENT_OPERATION(name) MASK_INSTRUMENT_COUNTERS(name); MASK_TRACE_SCOPE(name)
+
+#endif
@@ -0,0 +1,106 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/**
+\class MaskLineWalker
+\brief Walks the pixels of the digital line from 'start' to 'end' (both included) with the incremental
+       Bresenham algorithm. Unlike itk::BresenhamLine, the pixels are produced one at a time, so no
+       vector of indices is built for each line.
+*/
+
+#ifndef MaskLineWalker_H
+#define MaskLineWalker_H
+
+// ITK
+#include "itkIndex.h"
+
+class MaskLineWalker
+{
+public:
+  MaskLineWalker(const itk::Index<2>& start, const itk::Index<2>& end) : Pixel(start)
+  {
+    for(unsigned int dimension = 0; dimension < 2; ++dimension)
+    {
+      const itk::IndexValueType delta = end[dimension] - start[dimension];
+      this->Direction[dimension] = (delta < 0) ? -1 : 1;
+      this->Delta[dimension] = (delta < 0) ? -delta : delta;
+    }
+
+    this->MajorAxis = (this->Delta[0] >= this->Delta[1]) ? 0 : 1;
+    this->MinorAxis = 1 - this->MajorAxis;
+  }
+
+  /** The pixel the walker is currently on.*/
+  const itk::Index<2>& GetPixel() const
+  {
+    return this->Pixel;
+  }
+
+  /** How many steps have been taken from 'start'.*/
+  itk::SizeValueType GetStepNumber() const
+  {
+    return this->StepNumber;
+  }
+
+  /** The number of pixels on the line.*/
+  itk::SizeValueType GetNumberOfPixels() const
+  {
+    return static_cast<itk::SizeValueType>(this->Delta[this->MajorAxis]) + 1;
+  }
+
+  /** The axis along which every step moves by exactly one pixel (0 for mostly horizontal lines).*/
+  unsigned int GetMajorAxis() const
+  {
+    return this->MajorAxis;
+  }
+
+  /** Determine if the walker has moved past 'end'.*/
+  bool IsAtEnd() const
+  {
+    return this->StepNumber >= this->GetNumberOfPixels();
+  }
+
+  /** Move to the next pixel of the line.*/
+  void Next()
+  {
+    this->StepNumber++;
+    this->Pixel[this->MajorAxis] += this->Direction[this->MajorAxis];
+
+    // The minor coordinate is round(step * minorDelta / majorDelta), tracked without division.
+    this->Error += 2 * this->Delta[this->MinorAxis];
+    if(this->Error > this->Delta[this->MajorAxis])
+    {
+      this->Pixel[this->MinorAxis] += this->Direction[this->MinorAxis];
+      this->Error -= 2 * this->Delta[this->MajorAxis];
+    }
+  }
+
+private:
+  itk::Index<2> Pixel;
+
+  itk::IndexValueType Direction[2];
+  itk::IndexValueType Delta[2];
+
+  unsigned int MajorAxis;
+  unsigned int MinorAxis;
+
+  itk::OffsetValueType Error = 0;
+  itk::SizeValueType StepNumber = 0;
+};
+
+#endif
@@ -17,16 +17,65 @@
  *=========================================================================*/
 
 #include "MaskOperations.h"
+#include "MaskInstrumentation.h"
+#include "MaskLineWalker.h"
+#include "MaskParallel.h"
+#include "MaskPatchSampler.h"
 
 // STL
+#include <algorithm>
+#include <cmath>
+#include <sstream>
 #include <stdexcept>
 
+namespace
+{
+/** Try random patch corners in 'searchRegion' until one is a fully valid patch.
+  * 'randomInteger(min, max)' must return a uniformly distributed integer in [min, max].*/
+template <typename TRandomInteger>
+itk::ImageRegion<2> DrawValidPatchInRegionByRejection(const Mask* const mask,
+                                                      const itk::ImageRegion<2>& searchRegion,
+                                                      const unsigned int patchRadius,
+                                                      const unsigned int maxNumberOfAttempts,
+                                                      TRandomInteger randomInteger)
+{
+  assert(mask);
+
+  unsigned int numberOfAttempts = 0;
+
+  itk::Size<2> patchSize = {{patchRadius * 2 + 1, patchRadius * 2 + 1}};
+  itk::ImageRegion<2> region;
+  region.SetSize(patchSize);
+
+  do
+  {
+    int randX = randomInteger(searchRegion.GetIndex()[0],
+                              searchRegion.GetIndex()[0] + searchRegion.GetSize()[0] - 1);
+
+    int randY = randomInteger(searchRegion.GetIndex()[1],
+                              searchRegion.GetIndex()[1] + searchRegion.GetSize()[1] - 1);
+
+    itk::Index<2> randomIndex = {{randX, randY}};
+    region.SetIndex(randomIndex);
+
+    numberOfAttempts++;
+    if(numberOfAttempts > maxNumberOfAttempts)
+    {
+      throw std::runtime_error("The numberOfAttempts exceeded maxNumberOfAttempts!");
+    }
+  } while(!(mask->GetLargestPossibleRegion().IsInside(region) && mask->IsValid(region)));
+
+  return region;
+}
+} // end anonymous namespace
+
 namespace MaskOperations
 {
 
 itk::Index<2> FindPixelAcrossHole(const itk::Index<2>& queryPixel,
                                   const ITKHelpers::FloatVector2Type& inputDirection, const Mask* const mask)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::FindPixelAcrossHole");
   assert(mask);
   if(!mask->IsValid(queryPixel))
     {
@@ -65,71 +114,222 @@ itk::Index<2> FindPixelAcrossHole(const itk::Index<2>& queryPixel,
   return nextPixelAlongVector;
 }
 
+void FindPixelsAcrossHole(const std::vector<itk::Index<2> >& queryPixels,
+                          const std::vector<ITKHelpers::FloatVector2Type>& directions, const Mask* const mask,
+                          std::vector<itk::Index<2> >& pixelsAcrossHole,
+                          std::vector<AcrossHoleStatusEnum>& statuses)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::FindPixelsAcrossHole");
+  assert(mask);
+  if(queryPixels.size() != directions.size())
+  {
+    std::stringstream ss;
+    ss << "FindPixelsAcrossHole: there are " << queryPixels.size() << " query pixels but "
+       << directions.size() << " directions!";
+    throw std::runtime_error(ss.str());
+  }
+
+  pixelsAcrossHole = queryPixels;
+  statuses.assign(queryPixels.size(), AcrossHoleStatusEnum::FOUND);
+
+  const itk::ImageRegion<2> region = mask->GetLargestPossibleRegion();
+  std::shared_ptr<const Mask::NearestPixelMapType> nearestNonHolePixelMap = mask->GetNearestNonHolePixelMap();
+
+  MaskParallel::ParallelFor(0, queryPixels.size(), [&](const std::size_t firstQuery, const std::size_t endQuery)
+  {
+    for(std::size_t queryId = firstQuery; queryId < endQuery; ++queryId)
+    {
+      const itk::Index<2>& queryPixel = queryPixels[queryId];
+      if(!region.IsInside(queryPixel) || !mask->IsValid(queryPixel))
+      {
+        statuses[queryId] = AcrossHoleStatusEnum::INVALID_QUERY;
+        continue;
+      }
+
+      // Choose the direction into the hole exactly as FindPixelAcrossHole() does.
+      ITKHelpers::FloatVector2Type direction = directions[queryId];
+      itk::Offset<2> step = ITKHelpers::GetNextPixelAlongVector(queryPixel, direction) - queryPixel;
+      itk::Index<2> pixel = queryPixel + step;
+      if(!(region.IsInside(pixel) && mask->IsHole(pixel)))
+      {
+        direction *= -1.0;
+        step = ITKHelpers::GetNextPixelAlongVector(queryPixel, direction) - queryPixel;
+        pixel = queryPixel + step;
+      }
+
+      const itk::OffsetValueType stepLengthSquared = step[0] * step[0] + step[1] * step[1];
+
+      // Trace across the hole. Every pixel closer to 'pixel' than its nearest non-hole pixel is a hole
+      // pixel, so the walk can jump over all of the steps that stay strictly inside that distance.
+      while(region.IsInside(pixel) && mask->IsHole(pixel))
+      {
+        const itk::Index<2> nearestNonHolePixel =
+            mask->ComputeIndex((*nearestNonHolePixelMap)[mask->ComputeOffset(pixel)]);
+        const itk::OffsetValueType distanceX = nearestNonHolePixel[0] - pixel[0];
+        const itk::OffsetValueType distanceY = nearestNonHolePixel[1] - pixel[1];
+        const itk::OffsetValueType distanceSquared = distanceX * distanceX + distanceY * distanceY;
+
+        // The largest number of steps k with (k * |step|)^2 < distance^2, computed exactly.
+        itk::OffsetValueType numberOfSteps =
+            static_cast<itk::OffsetValueType>(std::sqrt(static_cast<double>(distanceSquared) / stepLengthSquared));
+        while(numberOfSteps > 0 && numberOfSteps * numberOfSteps * stepLengthSquared >= distanceSquared)
+        {
+          numberOfSteps--;
+        }
+        while((numberOfSteps + 1) * (numberOfSteps + 1) * stepLengthSquared < distanceSquared)
+        {
+          numberOfSteps++;
+        }
+        numberOfSteps = std::max<itk::OffsetValueType>(numberOfSteps, 1);
+
+        pixel[0] += numberOfSteps * step[0];
+        pixel[1] += numberOfSteps * step[1];
+      }
+
+      // A straight walk that leaves the (convex) image never comes back, so it has no exit.
+      if(!region.IsInside(pixel))
+      {
+        statuses[queryId] = AcrossHoleStatusEnum::NO_EXIT;
+        continue;
+      }
+
+      pixelsAcrossHole[queryId] = pixel;
+    }
+  });
+}
+
 
 itk::ImageRegion<2> RandomRegionInsideHole(const Mask* const mask, const unsigned int halfWidth)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::RandomRegionInsideHole");
   assert(mask);
-  std::vector<itk::Index<2> > holePixels = mask->GetHolePixelsInRegion(mask->GetLargestPossibleRegion());
+  std::shared_ptr<const MaskPatchSampler> sampler = mask->GetPatchSampler(HoleMaskPixelTypeEnum::HOLE, halfWidth);
 
-  itk::ImageRegion<2> randomRegion;
+  if(sampler->IsEmpty())
+  {
+    return itk::ImageRegion<2>();
+  }
 
-  do
+  return sampler->DrawPatch();
+}
+
+itk::ImageRegion<2> RandomRegionInsideHole(const Mask* const mask, const unsigned int halfWidth,
+                                           MaskRandomState& randomState)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::RandomRegionInsideHole");
+  assert(mask);
+  std::shared_ptr<const MaskPatchSampler> sampler = mask->GetPatchSampler(HoleMaskPixelTypeEnum::HOLE, halfWidth);
+
+  if(sampler->IsEmpty())
   {
-    itk::Index<2> randomPixel = holePixels[rand() % holePixels.size()];
-    randomRegion = ITKHelpers::GetRegionInRadiusAroundPixel(randomPixel, halfWidth);
-  } while (!mask->IsHole(randomRegion));
+    return itk::ImageRegion<2>();
+  }
 
-  return randomRegion;
+  return sampler->DrawPatch(randomState);
 }
 
 itk::ImageRegion<2> RandomValidRegion(const Mask* const mask, const unsigned int halfWidth)
 {
-  // The center pixel must be valid, so we choose one from the valid pixels.
-  std::vector<itk::Index<2> > validPixels = mask->GetValidPixelsInRegion(mask->GetLargestPossibleRegion());
+  MASK_INSTRUMENT_OPERATION("MaskOperations::RandomValidRegion");
+  assert(mask);
+  std::shared_ptr<const MaskPatchSampler> sampler = mask->GetPatchSampler(HoleMaskPixelTypeEnum::VALID, halfWidth);
 
-  itk::ImageRegion<2> randomRegion;
+  if(sampler->IsEmpty())
+  {
+    return itk::ImageRegion<2>();
+  }
 
-  do
+  return sampler->DrawPatch();
+}
+
+itk::ImageRegion<2> RandomValidRegion(const Mask* const mask, const unsigned int halfWidth,
+                                      MaskRandomState& randomState)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::RandomValidRegion");
+  assert(mask);
+  std::shared_ptr<const MaskPatchSampler> sampler = mask->GetPatchSampler(HoleMaskPixelTypeEnum::VALID, halfWidth);
+
+  if(sampler->IsEmpty())
   {
-    itk::Index<2> randomPixel = validPixels[rand() % validPixels.size()];
-    randomRegion = ITKHelpers::GetRegionInRadiusAroundPixel(randomPixel, halfWidth);
-  } while (!mask->IsValid(randomRegion));
+    return itk::ImageRegion<2>();
+  }
 
-  return randomRegion;
+  return sampler->DrawPatch(randomState);
 }
 
 itk::ImageRegion<2> ComputeValidBoundingBox(const Mask* const mask)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::ComputeValidBoundingBox");
+  MASK_INSTRUMENT_PIXELS(mask->GetLargestPossibleRegion().GetNumberOfPixels());
   return ITKHelpers::ComputeBoundingBox(mask, HoleMaskPixelTypeEnum::VALID);
 }
 
 itk::ImageRegion<2> ComputeHoleBoundingBox(const Mask* const mask)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::ComputeHoleBoundingBox");
+  MASK_INSTRUMENT_PIXELS(mask->GetLargestPossibleRegion().GetNumberOfPixels());
   return ITKHelpers::ComputeBoundingBox(mask, HoleMaskPixelTypeEnum::HOLE);
 }
 
 
-std::vector<itk::ImageRegion<2> > GetAllFullyValidRegions(const Mask* const mask,
-                                                          const itk::ImageRegion<2>& searchRegion,
-                                                          const unsigned int patchRadius)
+std::vector<itk::Index<2> > GetAllFullyValidPatchCenters(const Mask* const mask,
+                                                         const itk::ImageRegion<2>& searchRegion,
+                                                         const unsigned int patchRadius)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::GetAllFullyValidPatchCenters");
   assert(mask);
 
-  std::vector<itk::ImageRegion<2> > fullyValidRegions;
+  std::vector<itk::Index<2> > fullyValidPatchCenters;
 
-  itk::ImageRegionConstIteratorWithIndex<Mask> imageIterator(mask, searchRegion);
+  itk::ImageRegion<2> croppedSearchRegion = searchRegion;
+  const itk::SizeValueType patchWidth = 2 * patchRadius + 1;
+  if(!croppedSearchRegion.Crop(mask->GetLargestPossibleRegion()) ||
+     croppedSearchRegion.GetSize()[0] < patchWidth || croppedSearchRegion.GetSize()[1] < patchWidth)
+    {
+    return fullyValidPatchCenters;
+    }
 
-  itk::Size<2> patchSize = {{patchRadius * 2 + 1, patchRadius * 2 + 1}};
+  std::shared_ptr<const Mask::PatchCenterMapType> validPatchCenterMap = mask->GetValidPatchCenterMap(patchRadius);
 
-  while(!imageIterator.IsAtEnd())
-    {
-    itk::ImageRegion<2> region(imageIterator.GetIndex(), patchSize);
+  // A patch is inside the search region if its center is at least patchRadius away from the region's edges.
+  const itk::IndexValueType firstX = croppedSearchRegion.GetIndex()[0] + patchRadius;
+  const itk::IndexValueType lastX = croppedSearchRegion.GetIndex()[0] + croppedSearchRegion.GetSize()[0] - patchRadius - 1;
+  const itk::IndexValueType firstY = croppedSearchRegion.GetIndex()[1] + patchRadius;
+  const itk::IndexValueType lastY = croppedSearchRegion.GetIndex()[1] + croppedSearchRegion.GetSize()[1] - patchRadius - 1;
 
-    if(searchRegion.IsInside(region) && mask->IsValid(region))
+  for(itk::IndexValueType y = firstY; y <= lastY; ++y)
+    {
+    itk::Index<2> center = {{firstX, y}};
+    const unsigned char* rowCenters = &(*validPatchCenterMap)[mask->ComputeOffset(center)];
+    for(itk::IndexValueType x = firstX; x <= lastX; ++x, ++rowCenters)
       {
-      fullyValidRegions.push_back(region);
+      if(*rowCenters)
+        {
+        center[0] = x;
+        fullyValidPatchCenters.push_back(center);
+        }
       }
-    ++imageIterator;
+    }
+
+  return fullyValidPatchCenters;
+}
+
+std::vector<itk::ImageRegion<2> > GetAllFullyValidRegions(const Mask* const mask,
+                                                          const itk::ImageRegion<2>& searchRegion,
+                                                          const unsigned int patchRadius)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::GetAllFullyValidRegions");
+  assert(mask);
+
+  std::vector<itk::Index<2> > fullyValidPatchCenters =
+      GetAllFullyValidPatchCenters(mask, searchRegion, patchRadius);
+
+  std::vector<itk::ImageRegion<2> > fullyValidRegions;
+  fullyValidRegions.reserve(fullyValidPatchCenters.size());
+
+  for(unsigned int i = 0; i < fullyValidPatchCenters.size(); ++i)
+    {
+    fullyValidRegions.push_back(ITKHelpers::GetRegionInRadiusAroundPixel(fullyValidPatchCenters[i], patchRadius));
     }
 
   return fullyValidRegions;
@@ -146,95 +346,230 @@ itk::ImageRegion<2> GetRandomValidPatchInRegion(const Mask* const mask,
                                                 const unsigned int patchRadius,
                                                 const unsigned int maxNumberOfAttempts)
 {
-  assert(mask);
+  MASK_INSTRUMENT_OPERATION("MaskOperations::GetRandomValidPatchInRegion");
+  return DrawValidPatchInRegionByRejection(mask, searchRegion, patchRadius, maxNumberOfAttempts,
+                                           [](const int minValue, const int maxValue)
+                                           {
+                                             return Helpers::RandomInt(minValue, maxValue);
+                                           });
+}
 
-  unsigned int numberOfAttempts = 0;
+itk::ImageRegion<2> GetRandomValidPatchInRegion(const Mask* const mask,
+                                                const itk::ImageRegion<2>& searchRegion,
+                                                const unsigned int patchRadius,
+                                                const unsigned int maxNumberOfAttempts,
+                                                MaskRandomState& randomState)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::GetRandomValidPatchInRegion");
+  return DrawValidPatchInRegionByRejection(mask, searchRegion, patchRadius, maxNumberOfAttempts,
+                                           [&randomState](const int minValue, const int maxValue)
+                                           {
+                                             // Shift to unsigned so negative indices are handled.
+                                             const uint64_t range = static_cast<uint64_t>(
+                                                   static_cast<int64_t>(maxValue) - minValue);
+                                             return static_cast<int>(minValue + static_cast<int64_t>(
+                                                   randomState.NextUniformInteger(0, range)));
+                                           });
+}
 
-  itk::Size<2> patchSize = {{patchRadius * 2 + 1, patchRadius * 2 + 1}};
-  itk::ImageRegion<2> region;
-  region.SetSize(patchSize);
+itk::ImageRegion<2> GetRandomValidPatchInRegion(const Mask* const mask,
+                                                const itk::ImageRegion<2>& searchRegion,
+                                                const unsigned int patchRadius)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::GetRandomValidPatchInRegion");
+  assert(mask);
+  std::shared_ptr<const MaskPatchSampler> sampler =
+      mask->GetPatchSampler(HoleMaskPixelTypeEnum::VALID, patchRadius, searchRegion);
 
-  do
+  if(sampler->IsEmpty()) // There are actually no valid regions in this searchRegion
   {
-    int randX = Helpers::RandomInt(searchRegion.GetIndex()[0],
-                                   searchRegion.GetIndex()[0] + searchRegion.GetSize()[0] - 1);
-
-    int randY = Helpers::RandomInt(searchRegion.GetIndex()[1],
-                                   searchRegion.GetIndex()[1] + searchRegion.GetSize()[1] - 1);
+    return itk::ImageRegion<2>();
+  }
 
-    itk::Index<2> randomIndex = {{randX, randY}};
-    //std::cout << "RandomIndex: " << randomIndex << std::endl;
-    region.SetIndex(randomIndex);
-
-    numberOfAttempts++;
-    if(numberOfAttempts > maxNumberOfAttempts)
-    {
-      throw std::runtime_error("The numberOfAttempts exceeded maxNumberOfAttempts!");
-    }
-  } while(!(mask->GetLargestPossibleRegion().IsInside(region) && mask->IsValid(region)));
-
-  return region;
+  return sampler->DrawPatch();
 }
 
 itk::ImageRegion<2> GetRandomValidPatchInRegion(const Mask* const mask,
                                                 const itk::ImageRegion<2>& searchRegion,
-                                                const unsigned int patchRadius)
+                                                const unsigned int patchRadius,
+                                                MaskRandomState& randomState)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::GetRandomValidPatchInRegion");
   assert(mask);
+  std::shared_ptr<const MaskPatchSampler> sampler =
+      mask->GetPatchSampler(HoleMaskPixelTypeEnum::VALID, patchRadius, searchRegion);
 
-  unsigned int numberOfAttempts = 0;
+  if(sampler->IsEmpty()) // There are actually no valid regions in this searchRegion
+  {
+    return itk::ImageRegion<2>();
+  }
 
-  itk::Size<2> patchSize = {{patchRadius * 2 + 1, patchRadius * 2 + 1}};
-  itk::ImageRegion<2> region;
-  region.SetSize(patchSize);
+  return sampler->DrawPatch(randomState);
+}
 
-  unsigned int maxRandomAttemps = 10;
-  do
-  {
-    int randX = Helpers::RandomInt(searchRegion.GetIndex()[0],
-                                   searchRegion.GetIndex()[0] + searchRegion.GetSize()[0] - 1);
 
-    int randY = Helpers::RandomInt(searchRegion.GetIndex()[1],
-                                   searchRegion.GetIndex()[1] + searchRegion.GetSize()[1] - 1);
+void FindHoleIntervalsAlongLine(const Mask* const mask, const itk::Index<2>& p0, const itk::Index<2>& p1,
+                                std::vector<LineHoleInterval>& intervals)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::FindHoleIntervalsAlongLine");
+  assert(mask);
+  intervals.clear();
+
+  const itk::ImageRegion<2> region = mask->GetLargestPossibleRegion();
 
-    itk::Index<2> randomIndex = {{randX, randY}};
-    //std::cout << "RandomIndex: " << randomIndex << std::endl;
-    region.SetIndex(randomIndex);
+  // The two pixels before the current one, and whether they are valid.
+  itk::Index<2> previousPixel = p0;
+  itk::Index<2> previousPreviousPixel = p0;
+  bool previousIsValid = false;
+  bool previousPreviousIsValid = false;
 
-    numberOfAttempts++;
-    if(numberOfAttempts > maxRandomAttemps)
+  bool inHoleRun = false;
+  bool lastIntervalNeedsOuterAfterPixel = false;
+  LineHoleInterval interval;
+
+  for(MaskLineWalker walker(p0, p1); !walker.IsAtEnd(); walker.Next())
+  {
+    const itk::Index<2>& pixel = walker.GetPixel();
+    const HoleMaskPixelTypeEnum pixelType =
+        region.IsInside(pixel) ? mask->GetPixel(pixel) : HoleMaskPixelTypeEnum::UNDETERMINED;
+    const bool isValid = (pixelType == HoleMaskPixelTypeEnum::VALID);
+
+    if(lastIntervalNeedsOuterAfterPixel)
     {
-      //std::cout << "Searching all patches in region for a valid patch..." << std::endl;
+      intervals.back().HasOuterAfterPixel = isValid;
+      intervals.back().OuterAfterPixel = pixel;
+      lastIntervalNeedsOuterAfterPixel = false;
+    }
 
-      // This function is relatively slow.
-      std::vector<itk::ImageRegion<2> > allRegions = GetAllFullyValidRegions(mask, searchRegion, patchRadius);
-      if(allRegions.size() == 0) // There are actually no valid regions in this searchRegion
+    if(pixelType == HoleMaskPixelTypeEnum::HOLE)
+    {
+      if(!inHoleRun && previousIsValid) // Found an entry point
       {
-        //std::cout << "No valid patch found." << std::endl;
-        itk::Size<2> regionSize = {{0,0}};
-        region.SetSize(regionSize);
-        return region;
+        inHoleRun = true;
+        interval.FirstHoleStep = walker.GetStepNumber();
+        interval.BeforePixel = previousPixel;
+        interval.HasOuterBeforePixel = previousPreviousIsValid;
+        interval.OuterBeforePixel = previousPreviousPixel;
       }
-      else
+    }
+    else
+    {
+      if(inHoleRun && isValid) // Found the exit point
       {
-//         std::cout << "Valid patch finally found." << std::endl;
-//         std::cout << "allRegions.size() = " << allRegions.size() << std::endl;
-        unsigned int randomIndex = Helpers::RandomInt(0, allRegions.size() - 1);
-//        std::cout << "Returning patch " << randomIndex << std::endl;
-
-        return allRegions[randomIndex];
+        interval.LastHoleStep = walker.GetStepNumber() - 1;
+        interval.AfterPixel = pixel;
+        interval.HasOuterAfterPixel = false;
+        intervals.push_back(interval);
+        lastIntervalNeedsOuterAfterPixel = true;
       }
+      inHoleRun = false;
     }
-  } while(!(mask->GetLargestPossibleRegion().IsInside(region) && mask->IsValid(region)));
 
-  return region;
+    previousPreviousPixel = previousPixel;
+    previousPreviousIsValid = previousIsValid;
+    previousPixel = pixel;
+    previousIsValid = isValid;
+  }
+}
+
+namespace Internal
+{
+
+void ComputeLineInterpolationWeights(const float t, const float length, const LineInterpolationEnum interpolation,
+                                     const bool useOuterBefore, const bool useOuterAfter, float weights[4])
+{
+  weights[0] = 1.0f - t;
+  weights[1] = t;
+  weights[2] = 0.0f;
+  weights[3] = 0.0f;
+
+  if(interpolation != LineInterpolationEnum::CUBIC)
+  {
+    return;
+  }
+
+  // Cubic Hermite basis. A missing outer pixel uses the slope of the chord, which makes that end linear.
+  const float h00 = 2.0f * t * t * t - 3.0f * t * t + 1.0f;
+  const float h10 = t * t * t - 2.0f * t * t + t;
+  const float h01 = -2.0f * t * t * t + 3.0f * t * t;
+  const float h11 = t * t * t - t * t;
+
+  weights[0] = h00;
+  weights[1] = h01;
+
+  if(useOuterBefore)
+  {
+    weights[0] += h10 * length;
+    weights[2] = -h10 * length;
+  }
+  else
+  {
+    weights[0] -= h10;
+    weights[1] += h10;
+  }
+
+  if(useOuterAfter)
+  {
+    weights[1] -= h11 * length;
+    weights[3] = h11 * length;
+  }
+  else
+  {
+    weights[0] -= h11;
+    weights[1] += h11;
+  }
+}
+
+itk::ImageRegion<2> GetFilledLinesRegion(const itk::ImageRegion<2>& region, const unsigned int axis,
+                                         const std::vector<std::pair<itk::OffsetValueType, itk::OffsetValueType> >&
+                                         filledExtents)
+{
+  bool filledAnyLines = false;
+  itk::OffsetValueType firstLine = 0;
+  itk::OffsetValueType lastLine = 0;
+  itk::OffsetValueType firstPosition = 0;
+  itk::OffsetValueType lastPosition = 0;
+
+  for(std::size_t line = 0; line < filledExtents.size(); ++line)
+  {
+    if(filledExtents[line].first > filledExtents[line].second)
+    {
+      continue;
+    }
+
+    if(!filledAnyLines)
+    {
+      firstLine = static_cast<itk::OffsetValueType>(line);
+      firstPosition = filledExtents[line].first;
+      lastPosition = filledExtents[line].second;
+      filledAnyLines = true;
+    }
+    lastLine = static_cast<itk::OffsetValueType>(line);
+    firstPosition = std::min(firstPosition, filledExtents[line].first);
+    lastPosition = std::max(lastPosition, filledExtents[line].second);
+  }
+
+  if(!filledAnyLines)
+  {
+    return itk::ImageRegion<2>();
+  }
+
+  itk::Index<2> corner = region.GetIndex();
+  itk::Size<2> size;
+  corner[axis] += firstPosition;
+  corner[1 - axis] += firstLine;
+  size[axis] = static_cast<itk::SizeValueType>(lastPosition - firstPosition + 1);
+  size[1 - axis] = static_cast<itk::SizeValueType>(lastLine - firstLine + 1);
+  return itk::ImageRegion<2>(corner, size);
 }
 
+} // end namespace Internal
 
 std::pair<itk::Index<2>, itk::Index<2> > IntersectLineWithHole(const std::vector<itk::Index<2> >& line,
                                                                const Mask* const mask,
                                                                bool &hasInteriorLine)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::IntersectLineWithHole");
   assert(mask);
   // We want to find where the line enters the mask, and where it leaves the mask.
   // This function assumes that the line starts outside the mask. Nothing is assumed
@@ -21,6 +21,8 @@
 
 // Custom
 #include "Mask.h"
+#include "MaskHolePipeline.h"
+#include "MaskRandomState.h"
 
 // Submodules
 #include <ITKHelpers/ITKHelpers.h>
@@ -28,17 +30,59 @@
 // ITK
 #include "itkIndex.h"
 #include "itkImageRegion.h"
+#include "itkVectorImage.h"
 
 namespace MaskOperations
 {
 
+/** The outcome of a FindPixelsAcrossHole() query.*/
+enum class AcrossHoleStatusEnum {FOUND, NO_EXIT, INVALID_QUERY};
+
+/** How hole pixels on a line are computed from the valid pixels on either side of the hole.
+  * CUBIC is a Hermite spline whose end slopes come from the next valid pixels outward (when they exist). */
+enum class LineInterpolationEnum {LINEAR, CUBIC};
+
+/** A run of hole pixels along a line that has a valid pixel on both sides. Steps are counted from the
+  * start of the line. The outer pixels are the pixels one step further out than BeforePixel and AfterPixel,
+  * and are only used if they are valid. */
+struct LineHoleInterval
+{
+  itk::SizeValueType FirstHoleStep;
+  itk::SizeValueType LastHoleStep;
+
+  itk::Index<2> BeforePixel;
+  itk::Index<2> AfterPixel;
+
+  bool HasOuterBeforePixel;
+  itk::Index<2> OuterBeforePixel;
+
+  bool HasOuterAfterPixel;
+  itk::Index<2> OuterAfterPixel;
+};
+
+/** The outputs of ComputeLocalMaskedMoments(): the number of valid pixels in the window around each pixel,
+  * and the mean and variance of each component over those pixels. */
+typedef itk::Image<unsigned int, 2> LocalCountImageType;
+typedef itk::VectorImage<float, 2> LocalMomentImageType;
+
 // Functions
-/** Return a random region that is entirely inside the hole. */
+/** Return a random region that is entirely inside the hole, or an empty region if there is none.
+  * The sampler is cached on the mask (see Mask::GetPatchSampler()), so only the first call after the
+  * mask is modified takes linear time. */
 itk::ImageRegion<2> RandomRegionInsideHole(const Mask* const mask, const unsigned int halfWidth);
 
-/** Return a random region that is entirely valid. */
+/** Return a random region that is entirely inside the hole, drawn using 'randomState'. */
+itk::ImageRegion<2> RandomRegionInsideHole(const Mask* const mask, const unsigned int halfWidth,
+                                           MaskRandomState& randomState);
+
+/** Return a random region that is entirely valid, or an empty region if there is none.
+  * Cached like RandomRegionInsideHole(). */
 itk::ImageRegion<2> RandomValidRegion(const Mask* const mask, const unsigned int halfWidth);
 
+/** Return a random region that is entirely valid, drawn using 'randomState'. */
+itk::ImageRegion<2> RandomValidRegion(const Mask* const mask, const unsigned int halfWidth,
+                                      MaskRandomState& randomState);
+
 /** Compute the bounding box of the hole pixels. */
 itk::ImageRegion<2> ComputeHoleBoundingBox(const Mask* const mask);
 
@@ -50,6 +94,17 @@ itk::ImageRegion<2> ComputeValidBoundingBox(const Mask* const mask);
 itk::Index<2> FindPixelAcrossHole(const itk::Index<2>& queryPixel,
                                   const ITKHelpers::FloatVector2Type& direction, const Mask* const mask);
 
+/** Batch version of FindPixelAcrossHole() for many (query pixel, direction) pairs, run in parallel.
+  * Instead of stepping one pixel at a time, each walk jumps as far along its direction as the mask's
+  * distance to the edge of the hole allows, so the result is the same pixel FindPixelAcrossHole() finds.
+  * Nothing is thrown for a failed query: 'statuses[i]' is INVALID_QUERY if 'queryPixels[i]' is not a
+  * valid pixel of the mask and NO_EXIT if the walk leaves the image, and 'pixelsAcrossHole[i]' is then
+  * 'queryPixels[i]'. */
+void FindPixelsAcrossHole(const std::vector<itk::Index<2> >& queryPixels,
+                          const std::vector<ITKHelpers::FloatVector2Type>& directions, const Mask* const mask,
+                          std::vector<itk::Index<2> >& pixelsAcrossHole,
+                          std::vector<AcrossHoleStatusEnum>& statuses);
+
 
 /** Get all regions of a particular size that contain only valid pixels.*/
 std::vector<itk::ImageRegion<2> > GetAllFullyValidRegions(const Mask* const mask,
@@ -60,20 +115,47 @@ std::vector<itk::ImageRegion<2> > GetAllFullyValidRegions(const Mask* const mask
                                                           const itk::ImageRegion<2>& searchRegion,
                                                           const unsigned int patchRadius);
 
+/** Get the centers of all patches of radius 'patchRadius' inside searchRegion that contain only
+  * valid pixels. This is read from the mask's cached valid patch center map. */
+std::vector<itk::Index<2> > GetAllFullyValidPatchCenters(const Mask* const mask,
+                                                         const itk::ImageRegion<2>& searchRegion,
+                                                         const unsigned int patchRadius);
+
 /** Get a random fully valid patch in the specified region, if it exists.*/
 itk::ImageRegion<2> GetRandomValidPatchInRegion(const Mask* const mask,
                                                 const itk::ImageRegion<2>& searchRegion,
                                                 const unsigned int patchRadius,
                                                 const unsigned int maxNumberOfAttempts);
 
-/** Get a random fully valid patch in the specified region. Try harder than the
-  * above function - takes much longer.*/
+/** Get a random fully valid patch in the specified region, if it exists, drawing the candidates using 'randomState'.*/
+itk::ImageRegion<2> GetRandomValidPatchInRegion(const Mask* const mask,
+                                                const itk::ImageRegion<2>& searchRegion,
+                                                const unsigned int patchRadius,
+                                                const unsigned int maxNumberOfAttempts,
+                                                MaskRandomState& randomState);
+
+/** Get a random fully valid patch inside the specified region, or an empty region if there is none.
+  * Every such patch is equally likely. The sampler of 'searchRegion' is cached on the mask (see
+  * Mask::GetPatchSampler()), so only the first draw from a region after the mask is modified takes linear time.*/
 itk::ImageRegion<2> GetRandomValidPatchInRegion(const Mask* const mask,
                                                 const itk::ImageRegion<2>& searchRegion,
                                                 const unsigned int patchRadius);
 
+/** Get a random fully valid patch inside the specified region, or an empty region if there is none,
+  * drawn using 'randomState'.*/
+itk::ImageRegion<2> GetRandomValidPatchInRegion(const Mask* const mask,
+                                                const itk::ImageRegion<2>& searchRegion,
+                                                const unsigned int patchRadius,
+                                                MaskRandomState& randomState);
+
 ////////////////// Templates ////////////////
 
+/** Copy a 'region' of an 'image' into 'output' (which is allocated with its corner at (0,0)),
+  * coloring the hole pixels of 'mask' in the region the color 'holeColor'. */
+template<typename TImage>
+void ExtractMaskedRegion(const TImage* const image, const Mask* const mask, const itk::ImageRegion<2>& region,
+                         const typename TImage::PixelType& holeColor, TImage* const output);
+
 /** Write a 'region' of an 'image' to 'filename', coloring any invalid pixels
   * in 'mask' the color 'holeColor'. */
 template<typename TImage>
@@ -98,6 +180,17 @@ template <typename TImage>
 void MaskedBlurInRegion(const TImage* const inputImage, const Mask* const mask, const itk::ImageRegion<2>& region,
                         const float blurVariance, TImage* const output);
 
+/** Copy the pixels of 'sourceRegion' of 'sourceImage' to the pixels of 'destinationRegion' (the same size) of
+  * 'destinationImage' that are covered by 'spans' (e.g. Mask::GetHoleSpans(destinationRegion)). Each span is
+  * copied as one block. The images may be the same image with overlapping regions, in which case every
+  * pixel gets the source value from before the copy. */
+template <class TImage>
+void CopySpans(const TImage* const sourceImage, const itk::ImageRegion<2>& sourceRegion,
+               TImage* const destinationImage, const itk::ImageRegion<2>& destinationRegion,
+               const Mask::SpanListType& spans);
+
+/** Copy the pixels of 'sourceRegionInput' into the hole pixels of 'destinationRegionInput' of the same image.
+  * The regions may overlap. */
 template <class TImage>
 void CopySelfPatchIntoHoleOfTargetRegion(TImage* const image, const Mask* const mask,
                                          const itk::ImageRegion<2>& sourceRegionInput,
@@ -118,10 +211,21 @@ void CopyRegionIntoHolePortionOfTargetRegion(const TImage* const sourceImage, TI
                                              const Mask* const mask, itk::ImageRegion<2> sourceRegion,
                                              itk::ImageRegion<2> destinationRegion);
 
+/** Copy 'patch' into the hole pixels of the region of 'image' centered at 'position'.*/
+template <class TImage>
+void CopyPatchIntoImage(const TImage* const patch, TImage* const image, const Mask* const mask,
+                        const itk::Index<2>& position);
+
 template<typename TImage>
 void CreatePatchImage(const TImage* const image, const itk::ImageRegion<2>& sourceRegion,
                       const itk::ImageRegion<2>& targetRegion, const Mask* const mask, TImage* const result);
 
+/** Start a chain of operations on the hole pixels of 'image' that is run in one pass by Apply(), e.g.
+  * InHole(image, mask).Add(5).Clip(0, 255).Apply(); See MaskHolePipeline. */
+template<typename TImage>
+MaskHolePipeline<TImage> InHole(TImage* const image, const Mask* const mask);
+
+/** Set every component of the hole pixels to 'value' (despite the name, nothing is added).*/
 template<typename TImage>
 void AddConstantInHole(TImage* const image, const float value, const Mask* const maskImage);
 
@@ -129,23 +233,42 @@ template<typename TImage>
 void SetHolePixelsToConstant(TImage* const image, const typename TImage::PixelType& value,
                              const Mask* const maskImage);
 
-/** Return the highest value of the specified image out of the pixels under a specified 'maskImage'.
-  * The value is returned by reference, since the interal use of MinOfAllIndices requires this. */
+/** Return the highest value (per component) of the specified image out of the pixels under a specified 'maskImage'.
+  * The value is returned by reference. */
 template<typename TImage>
 void FindMaximumValueInMaskedRegion(const TImage* const image,
                                     const Mask* const maskImage, const itk::ImageRegion<2>& region,
                                     const Mask::PixelType maskValue, typename TImage::PixelType& maxValue);
 
-/** Return the lowest value of the specified image out of the pixels under a specified 'maskImage'.
-  * The value is returned by reference, since the interal use of MinOfAllIndices requires this. */
+/** Return the lowest value (per component) of the specified image out of the pixels under a specified 'maskImage'.
+  * The value is returned by reference. */
 template<typename TImage>
 void FindMinimumValueInMaskedRegion(const TImage* const image, const Mask* const maskImage, const itk::ImageRegion<2>& region,
                                     const Mask::PixelType maskValue, typename TImage::PixelType& minValue);
 
-/** Find the highest value in the non-zero part of 'image' */
-template<typename TImage, typename TRegionIndicatorImage>
+/** Find the location of the highest value in the non-zero part of the scalar 'image'. The value is
+  * returned by reference. */
+template<typename TImage>
 itk::Index<2> FindHighestValueInNonZero(const TImage* const image, float& maxValue);
 
+/** Compute the count, mean and (population) variance of the valid pixels in the (2*radius+1) square window
+  * around every pixel of 'region', with the window clipped to the image. The outputs are allocated with
+  * 'region' as their region, and any of them may be null. The windows are summed with running box sums
+  * of image*mask, image^2*mask and mask, so the cost per pixel does not depend on the radius. The image is
+  * shifted by the mean of the valid pixels near each chunk of rows before it is summed, which keeps the
+  * variance accurate for values that are large compared to their spread. Pixels with no valid pixels in
+  * their window get a mean and variance of 0. */
+template<typename TImage>
+void ComputeLocalMaskedMoments(const TImage* const image, const Mask* const mask, const unsigned int radius,
+                               const itk::ImageRegion<2>& region, LocalCountImageType* const countImage,
+                               LocalMomentImageType* const meanImage, LocalMomentImageType* const varianceImage);
+
+/** Compute the local masked moments of every pixel of the image.*/
+template<typename TImage>
+void ComputeLocalMaskedMoments(const TImage* const image, const Mask* const mask, const unsigned int radius,
+                               LocalCountImageType* const countImage, LocalMomentImageType* const meanImage,
+                               LocalMomentImageType* const varianceImage);
+
 /** Get the average value of the masked pixels. */
 template<typename TImage>
 typename TImage::PixelType AverageHoleValue(const TImage* const image, const Mask* const mask);
@@ -160,27 +283,80 @@ template<typename TImage>
 typename TImage::PixelType AverageHoleNeighborValue(const TImage* const image, const Mask* const mask,
                                                     const itk::Index<2>& pixel);
 
+/** Compute AverageValidNeighborValue() (for 'neighborType' VALID) or AverageHoleNeighborValue() (for HOLE)
+  * of every pixel of 'region' in one sweep over the rows, and write them into 'outputImage', which is allocated
+  * with 'region' as its region. Pixels without a neighbor of 'neighborType' are set to zero. If
+  * 'boundaryPixelsOnly' is true, only the pixels that are not 'neighborType' themselves but touch a
+  * 'neighborType' pixel (e.g. the hole boundary for VALID neighbors) are written, and all others are zero. */
+template<typename TImage>
+void AverageNeighborValues(const TImage* const image, const Mask* const mask,
+                           const HoleMaskPixelTypeEnum& neighborType, const itk::ImageRegion<2>& region,
+                           TImage* const outputImage, const bool boundaryPixelsOnly = false);
+
 /** Get the average value of the masked neighbors of a pixel. */
 template<typename TImage>
 std::vector<typename TImage::PixelType> GetValidPixelsInRegion(const TImage* const image,
                                                                const Mask* const mask,
                                                                const itk::ImageRegion<2>& region);
 
-/** Get the average value of the masked neighbors of a pixel. */
+/** Add uniform noise in [-noiseVariance/2, noiseVariance/2) to every hole pixel.
+  * The stream is seeded from lrand48(), so srand48() controls the result. */
 template<typename TImage>
 void AddNoiseInHole(TImage* const image, const Mask* const mask, const float noiseVariance);
 
-/** Interpolate values through a hole, filling only pixels that are in the hole.
-  * This function assumes one hole entry and one hole exit (i.e. the line between
-  * p0 and p1 only intersects the hole twice). */
+/** Add uniform noise in [-noiseVariance/2, noiseVariance/2) to every hole pixel, using a stream split
+  * from 'randomState'. The noise at each pixel is keyed by its buffer offset, so the result is the same
+  * for any number of threads. The image and the mask must have the same region. */
 template<typename TImage>
-void InterpolateThroughHole(TImage* const image, const Mask* const mask, const itk::Index<2>& p0,
+void AddNoiseInHole(TImage* const image, const Mask* const mask, const float noiseVariance,
+                    MaskRandomState& randomState);
+
+/** Interpolate values through a hole, filling only pixels that are in the hole, and mark them valid.
+  * Every part of the line between p0 and p1 that crosses the hole is filled. */
+template<typename TImage>
+void InterpolateThroughHole(TImage* const image, Mask* const mask, const itk::Index<2>& p0,
                             const itk::Index<2>& p1, const unsigned int lineThickness = 0);
 
+/** Interpolate values along each line (start, end) wherever it crosses the hole, and mark the filled pixels
+  * valid. Lines are filled in order, so pixels filled by one line are valid for the lines after it.
+  * 'lineThickness' also fills the hole pixels up to that many pixels to either side of the line. */
+template<typename TImage>
+void InterpolateLinesThroughHole(TImage* const image, Mask* const mask,
+                                 const std::vector<std::pair<itk::Index<2>, itk::Index<2> > >& lines,
+                                 const LineInterpolationEnum interpolation = LineInterpolationEnum::LINEAR,
+                                 const unsigned int lineThickness = 0);
+
+/** Fill the 'intervals' of the line from p0 to p1 that were found with FindHoleIntervalsAlongLine(),
+  * and mark the filled pixels valid. Return a region that contains every filled pixel (of size 0 if there
+  * were no intervals). This does not call mask->Modified() or mask->MarkModifiedRegion(). */
+template<typename TImage>
+itk::ImageRegion<2> InterpolateHoleIntervalsAlongLine(TImage* const image, Mask* const mask,
+                                                      const itk::Index<2>& p0, const itk::Index<2>& p1,
+                                                      const std::vector<LineHoleInterval>& intervals,
+                                                      const LineInterpolationEnum interpolation,
+                                                      const unsigned int lineThickness);
+
+/** Interpolate across the hole along every row (each row in parallel), and mark the filled pixels valid.
+  * Only runs of hole pixels with a valid pixel at both ends of the run are filled. */
+template<typename TImage>
+void InterpolateHoleAlongRows(TImage* const image, Mask* const mask,
+                              const LineInterpolationEnum interpolation = LineInterpolationEnum::LINEAR);
+
+/** Interpolate across the hole along every column (each column in parallel), and mark the filled pixels valid.
+  * Only runs of hole pixels with a valid pixel at both ends of the run are filled. */
+template<typename TImage>
+void InterpolateHoleAlongColumns(TImage* const image, Mask* const mask,
+                                 const LineInterpolationEnum interpolation = LineInterpolationEnum::LINEAR);
+
 /** Interpolate values in a hole. */
 template<typename TImage>
 void InterpolateHole(TImage* const image, const Mask* const mask);
 
+/** Set every hole pixel to the value of the closest valid pixel (a Voronoi fill).
+  * This uses the mask's nearest valid pixel map, so it is linear in the number of pixels. */
+template<typename TImage>
+void FillHoleWithNearestValidPixel(TImage* const image, const Mask* const mask);
+
 /** Blur an image using all of its values but only replaced the pixel values with
   * the blurred values inside the hole. */
 template<typename TImage>
@@ -196,6 +372,12 @@ template<typename TImage>
 void ClipInHole(TImage* const image, const Mask* const mask, const float min, const float max);
 
 
+/** Find every run of hole pixels along the line from p0 to p1 that has a valid pixel on both sides.
+  * Pixels outside the mask end a run without an exit. 'intervals' is cleared first, so passing the same
+  * vector for many lines avoids allocating for each one. */
+void FindHoleIntervalsAlongLine(const Mask* const mask, const itk::Index<2>& p0, const itk::Index<2>& p1,
+                                std::vector<LineHoleInterval>& intervals);
+
 /** Intersect a line with a hole. Return a pair containing the starting and ending
   * points of the line intersection. */
 std::pair<itk::Index<2>, itk::Index<2> > IntersectLineWithHole(const std::vector<itk::Index<2> >& line,
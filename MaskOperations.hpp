@@ -17,14 +17,25 @@
  *=========================================================================*/
 
 // STL
+#include <algorithm>
+#include <cstdlib>
 #include <stdexcept>
+#include <type_traits>
+#include <vector>
 
 // Custom
 #include "Mask.h"
+#include "MaskImageBuffer.h"
+#include "MaskInstrumentation.h"
+#include "MaskLineWalker.h"
+#include "MaskParallel.h"
+#include "MaskRandomState.h"
+#include "MaskRegionStatistics.h"
+#include "MaskSelect.h"
+#include "MaskView.h"
 #include <ITKHelpers/ITKHelpers.h>
 
 // ITK
-#include "itkBresenhamLine.h"
 #include "itkDiscreteGaussianImageFilter.h"
 #include "itkGaussianOperator.h"
 #include "itkImageRegionIterator.h"
@@ -43,13 +54,78 @@
 
 namespace MaskOperations
 {
-  
+
+/** Helpers of the line interpolation functions.*/
+namespace Internal
+{
+
+/** A run of hole pixels along one row or column of a buffer that has a valid pixel on both sides, as positions
+  * along the line. The outer pixels are one position further out than the valid pixels on either side. */
+struct BufferLineHoleRun
+{
+  itk::OffsetValueType FirstHole;
+  itk::OffsetValueType LastHole;
+
+  bool HasOuterBeforePixel;
+  bool HasOuterAfterPixel;
+};
+
+/** Get the bounding box of the pixels filled along the rows (axis 0) or columns (axis 1) of 'region', from the
+  * first and last filled position along each line ('first > last' for lines where nothing was filled). */
+itk::ImageRegion<2> GetFilledLinesRegion(const itk::ImageRegion<2>& region, const unsigned int axis,
+                                         const std::vector<std::pair<itk::OffsetValueType, itk::OffsetValueType> >&
+                                         filledExtents);
+
+/** Compute the weights of the before, after, outer before and outer after values (in that order) at fraction 't'
+  * of a hole interval that is 'length' steps from its before pixel to its after pixel. Outer pixels that are not
+  * used get weight 0. */
+void ComputeLineInterpolationWeights(const float t, const float length, const LineInterpolationEnum interpolation,
+                                     const bool useOuterBefore, const bool useOuterAfter, float weights[4]);
+
+} // end namespace Internal
+
+template <class TImage>
+void CopySpans(const TImage* const sourceImage, const itk::ImageRegion<2>& sourceRegion,
+               TImage* const destinationImage, const itk::ImageRegion<2>& destinationRegion,
+               const Mask::SpanListType& spans)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::CopySpans");
+  if(sourceRegion.GetSize() != destinationRegion.GetSize())
+  {
+    std::stringstream ss;
+    ss << "CopySpans: source region size (" << sourceRegion.GetSize() << ") must match destination region size ("
+       << destinationRegion.GetSize() << ")";
+    throw std::runtime_error(ss.str());
+  }
+
+  const itk::OffsetValueType sourceShiftX = sourceRegion.GetIndex()[0] - destinationRegion.GetIndex()[0];
+  const itk::OffsetValueType sourceShiftY = sourceRegion.GetIndex()[1] - destinationRegion.GetIndex()[1];
+
+  // When copying within one image, a span must not read pixels that an earlier span already wrote.
+  // If the source is above the destination (or to the left of it in the same rows), that is
+  // guaranteed by copying the spans in reverse order. Overlap inside a span is handled by memmove.
+  const bool reverseOrder = (sourceImage == destinationImage) &&
+                            (sourceShiftY < 0 || (sourceShiftY == 0 && sourceShiftX < 0));
+
+  for(std::size_t spanNumber = 0; spanNumber < spans.size(); ++spanNumber)
+  {
+    const Mask::Span& span = spans[reverseOrder ? spans.size() - 1 - spanNumber : spanNumber];
+
+    const itk::Index<2> destinationStart = {{destinationRegion.GetIndex()[0] + span.X,
+                                             destinationRegion.GetIndex()[1] + span.Y}};
+    const itk::Index<2> sourceStart = {{sourceRegion.GetIndex()[0] + span.X, sourceRegion.GetIndex()[1] + span.Y}};
+
+    MaskImageBuffer::CopyPixelRun(sourceImage, sourceStart, destinationImage, destinationStart, span.Length);
+  }
+}
+
 template <class TImage>
 void CopySelfPatchIntoHoleOfTargetRegion(TImage* const image, const Mask* const mask,
                                   const itk::ImageRegion<2>& sourceRegionInput,
                                   const itk::ImageRegion<2>& destinationRegionInput)
 {
-  CopySourcePatchIntoHoleOfTargetRegion(image, image, mask, sourceRegionInput, destinationRegionInput);
+  MASK_INSTRUMENT_OPERATION("MaskOperations::CopySelfPatchIntoHoleOfTargetRegion");
+  CopyRegionIntoHolePortionOfTargetRegion(image, image, mask, sourceRegionInput, destinationRegionInput);
 }
 
 template <class TImage>
@@ -58,25 +134,14 @@ void CopyRegionIntoHolePortionOfTargetRegion(const TImage* const sourceImage, TI
                                            itk::ImageRegion<2> sourceRegion,
                                            itk::ImageRegion<2> destinationRegion)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::CopyRegionIntoHolePortionOfTargetRegion");
   itk::ImageRegion<2> fullImageRegion = sourceImage->GetLargestPossibleRegion();
 
   sourceRegion = ITKHelpers::CropRegionAtPosition(sourceRegion, fullImageRegion, destinationRegion);
   destinationRegion.Crop(fullImageRegion);
 
-  itk::ImageRegionConstIterator<TImage> sourceIterator(sourceImage, sourceRegion);
-  itk::ImageRegionIterator<TImage> destinationIterator(targetImage, destinationRegion);
-  itk::ImageRegionConstIterator<Mask> maskIterator(mask, destinationRegion);
-
-  while(!sourceIterator.IsAtEnd())
-  {
-    if(maskIterator.Get() == HoleMaskPixelTypeEnum::HOLE) // we are in the target region
-    {
-      destinationIterator.Set(sourceIterator.Get());
-    }
-    ++sourceIterator;
-    ++maskIterator;
-    ++destinationIterator;
-  }
+  std::shared_ptr<const Mask::SpanListType> holeSpans = mask->GetHoleSpans(destinationRegion);
+  CopySpans(sourceImage, sourceRegion, targetImage, destinationRegion, *holeSpans);
 }
 
 template<typename TImage>
@@ -84,29 +149,22 @@ void CreatePatchImage(const TImage* const image, const itk::ImageRegion<2>& sour
                       const itk::ImageRegion<2>& targetRegion,
                       const Mask* const mask, TImage* const result)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::CreatePatchImage");
   // The input 'result' is expected to already be sized and initialized.
+  const itk::ImageRegion<2> resultRegion = result->GetLargestPossibleRegion();
 
-  itk::ImageRegionConstIterator<TImage> sourceRegionIterator(image, sourceRegion);
-  itk::ImageRegionConstIterator<TImage> targetRegionIterator(image, targetRegion);
-
-  itk::ImageRegionIterator<TImage> resultIterator(result, result->GetLargestPossibleRegion());
-
-  while(!sourceRegionIterator.IsAtEnd())
+  // Start with the target region, then copy the source region over its hole pixels.
+  for(itk::SizeValueType row = 0; row < targetRegion.GetSize()[1]; ++row)
     {
-
-    if(mask->IsHole(targetRegionIterator.GetIndex()))
-      {
-      resultIterator.Set(sourceRegionIterator.Get());
-      }
-    else
-      {
-      resultIterator.Set(targetRegionIterator.Get());
-      }
-
-    ++sourceRegionIterator;
-    ++targetRegionIterator;
-    ++resultIterator;
+    const itk::Index<2> targetRowStart = {{targetRegion.GetIndex()[0],
+                                           targetRegion.GetIndex()[1] + static_cast<itk::IndexValueType>(row)}};
+    const itk::Index<2> resultRowStart = {{resultRegion.GetIndex()[0],
+                                           resultRegion.GetIndex()[1] + static_cast<itk::IndexValueType>(row)}};
+    MaskImageBuffer::CopyPixelRun(image, targetRowStart, result, resultRowStart, targetRegion.GetSize()[0]);
     }
+
+  std::shared_ptr<const Mask::SpanListType> holeSpans = mask->GetHoleSpans(targetRegion);
+  CopySpans(image, sourceRegion, result, resultRegion, *holeSpans);
 }
 
 template<typename TImage>
@@ -114,55 +172,59 @@ void FindMaximumValueInMaskedRegion(const TImage* const image, const Mask* const
                                     const itk::ImageRegion<2>& region, const Mask::PixelType maskValue,
                                     typename TImage::PixelType& maxValue)
 {
-  // Return the location of the highest pixel in 'image' out of the pixels with 'maskValue' in the 'mask'.
-  // Return the value of that pixel by reference.
+  MASK_INSTRUMENT_OPERATION("MaskOperations::FindMaximumValueInMaskedRegion");
+  // Return the highest value (per component) in 'image' out of the pixels with 'maskValue' in the 'mask'.
 
-  std::vector<itk::Index<2> > maskedPixelLocations = ITKHelpers::GetPixelsWithValueInRegion(mask, region, maskValue);
+  MaskRegionStatistics<TImage> statistics(MaskRegionStatistics<TImage>::MAXIMUM);
+  statistics.Compute(image, mask, region, maskValue);
 
-  if(maskedPixelLocations.size() <= 0)
+  if(statistics.GetCount() == 0)
   {
     throw std::runtime_error("FindMaximumValueInMaskedRegion(): No boundary pixels!");
   }
 
-  std::vector<typename TImage::PixelType> maskedPixels = ITKHelpers::GetPixelValues(image, maskedPixelLocations);
-
-  // Initialize
-  Helpers::MaxOfAllIndices(maskedPixels, maxValue);
+  statistics.GetMaximum(maxValue);
 }
 
 template<typename TImage>
 void FindMinimumValueInMaskedRegion(const TImage* const image, const Mask* const mask, const itk::ImageRegion<2>& region,
                                     const Mask::PixelType maskValue, typename TImage::PixelType& minValue)
 {
-  // Return the location of the lowest pixel in 'image' out of the pixels with 'maskValue' in the 'mask'.
-  // Return the value of that pixel by reference.
+  MASK_INSTRUMENT_OPERATION("MaskOperations::FindMinimumValueInMaskedRegion");
+  // Return the lowest value (per component) in 'image' out of the pixels with 'maskValue' in the 'mask'.
 
-  std::vector<itk::Index<2> > maskedPixelLocations = ITKHelpers::GetPixelsWithValueInRegion(mask, region, maskValue);
+  MaskRegionStatistics<TImage> statistics(MaskRegionStatistics<TImage>::MINIMUM);
+  statistics.Compute(image, mask, region, maskValue);
 
-  if(maskedPixelLocations.size() <= 0)
+  if(statistics.GetCount() == 0)
   {
     throw std::runtime_error("FindMinimumValueInMaskedRegion(): No masked pixels!");
   }
 
-  std::vector<typename TImage::PixelType> maskedPixels = ITKHelpers::GetPixelValues(image, maskedPixelLocations);
-
-  // Initialize
-  Helpers::MinOfAllIndices(maskedPixels, minValue);
+  statistics.GetMinimum(minValue);
 }
 
-template<typename TImage, typename TRegionIndicatorImage>
-itk::Index<2> FindHighestValueInNonZeroRegion(const TImage* const image, float& maxValue)
+template<typename TImage>
+itk::Index<2> FindHighestValueInNonZero(const TImage* const image, float& maxValue)
 {
-  // Create a mask from the indicator image
-  Mask::Pointer mask = Mask::New();
-  mask->CreateFromImage(image, itk::NumericTraits<typename TRegionIndicatorImage::PixelType>::Zero);
-  return FindHighestValueInMaskedRegion(image, maxValue, mask);
+  MASK_INSTRUMENT_OPERATION("MaskOperations::FindHighestValueInNonZero");
+  MaskRegionStatistics<TImage> statistics(MaskRegionStatistics<TImage>::MAXIMUM);
+  statistics.AccumulateNonZero(image, image->GetLargestPossibleRegion());
+
+  if(statistics.GetCount() == 0)
+  {
+    throw std::runtime_error("FindHighestValueInNonZero(): No non-zero pixels!");
+  }
+
+  maxValue = static_cast<float>(statistics.GetMaximum());
+  return statistics.GetMaximumIndex();
 }
 
 template<typename TImage>
 std::vector<typename TImage::PixelType> GetValidPixelsInRegion(const TImage* const image, const Mask* const mask,
                                                                const itk::ImageRegion<2>& region)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::GetValidPixelsInRegion");
   std::vector<typename TImage::PixelType> validPixels;
   
   itk::ImageRegionConstIteratorWithIndex<TImage> imageIterator(image, region);
@@ -182,25 +244,29 @@ std::vector<typename TImage::PixelType> GetValidPixelsInRegion(const TImage* con
 template<typename TImage>
 void AddNoiseInHole(TImage* const image, const Mask* const mask, const float noiseVariance)
 {
-  itk::ImageRegionIterator<TImage> imageIterator(image, image->GetLargestPossibleRegion());
+  MaskRandomState randomState(static_cast<uint64_t>(lrand48()));
+  AddNoiseInHole(image, mask, noiseVariance, randomState);
+}
 
-  while(!imageIterator.IsAtEnd())
-    {
-    if(mask->IsHole(imageIterator.GetIndex()))
-      {
-      float randomNumber = drand48();
-      //std::cout << "randomNumber: " << randomNumber << std::endl;
-      float noise = (randomNumber - .5) * noiseVariance;
-      //std::cout << "noise: " << noise << std::endl;
-      imageIterator.Set(imageIterator.Get() + noise);
-      }
-    ++imageIterator;
-    }
+template<typename TImage>
+void AddNoiseInHole(TImage* const image, const Mask* const mask, const float noiseVariance,
+                    MaskRandomState& randomState)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::AddNoiseInHole");
+  InHole(image, mask).Noise(noiseVariance, randomState).Apply();
+}
+
+template<typename TImage>
+MaskHolePipeline<TImage> InHole(TImage* const image, const Mask* const mask)
+{
+  return MaskHolePipeline<TImage>(image, mask);
 }
 
 template<typename TImage>
 void InterpolateHole(TImage* const image, const Mask* const mask)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::InterpolateHole");
+  MASK_INSTRUMENT_PIXELS(mask->GetLargestPossibleRegion().GetNumberOfPixels());
   struct WeightedPixel
   {
     float Weight;
@@ -275,129 +341,404 @@ void InterpolateHole(TImage* const image, const Mask* const mask)
 //  }
 }
 
+template<typename TImage>
+void FillHoleWithNearestValidPixel(TImage* const image, const Mask* const mask)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::FillHoleWithNearestValidPixel");
+  MASK_INSTRUMENT_PIXELS(mask->GetLargestPossibleRegion().GetNumberOfPixels());
+  if(image->GetLargestPossibleRegion() != mask->GetLargestPossibleRegion())
+  {
+    std::stringstream ss;
+    ss << "Image region (" << image->GetLargestPossibleRegion() << ") must match mask region ("
+       << mask->GetLargestPossibleRegion() << ")";
+    throw std::runtime_error(ss.str());
+  }
+
+  std::shared_ptr<const Mask::NearestPixelMapType> nearestValidPixelMap = mask->GetNearestValidPixelMap();
+
+  // The nearest pixel map is stored in buffer order, so walk the mask in the same order.
+  itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(mask, mask->GetLargestPossibleRegion());
+  itk::OffsetValueType pixelOffset = 0;
+
+  while(!maskIterator.IsAtEnd())
+    {
+    itk::OffsetValueType nearestValidOffset = (*nearestValidPixelMap)[pixelOffset];
+    if(maskIterator.Get() == HoleMaskPixelTypeEnum::HOLE && nearestValidOffset >= 0)
+      {
+      // Valid pixels are never written, so the source values are always original values.
+      image->SetPixel(maskIterator.GetIndex(), image->GetPixel(mask->ComputeIndex(nearestValidOffset)));
+      }
+
+    ++maskIterator;
+    ++pixelOffset;
+    }
+}
+
 template<typename TImage>
 void InterpolateThroughHole(TImage* const image, Mask* const mask, const itk::Index<2>& p0,
                             const itk::Index<2>& p1, const unsigned int lineThickness)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::InterpolateThroughHole");
   // This function sets the pixels on the line in the mask to valid and sets the corresponding pixels
   // in the image to the interpolated values.
   if(mask->IsHole(p0) || mask->IsHole(p1))
   {
     throw std::runtime_error("Both p0 and p1 must be valid (not holes)!");
   }
-  
-  itk::BresenhamLine<2> line;
 
-  std::vector< itk::Index<2> > pixels = line.BuildLine(p0, p1);
-  std::cout << "Line contains " << pixels.size() << " pixels." << std::endl;
-  
-  std::vector< itk::Index<2> > holePixels;
+  std::vector<std::pair<itk::Index<2>, itk::Index<2> > > lines(1, std::make_pair(p0, p1));
+  InterpolateLinesThroughHole(image, mask, lines, LineInterpolationEnum::LINEAR, lineThickness);
+}
+
+template<typename TImage>
+void InterpolateLinesThroughHole(TImage* const image, Mask* const mask,
+                                 const std::vector<std::pair<itk::Index<2>, itk::Index<2> > >& lines,
+                                 const LineInterpolationEnum interpolation, const unsigned int lineThickness)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::InterpolateLinesThroughHole");
+  // Reused for every line so that only the first few lines allocate.
+  std::vector<LineHoleInterval> intervals;
 
-  // Find the start and end of the line
-  typename TImage::PixelType value0;
-  unsigned int firstHolePixelIndex = 0;
+  // The bounding box of the filled pixels of every line, recorded once at the end.
+  bool filledAnyPixels = false;
+  itk::Index<2> firstFilled = {{0,0}};
+  itk::Index<2> lastFilled = {{0,0}};
 
-  // Look for the first hole pixel, and set value0 to the one before it (the pixel on the valid side of the hole boundary)
-  unsigned int pixelId = 0;
-  for(; pixelId < pixels.size(); ++pixelId)
+  for(unsigned int lineId = 0; lineId < lines.size(); ++lineId)
+  {
+    FindHoleIntervalsAlongLine(mask, lines[lineId].first, lines[lineId].second, intervals);
+    const itk::ImageRegion<2> filledRegion =
+        InterpolateHoleIntervalsAlongLine(image, mask, lines[lineId].first, lines[lineId].second, intervals,
+                                          interpolation, lineThickness);
+    if(filledRegion.GetNumberOfPixels() == 0)
     {
-    // std::cout << "pixel " << i << " " << pixels[i] << std::endl;
-    if(mask->IsHole(pixels[pixelId]))
-      {
-      firstHolePixelIndex = pixelId;
-      value0 = image->GetPixel(pixels[pixelId-1]);
-      break;
-      }
-    else
+      continue;
+    }
+
+    if(!filledAnyPixels)
+    {
+      firstFilled = filledRegion.GetIndex();
+      lastFilled = filledRegion.GetUpperIndex();
+      filledAnyPixels = true;
+    }
+
+    for(unsigned int dimension = 0; dimension < 2; ++dimension)
+    {
+      firstFilled[dimension] = std::min(firstFilled[dimension], filledRegion.GetIndex()[dimension]);
+      lastFilled[dimension] = std::max(lastFilled[dimension], filledRegion.GetUpperIndex()[dimension]);
+    }
+  }
+
+  if(filledAnyPixels)
+  {
+    itk::Size<2> filledSize = {{static_cast<itk::SizeValueType>(lastFilled[0] - firstFilled[0] + 1),
+                                static_cast<itk::SizeValueType>(lastFilled[1] - firstFilled[1] + 1)}};
+    mask->MarkModifiedRegion(itk::ImageRegion<2>(firstFilled, filledSize));
+  }
+  mask->Modified();
+  image->Modified();
+}
+
+template<typename TImage>
+itk::ImageRegion<2> InterpolateHoleIntervalsAlongLine(TImage* const image, Mask* const mask,
+                                                      const itk::Index<2>& p0, const itk::Index<2>& p1,
+                                                      const std::vector<LineHoleInterval>& intervals,
+                                                      const LineInterpolationEnum interpolation,
+                                                      const unsigned int lineThickness)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::InterpolateHoleIntervalsAlongLine");
+  typedef typename TImage::PixelType PixelType;
+
+  const itk::ImageRegion<2> region = mask->GetLargestPossibleRegion();
+  const itk::IndexValueType thickness = static_cast<itk::IndexValueType>(lineThickness);
+
+  MaskLineWalker walker(p0, p1);
+  // Thick lines are widened across the line's major axis.
+  const unsigned int wideningAxis = 1 - walker.GetMajorAxis();
+
+  // The line is monotone in both directions, so the first and last filled line pixels bound the filled pixels.
+  itk::Index<2> firstFilled = p0;
+  itk::Index<2> lastFilled = p0;
+
+  for(unsigned int intervalId = 0; intervalId < intervals.size(); ++intervalId)
+  {
+    const LineHoleInterval& interval = intervals[intervalId];
+    while(walker.GetStepNumber() < interval.FirstHoleStep)
+    {
+      walker.Next();
+    }
+
+    if(intervalId == 0)
+    {
+      firstFilled = walker.GetPixel();
+    }
+
+    const PixelType beforeValue = image->GetPixel(interval.BeforePixel);
+    const PixelType afterValue = image->GetPixel(interval.AfterPixel);
+    const bool useOuterBefore = (interpolation == LineInterpolationEnum::CUBIC) && interval.HasOuterBeforePixel;
+    const bool useOuterAfter = (interpolation == LineInterpolationEnum::CUBIC) && interval.HasOuterAfterPixel;
+    const PixelType outerBeforeValue = useOuterBefore ? image->GetPixel(interval.OuterBeforePixel) : beforeValue;
+    const PixelType outerAfterValue = useOuterAfter ? image->GetPixel(interval.OuterAfterPixel) : afterValue;
+
+    // The number of steps from BeforePixel to AfterPixel.
+    const float length = static_cast<float>(interval.LastHoleStep - interval.FirstHoleStep + 2);
+
+    for(; walker.GetStepNumber() <= interval.LastHoleStep; walker.Next())
+    {
+      const float t = static_cast<float>(walker.GetStepNumber() - interval.FirstHoleStep + 1) / length;
+
+      // Write the value as a weighted sum of the (up to four) known values.
+      float weights[4];
+      Internal::ComputeLineInterpolationWeights(t, length, interpolation, useOuterBefore, useOuterAfter, weights);
+
+      const PixelType value = beforeValue * weights[0] + afterValue * weights[1] +
+                              outerBeforeValue * weights[2] + outerAfterValue * weights[3];
+
+      const itk::Index<2>& pixel = walker.GetPixel();
+      image->SetPixel(pixel, value);
+      mask->SetPixel(pixel, HoleMaskPixelTypeEnum::VALID);
+
+      for(itk::IndexValueType widening = -thickness; widening <= thickness; ++widening)
       {
-      //std::cout << "Skipping pixel " << pixels[pixelId] << " while looking for beginning of hole." << std::endl;
+        itk::Index<2> neighbor = pixel;
+        neighbor[wideningAxis] += widening;
+        if(widening != 0 && region.IsInside(neighbor) && mask->IsHole(neighbor))
+        {
+          image->SetPixel(neighbor, value);
+          mask->SetPixel(neighbor, HoleMaskPixelTypeEnum::VALID);
+        }
       }
+
+      lastFilled = pixel;
     }
+  }
 
-  std::cout << "First pixel in hole ID " << firstHolePixelIndex << std::endl;
-    
-  typename TImage::PixelType value1;
-  // Look for the last hole pixel, and set value1 to the one after it
-  // (the pixel on the valid side of the hole boundary)
-  unsigned int lastHolePixelIndex = 0;
-  for(; pixelId < pixels.size(); ++pixelId)
-    {
-    // std::cout << "pixel " << i << " " << pixels[i] << std::endl;
-    if(mask->IsValid(pixels[pixelId])) // We found a pixel on the other side of the hole.
+  if(intervals.empty())
+  {
+    return itk::ImageRegion<2>();
+  }
+
+  itk::Index<2> corner;
+  itk::Size<2> size;
+  for(unsigned int dimension = 0; dimension < 2; ++dimension)
+  {
+    corner[dimension] = std::min(firstFilled[dimension], lastFilled[dimension]);
+    size[dimension] = static_cast<itk::SizeValueType>(std::abs(lastFilled[dimension] - firstFilled[dimension]) + 1);
+  }
+  corner[wideningAxis] -= thickness;
+  size[wideningAxis] += 2 * thickness;
+
+  itk::ImageRegion<2> filledRegion(corner, size);
+  filledRegion.Crop(region);
+  return filledRegion;
+}
+
+namespace Internal
+{
+
+/** Fill the runs of hole pixels with a valid pixel at both ends along one row or column of the buffers, and mark
+  * them valid. The line is 'length' mask pixels that are 'maskStride' apart, and the matching pixels of a
+  * component buffer, 'componentStride' components apart. 'runs' is scratch space that can be reused between lines. */
+template<typename TComponent>
+void InterpolateHoleAlongBufferLine(HoleMaskPixelTypeEnum* const maskPixels, const itk::OffsetValueType maskStride,
+                                    TComponent* const components, const itk::OffsetValueType componentStride,
+                                    const unsigned int numberOfComponents, const itk::OffsetValueType length,
+                                    const LineInterpolationEnum interpolation,
+                                    std::vector<BufferLineHoleRun>& runs)
+{
+  // Find every run before filling any, so that the outer pixels are judged on the mask as it was.
+  runs.clear();
+  itk::OffsetValueType position = 0;
+  while(position < length)
+  {
+    if(maskPixels[position * maskStride] != HoleMaskPixelTypeEnum::HOLE)
+    {
+      ++position;
+      continue;
+    }
+
+    BufferLineHoleRun run;
+    run.FirstHole = position;
+    while(position < length && maskPixels[position * maskStride] == HoleMaskPixelTypeEnum::HOLE)
+    {
+      ++position;
+    }
+    run.LastHole = position - 1;
+
+    if(run.FirstHole > 0 && position < length &&
+       maskPixels[(run.FirstHole - 1) * maskStride] == HoleMaskPixelTypeEnum::VALID &&
+       maskPixels[position * maskStride] == HoleMaskPixelTypeEnum::VALID)
+    {
+      run.HasOuterBeforePixel = run.FirstHole >= 2 &&
+                                maskPixels[(run.FirstHole - 2) * maskStride] == HoleMaskPixelTypeEnum::VALID;
+      run.HasOuterAfterPixel = position + 1 < length &&
+                               maskPixels[(position + 1) * maskStride] == HoleMaskPixelTypeEnum::VALID;
+      runs.push_back(run);
+    }
+  }
+
+  const bool cubic = (interpolation == LineInterpolationEnum::CUBIC);
+  for(std::size_t runId = 0; runId < runs.size(); ++runId)
+  {
+    const itk::OffsetValueType firstHole = runs[runId].FirstHole;
+    const itk::OffsetValueType lastHole = runs[runId].LastHole;
+    const bool useOuterBefore = cubic && runs[runId].HasOuterBeforePixel;
+    const bool useOuterAfter = cubic && runs[runId].HasOuterAfterPixel;
+
+    const TComponent* const before = components + (firstHole - 1) * componentStride;
+    const TComponent* const after = components + (lastHole + 1) * componentStride;
+    const TComponent* const outerBefore = useOuterBefore ? before - componentStride : before;
+    const TComponent* const outerAfter = useOuterAfter ? after + componentStride : after;
+
+    // The number of steps from the before pixel to the after pixel.
+    const float runLength = static_cast<float>(lastHole - firstHole + 2);
+
+    for(itk::OffsetValueType hole = firstHole; hole <= lastHole; ++hole)
+    {
+      float weights[4];
+      ComputeLineInterpolationWeights(static_cast<float>(hole - firstHole + 1) / runLength, runLength,
+                                      interpolation, useOuterBefore, useOuterAfter, weights);
+
+      TComponent* const pixel = components + hole * componentStride;
+      for(unsigned int component = 0; component < numberOfComponents; ++component)
       {
-      value1 = image->GetPixel(pixels[pixelId]);
-      lastHolePixelIndex = pixelId - 1; // The previous pixel is the last one in the hole.
-      break;
+        pixel[component] = static_cast<TComponent>(before[component] * weights[0] + after[component] * weights[1] +
+                                                   outerBefore[component] * weights[2] +
+                                                   outerAfter[component] * weights[3]);
       }
-    else
+      maskPixels[hole * maskStride] = HoleMaskPixelTypeEnum::VALID;
+    }
+  }
+}
+
+} // end namespace Internal
+
+template<typename TImage>
+void InterpolateHoleAlongRows(TImage* const image, Mask* const mask, const LineInterpolationEnum interpolation)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::InterpolateHoleAlongRows");
+  if(image->GetLargestPossibleRegion() != mask->GetLargestPossibleRegion())
+  {
+    std::stringstream ss;
+    ss << "Image region (" << image->GetLargestPossibleRegion() << ") must match mask region ("
+       << mask->GetLargestPossibleRegion() << ")";
+    throw std::runtime_error(ss.str());
+  }
+
+  typedef MaskImageBuffer::ImageComponents<TImage> ImageComponentsType;
+  typedef typename ImageComponentsType::ComponentType ComponentType;
+
+  const itk::ImageRegion<2> region = mask->GetLargestPossibleRegion();
+  MASK_INSTRUMENT_PIXELS(region.GetNumberOfPixels());
+  const itk::OffsetValueType width = region.GetSize()[0];
+  const unsigned int numberOfComponents = ImageComponentsType::GetNumberOfComponents(image);
+  HoleMaskPixelTypeEnum* const maskBuffer = mask->GetBufferPointer();
+  ComponentType* const componentBuffer = ImageComponentsType::GetComponentBuffer(image);
+
+  // The first and last filled pixel of each row, so the modified region can be recorded after the parallel loop.
+  std::vector<std::pair<itk::OffsetValueType, itk::OffsetValueType> >
+      filledExtents(region.GetSize()[1], std::make_pair(itk::OffsetValueType(0), itk::OffsetValueType(-1)));
+
+  // Each row only writes to its own pixels, so rows can be filled in parallel.
+  MaskParallel::ParallelFor(0, region.GetSize()[1], [&](const std::size_t firstRow, const std::size_t endRow)
+  {
+    std::vector<Internal::BufferLineHoleRun> runs;
+    for(std::size_t row = firstRow; row < endRow; ++row)
+    {
+      const itk::OffsetValueType rowOffset = static_cast<itk::OffsetValueType>(row) * width;
+      Internal::InterpolateHoleAlongBufferLine(maskBuffer + rowOffset, 1,
+                                               componentBuffer + rowOffset * numberOfComponents,
+                                               numberOfComponents, numberOfComponents, width, interpolation, runs);
+      if(!runs.empty())
       {
-      //std::cout << "Skipping pixel " << pixels[pixelId] << " while looking for end of hole." << std::endl;
+        filledExtents[row] = std::make_pair(runs.front().FirstHole, runs.back().LastHole);
       }
     }
+  });
 
-  float difference = value1 - value0;
-
-  std::cout << "Last pixel in hole ID " << lastHolePixelIndex << std::endl;
+  mask->MarkModifiedRegion(Internal::GetFilledLinesRegion(region, 0, filledExtents));
+  image->Modified();
+}
 
-  unsigned int numberOfPixelsInHole = lastHolePixelIndex - firstHolePixelIndex;
-  float step = difference / static_cast<float>(numberOfPixelsInHole);
-  std::cout << "There are " << numberOfPixelsInHole << " pixels in the hole." << std::endl;
-  
-  if(lastHolePixelIndex - firstHolePixelIndex == 0)
+template<typename TImage>
+void InterpolateHoleAlongColumns(TImage* const image, Mask* const mask, const LineInterpolationEnum interpolation)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::InterpolateHoleAlongColumns");
+  if(image->GetLargestPossibleRegion() != mask->GetLargestPossibleRegion())
   {
-    throw std::runtime_error("Something is wrong, there are zero pixels to change!");
+    std::stringstream ss;
+    ss << "Image region (" << image->GetLargestPossibleRegion() << ") must match mask region ("
+       << mask->GetLargestPossibleRegion() << ")";
+    throw std::runtime_error(ss.str());
   }
-  
-  for(unsigned int holePixelId = firstHolePixelIndex; holePixelId <= lastHolePixelIndex; ++holePixelId)
-    {
-    std::cout << "Changing pixel " << holePixelId << " " << pixels[holePixelId] << std::endl;
-//     if(!mask->IsHole(pixels[holePixelId]))
-//       {
-//       throw std::runtime_error("Something went wrong, we should only have hole pixels!");
-//       }
-    
-  // For a line thickness of 0
-    image->SetPixel(pixels[holePixelId], value0 + holePixelId * step);
-    mask->SetPixel(pixels[holePixelId], HoleMaskPixelTypeEnum::VALID);
 
-    // For a hacky thicker line
-    std::vector<itk::Index<2> > indices = ITKHelpers::GetIndicesInRegion(ITKHelpers::GetRegionInRadiusAroundPixel(pixels[holePixelId], lineThickness));
-    for(unsigned int neighborId = 0; neighborId < indices.size(); ++neighborId)
+  typedef MaskImageBuffer::ImageComponents<TImage> ImageComponentsType;
+  typedef typename ImageComponentsType::ComponentType ComponentType;
+
+  const itk::ImageRegion<2> region = mask->GetLargestPossibleRegion();
+  MASK_INSTRUMENT_PIXELS(region.GetNumberOfPixels());
+  const itk::OffsetValueType width = region.GetSize()[0];
+  const itk::OffsetValueType height = region.GetSize()[1];
+  const unsigned int numberOfComponents = ImageComponentsType::GetNumberOfComponents(image);
+  HoleMaskPixelTypeEnum* const maskBuffer = mask->GetBufferPointer();
+  ComponentType* const componentBuffer = ImageComponentsType::GetComponentBuffer(image);
+
+  // The first and last filled pixel of each column, so the modified region can be recorded after the parallel loop.
+  std::vector<std::pair<itk::OffsetValueType, itk::OffsetValueType> >
+      filledExtents(region.GetSize()[0], std::make_pair(itk::OffsetValueType(0), itk::OffsetValueType(-1)));
+
+  // Each column only writes to its own pixels, so columns can be filled in parallel.
+  MaskParallel::ParallelFor(0, region.GetSize()[0], [&](const std::size_t firstColumn, const std::size_t endColumn)
+  {
+    std::vector<Internal::BufferLineHoleRun> runs;
+    for(std::size_t column = firstColumn; column < endColumn; ++column)
+    {
+      const itk::OffsetValueType columnOffset = static_cast<itk::OffsetValueType>(column);
+      Internal::InterpolateHoleAlongBufferLine(maskBuffer + columnOffset, width,
+                                               componentBuffer + columnOffset * numberOfComponents,
+                                               width * numberOfComponents, numberOfComponents, height, interpolation,
+                                               runs);
+      if(!runs.empty())
       {
-      if(mask->IsHole(indices[neighborId]))
-        {
-        image->SetPixel(indices[neighborId], value0 + holePixelId * step);
-        mask->SetPixel(indices[neighborId], HoleMaskPixelTypeEnum::VALID);
-        }
+        filledExtents[column] = std::make_pair(runs.front().FirstHole, runs.back().LastHole);
       }
     }
+  });
+
+  mask->MarkModifiedRegion(Internal::GetFilledLinesRegion(region, 1, filledExtents));
+  image->Modified();
 }
 
 template<typename TImage>
 void InteroplateLineBetweenPointsWithFilling(TImage* const image, Mask* const mask,
                                              const itk::Index<2>& p0, const itk::Index<2>& p1)
 {
-  itk::BresenhamLine<2> line;
-
-  std::vector< itk::Index<2> > pixels = line.BuildLine(p0, p1);
+  MASK_INSTRUMENT_OPERATION("MaskOperations::InteroplateLineBetweenPointsWithFilling");
+  MaskLineWalker walker(p0, p1);
 
   typename TImage::PixelType value0 = image->GetPixel(p0);
   typename TImage::PixelType value1 = image->GetPixel(p1);
 
   float difference = value1 - value0;
-  float step = difference / static_cast<float>(pixels.size());
+  float step = difference / static_cast<float>(walker.GetNumberOfPixels());
 
-  for(unsigned int i = 0; i < pixels.size(); i++)
+  for(; !walker.IsAtEnd(); walker.Next())
     {
-    //std::cout << "pixel " << i << " " << pixels[i] << std::endl;
-    image->SetPixel(pixels[i], value0 + i * step);
-    mask->SetPixel(pixels[i], HoleMaskPixelTypeEnum::VALID);
+    image->SetPixel(walker.GetPixel(), value0 + walker.GetStepNumber() * step);
+    mask->SetPixel(walker.GetPixel(), HoleMaskPixelTypeEnum::VALID);
     }
+
+  itk::Index<2> corner = {{std::min(p0[0], p1[0]), std::min(p0[1], p1[1])}};
+  itk::Size<2> size = {{static_cast<itk::SizeValueType>(std::abs(p1[0] - p0[0]) + 1),
+                        static_cast<itk::SizeValueType>(std::abs(p1[1] - p0[1]) + 1)}};
+  mask->MarkModifiedRegion(itk::ImageRegion<2>(corner, size));
 }
 
 template<typename TImage>
 void BlurInHole(TImage* const image, const Mask* const mask, const float kernelVariance)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::BlurInHole");
+  MASK_INSTRUMENT_PIXELS(mask->GetLargestPossibleRegion().GetNumberOfPixels());
   typedef itk::DiscreteGaussianImageFilter<TImage, TImage> DiscreteGaussianImageFilterType;
 
   // Create and setup a Gaussian filter
@@ -425,6 +766,8 @@ void BlurInHole(TImage* const image, const Mask* const mask, const float kernelV
 template<typename TImage>
 void MedianFilterInHole(TImage* const image, const Mask* const mask, const unsigned int kernelRadius)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::MedianFilterInHole");
+  MASK_INSTRUMENT_PIXELS(mask->GetLargestPossibleRegion().GetNumberOfPixels());
   std::cout << "Median filtering with radius " << kernelRadius << std::endl;
   typedef itk::MedianImageFilter<TImage, TImage> MedianFilterType;
   typename MedianFilterType::Pointer medianFilter = MedianFilterType::New();
@@ -453,66 +796,29 @@ void MedianFilterInHole(TImage* const image, const Mask* const mask, const unsig
 template<typename TImage>
 void ClipInHole(TImage* const image, const Mask* const mask, const float min, const float max)
 {
-  itk::ImageRegionIteratorWithIndex<TImage> imageIterator(image, image->GetLargestPossibleRegion());
-
-  while(!imageIterator.IsAtEnd())
-    {
-    if(mask->IsHole(imageIterator.GetIndex()))
-      {
-      //std::cout << "Changing " << image->GetPixel(imageIterator.GetIndex()) << " to "
-      //          << medianFilter->GetOutput()->GetPixel(imageIterator.GetIndex()) << std::endl;
-      if(imageIterator.Get() < min)
-      {
-        imageIterator.Set(min);
-      }
-      if(imageIterator.Get() > max)
-      {
-        imageIterator.Set(max);
-      }
-      }
-
-    ++imageIterator;
-    }
+  MASK_INSTRUMENT_OPERATION("MaskOperations::ClipInHole");
+  MASK_INSTRUMENT_PIXELS(mask->GetLargestPossibleRegion().GetNumberOfPixels());
+  InHole(image, mask).Clip(min, max).Apply();
 }
 
 template<typename TImage>
 void AddConstantInHole(TImage* const image, const float value, const Mask* const mask)
 {
-  itk::ImageRegionIteratorWithIndex<TImage> imageIterator(image, image->GetLargestPossibleRegion());
-
-  while(!imageIterator.IsAtEnd())
-    {
-    if(mask->IsHole(imageIterator.GetIndex()))
-      {
-      imageIterator.Set(value);
-      }
-
-    ++imageIterator;
-    }
+  MASK_INSTRUMENT_OPERATION("MaskOperations::AddConstantInHole");
+  MASK_INSTRUMENT_PIXELS(mask->GetLargestPossibleRegion().GetNumberOfPixels());
+  InHole(image, mask).Fill(value).Apply();
 }
 
 template<typename TImage>
 typename TImage::PixelType AverageHoleValue(const TImage* const image, const Mask* const mask)
 {
-  itk::ImageRegionConstIteratorWithIndex<TImage> imageIterator(image, image->GetLargestPossibleRegion());
-
-  typename TImage::PixelType sum(image->GetNumberOfComponentsPerPixel());
-  sum.Fill(0);
-  unsigned int numberOfHolePixels = 0;
-  while(!imageIterator.IsAtEnd())
-    {
-    if(mask->IsHole(imageIterator.GetIndex()))
-      {
-      sum += imageIterator.Get();
-      numberOfHolePixels++;
-      }
+  MASK_INSTRUMENT_OPERATION("MaskOperations::AverageHoleValue");
+  MaskRegionStatistics<TImage> statistics(MaskRegionStatistics<TImage>::MEAN);
+  statistics.Compute(image, mask, image->GetLargestPossibleRegion(), HoleMaskPixelTypeEnum::HOLE);
 
-    ++imageIterator;
-    }
-  std::cout << "Sum: " << sum << std::endl;
-  std::cout << "numberOfHolePixels: " << numberOfHolePixels << std::endl;
-  
-  return sum/static_cast<float>(numberOfHolePixels);
+  typename TImage::PixelType average;
+  statistics.GetMean(average);
+  return average;
 }
 
 
@@ -520,7 +826,8 @@ template <class TImage>
 void CopyPatchIntoImage(const TImage* const patch, TImage* const image, const Mask* const mask,
                         const itk::Index<2>& position)
 {
-  // This function copies 'patch' into 'image' centered at 'position' only where the 'mask' is non-zero
+  MASK_INSTRUMENT_OPERATION("MaskOperations::CopyPatchIntoImage");
+  // This function copies 'patch' into 'image' centered at 'position' only where the 'mask' is a hole
 
   // 'Mask' must be the same size as 'image'
   if(mask->GetLargestPossibleRegion().GetSize() != image->GetLargestPossibleRegion().GetSize())
@@ -528,27 +835,11 @@ void CopyPatchIntoImage(const TImage* const patch, TImage* const image, const Ma
     throw std::runtime_error("mask and image must be the same size!");
     }
 
-  // The PasteFilter expects the lower left corner of the destination position, but we have passed the center pixel.
-  position[0] -= patch->GetLargestPossibleRegion().GetSize()[0]/2;
-  position[1] -= patch->GetLargestPossibleRegion().GetSize()[1]/2;
-
-  itk::ImageRegion<2> region = GetRegionInRadiusAroundPixel(position,
-                                                            patch->GetLargestPossibleRegion().GetSize()[0]/2);
+  itk::ImageRegion<2> region = ITKHelpers::GetRegionInRadiusAroundPixel(position,
+                                                                        patch->GetLargestPossibleRegion().GetSize()[0]/2);
 
-  itk::ImageRegionConstIterator<TImage> patchIterator(patch,patch->GetLargestPossibleRegion());
-  itk::ImageRegionConstIterator<Mask> maskIterator(mask,region);
-  itk::ImageRegionIterator<TImage> imageIterator(image, region);
-
-  while(!patchIterator.IsAtEnd())
-    {
-    if(mask->IsHole(maskIterator.GetIndex())) // we are in the target region
-      {
-      imageIterator.Set(patchIterator.Get());
-      }
-    ++imageIterator;
-    ++maskIterator;
-    ++patchIterator;
-    }
+  std::shared_ptr<const Mask::SpanListType> holeSpans = mask->GetHoleSpans(region);
+  CopySpans(patch, patch->GetLargestPossibleRegion(), image, region, *holeSpans);
 }
 
 
@@ -558,22 +849,13 @@ typename TypeTraits<typename TImage::PixelType>::LargerType AverageInRegionMaske
                                                                                   const Mask* const mask,
                                                                                   const itk::ImageRegion<2>& region)
 {
-  typename itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(mask, region);
-
-  std::vector<typename TImage::PixelType> pixels;
+  MASK_INSTRUMENT_OPERATION("MaskOperations::AverageInRegionMasked");
+  MaskRegionStatistics<TImage> statistics(MaskRegionStatistics<TImage>::MEAN);
+  statistics.Compute(image, mask, region, HoleMaskPixelTypeEnum::VALID);
 
-  while(!maskIterator.IsAtEnd())
-    {
-    if(mask->IsValid(maskIterator.GetIndex()))
-      {
-      pixels.push_back(image->GetPixel(maskIterator.GetIndex()));
-      }
-    ++maskIterator;
-    }
-
-  using Statistics::Average;
-  //using ITKHelpers::Average;
-  return Average(pixels);
+  typename TypeTraits<typename TImage::PixelType>::LargerType average;
+  statistics.GetMean(average);
+  return average;
 }
 
 template<typename TImage>
@@ -616,65 +898,382 @@ typename TImage::PixelType AverageHoleNeighborValue(const TImage* const image, c
   return Statistics::Average(pixels);
 }
 
-/** Compute the average of all unmasked pixels in a region.*/
 template<typename TImage>
-typename TypeTraits<typename TImage::PixelType>::LargerType VarianceInRegionMasked(const TImage* const image,
-                                                                                   const Mask* const mask,
-                                                                             const itk::ImageRegion<2>& region)
+void AverageNeighborValues(const TImage* const image, const Mask* const mask,
+                           const HoleMaskPixelTypeEnum& neighborType, const itk::ImageRegion<2>& region,
+                           TImage* const outputImage, const bool boundaryPixelsOnly)
 {
-  typename itk::ImageRegionConstIterator<Mask> maskIterator(mask, region);
-  std::vector<typename TImage::PixelType> pixels;
-  while(!maskIterator.IsAtEnd())
+  MASK_INSTRUMENT_OPERATION("MaskOperations::AverageNeighborValues");
+  const itk::ImageRegion<2> imageRegion = image->GetLargestPossibleRegion();
+  if(mask->GetLargestPossibleRegion() != imageRegion || !imageRegion.IsInside(region))
+  {
+    std::stringstream ss;
+    ss << "AverageNeighborValues: the mask must match the image " << imageRegion
+       << " and the region " << region << " must be inside it!";
+    throw std::runtime_error(ss.str());
+  }
+
+  typedef MaskImageBuffer::ImageComponents<TImage> ImageComponentsType;
+  typedef typename ImageComponentsType::ComponentType ComponentType;
+  const unsigned int numberOfComponents = ImageComponentsType::GetNumberOfComponents(image);
+
+  outputImage->SetRegions(region);
+  outputImage->SetNumberOfComponentsPerPixel(numberOfComponents);
+  outputImage->Allocate();
+  MASK_INSTRUMENT_PIXELS(region.GetNumberOfPixels());
+  MASK_INSTRUMENT_BYTES(region.GetNumberOfPixels() * numberOfComponents * sizeof(ComponentType));
+
+  if(region.GetNumberOfPixels() == 0)
+  {
+    return;
+  }
+
+  // The columns that any neighborhood of the region touches.
+  const itk::IndexValueType firstImageRow = imageRegion.GetIndex()[1];
+  const itk::IndexValueType lastImageRow = firstImageRow + static_cast<itk::IndexValueType>(imageRegion.GetSize()[1]) - 1;
+  const itk::IndexValueType firstRegionColumn = region.GetIndex()[0];
+  const itk::IndexValueType lastRegionColumn = firstRegionColumn + static_cast<itk::IndexValueType>(region.GetSize()[0]) - 1;
+  const itk::IndexValueType firstColumn = std::max(firstRegionColumn - 1, imageRegion.GetIndex()[0]);
+  const itk::IndexValueType lastColumn =
+      std::min(lastRegionColumn + 1, imageRegion.GetIndex()[0] + static_cast<itk::IndexValueType>(imageRegion.GetSize()[0]) - 1);
+  const std::size_t numberOfColumns = static_cast<std::size_t>(lastColumn - firstColumn + 1);
+
+  const ComponentType* const buffer = ImageComponentsType::GetComponentBuffer(image);
+  ComponentType* const outputBuffer = ImageComponentsType::GetComponentBuffer(outputImage);
+
+  // For every row, sum the 'neighborType' pixels of each column over the row and the rows above and below it.
+  // The sum over a 3x3 neighborhood is then three column sums minus the center pixel.
+  MaskParallel::ParallelFor(0, region.GetSize()[1], [&](const std::size_t firstRegionRow, const std::size_t endRegionRow)
+  {
+    std::vector<unsigned int> columnCounts(numberOfColumns);
+    std::vector<double> columnSums(numberOfColumns * numberOfComponents);
+
+    for(std::size_t regionRow = firstRegionRow; regionRow < endRegionRow; ++regionRow)
     {
-    if(mask->IsValid(maskIterator.GetIndex()))
+      const itk::IndexValueType row = region.GetIndex()[1] + static_cast<itk::IndexValueType>(regionRow);
+      std::fill(columnCounts.begin(), columnCounts.end(), 0);
+      std::fill(columnSums.begin(), columnSums.end(), 0.0);
+      for(itk::IndexValueType neighborRow = std::max(row - 1, firstImageRow);
+          neighborRow <= std::min(row + 1, lastImageRow); ++neighborRow)
       {
-      pixels.push_back(image->GetPixel(maskIterator.GetIndex()));
+        const itk::Index<2> rowStart = {{firstColumn, neighborRow}};
+        const HoleMaskPixelTypeEnum* const maskValues = mask->GetBufferPointer() + mask->ComputeOffset(rowStart);
+        const ComponentType* const components = buffer + image->ComputeOffset(rowStart) * numberOfComponents;
+        for(std::size_t column = 0; column < numberOfColumns; ++column)
+        {
+          const unsigned int weight = (maskValues[column] == neighborType);
+          columnCounts[column] += weight;
+          for(unsigned int component = 0; component < numberOfComponents; ++component)
+          {
+            columnSums[column * numberOfComponents + component] +=
+                weight * static_cast<double>(components[column * numberOfComponents + component]);
+          }
+        }
+      }
+
+      const itk::Index<2> regionRowStart = {{firstRegionColumn, row}};
+      const HoleMaskPixelTypeEnum* const centerMaskValues = mask->GetBufferPointer() + mask->ComputeOffset(regionRowStart);
+      const ComponentType* const centerComponents = buffer + image->ComputeOffset(regionRowStart) * numberOfComponents;
+      ComponentType* outputComponents = outputBuffer + regionRow * region.GetSize()[0] * numberOfComponents;
+      for(itk::SizeValueType regionColumn = 0; regionColumn < region.GetSize()[0];
+          ++regionColumn, outputComponents += numberOfComponents)
+      {
+        const itk::IndexValueType column = firstRegionColumn + static_cast<itk::IndexValueType>(regionColumn);
+        const std::size_t firstNeighborColumn = static_cast<std::size_t>(std::max(column - 1, firstColumn) - firstColumn);
+        const std::size_t lastNeighborColumn = static_cast<std::size_t>(std::min(column + 1, lastColumn) - firstColumn);
+        const unsigned int centerWeight = (centerMaskValues[regionColumn] == neighborType);
+
+        unsigned int count = 0;
+        for(std::size_t neighborColumn = firstNeighborColumn; neighborColumn <= lastNeighborColumn; ++neighborColumn)
+        {
+          count += columnCounts[neighborColumn];
+        }
+        count -= centerWeight;
+
+        const bool write = (count > 0) && !(boundaryPixelsOnly && centerWeight);
+        for(unsigned int component = 0; component < numberOfComponents; ++component)
+        {
+          double sum = 0;
+          for(std::size_t neighborColumn = firstNeighborColumn; neighborColumn <= lastNeighborColumn; ++neighborColumn)
+          {
+            sum += columnSums[neighborColumn * numberOfComponents + component];
+          }
+          sum -= centerWeight * static_cast<double>(centerComponents[regionColumn * numberOfComponents + component]);
+
+          outputComponents[component] = write ? static_cast<ComponentType>(sum / count) : ComponentType();
+        }
       }
-    ++maskIterator;
     }
+  }, 0, 1);
+}
+
+/** Compute the variance of all unmasked pixels in a region.*/
+template<typename TImage>
+typename TypeTraits<typename TImage::PixelType>::LargerType VarianceInRegionMasked(const TImage* const image,
+                                                                                   const Mask* const mask,
+                                                                                   const itk::ImageRegion<2>& region)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::VarianceInRegionMasked");
+  MaskRegionStatistics<TImage> statistics(MaskRegionStatistics<TImage>::VARIANCE);
+  statistics.Compute(image, mask, region, HoleMaskPixelTypeEnum::VALID);
 
-  return Statistics::Variance(pixels);
+  typename TypeTraits<typename TImage::PixelType>::LargerType variance;
+  statistics.GetVariance(variance);
+  return variance;
 }
 
 template<typename TImage>
-void WriteMaskedRegion(const TImage* const image, const Mask* mask, const itk::ImageRegion<2>& region,
-                       const std::string& filename, const typename TImage::PixelType& holeColor)
+void ComputeLocalMaskedMoments(const TImage* const image, const Mask* const mask, const unsigned int radius,
+                               const itk::ImageRegion<2>& region, LocalCountImageType* const countImage,
+                               LocalMomentImageType* const meanImage, LocalMomentImageType* const varianceImage)
 {
-  typedef itk::RegionOfInterestImageFilter<TImage, TImage> RegionOfInterestImageFilterType;
-  typename RegionOfInterestImageFilterType::Pointer regionOfInterestImageFilter =
-            RegionOfInterestImageFilterType::New();
-  regionOfInterestImageFilter->SetRegionOfInterest(region);
-  regionOfInterestImageFilter->SetInput(image);
-  regionOfInterestImageFilter->Update();
+  MASK_INSTRUMENT_OPERATION("MaskOperations::ComputeLocalMaskedMoments");
+  const itk::ImageRegion<2> imageRegion = image->GetLargestPossibleRegion();
+  if(mask->GetLargestPossibleRegion() != imageRegion || !imageRegion.IsInside(region))
+  {
+    std::stringstream ss;
+    ss << "ComputeLocalMaskedMoments: the mask must match the image " << imageRegion
+       << " and the region " << region << " must be inside it!";
+    throw std::runtime_error(ss.str());
+  }
 
-  typedef itk::RegionOfInterestImageFilter<Mask, Mask> RegionOfInterestMaskFilterType;
-  typename RegionOfInterestMaskFilterType::Pointer regionOfInterestMaskFilter =
-            RegionOfInterestMaskFilterType::New();
-  regionOfInterestMaskFilter->SetRegionOfInterest(region);
-  regionOfInterestMaskFilter->SetInput(mask);
-  regionOfInterestMaskFilter->Update();
+  const unsigned int numberOfComponents = MaskImageBuffer::ImageComponents<TImage>::GetNumberOfComponents(image);
+  MASK_INSTRUMENT_PIXELS(region.GetNumberOfPixels());
+  if(countImage)
+  {
+    countImage->SetRegions(region);
+    countImage->Allocate();
+    MASK_INSTRUMENT_BYTES(region.GetNumberOfPixels() * sizeof(typename LocalCountImageType::PixelType));
+  }
+  if(meanImage)
+  {
+    meanImage->SetRegions(region);
+    meanImage->SetNumberOfComponentsPerPixel(numberOfComponents);
+    meanImage->Allocate();
+    MASK_INSTRUMENT_BYTES(region.GetNumberOfPixels() * numberOfComponents * sizeof(typename LocalMomentImageType::InternalPixelType));
+  }
+  if(varianceImage)
+  {
+    varianceImage->SetRegions(region);
+    varianceImage->SetNumberOfComponentsPerPixel(numberOfComponents);
+    varianceImage->Allocate();
+    MASK_INSTRUMENT_BYTES(region.GetNumberOfPixels() * numberOfComponents * sizeof(typename LocalMomentImageType::InternalPixelType));
+  }
 
-  itk::ImageRegionIterator<TImage> imageIterator(regionOfInterestImageFilter->GetOutput(),
-                                                 regionOfInterestImageFilter->GetOutput()->
-                                                 GetLargestPossibleRegion());
+  if(region.GetNumberOfPixels() == 0)
+  {
+    return;
+  }
 
-  while(!imageIterator.IsAtEnd())
+  // The columns that any window of the region touches.
+  const itk::IndexValueType signedRadius = static_cast<itk::IndexValueType>(radius);
+  const itk::IndexValueType firstImageRow = imageRegion.GetIndex()[1];
+  const itk::IndexValueType lastImageRow = firstImageRow + static_cast<itk::IndexValueType>(imageRegion.GetSize()[1]) - 1;
+  const itk::IndexValueType firstColumn = std::max(region.GetIndex()[0] - signedRadius, imageRegion.GetIndex()[0]);
+  const itk::IndexValueType lastColumn =
+      std::min(region.GetIndex()[0] + static_cast<itk::IndexValueType>(region.GetSize()[0]) - 1 + signedRadius,
+               imageRegion.GetIndex()[0] + static_cast<itk::IndexValueType>(imageRegion.GetSize()[0]) - 1);
+  const std::size_t numberOfColumns = static_cast<std::size_t>(lastColumn - firstColumn + 1);
+
+  typedef typename MaskImageBuffer::ImageComponents<TImage>::ComponentType ComponentType;
+  const ComponentType* const buffer = MaskImageBuffer::ImageComponents<TImage>::GetComponentBuffer(image);
+
+  // Each chunk of rows keeps the sums of every column over the rows of its current window, and slides
+  // them down one row at a time. The windows of a row are then summed by sliding along the columns.
+  MaskParallel::ParallelFor(0, region.GetSize()[1], [&](const std::size_t firstRegionRow, const std::size_t endRegionRow)
+  {
+    const itk::IndexValueType firstRow = region.GetIndex()[1] + static_cast<itk::IndexValueType>(firstRegionRow);
+    const itk::IndexValueType endRow = region.GetIndex()[1] + static_cast<itk::IndexValueType>(endRegionRow);
+    const itk::IndexValueType firstBandRow = std::max(firstRow - signedRadius, firstImageRow);
+    const itk::IndexValueType lastBandRow = std::min(endRow - 1 + signedRadius, lastImageRow);
+
+    // The sums are of the values minus the mean of the valid pixels that the chunk's windows cover, so
+    // E[x^2] - E[x]^2 does not cancel away the variance of windows whose values are large compared to it.
+    std::vector<double> referenceValues(numberOfComponents, 0);
+    itk::OffsetValueType numberOfBandPixels = 0;
+    for(itk::IndexValueType row = firstBandRow; row <= lastBandRow; ++row)
     {
-    typename TImage::PixelType pixel = imageIterator.Get();
+      const itk::Index<2> rowStart = {{firstColumn, row}};
+      const HoleMaskPixelTypeEnum* maskValues = mask->GetBufferPointer() + mask->ComputeOffset(rowStart);
+      const ComponentType* components = buffer + image->ComputeOffset(rowStart) * numberOfComponents;
+      for(std::size_t column = 0; column < numberOfColumns; ++column, components += numberOfComponents)
+      {
+        if(maskValues[column] == HoleMaskPixelTypeEnum::VALID)
+        {
+          numberOfBandPixels++;
+          for(unsigned int component = 0; component < numberOfComponents; ++component)
+          {
+            referenceValues[component] += static_cast<double>(components[component]);
+          }
+        }
+      }
+    }
+    for(unsigned int component = 0; component < numberOfComponents && numberOfBandPixels > 0; ++component)
+    {
+      referenceValues[component] /= numberOfBandPixels;
+    }
 
-    itk::Index<2> index = imageIterator.GetIndex();
+    std::vector<itk::OffsetValueType> columnCounts(numberOfColumns, 0);
+    std::vector<double> columnSums(numberOfColumns * numberOfComponents, 0);
+    std::vector<double> columnSquaredSums(numberOfColumns * numberOfComponents, 0);
+    std::vector<double> windowSums(numberOfComponents);
+    std::vector<double> windowSquaredSums(numberOfComponents);
 
-    if(regionOfInterestMaskFilter->GetOutput()->IsHole(imageIterator.GetIndex()))
+    // Add (sign 1) or remove (sign -1) an image row from the column sums.
+    auto updateColumnSums = [&](const itk::IndexValueType row, const int sign)
+    {
+      const itk::Index<2> rowStart = {{firstColumn, row}};
+      const HoleMaskPixelTypeEnum* maskValues = mask->GetBufferPointer() + mask->ComputeOffset(rowStart);
+      const ComponentType* components = buffer + image->ComputeOffset(rowStart) * numberOfComponents;
+      for(std::size_t column = 0; column < numberOfColumns; ++column, components += numberOfComponents)
       {
-      regionOfInterestImageFilter->GetOutput()->SetPixel(index, holeColor);
+        if(maskValues[column] != HoleMaskPixelTypeEnum::VALID)
+        {
+          continue;
+        }
+
+        columnCounts[column] += sign;
+        for(unsigned int component = 0; component < numberOfComponents; ++component)
+        {
+          const double value = static_cast<double>(components[component]) - referenceValues[component];
+          columnSums[column * numberOfComponents + component] += sign * value;
+          columnSquaredSums[column * numberOfComponents + component] += sign * value * value;
+        }
       }
+    };
 
-    ++imageIterator;
+    for(itk::IndexValueType row = firstBandRow; row <= std::min(firstRow + signedRadius, lastImageRow); ++row)
+    {
+      updateColumnSums(row, 1);
     }
 
+    for(std::size_t regionRow = firstRegionRow; regionRow < endRegionRow; ++regionRow)
+    {
+      const itk::IndexValueType row = region.GetIndex()[1] + static_cast<itk::IndexValueType>(regionRow);
+      if(regionRow > firstRegionRow)
+      {
+        if(row - signedRadius - 1 >= firstImageRow)
+        {
+          updateColumnSums(row - signedRadius - 1, -1);
+        }
+        if(row + signedRadius <= lastImageRow)
+        {
+          updateColumnSums(row + signedRadius, 1);
+        }
+      }
+
+      // Slide the window along the row.
+      itk::OffsetValueType windowCount = 0;
+      std::fill(windowSums.begin(), windowSums.end(), 0.0);
+      std::fill(windowSquaredSums.begin(), windowSquaredSums.end(), 0.0);
+      auto updateWindowSums = [&](const itk::IndexValueType column, const int sign)
+      {
+        const std::size_t columnId = static_cast<std::size_t>(column - firstColumn);
+        windowCount += sign * columnCounts[columnId];
+        for(unsigned int component = 0; component < numberOfComponents; ++component)
+        {
+          windowSums[component] += sign * columnSums[columnId * numberOfComponents + component];
+          windowSquaredSums[component] += sign * columnSquaredSums[columnId * numberOfComponents + component];
+        }
+      };
+
+      const itk::IndexValueType firstRegionColumn = region.GetIndex()[0];
+      for(itk::IndexValueType column = firstColumn; column <= std::min(firstRegionColumn + signedRadius, lastColumn); ++column)
+      {
+        updateWindowSums(column, 1);
+      }
+
+      for(itk::SizeValueType regionColumn = 0; regionColumn < region.GetSize()[0]; ++regionColumn)
+      {
+        const itk::IndexValueType column = firstRegionColumn + static_cast<itk::IndexValueType>(regionColumn);
+        if(regionColumn > 0)
+        {
+          if(column - signedRadius - 1 >= firstColumn)
+          {
+            updateWindowSums(column - signedRadius - 1, -1);
+          }
+          if(column + signedRadius <= lastColumn)
+          {
+            updateWindowSums(column + signedRadius, 1);
+          }
+        }
+
+        const std::size_t outputOffset = regionRow * region.GetSize()[0] + regionColumn;
+        if(countImage)
+        {
+          countImage->GetBufferPointer()[outputOffset] = static_cast<unsigned int>(windowCount);
+        }
+
+        for(unsigned int component = 0; component < numberOfComponents; ++component)
+        {
+          double mean = 0;
+          double variance = 0;
+          if(windowCount > 0)
+          {
+            const double shiftedMean = windowSums[component] / windowCount;
+            mean = referenceValues[component] + shiftedMean;
+            // Clamp the remaining rounding error for (nearly) constant windows.
+            variance = std::max(0.0, windowSquaredSums[component] / windowCount - shiftedMean * shiftedMean);
+          }
+          if(meanImage)
+          {
+            meanImage->GetBufferPointer()[outputOffset * numberOfComponents + component] = static_cast<float>(mean);
+          }
+          if(varianceImage)
+          {
+            varianceImage->GetBufferPointer()[outputOffset * numberOfComponents + component] = static_cast<float>(variance);
+          }
+        }
+      }
+    }
+  }, 0, 2 * radius + 1);
+}
+
+template<typename TImage>
+void ComputeLocalMaskedMoments(const TImage* const image, const Mask* const mask, const unsigned int radius,
+                               LocalCountImageType* const countImage, LocalMomentImageType* const meanImage,
+                               LocalMomentImageType* const varianceImage)
+{
+  ComputeLocalMaskedMoments(image, mask, radius, image->GetLargestPossibleRegion(), countImage, meanImage,
+                            varianceImage);
+}
+
+template<typename TImage>
+void ExtractMaskedRegion(const TImage* const image, const Mask* const mask, const itk::ImageRegion<2>& region,
+                         const typename TImage::PixelType& holeColor, TImage* const output)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::ExtractMaskedRegion");
+  // Read the region in place through views, instead of copying it out of the image and the mask first.
+  const MaskView maskView(mask, region);
+  const MaskImageView<TImage> imageView(image, region);
+
+  output->SetRegions(maskView.GetLocalRegion());
+  output->SetNumberOfComponentsPerPixel(imageView.GetNumberOfComponents());
+  output->Allocate();
+  MASK_INSTRUMENT_PIXELS(region.GetNumberOfPixels());
+  MASK_INSTRUMENT_BYTES(region.GetNumberOfPixels() * imageView.GetNumberOfComponents() *
+                        sizeof(typename MaskImageBuffer::ImageComponents<TImage>::ComponentType));
+
+  for(itk::IndexValueType row = 0; row < static_cast<itk::IndexValueType>(region.GetSize()[1]); ++row)
+  {
+    const itk::Index<2> rowStart = {{0, row}};
+    MaskImageBuffer::CopyPixelRun(image, imageView.GetImageIndex(rowStart), output, rowStart, region.GetSize()[0]);
+  }
+
+  MaskSelect::Fill(mask, region, HoleMaskPixelTypeEnum::HOLE, holeColor, output, maskView.GetLocalRegion());
+}
+
+template<typename TImage>
+void WriteMaskedRegion(const TImage* const image, const Mask* mask, const itk::ImageRegion<2>& region,
+                       const std::string& filename, const typename TImage::PixelType& holeColor)
+{
+  MASK_INSTRUMENT_OPERATION("MaskOperations::WriteMaskedRegion");
+  typename TImage::Pointer maskedRegion = TImage::New();
+  ExtractMaskedRegion(image, mask, region, holeColor, maskedRegion.GetPointer());
+
   typename itk::ImageFileWriter<TImage>::Pointer writer = itk::ImageFileWriter<TImage>::New();
   writer->SetFileName(filename);
-  writer->SetInput(regionOfInterestImageFilter->GetOutput());
+  writer->SetInput(maskedRegion);
   writer->Update();
 }
 
@@ -683,6 +1282,7 @@ void WriteMaskedRegionPNG(const TImage* const image, const Mask* mask,
                           itk::ImageRegion<2> region, const std::string& filename,
                           const typename TImage::PixelType& holeColor)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::WriteMaskedRegionPNG");
   region.Crop(image->GetLargestPossibleRegion());
 
   if(region.GetSize()[0] == 0 || region.GetSize()[1] == 0 )
@@ -690,59 +1290,21 @@ void WriteMaskedRegionPNG(const TImage* const image, const Mask* mask,
     throw std::runtime_error("Cropped region is 0 in at least one dimension!");
   }
 
-  typedef itk::RegionOfInterestImageFilter<TImage, TImage> RegionOfInterestImageFilterType;
-  typename RegionOfInterestImageFilterType::Pointer regionOfInterestImageFilter =
-            RegionOfInterestImageFilterType::New();
-  regionOfInterestImageFilter->SetRegionOfInterest(region);
-  regionOfInterestImageFilter->SetInput(image);
-  regionOfInterestImageFilter->Update();
-
-  typedef itk::RegionOfInterestImageFilter<Mask, Mask> RegionOfInterestMaskFilterType;
-  typename RegionOfInterestMaskFilterType::Pointer regionOfInterestMaskFilter =
-            RegionOfInterestMaskFilterType::New();
-  regionOfInterestMaskFilter->SetRegionOfInterest(region);
-  regionOfInterestMaskFilter->SetInput(mask);
-  regionOfInterestMaskFilter->Update();
-
-  itk::ImageRegionIterator<TImage> imageIterator(regionOfInterestImageFilter->GetOutput(),
-                                                 regionOfInterestImageFilter->GetOutput()->
-                                                 GetLargestPossibleRegion());
-
-  while(!imageIterator.IsAtEnd())
-  {
-//    typename TImage::PixelType pixel = imageIterator.Get();
-
-    itk::Index<2> index = imageIterator.GetIndex();
-
-    if(regionOfInterestMaskFilter->GetOutput()->IsHole(imageIterator.GetIndex()))
-    {
-      regionOfInterestImageFilter->GetOutput()->SetPixel(index, holeColor);
-    }
-
-    ++imageIterator;
-  }
+  typename TImage::Pointer maskedRegion = TImage::New();
+  ExtractMaskedRegion(image, mask, region, holeColor, maskedRegion.GetPointer());
 
   ITKHelpers::RGBImageType::Pointer rgbImage = ITKHelpers::RGBImageType::New();
-  ITKHelpers::VectorImageToRGBImage(regionOfInterestImageFilter->GetOutput(), rgbImage.GetPointer());
+  ITKHelpers::VectorImageToRGBImage(maskedRegion.GetPointer(), rgbImage.GetPointer());
 
   ITKHelpers::WriteImage(rgbImage.GetPointer(), filename);
 }
 
 
-// This struct is used inside MaskedBlur()
-template <typename TPixel>
-struct Contribution
-{
-  Contribution() : Weight(0.0f), Value(itk::NumericTraits<TPixel>::Zero){}
-  float Weight;
-  TPixel Value;
-  itk::Offset<2> Offset;
-};
-
 template <typename TImage>
 void MaskedBlur(const TImage* const inputImage, const Mask* const mask, const float blurVariance,
                 TImage* const output)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::MaskedBlur");
 //  itk::SimpleFastMutexLock mutex;
 
 //  mutex.Lock();
@@ -755,17 +1317,15 @@ template <typename TImage>
 void MaskedBlurInRegion(const TImage* const inputImage, const Mask* const mask,
                         const itk::ImageRegion<2>& region,
                         const float blurVariance, TImage* const output)
-
 {
-//  std::cout << "MaskedBlurInRegion()" << region << std::endl;
-//  std::cout << "image region: " << inputImage->GetLargestPossibleRegion()
-//            << " mask region: " << mask->GetLargestPossibleRegion() << std::endl;
-  assert(inputImage->GetLargestPossibleRegion() == mask->GetLargestPossibleRegion());
-  assert(mask->GetLargestPossibleRegion().IsInside(region));
-
-  if(!mask->GetLargestPossibleRegion().IsInside(region))
+  MASK_INSTRUMENT_OPERATION("MaskOperations::MaskedBlurInRegion");
+  const itk::ImageRegion<2> imageRegion = inputImage->GetLargestPossibleRegion();
+  if(mask->GetLargestPossibleRegion() != imageRegion || !imageRegion.IsInside(region))
   {
-    std::cout << "MaskedBlurInRegion: region is not inside image!" << region << std::endl;
+    std::stringstream ss;
+    ss << "MaskedBlurInRegion: the mask must match the image " << imageRegion
+       << " and the region " << region << " must be inside it!";
+    throw std::runtime_error(ss.str());
   }
 
   // Create a Gaussian kernel
@@ -777,114 +1337,155 @@ void MaskedBlurInRegion(const TImage* const inputImage, const Mask* const mask,
 
   GaussianOperatorType gaussianOperator;
   // It doesn't matter which direction we set - we will be interpreting the kernel as 1D (no direction)
-  gaussianOperator.SetDirection(0); 
+  gaussianOperator.SetDirection(0);
   gaussianOperator.SetVariance(blurVariance);
   gaussianOperator.CreateToRadius(radius);
 
-//   {
-//   // Debugging only
-//   std::cout << "gaussianOperator: " << gaussianOperator << std::endl;
-//   for(unsigned int i = 0; i < gaussianOperator.Size(); i++)
-//     {
-//     //std::cout << i << " : " << gaussianOperator.GetOffset(i) << std::endl;
-//     std::cout << i << " : " << gaussianOperator.GetElement(i) << std::endl;
-//     }
-//   }
+  const itk::IndexValueType kernelRadius = static_cast<itk::IndexValueType>(radius[0]);
+  std::vector<float> kernel(gaussianOperator.Size());
+  for(unsigned int i = 0; i < gaussianOperator.Size(); i++)
+  {
+    kernel[i] = gaussianOperator.GetElement(i);
+  }
 
-  // Create the output image - data will be deep copied into it
-//  std::cout << "MaskedBlurInRegion: creating blurredImage" << std::endl;
-//  std::cout << "MaskedBlurInRegion: inputImage region " << inputImage->GetLargestPossibleRegion() << std::endl;
-  typename TImage::Pointer blurredImage = TImage::New();
-  ITKHelpers::InitializeImage(blurredImage.GetPointer(), inputImage->GetLargestPossibleRegion());
-//  std::cout << "MaskedBlurInRegion: after init" << std::endl;
-  // We apply the filter to the same image, one dimension at a time. To do this,
-  // instead of applying it to the 'input' the first pass, then needing to copy
-  // the output to the input before running the next pass, we instead create
-  // an intermediate image that is used each pass.
-  typename TImage::Pointer operatingImage = TImage::New();
-//  operatingImage->SetRegions(region);
-  operatingImage->SetRegions(inputImage->GetLargestPossibleRegion());
-  operatingImage->Allocate();
-//  std::cout << "MaskedBlurInRegion: deep copy" << std::endl;
-  ITKHelpers::DeepCopyInRegion(inputImage, region, operatingImage.GetPointer());
-//  std::cout << "MaskedBlurInRegion: after deep copy" << std::endl;
-  for(unsigned int dimensionPass = 0; dimensionPass < 2; dimensionPass++) // The image is 2D
-  {
-//    std::cout << "MaskedBlurInRegion: inner iter" << std::endl;
-    itk::ImageRegionIterator<TImage> imageIterator(operatingImage, region);
-//    std::cout << "MaskedBlurInRegion: after inner iter" << std::endl;
-    while(!imageIterator.IsAtEnd())
-    {
-      itk::Index<2> centerPixel = imageIterator.GetIndex();
-
-      // We should not compute derivatives for pixels in the hole.
-//      std::cout << "MaskedBlurInRegion: checking IsHole()" << std::endl;
-      if(mask->IsHole(centerPixel))
+  // Work directly on the interleaved components, so vector pixels are never constructed. The rows
+  // the vertical pass reads are blurred horizontally first, into a buffer covering the region's
+  // columns; each pass rounds to the component type, as writing the pixels did.
+  typedef MaskImageBuffer::ImageComponents<TImage> ImageComponentsType;
+  typedef typename ImageComponentsType::ComponentType ComponentType;
+  const unsigned int numberOfComponents = ImageComponentsType::GetNumberOfComponents(inputImage);
+
+  const itk::IndexValueType firstImageRow = imageRegion.GetIndex()[1];
+  const itk::IndexValueType lastImageRow = firstImageRow + static_cast<itk::IndexValueType>(imageRegion.GetSize()[1]) - 1;
+
+  const itk::IndexValueType firstColumn = region.GetIndex()[0];
+  const std::size_t width = region.GetSize()[0];
+  const itk::IndexValueType firstRow = region.GetIndex()[1];
+  const itk::IndexValueType lastRow = firstRow + static_cast<itk::IndexValueType>(region.GetSize()[1]) - 1;
+  const itk::IndexValueType firstPaddedRow = std::max(firstRow - kernelRadius, firstImageRow);
+  const itk::IndexValueType lastPaddedRow = std::min(lastRow + kernelRadius, lastImageRow);
+
+  typedef typename std::conditional<std::is_same<ComponentType, double>::value, double, float>::type SumType;
+  const HoleMaskPixelTypeEnum* const maskBuffer = mask->GetBufferPointer();
+  const std::ptrdiff_t maskStrides[2] = {1, static_cast<std::ptrdiff_t>(imageRegion.GetSize()[0])};
+
+  // Blur one pixel along 'dimension', reading the taps 'stride' components apart from 'centerComponents'.
+  auto blurPixel = [&](const itk::Index<2>& centerPixel, const unsigned int dimension,
+                       const ComponentType* const centerComponents, const std::ptrdiff_t stride,
+                       ComponentType* const blurredComponents, std::vector<SumType>& sums)
+  {
+    const itk::IndexValueType firstOffset =
+        std::max(-kernelRadius, imageRegion.GetIndex()[dimension] - centerPixel[dimension]);
+    const itk::IndexValueType lastOffset =
+        std::min(kernelRadius, imageRegion.GetIndex()[dimension] +
+                               static_cast<itk::IndexValueType>(imageRegion.GetSize()[dimension]) - 1 - centerPixel[dimension]);
+    const HoleMaskPixelTypeEnum* const centerMask = maskBuffer + mask->ComputeOffset(centerPixel);
+    const std::ptrdiff_t maskStride = maskStrides[dimension];
+
+    // Normalize by the weights of the taps that were used.
+    float totalWeight = 0.0f;
+    for(itk::IndexValueType offset = firstOffset; offset <= lastOffset; ++offset)
+    {
+      if(centerMask[offset * maskStride] == HoleMaskPixelTypeEnum::VALID)
       {
-        ++imageIterator;
-        continue;
+        totalWeight += kernel[offset + kernelRadius];
       }
+    }
 
-      // Loop over all of the pixels in the kernel and use the ones that fit a criteria
-      typedef Contribution<typename TImage::PixelType> ContributionType;
-      std::vector<ContributionType> contributions;
-      for(unsigned int i = 0; i < gaussianOperator.Size(); i++)
-      {
-        // Since we use 1D kernels, we must manually construct a 2D offset with 0 in all
-        // dimensions except the dimension of the current pass
-        itk::Offset<2> offset = ITKHelpers::OffsetFrom1DOffset(gaussianOperator.GetOffset(i), dimensionPass);
+    if(totalWeight == 0.0f)
+    {
+      std::stringstream ss;
+      ss << "Pixel " << centerPixel << " does not have any valid neighbors!";
+      throw std::runtime_error(ss.str());
+    }
 
-        itk::Index<2> index = centerPixel + offset;
-        if(blurredImage->GetLargestPossibleRegion().IsInside(index) && mask->IsValid(index))
+    std::fill(sums.begin(), sums.end(), SumType());
+    for(itk::IndexValueType offset = firstOffset; offset <= lastOffset; ++offset)
+    {
+      if(centerMask[offset * maskStride] == HoleMaskPixelTypeEnum::VALID)
+      {
+        const float weight = kernel[offset + kernelRadius] / totalWeight;
+        const ComponentType* const tapComponents = centerComponents + offset * stride;
+        for(unsigned int component = 0; component < numberOfComponents; ++component)
         {
-          ContributionType contribution;
-          contribution.Weight = gaussianOperator.GetElement(i);
-          contribution.Value = operatingImage->GetPixel(index);
-          contribution.Offset = offset;
-          contributions.push_back(contribution);
+          sums[component] += static_cast<SumType>(tapComponents[component]) * weight;
         }
       }
+    }
 
-      if(contributions.size() == 0)
-      {
-        std::stringstream ss;
-        ss << "Pixel " << centerPixel << " does not have any valid neighbors!";
-        throw std::runtime_error(ss.str());
-      }
+    for(unsigned int component = 0; component < numberOfComponents; ++component)
+    {
+      blurredComponents[component] = static_cast<ComponentType>(sums[component]);
+    }
+  };
 
-      float totalWeight = 0.0f;
-      for(unsigned int i = 0; i < contributions.size(); i++)
+  // Horizontal pass over the padded rows. Hole pixels are never read by the vertical pass.
+  const std::size_t rowLength = width * numberOfComponents;
+  std::vector<ComponentType> horizontal((lastPaddedRow - firstPaddedRow + 1) * rowLength);
+  MASK_INSTRUMENT_PIXELS((lastPaddedRow - firstPaddedRow + 1) * width + region.GetNumberOfPixels());
+  MASK_INSTRUMENT_BYTES((horizontal.size() + region.GetSize()[1] * rowLength) * sizeof(ComponentType));
+  {
+    MASK_TRACE_SCOPE("MaskOperations::MaskedBlurInRegion: horizontal pass");
+    MaskParallel::ParallelFor(0, lastPaddedRow - firstPaddedRow + 1, [&](const std::size_t first, const std::size_t end)
+    {
+      std::vector<SumType> sums(numberOfComponents);
+      for(std::size_t paddedRow = first; paddedRow < end; ++paddedRow)
       {
-        totalWeight += contributions[i].Weight;
+        itk::Index<2> pixel = {{firstColumn, firstPaddedRow + static_cast<itk::IndexValueType>(paddedRow)}};
+        const HoleMaskPixelTypeEnum* const maskRow = maskBuffer + mask->ComputeOffset(pixel);
+        const ComponentType* const inputRow = MaskImageBuffer::GetComponents(inputImage, pixel);
+        for(std::size_t column = 0; column < width; ++column, ++pixel[0])
+        {
+          if(maskRow[column] != HoleMaskPixelTypeEnum::HOLE)
+          {
+            blurPixel(pixel, 0, inputRow + column * numberOfComponents, numberOfComponents,
+                      &horizontal[paddedRow * rowLength + column * numberOfComponents], sums);
+          }
+        }
       }
+    });
+  }
 
-      // Determine the new pixel value
-      typedef typename TypeTraits<typename TImage::PixelType>::LargerType LargerType;
-      LargerType newPixelValue = itk::NumericTraits<LargerType>::Zero;
-
-      for(unsigned int i = 0; i < contributions.size(); i++)
+  // Vertical pass over the region.
+  std::vector<ComponentType> blurred(region.GetSize()[1] * rowLength, ComponentType());
+  {
+    MASK_TRACE_SCOPE("MaskOperations::MaskedBlurInRegion: vertical pass");
+    MaskParallel::ParallelFor(0, region.GetSize()[1], [&](const std::size_t first, const std::size_t end)
+    {
+      std::vector<SumType> sums(numberOfComponents);
+      for(std::size_t regionRow = first; regionRow < end; ++regionRow)
       {
-        itk::Index<2> contributionIndex = centerPixel + contributions[i].Offset;
-        float contributionWeight = contributions[i].Weight/totalWeight;
-        newPixelValue += static_cast<LargerType>(operatingImage->GetPixel(contributionIndex))
-                         * contributionWeight;
+        const std::size_t paddedRow = regionRow + static_cast<std::size_t>(firstRow - firstPaddedRow);
+        itk::Index<2> pixel = {{firstColumn, firstRow + static_cast<itk::IndexValueType>(regionRow)}};
+        const HoleMaskPixelTypeEnum* const maskRow = maskBuffer + mask->ComputeOffset(pixel);
+        for(std::size_t column = 0; column < width; ++column, ++pixel[0])
+        {
+          if(maskRow[column] != HoleMaskPixelTypeEnum::HOLE)
+          {
+            blurPixel(pixel, 1, &horizontal[paddedRow * rowLength + column * numberOfComponents], rowLength,
+                      &blurred[regionRow * rowLength + column * numberOfComponents], sums);
+          }
+        }
       }
-
-      blurredImage->SetPixel(centerPixel, newPixelValue);
-      ++imageIterator;
-    }
-
-    // For the separable Gaussian filtering concept to work,
-    // the next pass must operate on the output of the current pass.
-//    std::cout << "MaskedBlurInRegion: copying into operating image" << std::endl;
-    ITKHelpers::DeepCopy(blurredImage.GetPointer(), operatingImage.GetPointer());
-//    std::cout << "MaskedBlurInRegion: after copying into operating image" << std::endl;
+    });
   }
 
-  // Copy the final image to the output.
-//  std::cout << "MaskedBlurInRegion: copying into output" << std::endl;
-  ITKHelpers::DeepCopy(blurredImage.GetPointer(), output);
-//  std::cout << "MaskedBlurInRegion: after copying into output" << std::endl;
+  // As before, the hole pixels and the pixels outside the region are zero in the output.
+  if(output != inputImage)
+  {
+    output->SetRegions(imageRegion);
+    output->SetNumberOfComponentsPerPixel(numberOfComponents);
+    output->Allocate();
+  }
+  ComponentType* const outputBuffer = ImageComponentsType::GetComponentBuffer(output);
+  std::fill(outputBuffer, outputBuffer + imageRegion.GetNumberOfPixels() * numberOfComponents, ComponentType());
+  for(std::size_t regionRow = 0; regionRow < region.GetSize()[1]; ++regionRow)
+  {
+    const itk::Index<2> rowStart = {{firstColumn, firstRow + static_cast<itk::IndexValueType>(regionRow)}};
+    std::copy(&blurred[regionRow * rowLength], &blurred[regionRow * rowLength] + rowLength,
+              MaskImageBuffer::GetComponents(output, rowStart));
+  }
+  output->Modified();
 }
 
 
@@ -892,6 +1493,7 @@ template<typename TImage>
 void CopyAtValues(const TImage* const input, const Mask::PixelType& value,
                   const Mask* const mask, TImage* const output)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::CopyAtValues");
   // It is sometimes desired to copy the hole pixels from an image into the corresponding pixels
   // in a larger image, so we do not do the following.
 //   if(input->GetLargestPossibleRegion().GetSize() != output->GetLargestPossibleRegion().GetSize())
@@ -918,27 +1520,21 @@ void CopyAtValues(const TImage* const input, const Mask::PixelType& value,
     throw std::runtime_error(ss.str());
   }
 
-  itk::ImageRegionConstIterator<Mask> maskIterator(mask, mask->GetLargestPossibleRegion());
-
-  while(!maskIterator.IsAtEnd())
-  {
-    if(maskIterator.Get() == value)
-    {
-      output->SetPixel(maskIterator.GetIndex(), input->GetPixel(maskIterator.GetIndex()));
-    }
-    ++maskIterator;
-  }
+  MASK_INSTRUMENT_PIXELS(input->GetLargestPossibleRegion().GetNumberOfPixels());
+  MaskSelect::Select(mask, value, input, output, output);
 }
 
 template <class TImage>
 void CopyInHoleRegion(const TImage* const input, TImage* const output, const Mask* const mask)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::CopyInHoleRegion");
   CopyAtValues(input, HoleMaskPixelTypeEnum::HOLE, mask, output);
 }
 
 template <class TImage>
 void CopyInValidRegion(const TImage* const input, TImage* const output, const Mask* const mask)
 {
+  MASK_INSTRUMENT_OPERATION("MaskOperations::CopyInValidRegion");
   CopyAtValues(input, HoleMaskPixelTypeEnum::VALID, mask, output);
 }
 
@@ -946,16 +1542,9 @@ template<typename TImage>
 void SetHolePixelsToConstant(TImage* const image, const typename TImage::PixelType& value,
                              const Mask* const mask)
 {
-  itk::ImageRegionIterator<TImage> imageIterator(image, image->GetLargestPossibleRegion());
-  
-  while(!imageIterator.IsAtEnd())
-  {
-    if(mask->IsHole(imageIterator.GetIndex()))
-    {
-      imageIterator.Set(value);
-    }
-    ++imageIterator;
-  }
+  MASK_INSTRUMENT_OPERATION("MaskOperations::SetHolePixelsToConstant");
+  MASK_INSTRUMENT_PIXELS(mask->GetLargestPossibleRegion().GetNumberOfPixels());
+  InHole(image, mask).Set(value).Apply();
 }
 
 } // end namespace
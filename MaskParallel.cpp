@@ -0,0 +1,52 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "MaskParallel.h"
+
+// ITK
+#include "itkMultiThreader.h"
+
+// STL
+#include <atomic>
+
+namespace MaskParallel
+{
+
+namespace
+{
+// 0 means "use the ITK default".
+std::atomic<unsigned int> NumberOfThreads(0);
+}
+
+unsigned int GetNumberOfThreads()
+{
+  const unsigned int numberOfThreads = NumberOfThreads.load();
+  if(numberOfThreads != 0)
+  {
+    return numberOfThreads;
+  }
+
+  return std::max<unsigned int>(itk::MultiThreader::GetGlobalDefaultNumberOfThreads(), 1);
+}
+
+void SetNumberOfThreads(const unsigned int numberOfThreads)
+{
+  NumberOfThreads.store(numberOfThreads);
+}
+
+} // end namespace
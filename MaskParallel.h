@@ -0,0 +1,49 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef MaskParallel_H
+#define MaskParallel_H
+
+// STL
+#include <cstddef>
+
+/** A minimal std::thread based parallel loop for the Mask operations. Work is split into contiguous
+  * chunks, so operations whose results depend only on the pixel (and not on which thread processed it)
+  * give identical results for any number of threads. */
+namespace MaskParallel
+{
+
+/** Get the number of threads used when a ParallelFor() is not given one. Defaults to
+  * itk::MultiThreader::GetGlobalDefaultNumberOfThreads().*/
+unsigned int GetNumberOfThreads();
+
+/** Set the number of threads used when a ParallelFor() is not given one. 0 restores the default.*/
+void SetNumberOfThreads(const unsigned int numberOfThreads);
+
+/** Call 'function(chunkBegin, chunkEnd)' on contiguous chunks that cover [begin, end), using up to
+  * 'numberOfThreads' threads (0 uses GetNumberOfThreads()). Chunks are never smaller than 'minimumChunkSize'.
+  * If any call throws, the first exception is rethrown after all threads have finished. */
+template <typename TFunction>
+void ParallelFor(const std::size_t begin, const std::size_t end, TFunction function,
+                 const unsigned int numberOfThreads = 0, const std::size_t minimumChunkSize = 1);
+
+} // end namespace
+
+#include "MaskParallel.hpp"
+
+#endif
@@ -0,0 +1,97 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef MaskParallel_HPP
+#define MaskParallel_HPP
+
+#include "MaskParallel.h" // Appease syntax parser
+
+// Custom
+#include "MaskTrace.h"
+
+// STL
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace MaskParallel
+{
+
+template <typename TFunction>
+void ParallelFor(const std::size_t begin, const std::size_t end, TFunction function,
+                 const unsigned int numberOfThreads, const std::size_t minimumChunkSize)
+{
+  if(end <= begin)
+  {
+    return;
+  }
+
+  const std::size_t numberOfItems = end - begin;
+  std::size_t numberOfChunks = (numberOfThreads == 0) ? GetNumberOfThreads() : numberOfThreads;
+  numberOfChunks = std::min(numberOfChunks, numberOfItems / std::max<std::size_t>(minimumChunkSize, 1));
+  numberOfChunks = std::max<std::size_t>(numberOfChunks, 1);
+
+  if(numberOfChunks == 1)
+  {
+    function(begin, end);
+    return;
+  }
+
+  std::vector<std::exception_ptr> exceptions(numberOfChunks);
+  auto runChunk = [&function, &exceptions, begin, numberOfItems, numberOfChunks](const std::size_t chunkId)
+  {
+    const std::size_t chunkBegin = begin + numberOfItems * chunkId / numberOfChunks;
+    const std::size_t chunkEnd = begin + numberOfItems * (chunkId + 1) / numberOfChunks;
+    try
+    {
+      MASK_TRACE_SCOPE("MaskParallel::ParallelFor chunk");
+      function(chunkBegin, chunkEnd);
+    }
+    catch(...)
+    {
+      exceptions[chunkId] = std::current_exception();
+    }
+  };
+
+  // The first chunk is run on the calling thread.
+  std::vector<std::thread> threads;
+  threads.reserve(numberOfChunks - 1);
+  for(std::size_t chunkId = 1; chunkId < numberOfChunks; ++chunkId)
+  {
+    threads.push_back(std::thread(runChunk, chunkId));
+  }
+  runChunk(0);
+
+  for(std::size_t threadId = 0; threadId < threads.size(); ++threadId)
+  {
+    threads[threadId].join();
+  }
+
+  for(std::size_t chunkId = 0; chunkId < numberOfChunks; ++chunkId)
+  {
+    if(exceptions[chunkId])
+    {
+      std::rethrow_exception(exceptions[chunkId]);
+    }
+  }
+}
+
+} // end namespace
+
+#endif
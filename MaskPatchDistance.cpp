@@ -0,0 +1,227 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "MaskPatchDistance.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+
+// SIMD
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+/** The vector lanes accumulate in float, so they are flushed into the double total after at most this
+  * many components to keep the rounding error independent of the span length.*/
+const std::size_t FlushInterval = 1024;
+
+#if defined(__AVX2__)
+
+const std::size_t VectorWidth = 8;
+
+inline __m256 LoadComponents(const float* const source)
+{
+  return _mm256_loadu_ps(source);
+}
+
+inline __m256 LoadComponents(const unsigned char* const source)
+{
+  return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(source))));
+}
+
+inline double HorizontalSum(const __m256 values)
+{
+  const __m128 halves = _mm_add_ps(_mm256_castps256_ps128(values), _mm256_extractf128_ps(values, 1));
+  float lanes[4];
+  _mm_storeu_ps(lanes, halves);
+  return (static_cast<double>(lanes[0]) + lanes[1]) + (static_cast<double>(lanes[2]) + lanes[3]);
+}
+
+template <typename TComponent>
+double VectorSumOfSquaredDifferences(const TComponent* const source, const float* const target,
+                                     const std::size_t numberOfComponents)
+{
+  double sum = 0;
+  std::size_t i = 0;
+  while(i + VectorWidth <= numberOfComponents)
+  {
+    const std::size_t blockEnd = std::min(numberOfComponents, i + FlushInterval);
+    __m256 accumulator = _mm256_setzero_ps();
+    for(; i + VectorWidth <= blockEnd; i += VectorWidth)
+    {
+      const __m256 difference = _mm256_sub_ps(LoadComponents(source + i), _mm256_loadu_ps(target + i));
+#if defined(__FMA__)
+      accumulator = _mm256_fmadd_ps(difference, difference, accumulator);
+#else
+      accumulator = _mm256_add_ps(accumulator, _mm256_mul_ps(difference, difference));
+#endif
+    }
+    sum += HorizontalSum(accumulator);
+  }
+
+  return sum + MaskPatchDistanceKernels::SumOfSquaredDifferences<TComponent>(source + i, target + i,
+                                                                             numberOfComponents - i);
+}
+
+template <typename TComponent>
+double VectorSumOfAbsoluteDifferences(const TComponent* const source, const float* const target,
+                                      const std::size_t numberOfComponents)
+{
+  const __m256 signMask = _mm256_set1_ps(-0.0f);
+  double sum = 0;
+  std::size_t i = 0;
+  while(i + VectorWidth <= numberOfComponents)
+  {
+    const std::size_t blockEnd = std::min(numberOfComponents, i + FlushInterval);
+    __m256 accumulator = _mm256_setzero_ps();
+    for(; i + VectorWidth <= blockEnd; i += VectorWidth)
+    {
+      const __m256 difference = _mm256_sub_ps(LoadComponents(source + i), _mm256_loadu_ps(target + i));
+      accumulator = _mm256_add_ps(accumulator, _mm256_andnot_ps(signMask, difference));
+    }
+    sum += HorizontalSum(accumulator);
+  }
+
+  return sum + MaskPatchDistanceKernels::SumOfAbsoluteDifferences<TComponent>(source + i, target + i,
+                                                                              numberOfComponents - i);
+}
+
+#elif defined(__SSE2__)
+
+const std::size_t VectorWidth = 4;
+
+inline __m128 LoadComponents(const float* const source)
+{
+  return _mm_loadu_ps(source);
+}
+
+inline __m128 LoadComponents(const unsigned char* const source)
+{
+  // Load 4 bytes and widen them to 32 bit integers.
+  const int packed = static_cast<int>(source[0]) | (static_cast<int>(source[1]) << 8) |
+                     (static_cast<int>(source[2]) << 16) | (static_cast<int>(source[3]) << 24);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+  return _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+}
+
+inline double HorizontalSum(const __m128 values)
+{
+  float lanes[4];
+  _mm_storeu_ps(lanes, values);
+  return (static_cast<double>(lanes[0]) + lanes[1]) + (static_cast<double>(lanes[2]) + lanes[3]);
+}
+
+template <typename TComponent>
+double VectorSumOfSquaredDifferences(const TComponent* const source, const float* const target,
+                                     const std::size_t numberOfComponents)
+{
+  double sum = 0;
+  std::size_t i = 0;
+  while(i + VectorWidth <= numberOfComponents)
+  {
+    const std::size_t blockEnd = std::min(numberOfComponents, i + FlushInterval);
+    __m128 accumulator = _mm_setzero_ps();
+    for(; i + VectorWidth <= blockEnd; i += VectorWidth)
+    {
+      const __m128 difference = _mm_sub_ps(LoadComponents(source + i), _mm_loadu_ps(target + i));
+      accumulator = _mm_add_ps(accumulator, _mm_mul_ps(difference, difference));
+    }
+    sum += HorizontalSum(accumulator);
+  }
+
+  return sum + MaskPatchDistanceKernels::SumOfSquaredDifferences<TComponent>(source + i, target + i,
+                                                                             numberOfComponents - i);
+}
+
+template <typename TComponent>
+double VectorSumOfAbsoluteDifferences(const TComponent* const source, const float* const target,
+                                      const std::size_t numberOfComponents)
+{
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+  double sum = 0;
+  std::size_t i = 0;
+  while(i + VectorWidth <= numberOfComponents)
+  {
+    const std::size_t blockEnd = std::min(numberOfComponents, i + FlushInterval);
+    __m128 accumulator = _mm_setzero_ps();
+    for(; i + VectorWidth <= blockEnd; i += VectorWidth)
+    {
+      const __m128 difference = _mm_sub_ps(LoadComponents(source + i), _mm_loadu_ps(target + i));
+      accumulator = _mm_add_ps(accumulator, _mm_andnot_ps(signMask, difference));
+    }
+    sum += HorizontalSum(accumulator);
+  }
+
+  return sum + MaskPatchDistanceKernels::SumOfAbsoluteDifferences<TComponent>(source + i, target + i,
+                                                                              numberOfComponents - i);
+}
+
+#else
+
+template <typename TComponent>
+double VectorSumOfSquaredDifferences(const TComponent* const source, const float* const target,
+                                     const std::size_t numberOfComponents)
+{
+  return MaskPatchDistanceKernels::SumOfSquaredDifferences<TComponent>(source, target, numberOfComponents);
+}
+
+template <typename TComponent>
+double VectorSumOfAbsoluteDifferences(const TComponent* const source, const float* const target,
+                                      const std::size_t numberOfComponents)
+{
+  return MaskPatchDistanceKernels::SumOfAbsoluteDifferences<TComponent>(source, target, numberOfComponents);
+}
+
+#endif
+
+} // end anonymous namespace
+
+namespace MaskPatchDistanceKernels
+{
+
+double SumOfSquaredDifferences(const float* const source, const float* const target,
+                               const std::size_t numberOfComponents)
+{
+  return VectorSumOfSquaredDifferences(source, target, numberOfComponents);
+}
+
+double SumOfSquaredDifferences(const unsigned char* const source, const float* const target,
+                               const std::size_t numberOfComponents)
+{
+  return VectorSumOfSquaredDifferences(source, target, numberOfComponents);
+}
+
+double SumOfAbsoluteDifferences(const float* const source, const float* const target,
+                                const std::size_t numberOfComponents)
+{
+  return VectorSumOfAbsoluteDifferences(source, target, numberOfComponents);
+}
+
+double SumOfAbsoluteDifferences(const unsigned char* const source, const float* const target,
+                                const std::size_t numberOfComponents)
+{
+  return VectorSumOfAbsoluteDifferences(source, target, numberOfComponents);
+}
+
+} // end namespace
@@ -0,0 +1,134 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/**
+\class MaskPatchDistance
+\brief Computes masked patch distances (sum of squared or absolute differences) between one target
+       region and many source regions of the same size. Only the target pixels selected by a mask
+       (by default the valid pixels of the target region) are compared. The selected pixels are stored
+       as runs ("spans") and the target values are packed once, so comparing against a source region
+       is a sequence of contiguous kernels over the source buffer. The target values are packed as float
+       when that holds the components exactly (float and integers of up to 16 bits), and as double otherwise;
+       distances are always accumulated in double. The kernels use AVX2 or SSE2 when the compiler targets
+       them, for float and unsigned char components, with a scalar fallback for every other component type.
+       SSE2 is the default on x86-64; configure with Mask_EnableAVX2 to build the AVX2 kernels. A bound on
+       the distance lets a search stop comparing as soon as a source region can no longer beat the best one
+       found so far.
+*/
+
+#ifndef MaskPatchDistance_H
+#define MaskPatchDistance_H
+
+// Custom
+#include "Mask.h"
+#include "MaskImageBuffer.h"
+
+// STL
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+enum class PatchDistanceEnum {SSD, SAD};
+
+/** The distance kernels over 'numberOfComponents' contiguous components. The float and
+  * unsigned char versions (with float targets) are vectorized. */
+namespace MaskPatchDistanceKernels
+{
+double SumOfSquaredDifferences(const float* const source, const float* const target,
+                               const std::size_t numberOfComponents);
+double SumOfSquaredDifferences(const unsigned char* const source, const float* const target,
+                               const std::size_t numberOfComponents);
+template <typename TComponent, typename TTarget>
+double SumOfSquaredDifferences(const TComponent* const source, const TTarget* const target,
+                               const std::size_t numberOfComponents);
+
+double SumOfAbsoluteDifferences(const float* const source, const float* const target,
+                                const std::size_t numberOfComponents);
+double SumOfAbsoluteDifferences(const unsigned char* const source, const float* const target,
+                                const std::size_t numberOfComponents);
+template <typename TComponent, typename TTarget>
+double SumOfAbsoluteDifferences(const TComponent* const source, const TTarget* const target,
+                                const std::size_t numberOfComponents);
+} // end namespace
+
+template <typename TImage>
+class MaskPatchDistance
+{
+public:
+  typedef typename MaskImageBuffer::ImageComponents<TImage>::ComponentType ComponentType;
+
+  /** The type the target values are packed as: float when it holds every ComponentType value exactly,
+    * double otherwise. */
+  typedef typename std::conditional<std::is_same<ComponentType, float>::value ||
+                                    (std::is_integral<ComponentType>::value && sizeof(ComponentType) <= 2),
+                                    float, double>::type TargetValueType;
+
+  /** Compare the valid pixels (according to 'mask') of 'targetRegion' of 'targetImage'.*/
+  MaskPatchDistance(const TImage* const targetImage, const Mask* const mask, const itk::ImageRegion<2>& targetRegion);
+
+  /** Compare the pixels of 'targetRegion' for which 'targetPixelMask' (one entry per pixel of the region,
+    * in row order) is non-zero.*/
+  MaskPatchDistance(const TImage* const targetImage, const itk::ImageRegion<2>& targetRegion,
+                    const std::vector<unsigned char>& targetPixelMask);
+
+  /** Compare the pixels at 'targetOffsets' from the corner of 'targetRegion', for example
+    * from Mask::GetValidOffsetsInRegion().*/
+  MaskPatchDistance(const TImage* const targetImage, const itk::ImageRegion<2>& targetRegion,
+                    const std::vector<itk::Offset<2> >& targetOffsets);
+
+  /** Get the number of target pixels that are compared.*/
+  itk::SizeValueType GetNumberOfComparedPixels() const;
+
+  /** Compute the distance between the target and 'sourceRegion' (the same size, inside 'sourceImage').
+    * As soon as the partial distance exceeds 'bound', the partial distance is returned, so any result
+    * greater than 'bound' only means "worse than 'bound'". */
+  double Compute(const PatchDistanceEnum distanceType, const TImage* const sourceImage,
+                 const itk::ImageRegion<2>& sourceRegion,
+                 const double bound = std::numeric_limits<double>::max()) const;
+
+  /** Compute the sum of squared differences. See Compute().*/
+  double ComputeSSD(const TImage* const sourceImage, const itk::ImageRegion<2>& sourceRegion,
+                    const double bound = std::numeric_limits<double>::max()) const;
+
+  /** Compute the sum of absolute differences. See Compute().*/
+  double ComputeSAD(const TImage* const sourceImage, const itk::ImageRegion<2>& sourceRegion,
+                    const double bound = std::numeric_limits<double>::max()) const;
+
+private:
+  void Initialize(const TImage* const targetImage, const itk::ImageRegion<2>& targetRegion,
+                  const Mask::SpanListType& spans);
+
+  template <typename TKernel>
+  double Accumulate(const TImage* const sourceImage, const itk::ImageRegion<2>& sourceRegion,
+                    const double bound, TKernel kernel) const;
+
+  itk::ImageRegion<2> TargetRegion;
+
+  unsigned int NumberOfComponents = 0;
+
+  /** The compared target pixels, as runs relative to the corner of the target region.*/
+  Mask::SpanListType Spans;
+
+  /** The components of the compared target pixels, span after span.*/
+  std::vector<TargetValueType> TargetValues;
+};
+
+#include "MaskPatchDistance.hpp"
+
+#endif
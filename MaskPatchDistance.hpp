@@ -0,0 +1,278 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef MaskPatchDistance_HPP
+#define MaskPatchDistance_HPP
+
+#include "MaskPatchDistance.h" // Appease syntax parser
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace MaskPatchDistanceKernels
+{
+
+template <typename TComponent, typename TTarget>
+double SumOfSquaredDifferences(const TComponent* const source, const TTarget* const target,
+                               const std::size_t numberOfComponents)
+{
+  double sum = 0;
+  for(std::size_t i = 0; i < numberOfComponents; ++i)
+  {
+    const double difference = static_cast<double>(source[i]) - static_cast<double>(target[i]);
+    sum += difference * difference;
+  }
+  return sum;
+}
+
+template <typename TComponent, typename TTarget>
+double SumOfAbsoluteDifferences(const TComponent* const source, const TTarget* const target,
+                                const std::size_t numberOfComponents)
+{
+  double sum = 0;
+  for(std::size_t i = 0; i < numberOfComponents; ++i)
+  {
+    sum += std::abs(static_cast<double>(source[i]) - static_cast<double>(target[i]));
+  }
+  return sum;
+}
+
+} // end namespace
+
+template <typename TImage>
+MaskPatchDistance<TImage>::MaskPatchDistance(const TImage* const targetImage, const Mask* const mask,
+                                             const itk::ImageRegion<2>& targetRegion)
+{
+  Initialize(targetImage, targetRegion, *mask->GetSpans(HoleMaskPixelTypeEnum::VALID, targetRegion));
+}
+
+template <typename TImage>
+MaskPatchDistance<TImage>::MaskPatchDistance(const TImage* const targetImage, const itk::ImageRegion<2>& targetRegion,
+                                             const std::vector<unsigned char>& targetPixelMask)
+{
+  const itk::OffsetValueType width = targetRegion.GetSize()[0];
+  const itk::OffsetValueType height = targetRegion.GetSize()[1];
+  if(targetPixelMask.size() != targetRegion.GetNumberOfPixels())
+  {
+    std::stringstream ss;
+    ss << "MaskPatchDistance: the pixel mask has " << targetPixelMask.size() << " entries but the target region has "
+       << targetRegion.GetNumberOfPixels() << " pixels!";
+    throw std::runtime_error(ss.str());
+  }
+
+  Mask::SpanListType spans;
+  for(itk::OffsetValueType y = 0; y < height; ++y)
+  {
+    const unsigned char* row = &targetPixelMask[y * width];
+    itk::OffsetValueType x = 0;
+    while(x < width)
+    {
+      if(!row[x])
+      {
+        ++x;
+        continue;
+      }
+
+      const itk::OffsetValueType start = x;
+      while(x < width && row[x])
+      {
+        ++x;
+      }
+      Mask::Span span = {start, y, static_cast<itk::SizeValueType>(x - start)};
+      spans.push_back(span);
+    }
+  }
+
+  Initialize(targetImage, targetRegion, spans);
+}
+
+template <typename TImage>
+MaskPatchDistance<TImage>::MaskPatchDistance(const TImage* const targetImage, const itk::ImageRegion<2>& targetRegion,
+                                             const std::vector<itk::Offset<2> >& targetOffsets)
+{
+  // Sort the offsets into buffer order and merge the consecutive ones into spans.
+  std::vector<itk::Offset<2> > sortedOffsets = targetOffsets;
+  std::sort(sortedOffsets.begin(), sortedOffsets.end(),
+            [](const itk::Offset<2>& a, const itk::Offset<2>& b)
+            {
+              return a[1] < b[1] || (a[1] == b[1] && a[0] < b[0]);
+            });
+
+  Mask::SpanListType spans;
+  for(const itk::Offset<2>& offset : sortedOffsets)
+  {
+    if(offset[0] < 0 || offset[1] < 0 ||
+       offset[0] >= static_cast<itk::OffsetValueType>(targetRegion.GetSize()[0]) ||
+       offset[1] >= static_cast<itk::OffsetValueType>(targetRegion.GetSize()[1]))
+    {
+      std::stringstream ss;
+      ss << "MaskPatchDistance: offset " << offset << " is outside of the target region " << targetRegion << "!";
+      throw std::runtime_error(ss.str());
+    }
+
+    if(!spans.empty())
+    {
+      Mask::Span& lastSpan = spans.back();
+      const itk::OffsetValueType nextX = lastSpan.X + static_cast<itk::OffsetValueType>(lastSpan.Length);
+      if(lastSpan.Y == offset[1] && nextX > offset[0])
+      {
+        continue; // Duplicate offset
+      }
+      if(lastSpan.Y == offset[1] && nextX == offset[0])
+      {
+        lastSpan.Length++;
+        continue;
+      }
+    }
+
+    Mask::Span span = {offset[0], offset[1], 1};
+    spans.push_back(span);
+  }
+
+  Initialize(targetImage, targetRegion, spans);
+}
+
+template <typename TImage>
+void MaskPatchDistance<TImage>::Initialize(const TImage* const targetImage, const itk::ImageRegion<2>& targetRegion,
+                                           const Mask::SpanListType& spans)
+{
+  if(!targetImage->GetBufferedRegion().IsInside(targetRegion))
+  {
+    std::stringstream ss;
+    ss << "MaskPatchDistance: the target region " << targetRegion << " is not inside the image "
+       << targetImage->GetBufferedRegion() << "!";
+    throw std::runtime_error(ss.str());
+  }
+
+  this->TargetRegion = targetRegion;
+  this->Spans = spans;
+  this->NumberOfComponents = MaskImageBuffer::ImageComponents<TImage>::GetNumberOfComponents(targetImage);
+
+  const ComponentType* const buffer = MaskImageBuffer::ImageComponents<TImage>::GetComponentBuffer(targetImage);
+  this->TargetValues.clear();
+  this->TargetValues.reserve(GetNumberOfComparedPixels() * this->NumberOfComponents);
+  for(const Mask::Span& span : this->Spans)
+  {
+    itk::Index<2> spanStart = {{targetRegion.GetIndex()[0] + span.X, targetRegion.GetIndex()[1] + span.Y}};
+    const ComponentType* spanValues = buffer + targetImage->ComputeOffset(spanStart) * this->NumberOfComponents;
+    for(itk::SizeValueType i = 0; i < span.Length * this->NumberOfComponents; ++i)
+    {
+      this->TargetValues.push_back(static_cast<TargetValueType>(spanValues[i]));
+    }
+  }
+}
+
+template <typename TImage>
+itk::SizeValueType MaskPatchDistance<TImage>::GetNumberOfComparedPixels() const
+{
+  itk::SizeValueType numberOfPixels = 0;
+  for(const Mask::Span& span : this->Spans)
+  {
+    numberOfPixels += span.Length;
+  }
+  return numberOfPixels;
+}
+
+template <typename TImage>
+double MaskPatchDistance<TImage>::Compute(const PatchDistanceEnum distanceType, const TImage* const sourceImage,
+                                          const itk::ImageRegion<2>& sourceRegion, const double bound) const
+{
+  switch(distanceType)
+  {
+    case PatchDistanceEnum::SSD:
+      return ComputeSSD(sourceImage, sourceRegion, bound);
+    case PatchDistanceEnum::SAD:
+      return ComputeSAD(sourceImage, sourceRegion, bound);
+    default:
+      throw std::runtime_error("MaskPatchDistance::Compute: invalid distance type!");
+  }
+}
+
+template <typename TImage>
+double MaskPatchDistance<TImage>::ComputeSSD(const TImage* const sourceImage, const itk::ImageRegion<2>& sourceRegion,
+                                             const double bound) const
+{
+  return Accumulate(sourceImage, sourceRegion, bound,
+                    [](const ComponentType* const source, const TargetValueType* const target, const std::size_t count)
+                    {
+                      return MaskPatchDistanceKernels::SumOfSquaredDifferences(source, target, count);
+                    });
+}
+
+template <typename TImage>
+double MaskPatchDistance<TImage>::ComputeSAD(const TImage* const sourceImage, const itk::ImageRegion<2>& sourceRegion,
+                                             const double bound) const
+{
+  return Accumulate(sourceImage, sourceRegion, bound,
+                    [](const ComponentType* const source, const TargetValueType* const target, const std::size_t count)
+                    {
+                      return MaskPatchDistanceKernels::SumOfAbsoluteDifferences(source, target, count);
+                    });
+}
+
+template <typename TImage>
+template <typename TKernel>
+double MaskPatchDistance<TImage>::Accumulate(const TImage* const sourceImage, const itk::ImageRegion<2>& sourceRegion,
+                                             const double bound, TKernel kernel) const
+{
+  if(sourceRegion.GetSize() != this->TargetRegion.GetSize())
+  {
+    std::stringstream ss;
+    ss << "MaskPatchDistance: the source region " << sourceRegion << " is not the same size as the target region "
+       << this->TargetRegion << "!";
+    throw std::runtime_error(ss.str());
+  }
+
+  if(!sourceImage->GetBufferedRegion().IsInside(sourceRegion))
+  {
+    std::stringstream ss;
+    ss << "MaskPatchDistance: the source region " << sourceRegion << " is not inside the image "
+       << sourceImage->GetBufferedRegion() << "!";
+    throw std::runtime_error(ss.str());
+  }
+
+  if(MaskImageBuffer::ImageComponents<TImage>::GetNumberOfComponents(sourceImage) != this->NumberOfComponents)
+  {
+    throw std::runtime_error("MaskPatchDistance: the source and target images have different numbers of components!");
+  }
+
+  const ComponentType* const buffer = MaskImageBuffer::ImageComponents<TImage>::GetComponentBuffer(sourceImage);
+  const TargetValueType* targetValues = this->TargetValues.data();
+
+  double sum = 0;
+  for(const Mask::Span& span : this->Spans)
+  {
+    itk::Index<2> spanStart = {{sourceRegion.GetIndex()[0] + span.X, sourceRegion.GetIndex()[1] + span.Y}};
+    const std::size_t count = span.Length * this->NumberOfComponents;
+    sum += kernel(buffer + sourceImage->ComputeOffset(spanStart) * this->NumberOfComponents, targetValues, count);
+    targetValues += count;
+
+    // The sum only grows, so once it exceeds the bound this source region cannot be better.
+    if(sum > bound)
+    {
+      return sum;
+    }
+  }
+
+  return sum;
+}
+
+#endif
@@ -0,0 +1,163 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/**
+\class MaskPatchMatch
+\brief Computes an approximate nearest neighbor field from target patches to fully valid source patches
+       with PatchMatch (Barnes et al. 2009): a random initialization, followed by iterations of propagation
+       from the already visited neighbors and a random search around the current best match. The targets
+       are the patches centered in a region (by default every patch that overlaps the hole), and they are
+       compared with MaskPatchDistance over their valid pixels. The rows of the target region are split
+       into fixed bands, and each iteration processes the even bands in parallel and then the odd bands, so
+       a band never reads a neighbor that another thread is writing. Every target draws from its own
+       MaskRandomState stream, so for a given seed the field does not depend on the number of threads
+       (unless a time budget stops the computation early).
+*/
+
+#ifndef MaskPatchMatch_H
+#define MaskPatchMatch_H
+
+// Custom
+#include "Mask.h"
+#include "MaskPatchDistance.h"
+#include "MaskRandomState.h"
+
+// STL
+#include <memory>
+#include <vector>
+
+template <typename TImage>
+class MaskPatchMatch
+{
+public:
+  /** Match every patch of radius 'patchRadius' that overlaps the hole of 'mask'.*/
+  MaskPatchMatch(const TImage* const image, const Mask* const mask, const unsigned int patchRadius);
+
+  /** Match the patches of radius 'patchRadius' centered in 'targetRegion'. The region is cropped to
+    * the centers of the patches that are inside the image. */
+  MaskPatchMatch(const TImage* const image, const Mask* const mask, const unsigned int patchRadius,
+                 const itk::ImageRegion<2>& targetRegion);
+
+  /** Set the state the random initialization and search are drawn from. Each Initialize() and
+    * each iteration advances it. */
+  void SetRandomState(const MaskRandomState& randomState);
+
+  /** Set the number of iterations Compute() runs.*/
+  void SetNumberOfIterations(const unsigned int numberOfIterations);
+  unsigned int GetNumberOfIterations() const;
+
+  /** Set a time budget in seconds for Compute(), checked between the halves of each iteration.
+    * 0 (the default) means no limit. */
+  void SetTimeBudget(const double seconds);
+  double GetTimeBudget() const;
+
+  /** Set the number of threads (0 uses MaskParallel::GetNumberOfThreads()).*/
+  void SetNumberOfThreads(const unsigned int numberOfThreads);
+
+  void SetDistanceType(const PatchDistanceEnum distanceType);
+
+  /** Assign a random fully valid source patch to every target. Throws if the mask has no fully valid patches.*/
+  void Initialize();
+
+  /** Warm start from 'previous' (which may be this object), e.g. after the mask has changed. Targets that
+    * 'previous' also matched keep their source patch if it is still fully valid, all others are randomly
+    * initialized, and all distances are recomputed with the current mask. */
+  void Initialize(const MaskPatchMatch<TImage>& previous);
+
+  bool IsInitialized() const;
+
+  /** Run the iterations (initializing randomly first if needed). Returns the number of iterations
+    * that were completed before the time budget ran out. */
+  unsigned int Compute();
+
+  /** Get the region of target patch centers.*/
+  itk::ImageRegion<2> GetTargetRegion() const;
+
+  /** Get the center of the source patch matched to the target patch centered at 'targetCenter'.*/
+  itk::Index<2> GetSourceCenter(const itk::Index<2>& targetCenter) const;
+
+  /** Get the source patch matched to the target patch centered at 'targetCenter'.*/
+  itk::ImageRegion<2> GetSourcePatch(const itk::Index<2>& targetCenter) const;
+
+  /** Get the distance between the target patch centered at 'targetCenter' and its source patch.*/
+  double GetDistance(const itk::Index<2>& targetCenter) const;
+
+private:
+  /** Get the centers of the patches that overlap the hole of 'mask'.*/
+  static itk::ImageRegion<2> ComputeHoleTargetRegion(const Mask* const mask, const unsigned int patchRadius);
+
+  /** The number of rows of the target region in a band.*/
+  static const unsigned int BandHeight = 8;
+
+  /** Run one half of an iteration, on the bands with 'bandParity'. 'direction' is 1 for a forward scan
+    * (propagating from the left and above) and -1 for a reverse scan.*/
+  void ProcessBands(const unsigned int bandParity, const int direction, const uint64_t iterationStream);
+
+  /** Improve the match of one target by propagation and random search.*/
+  void Visit(const itk::Index<2>& targetCenter, const int direction, const uint64_t iterationStream);
+
+  /** Compare 'candidate' with the current best source center of a target and keep the better one.*/
+  void TryCandidate(const MaskPatchDistance<TImage>& patchDistance, const itk::Index<2>& candidate,
+                    itk::Index<2>& bestCenter, double& bestDistance) const;
+
+  bool IsValidSourceCenter(const itk::Index<2>& center) const;
+
+  itk::OffsetValueType GetTargetId(const itk::Index<2>& targetCenter) const;
+
+  itk::ImageRegion<2> GetPatch(const itk::Index<2>& center) const;
+
+  /** Compute the distance of every target to its current source patch, in parallel.*/
+  void ComputeDistances();
+
+  /** Build the MaskPatchDistance of every target from the current image and mask, in parallel.*/
+  void BuildTargetPatchDistances();
+
+  const TImage* Image;
+
+  const Mask* MaskImage;
+
+  unsigned int PatchRadius;
+
+  itk::ImageRegion<2> TargetRegion;
+
+  MaskRandomState RandomState;
+
+  unsigned int NumberOfIterations = 5;
+
+  double TimeBudget = 0;
+
+  unsigned int NumberOfThreads = 0;
+
+  PatchDistanceEnum DistanceType = PatchDistanceEnum::SSD;
+
+  /** The valid patch center map the field was initialized with.*/
+  std::shared_ptr<const Mask::PatchCenterMapType> ValidPatchCenterMap;
+
+  /** The matched source centers and distances, one per target in buffer order of the target region.*/
+  std::vector<itk::Index<2> > SourceCenters;
+  std::vector<double> Distances;
+
+  /** The spans and packed values of every target patch, in the same order. The target patches do not
+    * change while the field is computed, so these are built once by Initialize() or Compute() and shared
+    * by every visit instead of being rebuilt (and their spans looked up on the mask) for each one. */
+  std::vector<std::unique_ptr<const MaskPatchDistance<TImage> > > TargetPatchDistances;
+};
+
+#include "MaskPatchMatch.hpp"
+
+#endif
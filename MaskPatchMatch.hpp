@@ -0,0 +1,412 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef MaskPatchMatch_HPP
+#define MaskPatchMatch_HPP
+
+#include "MaskPatchMatch.h" // Appease syntax parser
+
+// Custom
+#include "MaskOperations.h"
+#include "MaskParallel.h"
+#include "MaskPatchSampler.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+template <typename TImage>
+MaskPatchMatch<TImage>::MaskPatchMatch(const TImage* const image, const Mask* const mask,
+                                       const unsigned int patchRadius) :
+  MaskPatchMatch(image, mask, patchRadius, ComputeHoleTargetRegion(mask, patchRadius))
+{
+}
+
+template <typename TImage>
+MaskPatchMatch<TImage>::MaskPatchMatch(const TImage* const image, const Mask* const mask,
+                                       const unsigned int patchRadius, const itk::ImageRegion<2>& targetRegion) :
+  Image(image), MaskImage(mask), PatchRadius(patchRadius)
+{
+  // Only the patches that are entirely inside the image can be targets.
+  const itk::ImageRegion<2> imageRegion = image->GetLargestPossibleRegion();
+  const itk::SizeValueType patchWidth = 2 * patchRadius + 1;
+  if(imageRegion.GetSize()[0] < patchWidth || imageRegion.GetSize()[1] < patchWidth)
+  {
+    return;
+  }
+
+  const itk::Index<2> centerCorner = {{imageRegion.GetIndex()[0] + static_cast<itk::IndexValueType>(patchRadius),
+                                       imageRegion.GetIndex()[1] + static_cast<itk::IndexValueType>(patchRadius)}};
+  const itk::Size<2> centerSize = {{imageRegion.GetSize()[0] - 2 * patchRadius,
+                                    imageRegion.GetSize()[1] - 2 * patchRadius}};
+
+  itk::ImageRegion<2> croppedTargetRegion = targetRegion;
+  if(croppedTargetRegion.Crop(itk::ImageRegion<2>(centerCorner, centerSize)))
+  {
+    this->TargetRegion = croppedTargetRegion;
+  }
+}
+
+template <typename TImage>
+itk::ImageRegion<2> MaskPatchMatch<TImage>::ComputeHoleTargetRegion(const Mask* const mask,
+                                                                    const unsigned int patchRadius)
+{
+  // The patches that overlap the hole are centered within patchRadius of its bounding box.
+  const itk::ImageRegion<2> holeBoundingBox = MaskOperations::ComputeHoleBoundingBox(mask);
+  if(holeBoundingBox.GetNumberOfPixels() == 0)
+  {
+    return holeBoundingBox;
+  }
+
+  const itk::Index<2> corner = {{holeBoundingBox.GetIndex()[0] - static_cast<itk::IndexValueType>(patchRadius),
+                                 holeBoundingBox.GetIndex()[1] - static_cast<itk::IndexValueType>(patchRadius)}};
+  const itk::Size<2> size = {{holeBoundingBox.GetSize()[0] + 2 * patchRadius,
+                              holeBoundingBox.GetSize()[1] + 2 * patchRadius}};
+  return itk::ImageRegion<2>(corner, size);
+}
+
+template <typename TImage>
+void MaskPatchMatch<TImage>::SetRandomState(const MaskRandomState& randomState)
+{
+  this->RandomState = randomState;
+}
+
+template <typename TImage>
+void MaskPatchMatch<TImage>::SetNumberOfIterations(const unsigned int numberOfIterations)
+{
+  this->NumberOfIterations = numberOfIterations;
+}
+
+template <typename TImage>
+unsigned int MaskPatchMatch<TImage>::GetNumberOfIterations() const
+{
+  return this->NumberOfIterations;
+}
+
+template <typename TImage>
+void MaskPatchMatch<TImage>::SetTimeBudget(const double seconds)
+{
+  this->TimeBudget = seconds;
+}
+
+template <typename TImage>
+double MaskPatchMatch<TImage>::GetTimeBudget() const
+{
+  return this->TimeBudget;
+}
+
+template <typename TImage>
+void MaskPatchMatch<TImage>::SetNumberOfThreads(const unsigned int numberOfThreads)
+{
+  this->NumberOfThreads = numberOfThreads;
+}
+
+template <typename TImage>
+void MaskPatchMatch<TImage>::SetDistanceType(const PatchDistanceEnum distanceType)
+{
+  this->DistanceType = distanceType;
+}
+
+template <typename TImage>
+void MaskPatchMatch<TImage>::Initialize()
+{
+  std::vector<itk::Index<2> > noSourceCenters;
+  this->SourceCenters.swap(noSourceCenters);
+  Initialize(*this);
+}
+
+template <typename TImage>
+void MaskPatchMatch<TImage>::Initialize(const MaskPatchMatch<TImage>& previous)
+{
+  // Copy the previous field first, as 'previous' may be this object.
+  const itk::ImageRegion<2> previousTargetRegion = previous.TargetRegion;
+  const std::vector<itk::Index<2> > previousSourceCenters = previous.SourceCenters;
+
+  this->ValidPatchCenterMap = this->MaskImage->GetValidPatchCenterMap(this->PatchRadius);
+  const MaskPatchSampler sampler(this->MaskImage, HoleMaskPixelTypeEnum::VALID, this->PatchRadius);
+  if(sampler.IsEmpty() && this->TargetRegion.GetNumberOfPixels() > 0)
+  {
+    throw std::runtime_error("MaskPatchMatch::Initialize: there are no fully valid source patches!");
+  }
+
+  this->SourceCenters.assign(this->TargetRegion.GetNumberOfPixels(), itk::Index<2>());
+  this->Distances.assign(this->TargetRegion.GetNumberOfPixels(), 0);
+  BuildTargetPatchDistances();
+
+  const uint64_t initializationStream = this->RandomState.NextUInt64();
+  const itk::SizeValueType width = this->TargetRegion.GetSize()[0];
+  MaskParallel::ParallelFor(0, this->TargetRegion.GetSize()[1], [&](const std::size_t firstRow, const std::size_t endRow)
+  {
+    for(std::size_t row = firstRow; row < endRow; ++row)
+    {
+      for(itk::SizeValueType column = 0; column < width; ++column)
+      {
+        const itk::Index<2> targetCenter = {{this->TargetRegion.GetIndex()[0] + static_cast<itk::IndexValueType>(column),
+                                             this->TargetRegion.GetIndex()[1] + static_cast<itk::IndexValueType>(row)}};
+        const itk::OffsetValueType targetId = GetTargetId(targetCenter);
+
+        if(!previousSourceCenters.empty() && previousTargetRegion.IsInside(targetCenter))
+        {
+          const itk::Index<2>& previousCenter = previousSourceCenters[
+              (targetCenter[1] - previousTargetRegion.GetIndex()[1]) * previousTargetRegion.GetSize()[0] +
+              (targetCenter[0] - previousTargetRegion.GetIndex()[0])];
+          if(IsValidSourceCenter(previousCenter))
+          {
+            this->SourceCenters[targetId] = previousCenter;
+            continue;
+          }
+        }
+
+        MaskRandomState targetRandomState(this->RandomState.GetSeed(), initializationStream + targetId);
+        const itk::ImageRegion<2> sourcePatch = sampler.DrawPatch(targetRandomState);
+        const itk::Index<2> sourceCenter = {{sourcePatch.GetIndex()[0] + static_cast<itk::IndexValueType>(this->PatchRadius),
+                                             sourcePatch.GetIndex()[1] + static_cast<itk::IndexValueType>(this->PatchRadius)}};
+        this->SourceCenters[targetId] = sourceCenter;
+      }
+    }
+  }, this->NumberOfThreads);
+
+  ComputeDistances();
+}
+
+template <typename TImage>
+bool MaskPatchMatch<TImage>::IsInitialized() const
+{
+  return this->SourceCenters.size() == this->TargetRegion.GetNumberOfPixels() && !this->SourceCenters.empty();
+}
+
+template <typename TImage>
+unsigned int MaskPatchMatch<TImage>::Compute()
+{
+  if(!IsInitialized())
+  {
+    Initialize();
+  }
+  else
+  {
+    // The image and the mask may have been modified since the field was initialized.
+    this->ValidPatchCenterMap = this->MaskImage->GetValidPatchCenterMap(this->PatchRadius);
+    BuildTargetPatchDistances();
+  }
+
+  typedef std::chrono::steady_clock ClockType;
+  const ClockType::time_point startTime = ClockType::now();
+  auto isOverBudget = [this, &startTime]()
+  {
+    return this->TimeBudget > 0 &&
+           std::chrono::duration<double>(ClockType::now() - startTime).count() > this->TimeBudget;
+  };
+
+  for(unsigned int iteration = 0; iteration < this->NumberOfIterations; ++iteration)
+  {
+    // Alternate between forward and reverse scans, as in the original algorithm.
+    const int direction = (iteration % 2 == 0) ? 1 : -1;
+    const uint64_t iterationStream = this->RandomState.NextUInt64();
+
+    ProcessBands(0, direction, iterationStream);
+    if(isOverBudget())
+    {
+      return iteration;
+    }
+
+    ProcessBands(1, direction, iterationStream);
+    if(isOverBudget())
+    {
+      return iteration + 1;
+    }
+  }
+
+  return this->NumberOfIterations;
+}
+
+template <typename TImage>
+void MaskPatchMatch<TImage>::ProcessBands(const unsigned int bandParity, const int direction,
+                                          const uint64_t iterationStream)
+{
+  const itk::SizeValueType height = this->TargetRegion.GetSize()[1];
+  const itk::SizeValueType width = this->TargetRegion.GetSize()[0];
+  const itk::SizeValueType numberOfBands = (height + BandHeight - 1) / BandHeight;
+  const itk::SizeValueType numberOfBandsWithParity = (numberOfBands + 1 - bandParity) / 2;
+
+  MaskParallel::ParallelFor(0, numberOfBandsWithParity, [&](const std::size_t firstBand, const std::size_t endBand)
+  {
+    for(std::size_t bandNumber = firstBand; bandNumber < endBand; ++bandNumber)
+    {
+      const itk::SizeValueType firstRow = (2 * bandNumber + bandParity) * BandHeight;
+      const itk::SizeValueType endRow = std::min<itk::SizeValueType>(firstRow + BandHeight, height);
+      for(itk::SizeValueType rowNumber = 0; rowNumber < endRow - firstRow; ++rowNumber)
+      {
+        const itk::SizeValueType row = (direction > 0) ? firstRow + rowNumber : endRow - 1 - rowNumber;
+        for(itk::SizeValueType columnNumber = 0; columnNumber < width; ++columnNumber)
+        {
+          const itk::SizeValueType column = (direction > 0) ? columnNumber : width - 1 - columnNumber;
+          const itk::Index<2> targetCenter = {{this->TargetRegion.GetIndex()[0] + static_cast<itk::IndexValueType>(column),
+                                               this->TargetRegion.GetIndex()[1] + static_cast<itk::IndexValueType>(row)}};
+          Visit(targetCenter, direction, iterationStream);
+        }
+      }
+    }
+  }, this->NumberOfThreads);
+}
+
+template <typename TImage>
+void MaskPatchMatch<TImage>::Visit(const itk::Index<2>& targetCenter, const int direction,
+                                   const uint64_t iterationStream)
+{
+  const itk::OffsetValueType targetId = GetTargetId(targetCenter);
+  const MaskPatchDistance<TImage>& patchDistance = *this->TargetPatchDistances[targetId];
+
+  itk::Index<2> bestCenter = this->SourceCenters[targetId];
+  double bestDistance = this->Distances[targetId];
+
+  // Propagation: shift the matches of the neighbors that were already visited in this scan.
+  for(unsigned int dimension = 0; dimension < 2; ++dimension)
+  {
+    itk::Index<2> neighbor = targetCenter;
+    neighbor[dimension] -= direction;
+    if(this->TargetRegion.IsInside(neighbor))
+    {
+      itk::Index<2> candidate = this->SourceCenters[GetTargetId(neighbor)];
+      candidate[dimension] += direction;
+      TryCandidate(patchDistance, candidate, bestCenter, bestDistance);
+    }
+  }
+
+  // Random search in windows of exponentially decreasing size around the best match.
+  MaskRandomState targetRandomState(this->RandomState.GetSeed(), iterationStream + targetId);
+  const itk::Size<2> imageSize = this->Image->GetLargestPossibleRegion().GetSize();
+  for(itk::IndexValueType searchRadius = std::max(imageSize[0], imageSize[1]); searchRadius >= 1; searchRadius /= 2)
+  {
+    itk::Index<2> candidate = bestCenter;
+    for(unsigned int dimension = 0; dimension < 2; ++dimension)
+    {
+      candidate[dimension] += static_cast<itk::IndexValueType>(targetRandomState.NextUniformInteger(0, 2 * searchRadius)) -
+                              searchRadius;
+    }
+    TryCandidate(patchDistance, candidate, bestCenter, bestDistance);
+  }
+
+  this->SourceCenters[targetId] = bestCenter;
+  this->Distances[targetId] = bestDistance;
+}
+
+template <typename TImage>
+void MaskPatchMatch<TImage>::TryCandidate(const MaskPatchDistance<TImage>& patchDistance, const itk::Index<2>& candidate,
+                                          itk::Index<2>& bestCenter, double& bestDistance) const
+{
+  if(candidate == bestCenter || !IsValidSourceCenter(candidate))
+  {
+    return;
+  }
+
+  const double distance = patchDistance.Compute(this->DistanceType, this->Image, GetPatch(candidate), bestDistance);
+  if(distance < bestDistance)
+  {
+    bestCenter = candidate;
+    bestDistance = distance;
+  }
+}
+
+template <typename TImage>
+bool MaskPatchMatch<TImage>::IsValidSourceCenter(const itk::Index<2>& center) const
+{
+  return this->MaskImage->GetLargestPossibleRegion().IsInside(center) &&
+         (*this->ValidPatchCenterMap)[this->MaskImage->ComputeOffset(center)];
+}
+
+template <typename TImage>
+itk::OffsetValueType MaskPatchMatch<TImage>::GetTargetId(const itk::Index<2>& targetCenter) const
+{
+  return (targetCenter[1] - this->TargetRegion.GetIndex()[1]) * this->TargetRegion.GetSize()[0] +
+         (targetCenter[0] - this->TargetRegion.GetIndex()[0]);
+}
+
+template <typename TImage>
+itk::ImageRegion<2> MaskPatchMatch<TImage>::GetPatch(const itk::Index<2>& center) const
+{
+  return ITKHelpers::GetRegionInRadiusAroundPixel(center, this->PatchRadius);
+}
+
+template <typename TImage>
+void MaskPatchMatch<TImage>::ComputeDistances()
+{
+  MaskParallel::ParallelFor(0, this->SourceCenters.size(), [this](const std::size_t firstTarget, const std::size_t endTarget)
+  {
+    for(std::size_t targetId = firstTarget; targetId < endTarget; ++targetId)
+    {
+      this->Distances[targetId] = this->TargetPatchDistances[targetId]->Compute(this->DistanceType, this->Image,
+                                                                               GetPatch(this->SourceCenters[targetId]));
+    }
+  }, this->NumberOfThreads);
+}
+
+template <typename TImage>
+void MaskPatchMatch<TImage>::BuildTargetPatchDistances()
+{
+  this->TargetPatchDistances.clear();
+  this->TargetPatchDistances.resize(this->TargetRegion.GetNumberOfPixels());
+  MaskParallel::ParallelFor(0, this->TargetPatchDistances.size(), [this](const std::size_t firstTarget, const std::size_t endTarget)
+  {
+    const itk::SizeValueType width = this->TargetRegion.GetSize()[0];
+    for(std::size_t targetId = firstTarget; targetId < endTarget; ++targetId)
+    {
+      const itk::Index<2> targetCenter = {{this->TargetRegion.GetIndex()[0] + static_cast<itk::IndexValueType>(targetId % width),
+                                           this->TargetRegion.GetIndex()[1] + static_cast<itk::IndexValueType>(targetId / width)}};
+      this->TargetPatchDistances[targetId].reset(
+          new MaskPatchDistance<TImage>(this->Image, this->MaskImage, GetPatch(targetCenter)));
+    }
+  }, this->NumberOfThreads);
+}
+
+template <typename TImage>
+itk::ImageRegion<2> MaskPatchMatch<TImage>::GetTargetRegion() const
+{
+  return this->TargetRegion;
+}
+
+template <typename TImage>
+itk::Index<2> MaskPatchMatch<TImage>::GetSourceCenter(const itk::Index<2>& targetCenter) const
+{
+  if(!IsInitialized() || !this->TargetRegion.IsInside(targetCenter))
+  {
+    throw std::runtime_error("MaskPatchMatch::GetSourceCenter: the field is not initialized or the pixel is not a target!");
+  }
+  return this->SourceCenters[GetTargetId(targetCenter)];
+}
+
+template <typename TImage>
+itk::ImageRegion<2> MaskPatchMatch<TImage>::GetSourcePatch(const itk::Index<2>& targetCenter) const
+{
+  return GetPatch(GetSourceCenter(targetCenter));
+}
+
+template <typename TImage>
+double MaskPatchMatch<TImage>::GetDistance(const itk::Index<2>& targetCenter) const
+{
+  if(!IsInitialized() || !this->TargetRegion.IsInside(targetCenter))
+  {
+    throw std::runtime_error("MaskPatchMatch::GetDistance: the field is not initialized or the pixel is not a target!");
+  }
+  return this->Distances[GetTargetId(targetCenter)];
+}
+
+#endif
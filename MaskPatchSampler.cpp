@@ -0,0 +1,199 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "MaskPatchSampler.h"
+
+// Submodules
+#include <Helpers/Helpers.h>
+#include <ITKHelpers/ITKHelpers.h>
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+MaskPatchSampler::MaskPatchSampler(const Mask* const mask, const HoleMaskPixelTypeEnum& pixelType,
+                                   const unsigned int patchRadius, const itk::ImageRegion<2>& searchRegion)
+{
+  Initialize(mask, pixelType, patchRadius, searchRegion);
+}
+
+MaskPatchSampler::MaskPatchSampler(const Mask* const mask, const HoleMaskPixelTypeEnum& pixelType,
+                                   const unsigned int patchRadius)
+{
+  Initialize(mask, pixelType, patchRadius, mask->GetLargestPossibleRegion());
+}
+
+void MaskPatchSampler::Initialize(const Mask* const mask, const HoleMaskPixelTypeEnum& pixelType,
+                                  const unsigned int patchRadius, const itk::ImageRegion<2>& searchRegion)
+{
+  assert(mask);
+
+  this->PatchRadius = patchRadius;
+  this->MaskRegion = mask->GetBufferedRegion();
+  this->PatchCenterMap = mask->GetPatchCenterMap(pixelType, patchRadius);
+
+  itk::ImageRegion<2> croppedSearchRegion = searchRegion;
+  const itk::SizeValueType patchWidth = 2 * patchRadius + 1;
+  if(!croppedSearchRegion.Crop(this->MaskRegion) ||
+     croppedSearchRegion.GetSize()[0] < patchWidth || croppedSearchRegion.GetSize()[1] < patchWidth)
+  {
+    return;
+  }
+
+  // A patch is inside the search region if its center is at least patchRadius away from the region's edges.
+  const itk::IndexValueType firstX = croppedSearchRegion.GetIndex()[0] + patchRadius;
+  const itk::IndexValueType lastX = croppedSearchRegion.GetIndex()[0] + croppedSearchRegion.GetSize()[0] - patchRadius - 1;
+  const itk::IndexValueType firstY = croppedSearchRegion.GetIndex()[1] + patchRadius;
+  const itk::IndexValueType lastY = croppedSearchRegion.GetIndex()[1] + croppedSearchRegion.GetSize()[1] - patchRadius - 1;
+
+  // Split every row of candidate centers into blocks and count the centers in each block.
+  for(itk::IndexValueType y = firstY; y <= lastY; ++y)
+  {
+    for(itk::IndexValueType blockStartX = firstX; blockStartX <= lastX; blockStartX += BlockLength)
+    {
+      const itk::Index<2> blockStart = {{blockStartX, y}};
+      const itk::OffsetValueType blockOffset = mask->ComputeOffset(blockStart);
+      const unsigned int blockLength =
+          static_cast<unsigned int>(std::min<itk::IndexValueType>(BlockLength, lastX - blockStartX + 1));
+
+      unsigned int blockCount = 0;
+      for(unsigned int i = 0; i < blockLength; ++i)
+      {
+        blockCount += (*this->PatchCenterMap)[blockOffset + i];
+      }
+
+      if(blockCount > 0)
+      {
+        this->BlockOffsets.push_back(blockOffset);
+        this->BlockLengths.push_back(static_cast<unsigned char>(blockLength));
+        this->BlockCounts.push_back(static_cast<unsigned char>(blockCount));
+        this->NumberOfPatches += blockCount;
+      }
+    }
+  }
+
+  // Build the alias table (Vose's method) with the block weights scaled by the number of blocks,
+  // so that the average weight is exactly NumberOfPatches and everything stays in integers.
+  const itk::SizeValueType numberOfBlocks = this->BlockCounts.size();
+  std::vector<itk::SizeValueType> scaledWeights(numberOfBlocks);
+  std::vector<itk::SizeValueType> lightBlocks;
+  std::vector<itk::SizeValueType> heavyBlocks;
+  for(itk::SizeValueType blockId = 0; blockId < numberOfBlocks; ++blockId)
+  {
+    scaledWeights[blockId] = this->BlockCounts[blockId] * numberOfBlocks;
+    if(scaledWeights[blockId] < this->NumberOfPatches)
+    {
+      lightBlocks.push_back(blockId);
+    }
+    else
+    {
+      heavyBlocks.push_back(blockId);
+    }
+  }
+
+  this->AliasThresholds.assign(numberOfBlocks, this->NumberOfPatches);
+  this->AliasBlocks.resize(numberOfBlocks);
+  for(itk::SizeValueType blockId = 0; blockId < numberOfBlocks; ++blockId)
+  {
+    this->AliasBlocks[blockId] = blockId;
+  }
+
+  while(!lightBlocks.empty() && !heavyBlocks.empty())
+  {
+    const itk::SizeValueType lightBlock = lightBlocks.back();
+    lightBlocks.pop_back();
+    const itk::SizeValueType heavyBlock = heavyBlocks.back();
+
+    this->AliasThresholds[lightBlock] = scaledWeights[lightBlock];
+    this->AliasBlocks[lightBlock] = heavyBlock;
+
+    // The heavy block gives up the part of its weight that fills the light block's column.
+    scaledWeights[heavyBlock] -= this->NumberOfPatches - scaledWeights[lightBlock];
+    if(scaledWeights[heavyBlock] < this->NumberOfPatches)
+    {
+      heavyBlocks.pop_back();
+      lightBlocks.push_back(heavyBlock);
+    }
+  }
+}
+
+bool MaskPatchSampler::IsEmpty() const
+{
+  return this->NumberOfPatches == 0;
+}
+
+itk::SizeValueType MaskPatchSampler::GetNumberOfPatches() const
+{
+  return this->NumberOfPatches;
+}
+
+itk::ImageRegion<2> MaskPatchSampler::DrawPatch() const
+{
+  return DrawPatch([](const itk::SizeValueType minValue, const itk::SizeValueType maxValue)
+                   {
+                     return static_cast<itk::SizeValueType>(
+                           Helpers::RandomInt(static_cast<int>(minValue), static_cast<int>(maxValue)));
+                   });
+}
+
+itk::ImageRegion<2> MaskPatchSampler::DrawPatch(MaskRandomState& randomState) const
+{
+  return DrawPatch([&randomState](const itk::SizeValueType minValue, const itk::SizeValueType maxValue)
+                   {
+                     return static_cast<itk::SizeValueType>(randomState.NextUniformInteger(minValue, maxValue));
+                   });
+}
+
+template <typename TRandomInteger>
+itk::ImageRegion<2> MaskPatchSampler::DrawPatch(TRandomInteger randomInteger) const
+{
+  if(this->IsEmpty())
+  {
+    throw std::runtime_error("MaskPatchSampler::DrawPatch: there are no patches to draw from!");
+  }
+
+  itk::SizeValueType blockId = randomInteger(0, this->BlockCounts.size() - 1);
+  if(randomInteger(0, this->NumberOfPatches - 1) >= this->AliasThresholds[blockId])
+  {
+    blockId = this->AliasBlocks[blockId];
+  }
+
+  // Find the chosen center among the centers in the block.
+  unsigned int centerNumber = static_cast<unsigned int>(randomInteger(0, this->BlockCounts[blockId] - 1));
+  const unsigned char* blockCenters = &(*this->PatchCenterMap)[this->BlockOffsets[blockId]];
+  unsigned int pixelId = 0;
+  for(; pixelId < this->BlockLengths[blockId]; ++pixelId)
+  {
+    if(blockCenters[pixelId])
+    {
+      if(centerNumber == 0)
+      {
+        break;
+      }
+      centerNumber--;
+    }
+  }
+
+  const itk::OffsetValueType centerOffset = this->BlockOffsets[blockId] + pixelId;
+  const itk::OffsetValueType maskWidth = this->MaskRegion.GetSize()[0];
+  itk::Index<2> center = {{this->MaskRegion.GetIndex()[0] + centerOffset % maskWidth,
+                           this->MaskRegion.GetIndex()[1] + centerOffset / maskWidth}};
+
+  return ITKHelpers::GetRegionInRadiusAroundPixel(center, this->PatchRadius);
+}
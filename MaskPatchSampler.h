@@ -0,0 +1,99 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/**
+\class MaskPatchSampler
+\brief Draws patches uniformly at random from the patches of a fixed radius inside a search
+       region whose pixels all have a particular value (e.g. fully valid or fully hole patches).
+       The sampler is built once from the mask's patch center map. The centers are grouped into
+       short row segments ("blocks"), and an alias table over the blocks (weighted by how many
+       centers they contain) makes every draw O(1). The sampler keeps its own reference to the
+       center map, so it describes the mask as it was when the sampler was constructed.
+*/
+
+#ifndef MaskPatchSampler_H
+#define MaskPatchSampler_H
+
+// Custom
+#include "Mask.h"
+#include "MaskRandomState.h"
+
+// STL
+#include <memory>
+#include <vector>
+
+class MaskPatchSampler
+{
+public:
+  /** Sample patches of radius 'patchRadius' that are entirely inside 'searchRegion' and whose pixels are
+    * all 'pixelType'. */
+  MaskPatchSampler(const Mask* const mask, const HoleMaskPixelTypeEnum& pixelType,
+                   const unsigned int patchRadius, const itk::ImageRegion<2>& searchRegion);
+
+  /** Sample patches of radius 'patchRadius' anywhere in the mask whose pixels are all 'pixelType'. */
+  MaskPatchSampler(const Mask* const mask, const HoleMaskPixelTypeEnum& pixelType,
+                   const unsigned int patchRadius);
+
+  /** Determine if there are no patches to draw from.*/
+  bool IsEmpty() const;
+
+  /** Get the number of patches that can be drawn.*/
+  itk::SizeValueType GetNumberOfPatches() const;
+
+  /** Draw a patch using Helpers::RandomInt(). Throws if the sampler is empty. */
+  itk::ImageRegion<2> DrawPatch() const;
+
+  /** Draw a patch using 'randomState'. Throws if the sampler is empty. */
+  itk::ImageRegion<2> DrawPatch(MaskRandomState& randomState) const;
+
+private:
+
+  void Initialize(const Mask* const mask, const HoleMaskPixelTypeEnum& pixelType,
+                  const unsigned int patchRadius, const itk::ImageRegion<2>& searchRegion);
+
+  /** Draw a patch. 'randomInteger(min, max)' must return a uniformly distributed integer in [min, max].*/
+  template <typename TRandomInteger>
+  itk::ImageRegion<2> DrawPatch(TRandomInteger randomInteger) const;
+
+  /** The maximum number of pixels in a block.*/
+  static const unsigned int BlockLength = 64;
+
+  /** The center map this sampler was built from.*/
+  std::shared_ptr<const Mask::PatchCenterMapType> PatchCenterMap;
+
+  /** The buffered region of the mask, used to convert center map offsets to indices.*/
+  itk::ImageRegion<2> MaskRegion;
+
+  unsigned int PatchRadius = 0;
+
+  itk::SizeValueType NumberOfPatches = 0;
+
+  /** The offset of the first pixel of each block, the number of pixels it spans,
+    * and how many patch centers it contains. Only blocks with at least one center are stored. */
+  std::vector<itk::OffsetValueType> BlockOffsets;
+  std::vector<unsigned char> BlockLengths;
+  std::vector<unsigned char> BlockCounts;
+
+  /** The alias table. With the block weights scaled by the number of blocks, block 'i' is kept
+    * if a uniform integer in [0, NumberOfPatches) is less than AliasThresholds[i], and otherwise
+    * AliasBlocks[i] is used instead. This is exact integer arithmetic, so every patch is equally likely. */
+  std::vector<itk::SizeValueType> AliasThresholds;
+  std::vector<itk::SizeValueType> AliasBlocks;
+};
+
+#endif
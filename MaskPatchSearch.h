@@ -0,0 +1,74 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/**
+\brief Exhaustive masked patch search. Every fully valid patch of a search region (read from the mask's
+       valid patch center map) is compared with each target region using MaskPatchDistance, and the k
+       best source patches are kept. The source candidates are split across threads. Each thread keeps a
+       bounded heap of its k best candidates and uses the worst of them as the early termination bound.
+       The heaps are merged ordered by (distance, candidate number), so the result does not depend on
+       the number of threads.
+*/
+
+#ifndef MaskPatchSearch_H
+#define MaskPatchSearch_H
+
+// Custom
+#include "Mask.h"
+#include "MaskPatchDistance.h"
+
+// STL
+#include <vector>
+
+namespace MaskPatchSearch
+{
+
+/** A source patch and its distance to a target region.*/
+struct Match
+{
+  itk::ImageRegion<2> Region;
+  double Distance;
+};
+
+typedef std::vector<Match> MatchListType;
+
+/** Find the 'k' fully valid patches inside 'searchRegion' that are closest to each of 'targetRegions'
+  * (compared over the valid pixels of the target region), best first. All of the target regions must be
+  * square patches of the same radius. A fully valid target region will find itself at distance 0.
+  * Ties are broken in favor of the source patch that comes first in buffer order. 'numberOfThreads'
+  * is passed to MaskParallel::ParallelFor().*/
+template <typename TImage>
+std::vector<MatchListType> FindBestSourcePatches(const TImage* const image, const Mask* const mask,
+                                                 const std::vector<itk::ImageRegion<2> >& targetRegions,
+                                                 const itk::ImageRegion<2>& searchRegion, const unsigned int k,
+                                                 const PatchDistanceEnum distanceType = PatchDistanceEnum::SSD,
+                                                 const unsigned int numberOfThreads = 0);
+
+/** Find the 'k' fully valid patches anywhere in the image that are closest to each of 'targetRegions'.*/
+template <typename TImage>
+std::vector<MatchListType> FindBestSourcePatches(const TImage* const image, const Mask* const mask,
+                                                 const std::vector<itk::ImageRegion<2> >& targetRegions,
+                                                 const unsigned int k,
+                                                 const PatchDistanceEnum distanceType = PatchDistanceEnum::SSD,
+                                                 const unsigned int numberOfThreads = 0);
+
+} // end namespace
+
+#include "MaskPatchSearch.hpp"
+
+#endif
@@ -0,0 +1,172 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef MaskPatchSearch_HPP
+#define MaskPatchSearch_HPP
+
+#include "MaskPatchSearch.h" // Appease syntax parser
+
+// Custom
+#include "MaskOperations.h"
+#include "MaskParallel.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// STL
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace MaskPatchSearch
+{
+
+template <typename TImage>
+std::vector<MatchListType> FindBestSourcePatches(const TImage* const image, const Mask* const mask,
+                                                 const std::vector<itk::ImageRegion<2> >& targetRegions,
+                                                 const itk::ImageRegion<2>& searchRegion, const unsigned int k,
+                                                 const PatchDistanceEnum distanceType,
+                                                 const unsigned int numberOfThreads)
+{
+  std::vector<MatchListType> matches(targetRegions.size());
+  if(targetRegions.empty() || k == 0)
+  {
+    return matches;
+  }
+
+  const itk::SizeValueType patchWidth = targetRegions[0].GetSize()[0];
+  for(const itk::ImageRegion<2>& targetRegion : targetRegions)
+  {
+    if(targetRegion.GetSize()[0] != patchWidth || targetRegion.GetSize()[1] != patchWidth || patchWidth % 2 == 0)
+    {
+      std::stringstream ss;
+      ss << "MaskPatchSearch::FindBestSourcePatches: target region " << targetRegion
+         << " is not a square patch of width " << patchWidth << " (which must be odd)!";
+      throw std::runtime_error(ss.str());
+    }
+  }
+  const unsigned int patchRadius = static_cast<unsigned int>(patchWidth / 2);
+
+  const std::vector<itk::Index<2> > sourceCenters =
+      MaskOperations::GetAllFullyValidPatchCenters(mask, searchRegion, patchRadius);
+  const itk::Size<2> patchSize = targetRegions[0].GetSize();
+
+  // Candidates are (distance, candidate number) pairs, so that the comparison used by the heaps
+  // and by the final merge is a strict total order.
+  typedef std::pair<double, std::size_t> CandidateType;
+
+  // Pack every target once, in parallel.
+  std::vector<std::unique_ptr<const MaskPatchDistance<TImage> > > patchDistances(targetRegions.size());
+  MaskParallel::ParallelFor(0, targetRegions.size(), [&](const std::size_t firstTarget, const std::size_t endTarget)
+  {
+    for(std::size_t targetId = firstTarget; targetId < endTarget; ++targetId)
+    {
+      patchDistances[targetId].reset(new MaskPatchDistance<TImage>(image, mask, targetRegions[targetId]));
+    }
+  }, numberOfThreads);
+
+  // One parallel loop over (target, block of sources) pairs, so a batch of targets starts its threads once
+  // however few sources there are. Each pair keeps its k best candidates.
+  const std::size_t sourceBlockSize = 1024;
+  const std::size_t numberOfSourceBlocks = (sourceCenters.size() + sourceBlockSize - 1) / sourceBlockSize;
+  std::vector<std::vector<CandidateType> > blockCandidates(targetRegions.size() * numberOfSourceBlocks);
+  MaskParallel::ParallelFor(0, blockCandidates.size(), [&](const std::size_t firstBlock, const std::size_t endBlock)
+  {
+    for(std::size_t blockId = firstBlock; blockId < endBlock; ++blockId)
+    {
+      const MaskPatchDistance<TImage>& patchDistance = *patchDistances[blockId / numberOfSourceBlocks];
+      const std::size_t firstSource = (blockId % numberOfSourceBlocks) * sourceBlockSize;
+      const std::size_t endSource = std::min(firstSource + sourceBlockSize, sourceCenters.size());
+
+      // A max-heap of the best candidates of this block, the worst on top.
+      std::priority_queue<CandidateType> bestCandidates;
+      for(std::size_t sourceId = firstSource; sourceId < endSource; ++sourceId)
+      {
+        const double bound = (bestCandidates.size() < k) ? std::numeric_limits<double>::max() :
+                                                          bestCandidates.top().first;
+        const itk::Index<2> sourceCorner = {{sourceCenters[sourceId][0] - static_cast<itk::IndexValueType>(patchRadius),
+                                             sourceCenters[sourceId][1] - static_cast<itk::IndexValueType>(patchRadius)}};
+        const double distance = patchDistance.Compute(distanceType, image,
+                                                      itk::ImageRegion<2>(sourceCorner, patchSize), bound);
+
+        // Candidates are visited in increasing order, so a candidate that only ties the worst kept one loses.
+        if(bestCandidates.size() < k)
+        {
+          bestCandidates.push(CandidateType(distance, sourceId));
+        }
+        else if(distance < bestCandidates.top().first)
+        {
+          bestCandidates.pop();
+          bestCandidates.push(CandidateType(distance, sourceId));
+        }
+      }
+
+      std::vector<CandidateType>& candidates = blockCandidates[blockId];
+      candidates.reserve(bestCandidates.size());
+      while(!bestCandidates.empty())
+      {
+        candidates.push_back(bestCandidates.top());
+        bestCandidates.pop();
+      }
+    }
+  }, numberOfThreads);
+
+  for(std::size_t targetId = 0; targetId < targetRegions.size(); ++targetId)
+  {
+    // Every block kept its k best, so the k best overall are among them.
+    std::vector<CandidateType> candidates;
+    for(std::size_t blockNumber = 0; blockNumber < numberOfSourceBlocks; ++blockNumber)
+    {
+      const std::vector<CandidateType>& candidatesOfBlock = blockCandidates[targetId * numberOfSourceBlocks + blockNumber];
+      candidates.insert(candidates.end(), candidatesOfBlock.begin(), candidatesOfBlock.end());
+    }
+
+    const std::size_t numberOfMatches = std::min<std::size_t>(k, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + numberOfMatches, candidates.end());
+
+    matches[targetId].reserve(numberOfMatches);
+    for(std::size_t matchId = 0; matchId < numberOfMatches; ++matchId)
+    {
+      Match match;
+      match.Region = ITKHelpers::GetRegionInRadiusAroundPixel(sourceCenters[candidates[matchId].second], patchRadius);
+      match.Distance = candidates[matchId].first;
+      matches[targetId].push_back(match);
+    }
+  }
+
+  return matches;
+}
+
+template <typename TImage>
+std::vector<MatchListType> FindBestSourcePatches(const TImage* const image, const Mask* const mask,
+                                                 const std::vector<itk::ImageRegion<2> >& targetRegions,
+                                                 const unsigned int k, const PatchDistanceEnum distanceType,
+                                                 const unsigned int numberOfThreads)
+{
+  return FindBestSourcePatches(image, mask, targetRegions, mask->GetLargestPossibleRegion(), k,
+                               distanceType, numberOfThreads);
+}
+
+} // end namespace
+
+#endif
@@ -17,88 +17,207 @@
  *=========================================================================*/
 
 #include "MaskQt.h"
+#include "MaskParallel.h"
+#include "MaskView.h"
 
-// ITK
-#include "itkRegionOfInterestImageFilter.h"
-
-// Qt
-#include <QColor>
+// STL
+#include <sstream>
+#include <stdexcept>
 
 namespace MaskQt
 {
-  
-QImage GetQtImage(const Mask* const mask)
+
+namespace
+{
+void CheckFormat(const QImage::Format format)
 {
-  return GetQtImage(mask, mask->GetLargestPossibleRegion());
+  if(format != QImage::Format_ARGB32 && format != QImage::Format_Indexed8 && format != QImage::Format_Mono)
+  {
+    std::stringstream ss;
+    ss << "MaskQt: QImage format " << static_cast<int>(format)
+       << " is not supported! Use Format_ARGB32, Format_Indexed8 or Format_Mono.";
+    throw std::runtime_error(ss.str());
+  }
 }
 
-QImage GetQtImage(const Mask* const mask, const itk::ImageRegion<2>& region)
+/** Draw the pixels of 'view' into 'qimage', with the corner of the view at 'corner'. The rows are
+  * written through the image's scan lines, in parallel. */
+void DrawMaskView(const MaskView& view, const itk::Index<2>& corner, QImage& qimage)
 {
-  QImage qimage(region.GetSize()[0], region.GetSize()[1], QImage::Format_ARGB32);
-
-  typedef itk::RegionOfInterestImageFilter<Mask, Mask> RegionOfInterestImageFilterType;
-  typename RegionOfInterestImageFilterType::Pointer regionOfInterestImageFilter =
-           RegionOfInterestImageFilterType::New();
-  regionOfInterestImageFilter->SetRegionOfInterest(region);
-  regionOfInterestImageFilter->SetInput(mask);
-  regionOfInterestImageFilter->Update();
+  const QImage::Format format = qimage.format();
+  CheckFormat(format);
 
-  itk::ImageRegionConstIterator<Mask> imageIterator(regionOfInterestImageFilter->GetOutput(),
-                                                    regionOfInterestImageFilter->GetOutput()->GetLargestPossibleRegion());
+  // Detach the image data once here, rather than in scanLine() from several threads.
+  uchar* const bits = qimage.bits();
+  const std::size_t bytesPerLine = qimage.bytesPerLine();
+  const std::size_t width = view.GetSize()[0];
 
-  while(!imageIterator.IsAtEnd())
+  MaskParallel::ParallelFor(0, view.GetSize()[1], [&](const std::size_t firstRow, const std::size_t endRow)
   {
-    typename Mask::PixelType pixel = imageIterator.Get();
-
-    itk::Index<2> index = imageIterator.GetIndex();
-    // In a binary mask, R, G, and B are set to the same value.
-
-    int r = static_cast<int>(pixel);
-    int g = static_cast<int>(pixel);
-    int b = static_cast<int>(pixel);
-
-    unsigned int alpha = 0;
-
-    if(mask->IsHole(index))
+    for(std::size_t row = firstRow; row < endRow; ++row)
     {
-      alpha = 255; // opaque
+      const HoleMaskPixelTypeEnum* const maskRow = view.GetRow(row);
+      uchar* const scanLine = bits + (corner[1] + row) * bytesPerLine;
+
+      if(format == QImage::Format_ARGB32)
+      {
+        QRgb* const line = reinterpret_cast<QRgb*>(scanLine) + corner[0];
+        for(std::size_t x = 0; x < width; ++x)
+        {
+          // In a binary mask, R, G, and B are set to the same value.
+          const int value = static_cast<int>(maskRow[x]);
+          line[x] = qRgba(value, value, value, (maskRow[x] == HoleMaskPixelTypeEnum::HOLE) ? 255 : 0);
+        }
+      }
+      else if(format == QImage::Format_Indexed8)
+      {
+        uchar* const line = scanLine + corner[0];
+        for(std::size_t x = 0; x < width; ++x)
+        {
+          line[x] = static_cast<uchar>(maskRow[x]);
+        }
+      }
+      else // Format_Mono: the most significant bit of each byte is the leftmost pixel.
+      {
+        for(std::size_t x = 0; x < width; ++x)
+        {
+          const std::size_t column = corner[0] + x;
+          const uchar bit = static_cast<uchar>(0x80 >> (column & 7));
+          if(maskRow[x] == HoleMaskPixelTypeEnum::HOLE)
+          {
+            scanLine[column >> 3] |= bit;
+          }
+          else
+          {
+            scanLine[column >> 3] &= static_cast<uchar>(~bit);
+          }
+        }
+      }
     }
+  });
+}
+} // end anonymous namespace
 
-    QColor pixelColor(r,g,b,alpha);
+QImage GetQtImage(const Mask* const mask, const QImage::Format format)
+{
+  return GetQtImage(mask, mask->GetLargestPossibleRegion(), format);
+}
 
-    qimage.setPixel(index[0], index[1], pixelColor.rgba());
+QImage GetQtImage(const Mask* const mask, const itk::ImageRegion<2>& region, const QImage::Format format)
+{
+  CheckFormat(format);
 
-    ++imageIterator;
+  QImage qimage(region.GetSize()[0], region.GetSize()[1], format);
+  if(format != QImage::Format_ARGB32)
+  {
+    qimage.setColorTable(GetColorTable(format));
   }
 
+  const itk::Index<2> corner = {{0,0}};
+  DrawMaskView(MaskView(mask, region), corner, qimage);
+
   return qimage; // The actual image region
 }
 
-QImage SetPixelsToTransparent(QImage image, const Mask* const mask,
-                              HoleMaskPixelTypeEnum pixelValue)
+QVector<QRgb> GetColorTable(const QImage::Format format)
 {
-  itk::ImageRegionConstIteratorWithIndex<Mask>
-      maskIterator(mask, mask->GetLargestPossibleRegion());
-
-  while(!maskIterator.IsAtEnd())
+  QVector<QRgb> colorTable;
+  if(format == QImage::Format_Indexed8)
+  {
+    // The same colors as Format_ARGB32, indexed by the HoleMaskPixelTypeEnum value.
+    colorTable.push_back(qRgba(0, 0, 0, 255)); // HOLE
+    colorTable.push_back(qRgba(1, 1, 1, 0)); // VALID
+    colorTable.push_back(qRgba(2, 2, 2, 0)); // UNDETERMINED
+  }
+  else if(format == QImage::Format_Mono)
   {
-    itk::Index<2> index = maskIterator.GetIndex();
+    colorTable.push_back(qRgba(0, 0, 0, 0)); // Not a hole
+    colorTable.push_back(qRgba(0, 0, 0, 255)); // HOLE
+  }
+  else
+  {
+    std::stringstream ss;
+    ss << "GetColorTable: QImage format " << static_cast<int>(format) << " is not an indexed mask format!";
+    throw std::runtime_error(ss.str());
+  }
 
-    int alpha = 255; // opaque
-    if(maskIterator.Get() == pixelValue)
-    {
-      alpha = 0; // transparent
-    }
+  return colorTable;
+}
 
-    QColor pixelColor = image.pixel(index[0], index[1]);
-    pixelColor.setAlpha(alpha);
+void UpdateQtImage(QImage& image, const Mask* const mask, const itk::ImageRegion<2>& region)
+{
+  const itk::ImageRegion<2> maskRegion = mask->GetLargestPossibleRegion();
+  if(image.width() != static_cast<int>(maskRegion.GetSize()[0]) ||
+     image.height() != static_cast<int>(maskRegion.GetSize()[1]))
+  {
+    std::stringstream ss;
+    ss << "UpdateQtImage: the image (" << image.width() << "x" << image.height()
+       << ") was not made from the mask " << maskRegion;
+    throw std::runtime_error(ss.str());
+  }
 
-    image.setPixel(index[0], index[1], pixelColor.rgba());
+  itk::ImageRegion<2> updateRegion = region;
+  if(!updateRegion.Crop(maskRegion))
+  {
+    return;
+  }
+
+  const itk::Index<2> corner = {{updateRegion.GetIndex()[0] - maskRegion.GetIndex()[0],
+                                 updateRegion.GetIndex()[1] - maskRegion.GetIndex()[1]}};
+  DrawMaskView(MaskView(mask, updateRegion), corner, image);
+}
 
-    ++maskIterator;
+void UpdateQtImage(QImage& image, const Mask* const mask)
+{
+  if(mask->HasModifiedRegion())
+  {
+    UpdateQtImage(image, mask, mask->GetModifiedRegion());
   }
+}
 
+QImage SetPixelsToTransparent(QImage image, const Mask* const mask,
+                              HoleMaskPixelTypeEnum pixelValue)
+{
+  SetPixelsToTransparent(&image, mask, pixelValue);
   return image;
 }
 
+void SetPixelsToTransparent(QImage* const image, const Mask* const mask,
+                            HoleMaskPixelTypeEnum pixelValue)
+{
+  const MaskView maskView(mask);
+  if(image->width() < static_cast<int>(maskView.GetSize()[0]) ||
+     image->height() < static_cast<int>(maskView.GetSize()[1]))
+  {
+    std::stringstream ss;
+    ss << "SetPixelsToTransparent: the image (" << image->width() << "x" << image->height()
+       << ") is smaller than the mask " << mask->GetLargestPossibleRegion();
+    throw std::runtime_error(ss.str());
+  }
+
+  if(image->format() != QImage::Format_ARGB32)
+  {
+    *image = image->convertToFormat(QImage::Format_ARGB32);
+  }
+
+  // Detach the image data once here, rather than in scanLine() from several threads.
+  uchar* const bits = image->bits();
+  const std::size_t bytesPerLine = image->bytesPerLine();
+  const std::size_t width = maskView.GetSize()[0];
+
+  MaskParallel::ParallelFor(0, maskView.GetSize()[1], [&](const std::size_t firstRow, const std::size_t endRow)
+  {
+    for(std::size_t row = firstRow; row < endRow; ++row)
+    {
+      const HoleMaskPixelTypeEnum* const maskRow = maskView.GetRow(row);
+      QRgb* const line = reinterpret_cast<QRgb*>(bits + row * bytesPerLine);
+      for(std::size_t x = 0; x < width; ++x)
+      {
+        const QRgb alpha = (maskRow[x] == pixelValue) ? 0 : 255; // transparent : opaque
+        line[x] = (line[x] & 0x00ffffff) | (alpha << 24);
+      }
+    }
+  });
+}
+
 } // end namespace
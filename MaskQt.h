@@ -26,12 +26,36 @@
 
 namespace MaskQt
 {
-  QImage GetQtImage(const Mask* const mask);
+  /** Draw the mask into a QImage. Hole pixels are opaque and all other pixels are transparent.
+    * 'format' may be:
+    * Format_ARGB32: 4 bytes per pixel, gray level = the HoleMaskPixelTypeEnum value.
+    * Format_Indexed8: 1 byte per pixel, the index is the HoleMaskPixelTypeEnum value.
+    * Format_Mono: 1 bit per pixel, 1 for hole pixels.
+    * The indexed formats get the matching color table (see GetColorTable()). */
+  QImage GetQtImage(const Mask* const mask, const QImage::Format format = QImage::Format_ARGB32);
 
-  QImage GetQtImage(const Mask* const mask, const itk::ImageRegion<2>& region);
+  QImage GetQtImage(const Mask* const mask, const itk::ImageRegion<2>& region,
+                    const QImage::Format format = QImage::Format_ARGB32);
 
+  /** Get the color table GetQtImage() uses for an indexed 'format'.*/
+  QVector<QRgb> GetColorTable(const QImage::Format format);
+
+  /** Redraw the pixels of 'region' in 'image', which must have been made by GetQtImage(mask) (in any of
+    * its formats), so that they match the mask again. Only the region is touched. */
+  void UpdateQtImage(QImage& image, const Mask* const mask, const itk::ImageRegion<2>& region);
+
+  /** Redraw the pixels of mask->GetModifiedRegion(). The region is not acknowledged, so several
+    * overlays of the same mask can be updated before calling mask->AcknowledgeModifiedRegion(). */
+  void UpdateQtImage(QImage& image, const Mask* const mask);
+
+  /** Make the pixels of 'image' whose mask value is 'pixelValue' transparent and all others opaque.
+    * The image is converted to Format_ARGB32 if it has another format. */
   QImage SetPixelsToTransparent(QImage image, const Mask* const mask,
                                 HoleMaskPixelTypeEnum pixelValue);
+
+  /** Like SetPixelsToTransparent(), but changes 'image' in place.*/
+  void SetPixelsToTransparent(QImage* const image, const Mask* const mask,
+                              HoleMaskPixelTypeEnum pixelValue);
 }
 
 #endif
@@ -0,0 +1,264 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "MaskRandomState.h"
+
+// STL
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+// The Philox4x32 multipliers and Weyl key increments.
+const uint32_t PhiloxM0 = 0xD2511F53;
+const uint32_t PhiloxM1 = 0xCD9E8D57;
+const uint32_t PhiloxW0 = 0x9E3779B9;
+const uint32_t PhiloxW1 = 0xBB67AE85;
+
+const unsigned int PhiloxNumberOfRounds = 10;
+
+/** Philox4x32-10. The counter is overwritten with the output.*/
+void Philox4x32(uint32_t counter[4], uint32_t key0, uint32_t key1)
+{
+  for(unsigned int round = 0; round < PhiloxNumberOfRounds; ++round)
+  {
+    const uint64_t product0 = static_cast<uint64_t>(PhiloxM0) * counter[0];
+    const uint64_t product1 = static_cast<uint64_t>(PhiloxM1) * counter[2];
+
+    const uint32_t newCounter0 = static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key0;
+    const uint32_t newCounter2 = static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key1;
+    counter[0] = newCounter0;
+    counter[1] = static_cast<uint32_t>(product1);
+    counter[2] = newCounter2;
+    counter[3] = static_cast<uint32_t>(product0);
+
+    key0 += PhiloxW0;
+    key1 += PhiloxW1;
+  }
+}
+
+#ifdef __SSE2__
+/** Multiply each 32 bit lane of 'a' by 'multiplier' and return the low and high halves of the products.*/
+inline void MultiplyHighLow(const __m128i a, const __m128i multiplier, __m128i& low, __m128i& high)
+{
+  // Products of lanes 0 and 2, then of lanes 1 and 3, each as [low, high, low, high].
+  const __m128i evenProducts = _mm_shuffle_epi32(_mm_mul_epu32(a, multiplier), _MM_SHUFFLE(3,1,2,0));
+  const __m128i oddProducts = _mm_shuffle_epi32(_mm_mul_epu32(_mm_srli_epi64(a, 32), multiplier),
+                                                _MM_SHUFFLE(3,1,2,0));
+  low = _mm_unpacklo_epi32(evenProducts, oddProducts);
+  high = _mm_unpackhi_epi32(evenProducts, oddProducts);
+}
+
+/** Compute Philox blocks [firstBlock, firstBlock + 4) of 'stream' and write them as 16 uniform floats.*/
+void Philox4x32x4UniformFloats(const uint64_t firstBlock, const uint64_t stream,
+                               const uint64_t seed, float* const values)
+{
+  // Lane j of counterN holds word N of the counter of block firstBlock + j.
+  uint32_t blockLow[4];
+  uint32_t blockHigh[4];
+  for(unsigned int lane = 0; lane < 4; ++lane)
+  {
+    blockLow[lane] = static_cast<uint32_t>(firstBlock + lane);
+    blockHigh[lane] = static_cast<uint32_t>((firstBlock + lane) >> 32);
+  }
+  __m128i counter0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blockLow));
+  __m128i counter1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blockHigh));
+  __m128i counter2 = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream)));
+  __m128i counter3 = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream >> 32)));
+
+  const __m128i multiplier0 = _mm_set1_epi32(static_cast<int>(PhiloxM0));
+  const __m128i multiplier1 = _mm_set1_epi32(static_cast<int>(PhiloxM1));
+  uint32_t key0 = static_cast<uint32_t>(seed);
+  uint32_t key1 = static_cast<uint32_t>(seed >> 32);
+
+  for(unsigned int round = 0; round < PhiloxNumberOfRounds; ++round)
+  {
+    __m128i low0, high0, low1, high1;
+    MultiplyHighLow(counter0, multiplier0, low0, high0);
+    MultiplyHighLow(counter2, multiplier1, low1, high1);
+
+    counter0 = _mm_xor_si128(_mm_xor_si128(high1, counter1), _mm_set1_epi32(static_cast<int>(key0)));
+    counter1 = low1;
+    counter2 = _mm_xor_si128(_mm_xor_si128(high0, counter3), _mm_set1_epi32(static_cast<int>(key1)));
+    counter3 = low0;
+
+    key0 += PhiloxW0;
+    key1 += PhiloxW1;
+  }
+
+  // Same conversion as ToUniformFloat(): the top 24 bits scaled by 2^-24, which is exact.
+  const __m128 scale = _mm_set1_ps(1.0f / 16777216.0f);
+  __m128 word0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(counter0, 8)), scale);
+  __m128 word1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(counter1, 8)), scale);
+  __m128 word2 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(counter2, 8)), scale);
+  __m128 word3 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(counter3, 8)), scale);
+
+  // Transpose so that each block's four outputs are consecutive.
+  _MM_TRANSPOSE4_PS(word0, word1, word2, word3);
+  _mm_storeu_ps(values, word0);
+  _mm_storeu_ps(values + 4, word1);
+  _mm_storeu_ps(values + 8, word2);
+  _mm_storeu_ps(values + 12, word3);
+}
+#endif
+
+} // end anonymous namespace
+
+MaskRandomState::MaskRandomState(const uint64_t seed, const uint64_t stream) : Seed(seed), Stream(stream)
+{
+}
+
+uint64_t MaskRandomState::GetSeed() const
+{
+  return this->Seed;
+}
+
+uint64_t MaskRandomState::GetStream() const
+{
+  return this->Stream;
+}
+
+void MaskRandomState::ComputeBlock(const uint64_t blockIndex, uint32_t output[4]) const
+{
+  output[0] = static_cast<uint32_t>(blockIndex);
+  output[1] = static_cast<uint32_t>(blockIndex >> 32);
+  output[2] = static_cast<uint32_t>(this->Stream);
+  output[3] = static_cast<uint32_t>(this->Stream >> 32);
+  Philox4x32(output, static_cast<uint32_t>(this->Seed), static_cast<uint32_t>(this->Seed >> 32));
+}
+
+MaskRandomState MaskRandomState::Split()
+{
+  // The child keeps the seed (key) and gets a stream id drawn from this state.
+  return MaskRandomState(this->Seed, this->NextUInt64());
+}
+
+uint32_t MaskRandomState::NextUInt32()
+{
+  if(this->NumberOfUsedOutputs == 4)
+  {
+    ComputeBlock(this->NextBlock, this->Block);
+    this->NextBlock++;
+    this->NumberOfUsedOutputs = 0;
+  }
+
+  return this->Block[this->NumberOfUsedOutputs++];
+}
+
+uint64_t MaskRandomState::NextUInt64()
+{
+  const uint64_t low = NextUInt32();
+  const uint64_t high = NextUInt32();
+  return (high << 32) | low;
+}
+
+float MaskRandomState::NextUniformFloat()
+{
+  return ToUniformFloat(NextUInt32());
+}
+
+uint64_t MaskRandomState::NextUniformInteger(const uint64_t minValue, const uint64_t maxValue)
+{
+  if(maxValue <= minValue)
+  {
+    return minValue;
+  }
+
+  const uint64_t range = maxValue - minValue;
+
+  if(range <= std::numeric_limits<uint32_t>::max())
+  {
+    // Reject draws from the incomplete last copy of [0, range] so every value is equally likely.
+    const uint64_t numberOfValues = range + 1;
+    const uint64_t limit = (uint64_t(1) << 32) - (uint64_t(1) << 32) % numberOfValues;
+    uint64_t randomBits;
+    do
+    {
+      randomBits = NextUInt32();
+    } while(randomBits >= limit);
+
+    return minValue + randomBits % numberOfValues;
+  }
+
+  if(range == std::numeric_limits<uint64_t>::max())
+  {
+    return NextUInt64();
+  }
+
+  const uint64_t numberOfValues = range + 1;
+  const uint64_t limit = std::numeric_limits<uint64_t>::max() -
+                         (std::numeric_limits<uint64_t>::max() % numberOfValues + 1) % numberOfValues;
+  uint64_t randomBits;
+  do
+  {
+    randomBits = NextUInt64();
+  } while(randomBits > limit);
+
+  return minValue + randomBits % numberOfValues;
+}
+
+uint32_t MaskRandomState::GetUInt32(const uint64_t position) const
+{
+  uint32_t block[4];
+  ComputeBlock(position / 4, block);
+  return block[position % 4];
+}
+
+void MaskRandomState::GetUniformFloats(const uint64_t firstPosition, const std::size_t count,
+                                       float* const values) const
+{
+  std::size_t valueId = 0;
+  uint64_t position = firstPosition;
+  uint32_t block[4];
+
+  // Finish the block that 'firstPosition' is in.
+  if(position % 4 != 0)
+  {
+    ComputeBlock(position / 4, block);
+    for(; valueId < count && position % 4 != 0; ++valueId, ++position)
+    {
+      values[valueId] = ToUniformFloat(block[position % 4]);
+    }
+  }
+
+#ifdef __SSE2__
+  for(; valueId + 16 <= count; valueId += 16, position += 16)
+  {
+    Philox4x32x4UniformFloats(position / 4, this->Stream, this->Seed, values + valueId);
+  }
+#endif
+
+  for(; valueId < count; ++valueId, ++position)
+  {
+    if(position % 4 == 0)
+    {
+      ComputeBlock(position / 4, block);
+    }
+    values[valueId] = ToUniformFloat(block[position % 4]);
+  }
+}
+
+float MaskRandomState::ToUniformFloat(const uint32_t randomBits)
+{
+  // A float has 24 bits of precision, so use the top 24 bits.
+  return static_cast<float>(randomBits >> 8) * (1.0f / 16777216.0f);
+}
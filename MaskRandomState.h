@@ -0,0 +1,89 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/**
+\class MaskRandomState
+\brief A seedable random number generator for the randomized Mask operations, built on the
+       Philox4x32-10 counter-based generator. Every output is a pure function of (seed, stream, position),
+       so values can be looked up by position (e.g. a pixel's buffer offset) in any order, from any
+       thread, and always come out the same. A state is not meant to be shared between threads while
+       drawing sequentially - use Split() to give each worker its own independent stream.
+*/
+
+#ifndef MaskRandomState_H
+#define MaskRandomState_H
+
+// STL
+#include <cstddef>
+#include <cstdint>
+
+class MaskRandomState
+{
+public:
+  MaskRandomState(const uint64_t seed = 0, const uint64_t stream = 0);
+
+  uint64_t GetSeed() const;
+
+  uint64_t GetStream() const;
+
+  /** Return a new state with an independent stream. This draws from (and so advances) this state,
+    * so repeated calls return different streams, and the same sequence of calls on the same seed
+    * always returns the same streams. */
+  MaskRandomState Split();
+
+  /** Draw the next 32 random bits of the sequence.*/
+  uint32_t NextUInt32();
+
+  /** Draw the next 64 random bits of the sequence.*/
+  uint64_t NextUInt64();
+
+  /** Draw a float uniformly distributed in [0, 1).*/
+  float NextUniformFloat();
+
+  /** Draw an integer uniformly distributed in [minValue, maxValue] (without modulo bias).*/
+  uint64_t NextUniformInteger(const uint64_t minValue, const uint64_t maxValue);
+
+  /** Get the 32 random bits at 'position' of this stream. This does not depend on or change the
+    * sequential position of the state. */
+  uint32_t GetUInt32(const uint64_t position) const;
+
+  /** Get the uniform [0, 1) floats at positions [firstPosition, firstPosition + count) of this stream.
+    * This does not depend on or change the sequential position of the state. Four Philox blocks are
+    * computed at a time with SSE2 when it is available; the results are identical either way. */
+  void GetUniformFloats(const uint64_t firstPosition, const std::size_t count, float* const values) const;
+
+  /** Convert 32 random bits to a float uniformly distributed in [0, 1).*/
+  static float ToUniformFloat(const uint32_t randomBits);
+
+private:
+  /** Compute the four 32 bit outputs of Philox block 'blockIndex' of this stream.*/
+  void ComputeBlock(const uint64_t blockIndex, uint32_t output[4]) const;
+
+  uint64_t Seed;
+
+  uint64_t Stream;
+
+  /** The index of the next block of the sequence to compute.*/
+  uint64_t NextBlock = 0;
+
+  /** The current block of the sequence and how many of its outputs have been used.*/
+  uint32_t Block[4];
+  unsigned int NumberOfUsedOutputs = 4;
+};
+
+#endif
@@ -0,0 +1,133 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/**
+\class MaskRegionStatistics
+\brief Computes statistics of the pixels of an image region that have a particular mask value (or of the
+       non-zero pixels) in a single pass over the image and mask buffers. The count is always computed;
+       any subset of the minimum and maximum (with the first index where they occur), the mean and the
+       variance (Welford's algorithm) can be requested. Every statistic is computed per component, so
+       itk::VectorImage and fixed size vector pixels are handled like scalars. The object owns its
+       accumulators, so reusing it across calls does not allocate.
+*/
+
+#ifndef MaskRegionStatistics_H
+#define MaskRegionStatistics_H
+
+// Custom
+#include "Mask.h"
+#include "MaskImageBuffer.h"
+
+// STL
+#include <vector>
+
+template <typename TImage>
+class MaskRegionStatistics
+{
+public:
+  typedef typename MaskImageBuffer::ImageComponents<TImage>::ComponentType ComponentType;
+
+  /** The statistics that can be requested, combined with |. The count is always computed.*/
+  enum StatisticsFlags
+  {
+    MINIMUM = 1,
+    MAXIMUM = 2,
+    MEAN = 4,
+    VARIANCE = 8, // Also computes the mean
+    ALL = MINIMUM | MAXIMUM | MEAN | VARIANCE
+  };
+
+  explicit MaskRegionStatistics(const unsigned int statistics = ALL);
+
+  /** Set the statistics to compute. This resets the accumulated statistics.*/
+  void SetStatistics(const unsigned int statistics);
+  unsigned int GetStatistics() const;
+
+  /** Discard the accumulated pixels.*/
+  void Reset();
+
+  /** Reset() and accumulate the pixels of 'region' whose value in 'mask' is 'maskValue'.*/
+  void Compute(const TImage* const image, const Mask* const mask, const itk::ImageRegion<2>& region,
+               const HoleMaskPixelTypeEnum& maskValue);
+
+  /** Add the pixels of 'region' whose value in 'mask' is 'maskValue' to the statistics. The region must be
+    * inside the buffered regions of the image and the mask. */
+  void Accumulate(const TImage* const image, const Mask* const mask, const itk::ImageRegion<2>& region,
+                  const HoleMaskPixelTypeEnum& maskValue);
+
+  /** Add the pixels of 'region' that have a non-zero component to the statistics.*/
+  void AccumulateNonZero(const TImage* const image, const itk::ImageRegion<2>& region);
+
+  /** Get the number of accumulated pixels.*/
+  itk::SizeValueType GetCount() const;
+
+  unsigned int GetNumberOfComponents() const;
+
+  /** Get a statistic of one component. These throw if the statistic was not requested or no pixels were accumulated.*/
+  double GetMinimum(const unsigned int component = 0) const;
+  double GetMaximum(const unsigned int component = 0) const;
+  double GetMean(const unsigned int component = 0) const;
+
+  /** Get the population variance (the mean squared deviation from the mean).*/
+  double GetVariance(const unsigned int component = 0) const;
+
+  /** Get the first index (in buffer order of the accumulated regions) where a component is smallest or largest.*/
+  itk::Index<2> GetMinimumIndex(const unsigned int component = 0) const;
+  itk::Index<2> GetMaximumIndex(const unsigned int component = 0) const;
+
+  /** Get a statistic of every component as a pixel (e.g. TImage::PixelType, or a larger type for the mean).*/
+  template <typename TPixel>
+  void GetMinimum(TPixel& pixel) const;
+
+  template <typename TPixel>
+  void GetMaximum(TPixel& pixel) const;
+
+  template <typename TPixel>
+  void GetMean(TPixel& pixel) const;
+
+  template <typename TPixel>
+  void GetVariance(TPixel& pixel) const;
+
+private:
+  /** Add one pixel to the statistics.*/
+  void AccumulatePixel(const itk::Index<2>& index, const ComponentType* const components);
+
+  /** Check that the image components are compatible with the accumulated ones, and start accumulating if nothing has been.*/
+  void Prepare(const TImage* const image, const itk::ImageRegion<2>& region);
+
+  void CheckStatistic(const unsigned int statistic, const unsigned int component, const char* const name) const;
+
+  unsigned int Statistics;
+
+  unsigned int NumberOfComponents = 0;
+
+  itk::SizeValueType Count = 0;
+
+  std::vector<double> Minimum;
+  std::vector<double> Maximum;
+  std::vector<itk::Index<2> > MinimumIndex;
+  std::vector<itk::Index<2> > MaximumIndex;
+
+  /** Welford's running mean and sum of squared deviations from it.*/
+  std::vector<double> Mean;
+  std::vector<double> SquaredDeviations;
+};
+
+#include "MaskRegionStatistics.hpp"
+
+#endif
@@ -0,0 +1,302 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef MaskRegionStatistics_HPP
+#define MaskRegionStatistics_HPP
+
+#include "MaskRegionStatistics.h" // Appease syntax parser
+
+// STL
+#include <sstream>
+#include <stdexcept>
+
+template <typename TImage>
+MaskRegionStatistics<TImage>::MaskRegionStatistics(const unsigned int statistics) : Statistics(statistics)
+{
+}
+
+template <typename TImage>
+void MaskRegionStatistics<TImage>::SetStatistics(const unsigned int statistics)
+{
+  this->Statistics = statistics;
+  Reset();
+}
+
+template <typename TImage>
+unsigned int MaskRegionStatistics<TImage>::GetStatistics() const
+{
+  return this->Statistics;
+}
+
+template <typename TImage>
+void MaskRegionStatistics<TImage>::Reset()
+{
+  this->Count = 0;
+  this->NumberOfComponents = 0;
+}
+
+template <typename TImage>
+void MaskRegionStatistics<TImage>::Compute(const TImage* const image, const Mask* const mask,
+                                           const itk::ImageRegion<2>& region, const HoleMaskPixelTypeEnum& maskValue)
+{
+  Reset();
+  Accumulate(image, mask, region, maskValue);
+}
+
+template <typename TImage>
+void MaskRegionStatistics<TImage>::Prepare(const TImage* const image, const itk::ImageRegion<2>& region)
+{
+  if(!image->GetBufferedRegion().IsInside(region))
+  {
+    std::stringstream ss;
+    ss << "MaskRegionStatistics: region " << region << " is not inside the image " << image->GetBufferedRegion();
+    throw std::runtime_error(ss.str());
+  }
+
+  const unsigned int numberOfComponents = MaskImageBuffer::ImageComponents<TImage>::GetNumberOfComponents(image);
+  if(this->Count > 0 && numberOfComponents != this->NumberOfComponents)
+  {
+    throw std::runtime_error("MaskRegionStatistics: the image has a different number of components than the "
+                             "accumulated pixels!");
+  }
+
+  // The accumulators only grow, so a reused object does not allocate.
+  this->NumberOfComponents = numberOfComponents;
+  if(this->Minimum.size() < numberOfComponents)
+  {
+    this->Minimum.resize(numberOfComponents);
+    this->Maximum.resize(numberOfComponents);
+    this->MinimumIndex.resize(numberOfComponents);
+    this->MaximumIndex.resize(numberOfComponents);
+    this->Mean.resize(numberOfComponents);
+    this->SquaredDeviations.resize(numberOfComponents);
+  }
+}
+
+template <typename TImage>
+void MaskRegionStatistics<TImage>::Accumulate(const TImage* const image, const Mask* const mask,
+                                              const itk::ImageRegion<2>& region, const HoleMaskPixelTypeEnum& maskValue)
+{
+  Prepare(image, region);
+  if(!mask->GetBufferedRegion().IsInside(region))
+  {
+    std::stringstream ss;
+    ss << "MaskRegionStatistics: region " << region << " is not inside the mask " << mask->GetBufferedRegion();
+    throw std::runtime_error(ss.str());
+  }
+
+  const ComponentType* const buffer = MaskImageBuffer::ImageComponents<TImage>::GetComponentBuffer(image);
+  for(itk::SizeValueType row = 0; row < region.GetSize()[1]; ++row)
+  {
+    itk::Index<2> pixel = {{region.GetIndex()[0], region.GetIndex()[1] + static_cast<itk::IndexValueType>(row)}};
+    const HoleMaskPixelTypeEnum* maskValues = mask->GetBufferPointer() + mask->ComputeOffset(pixel);
+    const ComponentType* components = buffer + image->ComputeOffset(pixel) * this->NumberOfComponents;
+    for(itk::SizeValueType column = 0; column < region.GetSize()[0];
+        ++column, ++pixel[0], ++maskValues, components += this->NumberOfComponents)
+    {
+      if(*maskValues == maskValue)
+      {
+        AccumulatePixel(pixel, components);
+      }
+    }
+  }
+}
+
+template <typename TImage>
+void MaskRegionStatistics<TImage>::AccumulateNonZero(const TImage* const image, const itk::ImageRegion<2>& region)
+{
+  Prepare(image, region);
+
+  const ComponentType* const buffer = MaskImageBuffer::ImageComponents<TImage>::GetComponentBuffer(image);
+  for(itk::SizeValueType row = 0; row < region.GetSize()[1]; ++row)
+  {
+    itk::Index<2> pixel = {{region.GetIndex()[0], region.GetIndex()[1] + static_cast<itk::IndexValueType>(row)}};
+    const ComponentType* components = buffer + image->ComputeOffset(pixel) * this->NumberOfComponents;
+    for(itk::SizeValueType column = 0; column < region.GetSize()[0];
+        ++column, ++pixel[0], components += this->NumberOfComponents)
+    {
+      for(unsigned int component = 0; component < this->NumberOfComponents; ++component)
+      {
+        if(components[component] != ComponentType())
+        {
+          AccumulatePixel(pixel, components);
+          break;
+        }
+      }
+    }
+  }
+}
+
+template <typename TImage>
+inline void MaskRegionStatistics<TImage>::AccumulatePixel(const itk::Index<2>& index, const ComponentType* const components)
+{
+  this->Count++;
+  const bool isFirstPixel = (this->Count == 1);
+  const double inverseCount = 1.0 / static_cast<double>(this->Count);
+
+  for(unsigned int component = 0; component < this->NumberOfComponents; ++component)
+  {
+    const double value = static_cast<double>(components[component]);
+
+    if(this->Statistics & MINIMUM)
+    {
+      if(isFirstPixel || value < this->Minimum[component])
+      {
+        this->Minimum[component] = value;
+        this->MinimumIndex[component] = index;
+      }
+    }
+
+    if(this->Statistics & MAXIMUM)
+    {
+      if(isFirstPixel || value > this->Maximum[component])
+      {
+        this->Maximum[component] = value;
+        this->MaximumIndex[component] = index;
+      }
+    }
+
+    if(this->Statistics & (MEAN | VARIANCE))
+    {
+      if(isFirstPixel)
+      {
+        this->Mean[component] = 0;
+        this->SquaredDeviations[component] = 0;
+      }
+
+      const double deviation = value - this->Mean[component];
+      this->Mean[component] += deviation * inverseCount;
+      this->SquaredDeviations[component] += deviation * (value - this->Mean[component]);
+    }
+  }
+}
+
+template <typename TImage>
+itk::SizeValueType MaskRegionStatistics<TImage>::GetCount() const
+{
+  return this->Count;
+}
+
+template <typename TImage>
+unsigned int MaskRegionStatistics<TImage>::GetNumberOfComponents() const
+{
+  return this->NumberOfComponents;
+}
+
+template <typename TImage>
+void MaskRegionStatistics<TImage>::CheckStatistic(const unsigned int statistic, const unsigned int component,
+                                                  const char* const name) const
+{
+  if(!(this->Statistics & statistic))
+  {
+    std::stringstream ss;
+    ss << "MaskRegionStatistics::" << name << ": this statistic was not requested!";
+    throw std::runtime_error(ss.str());
+  }
+
+  if(this->Count == 0)
+  {
+    std::stringstream ss;
+    ss << "MaskRegionStatistics::" << name << ": no pixels were accumulated!";
+    throw std::runtime_error(ss.str());
+  }
+
+  if(component >= this->NumberOfComponents)
+  {
+    std::stringstream ss;
+    ss << "MaskRegionStatistics::" << name << ": component " << component << " is out of range!";
+    throw std::runtime_error(ss.str());
+  }
+}
+
+template <typename TImage>
+double MaskRegionStatistics<TImage>::GetMinimum(const unsigned int component) const
+{
+  CheckStatistic(MINIMUM, component, "GetMinimum");
+  return this->Minimum[component];
+}
+
+template <typename TImage>
+double MaskRegionStatistics<TImage>::GetMaximum(const unsigned int component) const
+{
+  CheckStatistic(MAXIMUM, component, "GetMaximum");
+  return this->Maximum[component];
+}
+
+template <typename TImage>
+double MaskRegionStatistics<TImage>::GetMean(const unsigned int component) const
+{
+  CheckStatistic(MEAN | VARIANCE, component, "GetMean");
+  return this->Mean[component];
+}
+
+template <typename TImage>
+double MaskRegionStatistics<TImage>::GetVariance(const unsigned int component) const
+{
+  CheckStatistic(VARIANCE, component, "GetVariance");
+  return this->SquaredDeviations[component] / static_cast<double>(this->Count);
+}
+
+template <typename TImage>
+itk::Index<2> MaskRegionStatistics<TImage>::GetMinimumIndex(const unsigned int component) const
+{
+  CheckStatistic(MINIMUM, component, "GetMinimumIndex");
+  return this->MinimumIndex[component];
+}
+
+template <typename TImage>
+itk::Index<2> MaskRegionStatistics<TImage>::GetMaximumIndex(const unsigned int component) const
+{
+  CheckStatistic(MAXIMUM, component, "GetMaximumIndex");
+  return this->MaximumIndex[component];
+}
+
+template <typename TImage>
+template <typename TPixel>
+void MaskRegionStatistics<TImage>::GetMinimum(TPixel& pixel) const
+{
+  CheckStatistic(MINIMUM, 0, "GetMinimum");
+  MaskImageBuffer::SetPixelComponents(this->Minimum.data(), this->NumberOfComponents, pixel);
+}
+
+template <typename TImage>
+template <typename TPixel>
+void MaskRegionStatistics<TImage>::GetMaximum(TPixel& pixel) const
+{
+  CheckStatistic(MAXIMUM, 0, "GetMaximum");
+  MaskImageBuffer::SetPixelComponents(this->Maximum.data(), this->NumberOfComponents, pixel);
+}
+
+template <typename TImage>
+template <typename TPixel>
+void MaskRegionStatistics<TImage>::GetMean(TPixel& pixel) const
+{
+  CheckStatistic(MEAN | VARIANCE, 0, "GetMean");
+  MaskImageBuffer::SetPixelComponents(this->Mean.data(), this->NumberOfComponents, pixel);
+}
+
+template <typename TImage>
+template <typename TPixel>
+void MaskRegionStatistics<TImage>::GetVariance(TPixel& pixel) const
+{
+  CheckStatistic(VARIANCE, 0, "GetVariance");
+  MaskImageBuffer::SetPixelComponents(this->SquaredDeviations.data(), this->NumberOfComponents, pixel,
+                                      1.0 / static_cast<double>(this->Count));
+}
+
+#endif
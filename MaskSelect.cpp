@@ -0,0 +1,131 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#include "MaskSelect.h"
+
+// Custom
+#include "Mask.h"
+
+// STL
+#include <cstdint>
+#include <cstring>
+
+// SIMD
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static_assert(sizeof(HoleMaskPixelTypeEnum) == sizeof(int32_t),
+              "The mask kernels compare mask pixels as 32 bit integers.");
+
+namespace MaskSelectKernels
+{
+
+void ExpandSelection(const HoleMaskPixelTypeEnum* const mask, const HoleMaskPixelTypeEnum value,
+                     const std::size_t numberOfPixels, const std::size_t pixelSize, unsigned char* const selection)
+{
+  std::size_t pixelId = 0;
+
+#if defined(__SSE2__)
+  // The compares give 32 bit lanes of all ones or zeros, which saturating packs narrow to 16 and 8 bits
+  // without changing them, and unpacking with themselves widens to 64 bits.
+  const __m128i valueVector = _mm_set1_epi32(static_cast<int32_t>(value));
+  auto compare = [&](const std::size_t firstPixel)
+  {
+    return _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + firstPixel)), valueVector);
+  };
+
+  switch(pixelSize)
+  {
+    case 1:
+      for(; pixelId + 16 <= numberOfPixels; pixelId += 16)
+      {
+        const __m128i low = _mm_packs_epi32(compare(pixelId), compare(pixelId + 4));
+        const __m128i high = _mm_packs_epi32(compare(pixelId + 8), compare(pixelId + 12));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(selection + pixelId), _mm_packs_epi16(low, high));
+      }
+      break;
+    case 2:
+      for(; pixelId + 8 <= numberOfPixels; pixelId += 8)
+      {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(selection + 2 * pixelId),
+                         _mm_packs_epi32(compare(pixelId), compare(pixelId + 4)));
+      }
+      break;
+    case 4:
+      for(; pixelId + 4 <= numberOfPixels; pixelId += 4)
+      {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(selection + 4 * pixelId), compare(pixelId));
+      }
+      break;
+    case 8:
+      for(; pixelId + 4 <= numberOfPixels; pixelId += 4)
+      {
+        const __m128i lanes = compare(pixelId);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(selection + 8 * pixelId), _mm_unpacklo_epi32(lanes, lanes));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(selection + 8 * pixelId + 16), _mm_unpackhi_epi32(lanes, lanes));
+      }
+      break;
+    default:
+      break;
+  }
+#endif
+
+  for(; pixelId < numberOfPixels; ++pixelId)
+  {
+    std::memset(selection + pixelId * pixelSize, (mask[pixelId] == value) ? 0xFF : 0, pixelSize);
+  }
+}
+
+void SelectBytes(const unsigned char* const selection, const unsigned char* const first,
+                 const unsigned char* const second, unsigned char* const output, const std::size_t numberOfBytes)
+{
+  std::size_t byteId = 0;
+
+#if defined(__AVX2__)
+  for(; byteId + 32 <= numberOfBytes; byteId += 32)
+  {
+    const __m256i selectionVector = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(selection + byteId));
+    const __m256i firstVector = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + byteId));
+    const __m256i secondVector = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(second + byteId));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + byteId),
+                        _mm256_blendv_epi8(secondVector, firstVector, selectionVector));
+  }
+#elif defined(__SSE2__)
+  for(; byteId + 16 <= numberOfBytes; byteId += 16)
+  {
+    const __m128i selectionVector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(selection + byteId));
+    const __m128i firstVector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + byteId));
+    const __m128i secondVector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(second + byteId));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + byteId),
+                     _mm_or_si128(_mm_and_si128(selectionVector, firstVector),
+                                  _mm_andnot_si128(selectionVector, secondVector)));
+  }
+#endif
+
+  for(; byteId < numberOfBytes; ++byteId)
+  {
+    output[byteId] = static_cast<unsigned char>((selection[byteId] & first[byteId]) |
+                                                (~selection[byteId] & second[byteId]));
+  }
+}
+
+} // end namespace
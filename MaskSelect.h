@@ -0,0 +1,86 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/** Masked select and fill over whole rows of raw image buffers: output = (mask == value) ? first : second,
+  * and output = (mask == value) ? constant : output. Each block of a row first expands the mask values
+  * into a byte mask with one byte per pixel byte (packed compares with SSE2), and then blends the rows
+  * 16 or 32 bytes at a time (SSE2 and/andnot/or or AVX2 blendv). There are no per-pixel branches, so the
+  * cost does not depend on the shape of the mask, and rows are split across threads. */
+
+#ifndef MaskSelect_H
+#define MaskSelect_H
+
+// Custom
+#include "MaskImageBuffer.h"
+
+// ITK
+#include "itkImageRegion.h"
+
+// STL
+#include <cstddef>
+
+// Mask.h includes this file (through Mask.hpp), so only declare what is needed here.
+class Mask;
+enum class HoleMaskPixelTypeEnum;
+
+/** The byte level kernels.*/
+namespace MaskSelectKernels
+{
+/** Set the 'pixelSize' bytes of every one of the 'numberOfPixels' pixels in 'selection' to 0xFF if its
+  * mask value is 'value', and to 0 otherwise.*/
+void ExpandSelection(const HoleMaskPixelTypeEnum* const mask, const HoleMaskPixelTypeEnum value,
+                     const std::size_t numberOfPixels, const std::size_t pixelSize, unsigned char* const selection);
+
+/** output[i] = selection[i] ? first[i] : second[i] for 'numberOfBytes' bytes. 'output' may be the same
+  * array as 'first' or 'second'.*/
+void SelectBytes(const unsigned char* const selection, const unsigned char* const first,
+                 const unsigned char* const second, unsigned char* const output, const std::size_t numberOfBytes);
+} // end namespace
+
+namespace MaskSelect
+{
+
+/** Set each pixel of 'imageRegion' in 'output' to the pixel of 'first' if the corresponding pixel of
+  * 'maskRegion' in 'mask' is 'value', and to the pixel of 'second' otherwise. The regions must have the
+  * same size and be inside the buffered regions. Any of the images may be the same image. */
+template <typename TImage>
+void Select(const Mask* const mask, const itk::ImageRegion<2>& maskRegion, const HoleMaskPixelTypeEnum& value,
+            const TImage* const first, const TImage* const second, TImage* const output,
+            const itk::ImageRegion<2>& imageRegion);
+
+/** Select() over the whole mask, which must have the same region as the images.*/
+template <typename TImage>
+void Select(const Mask* const mask, const HoleMaskPixelTypeEnum& value, const TImage* const first,
+            const TImage* const second, TImage* const output);
+
+/** Set each pixel of 'imageRegion' in 'output' whose pixel in 'maskRegion' of 'mask' is 'value' to 'pixel'.*/
+template <typename TImage>
+void Fill(const Mask* const mask, const itk::ImageRegion<2>& maskRegion, const HoleMaskPixelTypeEnum& value,
+          const typename TImage::PixelType& pixel, TImage* const output, const itk::ImageRegion<2>& imageRegion);
+
+/** Fill() over the whole mask, which must have the same region as the image.*/
+template <typename TImage>
+void Fill(const Mask* const mask, const HoleMaskPixelTypeEnum& value, const typename TImage::PixelType& pixel,
+          TImage* const output);
+
+} // end namespace
+
+#include "MaskSelect.hpp"
+
+#endif
@@ -0,0 +1,203 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef MaskSelect_HPP
+#define MaskSelect_HPP
+
+#include "MaskSelect.h" // Appease syntax parser
+
+// Custom
+#include "Mask.h"
+#include "MaskParallel.h"
+
+// STL
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace MaskSelect
+{
+
+/** The number of pixels whose byte mask is expanded at a time, so the byte mask stays in the L1 cache.*/
+const std::size_t BlockLength = 1024;
+
+/** Throw if 'region' is not inside the buffered region of 'image'.*/
+template <typename TImage>
+void CheckRegion(const TImage* const image, const itk::ImageRegion<2>& region, const char* const functionName)
+{
+  if(!image->GetBufferedRegion().IsInside(region))
+  {
+    std::stringstream ss;
+    ss << functionName << ": region " << region << " is not inside the buffered region "
+       << image->GetBufferedRegion() << "!";
+    throw std::runtime_error(ss.str());
+  }
+}
+
+/** Get the first byte of the row of 'region' that is 'regionRow' rows below its corner.*/
+template <typename TImage>
+unsigned char* GetRowBytes(TImage* const image, const itk::ImageRegion<2>& region, const std::size_t regionRow,
+                           const std::size_t pixelSize)
+{
+  const itk::Index<2> rowStart = {{region.GetIndex()[0],
+                                   region.GetIndex()[1] + static_cast<itk::IndexValueType>(regionRow)}};
+  return reinterpret_cast<unsigned char*>(MaskImageBuffer::ImageComponents<TImage>::GetComponentBuffer(image)) +
+         image->ComputeOffset(rowStart) * pixelSize;
+}
+
+template <typename TImage>
+const unsigned char* GetRowBytes(const TImage* const image, const itk::ImageRegion<2>& region,
+                                 const std::size_t regionRow, const std::size_t pixelSize)
+{
+  const itk::Index<2> rowStart = {{region.GetIndex()[0],
+                                   region.GetIndex()[1] + static_cast<itk::IndexValueType>(regionRow)}};
+  return reinterpret_cast<const unsigned char*>(MaskImageBuffer::ImageComponents<TImage>::GetComponentBuffer(image)) +
+         image->ComputeOffset(rowStart) * pixelSize;
+}
+
+/** Call 'function(regionRow, firstPixel, numberOfPixels, selection)' for every block of every row of
+  * 'maskRegion', with 'selection' holding the byte mask of the block.*/
+template <typename TFunction>
+void ForEachSelectedBlock(const Mask* const mask, const itk::ImageRegion<2>& maskRegion,
+                          const HoleMaskPixelTypeEnum& value, const std::size_t pixelSize, TFunction function)
+{
+  const std::size_t width = maskRegion.GetSize()[0];
+  MaskParallel::ParallelFor(0, maskRegion.GetSize()[1], [&](const std::size_t firstRow, const std::size_t endRow)
+  {
+    std::vector<unsigned char> selection(std::min(width, BlockLength) * pixelSize);
+    for(std::size_t row = firstRow; row < endRow; ++row)
+    {
+      const itk::Index<2> maskRowStart = {{maskRegion.GetIndex()[0],
+                                           maskRegion.GetIndex()[1] + static_cast<itk::IndexValueType>(row)}};
+      const HoleMaskPixelTypeEnum* const maskRow = mask->GetBufferPointer() + mask->ComputeOffset(maskRowStart);
+      for(std::size_t firstPixel = 0; firstPixel < width; firstPixel += BlockLength)
+      {
+        const std::size_t numberOfPixels = std::min(BlockLength, width - firstPixel);
+        MaskSelectKernels::ExpandSelection(maskRow + firstPixel, value, numberOfPixels, pixelSize, selection.data());
+        function(row, firstPixel, numberOfPixels, selection.data());
+      }
+    }
+  });
+}
+
+template <typename TImage>
+void Select(const Mask* const mask, const itk::ImageRegion<2>& maskRegion, const HoleMaskPixelTypeEnum& value,
+            const TImage* const first, const TImage* const second, TImage* const output,
+            const itk::ImageRegion<2>& imageRegion)
+{
+  if(maskRegion.GetSize() != imageRegion.GetSize())
+  {
+    std::stringstream ss;
+    ss << "MaskSelect::Select: mask region size (" << maskRegion.GetSize() << ") must match image region size ("
+       << imageRegion.GetSize() << ")";
+    throw std::runtime_error(ss.str());
+  }
+  CheckRegion(mask, maskRegion, "MaskSelect::Select");
+  CheckRegion(first, imageRegion, "MaskSelect::Select");
+  CheckRegion(second, imageRegion, "MaskSelect::Select");
+  CheckRegion(output, imageRegion, "MaskSelect::Select");
+
+  typedef MaskImageBuffer::ImageComponents<TImage> ImageComponentsType;
+  const unsigned int numberOfComponents = ImageComponentsType::GetNumberOfComponents(output);
+  if(ImageComponentsType::GetNumberOfComponents(first) != numberOfComponents ||
+     ImageComponentsType::GetNumberOfComponents(second) != numberOfComponents)
+  {
+    throw std::runtime_error("MaskSelect::Select: the images must have the same number of components!");
+  }
+
+  const std::size_t pixelSize = numberOfComponents * sizeof(typename ImageComponentsType::ComponentType);
+  ForEachSelectedBlock(mask, maskRegion, value, pixelSize,
+                       [&](const std::size_t row, const std::size_t firstPixel, const std::size_t numberOfPixels,
+                           const unsigned char* const selection)
+  {
+    const std::size_t firstByte = firstPixel * pixelSize;
+    MaskSelectKernels::SelectBytes(selection, GetRowBytes(first, imageRegion, row, pixelSize) + firstByte,
+                                   GetRowBytes(second, imageRegion, row, pixelSize) + firstByte,
+                                   GetRowBytes(output, imageRegion, row, pixelSize) + firstByte,
+                                   numberOfPixels * pixelSize);
+  });
+
+  output->Modified();
+}
+
+template <typename TImage>
+void Select(const Mask* const mask, const HoleMaskPixelTypeEnum& value, const TImage* const first,
+            const TImage* const second, TImage* const output)
+{
+  Select(mask, mask->GetLargestPossibleRegion(), value, first, second, output, output->GetLargestPossibleRegion());
+}
+
+template <typename TImage>
+void Fill(const Mask* const mask, const itk::ImageRegion<2>& maskRegion, const HoleMaskPixelTypeEnum& value,
+          const typename TImage::PixelType& pixel, TImage* const output, const itk::ImageRegion<2>& imageRegion)
+{
+  if(maskRegion.GetSize() != imageRegion.GetSize())
+  {
+    std::stringstream ss;
+    ss << "MaskSelect::Fill: mask region size (" << maskRegion.GetSize() << ") must match image region size ("
+       << imageRegion.GetSize() << ")";
+    throw std::runtime_error(ss.str());
+  }
+  CheckRegion(mask, maskRegion, "MaskSelect::Fill");
+  CheckRegion(output, imageRegion, "MaskSelect::Fill");
+
+  typedef MaskImageBuffer::ImageComponents<TImage> ImageComponentsType;
+  typedef typename ImageComponentsType::ComponentType ComponentType;
+  const unsigned int numberOfComponents = ImageComponentsType::GetNumberOfComponents(output);
+  const std::size_t pixelSize = numberOfComponents * sizeof(ComponentType);
+
+  // A block's worth of copies of the pixel, to blend whole blocks at once.
+  std::vector<double> values(numberOfComponents);
+  MaskImageBuffer::GetPixelComponents(pixel, numberOfComponents, values.data());
+  std::vector<ComponentType> components(numberOfComponents);
+  for(unsigned int component = 0; component < numberOfComponents; ++component)
+  {
+    components[component] = static_cast<ComponentType>(values[component]);
+  }
+
+  const std::size_t blockLength = std::min<std::size_t>(maskRegion.GetSize()[0], BlockLength);
+  std::vector<unsigned char> pattern(blockLength * pixelSize);
+  for(std::size_t pixelId = 0; pixelId < blockLength; ++pixelId)
+  {
+    std::memcpy(&pattern[pixelId * pixelSize], components.data(), pixelSize);
+  }
+
+  ForEachSelectedBlock(mask, maskRegion, value, pixelSize,
+                       [&](const std::size_t row, const std::size_t firstPixel, const std::size_t numberOfPixels,
+                           const unsigned char* const selection)
+  {
+    unsigned char* const outputBytes = GetRowBytes(output, imageRegion, row, pixelSize) + firstPixel * pixelSize;
+    MaskSelectKernels::SelectBytes(selection, pattern.data(), outputBytes, outputBytes, numberOfPixels * pixelSize);
+  });
+
+  output->Modified();
+}
+
+template <typename TImage>
+void Fill(const Mask* const mask, const HoleMaskPixelTypeEnum& value, const typename TImage::PixelType& pixel,
+          TImage* const output)
+{
+  Fill(mask, mask->GetLargestPossibleRegion(), value, pixel, output, output->GetLargestPossibleRegion());
+}
+
+} // end namespace
+
+#endif
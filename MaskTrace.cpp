@@ -0,0 +1,320 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "MaskTrace.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace MaskTrace
+{
+
+namespace
+{
+/** A slot of a ring buffer. The fields are atomics so that a writer can read a buffer while its thread
+  * is recording. The phase is stored in the lowest bit of the time (1 for end events). */
+struct EventSlot
+{
+  std::atomic<const char*> Name;
+  std::atomic<uint64_t> TimeAndPhase;
+};
+
+/** The events of one thread. Only the owning thread writes to it. */
+struct ThreadBuffer
+{
+  ThreadBuffer(const std::size_t capacity, const unsigned int threadNumber) :
+    Slots(new EventSlot[capacity]), Capacity(capacity), ThreadNumber(threadNumber)
+  {
+  }
+
+  std::unique_ptr<EventSlot[]> Slots;
+  const std::size_t Capacity;
+  const unsigned int ThreadNumber;
+
+  /** The number of events started (Reserved) and finished (Committed) since the buffer was created.
+    * A reader drops the slots that were reserved again while it was copying them. */
+  std::atomic<uint64_t> Reserved{0};
+  std::atomic<uint64_t> Committed{0};
+
+  /** Events before this count were discarded by Clear(). */
+  std::atomic<uint64_t> ClearedCount{0};
+};
+
+struct Registry
+{
+  std::mutex Mutex;
+  std::vector<std::shared_ptr<ThreadBuffer> > Buffers;
+  std::vector<std::shared_ptr<ThreadBuffer> > FreeBuffers;
+  std::size_t Capacity = 65536;
+};
+
+Registry& GetRegistry()
+{
+  static Registry registry;
+  return registry;
+}
+
+std::atomic<bool> Recording(false);
+
+/** Takes a free buffer (or creates one) for this thread, and frees it when the thread exits.*/
+struct ThreadBufferHolder
+{
+  ThreadBufferHolder()
+  {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> registryLock(registry.Mutex);
+    if(!registry.FreeBuffers.empty() && registry.FreeBuffers.back()->Capacity == registry.Capacity)
+    {
+      this->Buffer = registry.FreeBuffers.back();
+      registry.FreeBuffers.pop_back();
+    }
+    else
+    {
+      this->Buffer = std::make_shared<ThreadBuffer>(registry.Capacity,
+                                                    static_cast<unsigned int>(registry.Buffers.size() + 1));
+      registry.Buffers.push_back(this->Buffer);
+    }
+  }
+
+  ~ThreadBufferHolder()
+  {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> registryLock(registry.Mutex);
+    registry.FreeBuffers.push_back(this->Buffer);
+  }
+
+  std::shared_ptr<ThreadBuffer> Buffer;
+};
+
+void RecordEvent(const char* const name, const bool isEnd)
+{
+  thread_local ThreadBufferHolder holder;
+  ThreadBuffer& buffer = *holder.Buffer;
+
+  const uint64_t time = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch()).count());
+
+  const uint64_t eventId = buffer.Committed.load(std::memory_order_relaxed);
+  buffer.Reserved.store(eventId + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  EventSlot& slot = buffer.Slots[eventId % buffer.Capacity];
+  slot.Name.store(name, std::memory_order_relaxed);
+  slot.TimeAndPhase.store((time << 1) | (isEnd ? 1 : 0), std::memory_order_relaxed);
+
+  buffer.Committed.store(eventId + 1, std::memory_order_release);
+}
+
+struct Event
+{
+  const char* Name;
+  uint64_t TimeAndPhase;
+};
+
+/** Copy the events of 'buffer' that are still in its ring and were not cleared.*/
+std::vector<Event> ReadEvents(const ThreadBuffer& buffer)
+{
+  const uint64_t committed = buffer.Committed.load(std::memory_order_acquire);
+  const uint64_t first = std::max<uint64_t>(buffer.ClearedCount.load(std::memory_order_relaxed),
+                                            committed > buffer.Capacity ? committed - buffer.Capacity : 0);
+
+  std::vector<Event> events;
+  for(uint64_t eventId = first; eventId < committed; ++eventId)
+  {
+    const EventSlot& slot = buffer.Slots[eventId % buffer.Capacity];
+    const Event event = {slot.Name.load(std::memory_order_relaxed), slot.TimeAndPhase.load(std::memory_order_relaxed)};
+    events.push_back(event);
+  }
+
+  // Drop the events whose slots the thread started overwriting while they were copied.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t reserved = buffer.Reserved.load(std::memory_order_relaxed);
+  if(reserved > buffer.Capacity && reserved - buffer.Capacity > first)
+  {
+    const uint64_t numberOfOverwritten = std::min<uint64_t>(reserved - buffer.Capacity - first, events.size());
+    events.erase(events.begin(), events.begin() + static_cast<std::ptrdiff_t>(numberOfOverwritten));
+  }
+
+  return events;
+}
+
+void WriteJSONString(const char* text, std::ostream& output)
+{
+  output << '"';
+  for(; *text; ++text)
+  {
+    if(*text == '"' || *text == '\\')
+    {
+      output << '\\';
+    }
+    output << *text;
+  }
+  output << '"';
+}
+
+} // end anonymous namespace
+
+bool IsEnabled()
+{
+#ifdef MASK_ENABLE_TRACING
+  return true;
+#else
+  return false;
+#endif
+}
+
+void Start()
+{
+  Recording.store(true, std::memory_order_relaxed);
+}
+
+void Stop()
+{
+  Recording.store(false, std::memory_order_relaxed);
+}
+
+bool IsRecording()
+{
+  return Recording.load(std::memory_order_relaxed);
+}
+
+void SetBufferCapacity(const std::size_t numberOfEvents)
+{
+  if(numberOfEvents == 0)
+  {
+    throw std::runtime_error("MaskTrace::SetBufferCapacity: the capacity must be at least 1 event!");
+  }
+
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> registryLock(registry.Mutex);
+  registry.Capacity = numberOfEvents;
+}
+
+std::size_t GetBufferCapacity()
+{
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> registryLock(registry.Mutex);
+  return registry.Capacity;
+}
+
+void Clear()
+{
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> registryLock(registry.Mutex);
+  for(const std::shared_ptr<ThreadBuffer>& buffer : registry.Buffers)
+  {
+    buffer->ClearedCount.store(buffer->Committed.load(std::memory_order_acquire), std::memory_order_relaxed);
+  }
+}
+
+void WriteChromeTrace(std::ostream& output)
+{
+  std::vector<std::shared_ptr<ThreadBuffer> > buffers;
+  {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> registryLock(registry.Mutex);
+    buffers = registry.Buffers;
+  }
+
+  std::vector<std::vector<Event> > bufferEvents(buffers.size());
+  uint64_t startTime = UINT64_MAX;
+  for(std::size_t bufferId = 0; bufferId < buffers.size(); ++bufferId)
+  {
+    bufferEvents[bufferId] = ReadEvents(*buffers[bufferId]);
+    if(!bufferEvents[bufferId].empty())
+    {
+      startTime = std::min(startTime, bufferEvents[bufferId].front().TimeAndPhase >> 1);
+    }
+  }
+
+  const std::ios::fmtflags flags = output.flags();
+  output << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  bool firstEvent = true;
+  for(std::size_t bufferId = 0; bufferId < buffers.size(); ++bufferId)
+  {
+    if(bufferEvents[bufferId].empty())
+    {
+      continue;
+    }
+
+    const unsigned int threadNumber = buffers[bufferId]->ThreadNumber;
+    output << (firstEvent ? "" : ",") << "\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+           << threadNumber << ", \"args\": {\"name\": \"Thread " << threadNumber << "\"}}";
+    firstEvent = false;
+
+    // End events whose begin events were overwritten would confuse the viewer, so skip them.
+    unsigned int depth = 0;
+    for(const Event& event : bufferEvents[bufferId])
+    {
+      const bool isEnd = (event.TimeAndPhase & 1) != 0;
+      if(isEnd && depth == 0)
+      {
+        continue;
+      }
+      depth = isEnd ? depth - 1 : depth + 1;
+
+      const double microseconds = static_cast<double>((event.TimeAndPhase >> 1) - startTime) / 1e3;
+      output << ",\n  {\"name\": ";
+      WriteJSONString(event.Name, output);
+      output << ", \"ph\": \"" << (isEnd ? 'E' : 'B') << "\", \"pid\": 1, \"tid\": " << threadNumber
+             << ", \"ts\": " << std::fixed << microseconds << "}";
+    }
+  }
+  output << "\n]}\n";
+  output.flags(flags);
+}
+
+void WriteChromeTrace(const std::string& fileName)
+{
+  std::ofstream output(fileName.c_str());
+  if(!output)
+  {
+    std::stringstream ss;
+    ss << "MaskTrace::WriteChromeTrace: could not open " << fileName << " for writing!";
+    throw std::runtime_error(ss.str());
+  }
+
+  WriteChromeTrace(output);
+}
+
+ScopedEvent::ScopedEvent(const char* const name) : Name(name), Begun(IsRecording())
+{
+  if(this->Begun)
+  {
+    RecordEvent(this->Name, false);
+  }
+}
+
+ScopedEvent::~ScopedEvent()
+{
+  if(this->Begun)
+  {
+    RecordEvent(this->Name, true);
+  }
+}
+
+} // end MaskTrace namespace
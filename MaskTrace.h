@@ -0,0 +1,98 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/**
+\namespace MaskTrace
+\brief Optional timeline tracing of the Mask operations, written as Chrome trace-event JSON (open it in
+       chrome://tracing or Perfetto). Configure with Mask_EnableTracing (which defines MASK_ENABLE_TRACING)
+       to have the Mask and MaskOperations entry points, their internal phases and the MaskParallel
+       chunks emit begin/end events; otherwise MASK_TRACE_SCOPE expands to nothing.
+
+       Events are only recorded between Start() and Stop(). Each thread writes into its own fixed
+       size ring buffer without locking, so the oldest events of a busy thread are overwritten. A
+       buffer is handed on to the next new thread when its thread exits, so the short lived
+       MaskParallel worker threads share a few timeline rows instead of creating one each.
+*/
+
+#ifndef MaskTrace_H
+#define MaskTrace_H
+
+// STL
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+namespace MaskTrace
+{
+
+/** Determine if the library was built with MASK_ENABLE_TRACING.*/
+bool IsEnabled();
+
+/** Start recording events.*/
+void Start();
+
+/** Stop recording events. Events already recorded are kept until Clear().*/
+void Stop();
+
+bool IsRecording();
+
+/** Set the number of events each thread's ring buffer holds (65536 by default). This only applies
+  * to buffers created after the call. */
+void SetBufferCapacity(const std::size_t numberOfEvents);
+
+std::size_t GetBufferCapacity();
+
+/** Discard all recorded events.*/
+void Clear();
+
+/** Write the recorded events as Chrome trace-event JSON. This can be called while other threads are
+  * recording; events overwritten during the call are left out. */
+void WriteChromeTrace(std::ostream& output);
+
+/** Write the recorded events as Chrome trace-event JSON to 'fileName'. Throws if it cannot be written.*/
+void WriteChromeTrace(const std::string& fileName);
+
+/** Records a begin event at construction and the matching end event at destruction (if recording
+  * was on at construction). 'name' must be a string literal (or otherwise outlive the trace). */
+class ScopedEvent
+{
+public:
+  explicit ScopedEvent(const char* const name);
+  ~ScopedEvent();
+
+private:
+  ScopedEvent(const ScopedEvent&); // purposely not implemented
+  void operator=(const ScopedEvent&); // purposely not implemented
+
+  const char* const Name;
+  bool Begun;
+};
+
+} // end MaskTrace namespace
+
+#define MASK_TRACE_CONCATENATE_DETAIL(a, b) a##b
+#define MASK_TRACE_CONCATENATE(a, b) MASK_TRACE_CONCATENATE_DETAIL(a, b)
+
+#ifdef MASK_ENABLE_TRACING
+  #define MASK_TRACE_SCOPE(name) \
+    MaskTrace::ScopedEvent MASK_TRACE_CONCATENATE(maskTraceEvent, __LINE__)(name)
+#else
+  #define MASK_TRACE_SCOPE(name)
+#endif
+
+#endif
@@ -17,52 +17,133 @@
  *=========================================================================*/
 
 #include "MaskVTK.h"
+#include "MaskParallel.h"
 
 // VTK
 #include <vtkImageData.h>
+#include <vtkIntArray.h>
+#include <vtkLookupTable.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// STL
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace MaskVTK
+{
+
+namespace
+{
+/** Write the RGBA overlay pixels of 'region' (which must be inside the mask) into 'outputBuffer',
+  * which holds the overlay of the whole mask. Rows are written in parallel. */
+void DrawMaskTransparency(const Mask* const input, const itk::ImageRegion<2>& region,
+                          unsigned char* const outputBuffer)
+{
+  const itk::ImageRegion<2> maskRegion = input->GetLargestPossibleRegion();
+  const std::size_t maskWidth = maskRegion.GetSize()[0];
+  const std::size_t width = region.GetSize()[0];
+  const std::size_t regionOffset = input->ComputeOffset(region.GetIndex());
+
+  MaskParallel::ParallelFor(0, region.GetSize()[1], [&](const std::size_t firstRow, const std::size_t endRow)
+  {
+    for(std::size_t row = firstRow; row < endRow; ++row)
+    {
+      const std::size_t rowOffset = regionOffset + row * maskWidth;
+      const HoleMaskPixelTypeEnum* const maskRow = input->GetBufferPointer() + rowOffset;
+      unsigned char* pixel = outputBuffer + rowOffset * 4;
+      for(std::size_t column = 0; column < width; ++column, pixel += 4)
+      {
+        // Set masked pixels to bright red and opaque. Set non-masked pixels to black and fully transparent.
+        pixel[0] = 255;
+        pixel[1] = 0;
+        pixel[2] = 0;
+        pixel[3] = (maskRow[column] == HoleMaskPixelTypeEnum::HOLE) ? 255 : 0;
+      }
+    }
+  });
+}
+} // end anonymous namespace
 
 void SetMaskTransparency(const Mask* const input, vtkImageData* outputImage)
 {
   assert(input);
 
   // Setup and allocate the VTK image
-  outputImage->SetDimensions(input->GetLargestPossibleRegion().GetSize()[0],
-                             input->GetLargestPossibleRegion().GetSize()[1],
-                             1);
-
+  const itk::ImageRegion<2> region = input->GetLargestPossibleRegion();
+  outputImage->SetDimensions(region.GetSize()[0], region.GetSize()[1], 1);
   outputImage->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
 
-  // Copy all of the pixels to the output
-  itk::ImageRegionConstIteratorWithIndex<Mask> imageIterator(input, input->GetLargestPossibleRegion());
-  imageIterator.GoToBegin();
+  // Copy all of the rows to the output
+  DrawMaskTransparency(input, region, static_cast<unsigned char*>(outputImage->GetScalarPointer()));
+
+  outputImage->Modified();
+}
 
-  while(!imageIterator.IsAtEnd())
+void UpdateMaskTransparency(const Mask* const input, vtkImageData* outputImage, const itk::ImageRegion<2>& region)
+{
+  assert(input);
+
+  const itk::ImageRegion<2> maskRegion = input->GetLargestPossibleRegion();
+  int dimensions[3];
+  outputImage->GetDimensions(dimensions);
+  if(dimensions[0] != static_cast<int>(maskRegion.GetSize()[0]) ||
+     dimensions[1] != static_cast<int>(maskRegion.GetSize()[1]) ||
+     outputImage->GetNumberOfScalarComponents() != 4)
   {
-    unsigned char* pixel = static_cast<unsigned char*>(outputImage->GetScalarPointer(imageIterator.GetIndex()[0],
-                                                       imageIterator.GetIndex()[1],0));
-    /*
-    // Set masked pixels to bright green and opaque. Set non-masked pixels to black and fully transparent.
-    pixel[0] = 0;
-    pixel[1] = imageIterator.Get();
-    pixel[2] = 0;
-    */
-
-    // Set masked pixels to bright red and opaque. Set non-masked pixels to black and fully transparent.
-    pixel[0] = 255;
-    pixel[1] = 0;
-    pixel[2] = 0;
-
-    if(input->IsHole(imageIterator.GetIndex()))
-    {
-      pixel[3] = 255;
-    }
-    else
-    {
-      pixel[3] = 0;
-    }
+    std::stringstream ss;
+    ss << "UpdateMaskTransparency: the image was not made by SetMaskTransparency() from the mask " << maskRegion;
+    throw std::runtime_error(ss.str());
+  }
 
-    ++imageIterator;
+  itk::ImageRegion<2> updateRegion = region;
+  if(!updateRegion.Crop(maskRegion))
+  {
+    return;
   }
 
+  DrawMaskTransparency(input, updateRegion, static_cast<unsigned char*>(outputImage->GetScalarPointer()));
+
   outputImage->Modified();
 }
+
+void UpdateMaskTransparency(const Mask* const input, vtkImageData* outputImage)
+{
+  if(input->HasModifiedRegion())
+  {
+    UpdateMaskTransparency(input, outputImage, input->GetModifiedRegion());
+  }
+}
+
+void WrapMask(const Mask* const input, vtkImageData* outputImage)
+{
+  assert(input);
+
+  static_assert(sizeof(HoleMaskPixelTypeEnum) == sizeof(int) &&
+                std::is_same<std::underlying_type<HoleMaskPixelTypeEnum>::type, int>::value,
+                "The mask pixels must have the layout of int to be wrapped in a vtkIntArray.");
+
+  const itk::ImageRegion<2> region = input->GetLargestPossibleRegion();
+  outputImage->SetDimensions(region.GetSize()[0], region.GetSize()[1], 1);
+
+  // VTK does not write to the scalars through this array, and 'save' = 1 keeps it from freeing the buffer.
+  vtkSmartPointer<vtkIntArray> maskArray = vtkSmartPointer<vtkIntArray>::New();
+  maskArray->SetNumberOfComponents(1);
+  maskArray->SetArray(reinterpret_cast<int*>(const_cast<HoleMaskPixelTypeEnum*>(input->GetBufferPointer())),
+                      region.GetNumberOfPixels(), 1);
+  outputImage->GetPointData()->SetScalars(maskArray);
+
+  outputImage->Modified();
+}
+
+void CreateMaskTransparencyLookupTable(vtkLookupTable* const lookupTable)
+{
+  lookupTable->SetNumberOfTableValues(3);
+  lookupTable->SetRange(0, 2);
+  lookupTable->SetTableValue(static_cast<int>(HoleMaskPixelTypeEnum::HOLE), 1.0, 0.0, 0.0, 1.0);
+  lookupTable->SetTableValue(static_cast<int>(HoleMaskPixelTypeEnum::VALID), 0.0, 0.0, 0.0, 0.0);
+  lookupTable->SetTableValue(static_cast<int>(HoleMaskPixelTypeEnum::UNDETERMINED), 0.0, 0.0, 0.0, 0.0);
+}
+
+} // end namespace
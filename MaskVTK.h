@@ -26,15 +26,40 @@
 
 // VTK
 class vtkImageData;
+class vtkLookupTable;
 
 namespace MaskVTK
 {
   ////////////////// Functions with VTK ////////////////
+  /** Make 'outputImage' an RGBA overlay of 'input': hole pixels are opaque red, all other pixels are
+    * transparent.*/
   void SetMaskTransparency(const Mask* const input, vtkImageData* outputImage);
 
+  /** Redraw the pixels of 'region' in 'outputImage', which must have been made by SetMaskTransparency(input),
+    * so that they match the mask again. Only the region is touched. */
+  void UpdateMaskTransparency(const Mask* const input, vtkImageData* outputImage, const itk::ImageRegion<2>& region);
+
+  /** Redraw the pixels of input->GetModifiedRegion(). The region is not acknowledged, so several
+    * overlays of the same mask can be updated before calling input->AcknowledgeModifiedRegion(). */
+  void UpdateMaskTransparency(const Mask* const input, vtkImageData* outputImage);
+
+  /** Make the scalars of 'outputImage' a single component vtkIntArray that points at the mask's buffer,
+    * without copying it. The scalars are the HoleMaskPixelTypeEnum values, so display them through
+    * CreateMaskTransparencyLookupTable() (e.g. with vtkImageMapToColors) to get the overlay of
+    * SetMaskTransparency(). Changes to the mask's pixels are seen once outputImage->Modified() is called,
+    * so there is nothing to update.
+    * The mask must stay allocated (and must not be reallocated) for as long as 'outputImage' uses it. */
+  void WrapMask(const Mask* const input, vtkImageData* outputImage);
+
+  /** Fill 'lookupTable' so that it maps wrapped mask values (see WrapMask()) to opaque red for hole pixels
+    * and to transparent for all other pixels.*/
+  void CreateMaskTransparencyLookupTable(vtkLookupTable* const lookupTable);
+
   ////////////////// Function templates with VTK ////////////////
+  /** Copy the first 3 components of 'image' into the RGB 'outputImage', setting pixels that are not valid
+    * in 'mask' to 'maskColor'. The mask must have the same region as the image. */
   template <typename TImage>
-  void ITKImageToVTKImageMasked(const ITKHelpers::FloatVectorImageType* const image, const Mask* const mask,
+  void ITKImageToVTKImageMasked(const TImage* const image, const Mask* const mask,
                                 vtkImageData* const outputImage, const unsigned char maskColor[3]);
 
   template <typename TPixel>
@@ -20,10 +20,13 @@
 #define MaskVTK_HPP
 
 // STL
+#include <sstream>
 #include <stdexcept>
 
 // Custom
 #include "Mask.h"
+#include "MaskImageBuffer.h"
+#include "MaskParallel.h"
 
 // VTK
 #include <vtkImageData.h>
@@ -31,116 +34,89 @@
 namespace MaskVTK
 {
 
+namespace Internal
+{
+  /** Convert whole rows at a time, reading the image's components, the mask and the VTK scalars
+    * straight from their buffers. Rows are converted in parallel. */
   template <typename TImage>
   void ITKImageToVTKImageMasked(const TImage* const image, const Mask* const mask,
-                                                            vtkImageData* const outputImage, const unsigned char maskColor[3])
+                                vtkImageData* const outputImage, const unsigned char maskColor[3])
   {
     assert(mask);
     // This function assumes an ND (with N>3) image has the first 3 channels as RGB and extra
     // information in the remaining channels.
 
-    //std::cout << "ITKImagetoVTKRGBImage()" << std::endl;
-    if(image->GetNumberOfComponentsPerPixel() < 3)
+    typedef MaskImageBuffer::ImageComponents<TImage> ImageComponentsType;
+    const unsigned int numberOfComponents = ImageComponentsType::GetNumberOfComponents(image);
+    if(numberOfComponents < 3)
     {
-      std::cerr << "The input image has " << image->GetNumberOfComponentsPerPixel()
+      std::cerr << "The input image has " << numberOfComponents
                 << " components, but at least 3 are required." << std::endl;
       return;
     }
 
+    const itk::ImageRegion<2> region = image->GetLargestPossibleRegion();
+    if(mask->GetLargestPossibleRegion() != region)
+    {
+      std::stringstream ss;
+      ss << "ITKImageToVTKImageMasked: the mask region " << mask->GetLargestPossibleRegion()
+         << " does not match the image region " << region;
+      throw std::runtime_error(ss.str());
+    }
+
     // Setup and allocate the image data
-    //outputImage->SetNumberOfScalarComponents(3);
-    //outputImage->SetScalarTypeToUnsignedChar();
-    outputImage->SetDimensions(image->GetLargestPossibleRegion().GetSize()[0],
-                                                           image->GetLargestPossibleRegion().GetSize()[1],
-                                                           1);
-    //outputImage->AllocateScalars();
+    const std::size_t width = region.GetSize()[0];
+    outputImage->SetDimensions(region.GetSize()[0], region.GetSize()[1], 1);
     outputImage->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
 
-    // Copy all of the input image pixels to the output image
-    itk::ImageRegionConstIteratorWithIndex<TImage>
-                   imageIterator(image,image->GetLargestPossibleRegion());
-    imageIterator.GoToBegin();
+    const typename ImageComponentsType::ComponentType* const imageBuffer =
+        ImageComponentsType::GetComponentBuffer(image);
+    const HoleMaskPixelTypeEnum* const maskBuffer = mask->GetBufferPointer();
+    unsigned char* const outputBuffer = static_cast<unsigned char*>(outputImage->GetScalarPointer());
 
-    while(!imageIterator.IsAtEnd())
+    MaskParallel::ParallelFor(0, region.GetSize()[1], [&](const std::size_t firstRow, const std::size_t endRow)
     {
-      unsigned char* VTKPixel = static_cast<unsigned char*>(
-            outputImage->GetScalarPointer(imageIterator.GetIndex()[0], imageIterator.GetIndex()[1],0));
-      if(mask->IsValid(imageIterator.GetIndex()))
+      for(std::size_t row = firstRow; row < endRow; ++row)
       {
-        for(unsigned int component = 0; component < 3; component++)
+        const typename ImageComponentsType::ComponentType* imagePixel = imageBuffer + row * width * numberOfComponents;
+        const HoleMaskPixelTypeEnum* const maskRow = maskBuffer + row * width;
+        unsigned char* outputPixel = outputBuffer + row * width * 3;
+        for(std::size_t column = 0; column < width; ++column)
         {
-          VTKPixel[component] = static_cast<unsigned char>(imageIterator.Get()[component]);
-        }
-      }
-      else
-      {
-        for(unsigned int component = 0; component < 3; component++)
-        {
-          VTKPixel[component] = maskColor[component];
+          if(maskRow[column] == HoleMaskPixelTypeEnum::VALID)
+          {
+            outputPixel[0] = static_cast<unsigned char>(imagePixel[0]);
+            outputPixel[1] = static_cast<unsigned char>(imagePixel[1]);
+            outputPixel[2] = static_cast<unsigned char>(imagePixel[2]);
+          }
+          else
+          {
+            outputPixel[0] = maskColor[0];
+            outputPixel[1] = maskColor[1];
+            outputPixel[2] = maskColor[2];
+          }
+          imagePixel += numberOfComponents;
+          outputPixel += 3;
         }
       }
-
-      ++imageIterator;
-    }
+    });
 
     outputImage->Modified();
   }
+} // end namespace
+
+  template <typename TImage>
+  void ITKImageToVTKImageMasked(const TImage* const image, const Mask* const mask,
+                                vtkImageData* const outputImage, const unsigned char maskColor[3])
+  {
+    Internal::ITKImageToVTKImageMasked(image, mask, outputImage, maskColor);
+  }
 
   template <typename TPixel>
   void ITKImageToVTKImageMasked(const typename itk::VectorImage<TPixel, 2>* const image, const Mask* const mask,
-                                                            vtkImageData* const outputImage, const unsigned char maskColor[3])
+                                vtkImageData* const outputImage, const unsigned char maskColor[3])
   {
-    assert(mask);
-
-    typedef typename itk::VectorImage<TPixel, 2> VectorImageType;
-    // This function assumes an ND (with N>3) image has the first 3 channels as RGB and extra
-    // information in the remaining channels.
-
-    //std::cout << "ITKImagetoVTKRGBImage()" << std::endl;
-    if(image->GetNumberOfComponentsPerPixel() < 3)
-    {
-      std::cerr << "The input image has " << image->GetNumberOfComponentsPerPixel()
-                << " components, but at least 3 are required." << std::endl;
-      return;
-    }
-
-    // Setup and allocate the image data
-    //outputImage->SetNumberOfScalarComponents(3);
-    //outputImage->SetScalarTypeToUnsignedChar();
-    outputImage->SetDimensions(image->GetLargestPossibleRegion().GetSize()[0],
-                                                           image->GetLargestPossibleRegion().GetSize()[1],
-                                                           1);
-    //outputImage->AllocateScalars();
-    outputImage->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
-
-    // Copy all of the input image pixels to the output image
-    itk::ImageRegionConstIteratorWithIndex<VectorImageType>
-                   imageIterator(image,image->GetLargestPossibleRegion());
-    imageIterator.GoToBegin();
-
-    while(!imageIterator.IsAtEnd())
-    {
-      unsigned char* VTKPixel = static_cast<unsigned char*>(
-            outputImage->GetScalarPointer(imageIterator.GetIndex()[0], imageIterator.GetIndex()[1],0));
-      if(mask->IsValid(imageIterator.GetIndex()))
-      {
-        for(unsigned int component = 0; component < 3; component++)
-        {
-          VTKPixel[component] = static_cast<unsigned char>(imageIterator.Get()[component]);
-        }
-      }
-      else
-      {
-        for(unsigned int component = 0; component < 3; component++)
-        {
-          VTKPixel[component] = maskColor[component];
-        }
-      }
-
-      ++imageIterator;
-    }
-
-    outputImage->Modified();
+    Internal::ITKImageToVTKImageMasked(image, mask, outputImage, maskColor);
   }
 
 } // end namespace
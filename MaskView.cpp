@@ -0,0 +1,144 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#include "MaskView.h"
+
+// STL
+#include <sstream>
+#include <stdexcept>
+
+MaskView::MaskView(const Mask* const mask, const itk::ImageRegion<2>& region) :
+  MaskImage(mask), Region(region)
+{
+  if(!mask->GetBufferedRegion().IsInside(region))
+  {
+    std::stringstream ss;
+    ss << "MaskView: region " << region << " is not inside the mask " << mask->GetBufferedRegion();
+    throw std::runtime_error(ss.str());
+  }
+}
+
+MaskView::MaskView(const Mask* const mask) : MaskView(mask, mask->GetBufferedRegion())
+{
+}
+
+const Mask* MaskView::GetMask() const
+{
+  return this->MaskImage;
+}
+
+const itk::ImageRegion<2>& MaskView::GetRegion() const
+{
+  return this->Region;
+}
+
+itk::ImageRegion<2> MaskView::GetLocalRegion() const
+{
+  itk::Index<2> corner = {{0,0}};
+  return itk::ImageRegion<2>(corner, this->Region.GetSize());
+}
+
+itk::Size<2> MaskView::GetSize() const
+{
+  return this->Region.GetSize();
+}
+
+itk::Index<2> MaskView::GetMaskIndex(const itk::Index<2>& viewIndex) const
+{
+  itk::Index<2> maskIndex = {{this->Region.GetIndex()[0] + viewIndex[0], this->Region.GetIndex()[1] + viewIndex[1]}};
+  return maskIndex;
+}
+
+MaskView MaskView::GetSubView(const itk::ImageRegion<2>& region) const
+{
+  if(!GetLocalRegion().IsInside(region))
+  {
+    std::stringstream ss;
+    ss << "MaskView::GetSubView: region " << region << " is not inside the view " << GetLocalRegion();
+    throw std::runtime_error(ss.str());
+  }
+
+  return MaskView(this->MaskImage, itk::ImageRegion<2>(GetMaskIndex(region.GetIndex()), region.GetSize()));
+}
+
+HoleMaskPixelTypeEnum MaskView::GetPixel(const itk::Index<2>& viewIndex) const
+{
+  return this->MaskImage->GetPixel(GetMaskIndex(viewIndex));
+}
+
+const HoleMaskPixelTypeEnum* MaskView::GetRow(const itk::IndexValueType row) const
+{
+  itk::Index<2> rowStart = {{0, row}};
+  return this->MaskImage->GetBufferPointer() + this->MaskImage->ComputeOffset(GetMaskIndex(rowStart));
+}
+
+bool MaskView::IsHole(const itk::Index<2>& viewIndex) const
+{
+  return this->MaskImage->IsHole(GetMaskIndex(viewIndex));
+}
+
+bool MaskView::IsValid(const itk::Index<2>& viewIndex) const
+{
+  return this->MaskImage->IsValid(GetMaskIndex(viewIndex));
+}
+
+bool MaskView::IsHole() const
+{
+  return this->MaskImage->IsHole(this->Region);
+}
+
+bool MaskView::IsValid() const
+{
+  return this->MaskImage->IsValid(this->Region);
+}
+
+bool MaskView::HasHolePixels() const
+{
+  return this->MaskImage->HasHolePixels(this->Region);
+}
+
+bool MaskView::HasValidPixels() const
+{
+  return this->MaskImage->HasValidPixels(this->Region);
+}
+
+unsigned int MaskView::CountHolePixels() const
+{
+  return this->MaskImage->CountHolePixels(this->Region);
+}
+
+unsigned int MaskView::CountValidPixels() const
+{
+  return this->MaskImage->CountValidPixels(this->Region);
+}
+
+unsigned int MaskView::CountBoundaryPixels(const HoleMaskPixelTypeEnum& whichSideOfBoundary) const
+{
+  return this->MaskImage->CountBoundaryPixels(this->Region, whichSideOfBoundary);
+}
+
+std::shared_ptr<const Mask::SpanListType> MaskView::GetSpans(const HoleMaskPixelTypeEnum& pixelType) const
+{
+  return this->MaskImage->GetSpans(pixelType, this->Region);
+}
+
+std::shared_ptr<const Mask::SpanListType> MaskView::GetHoleSpans() const
+{
+  return this->MaskImage->GetHoleSpans(this->Region);
+}
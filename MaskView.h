@@ -0,0 +1,138 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+/**
+\class MaskView
+\brief A non-owning view of a region of a Mask. Indices passed to and returned from the view are
+       relative to the corner of the region, as they would be in a copy of the region made with
+       itk::RegionOfInterestImageFilter, but nothing is copied: queries go straight to the mask's
+       buffer (and its cached span lists). The mask must outlive the view.
+
+\class MaskImageView
+\brief The matching non-owning view of a region of an image.
+*/
+
+#ifndef MaskView_H
+#define MaskView_H
+
+// Custom
+#include "Mask.h"
+#include "MaskImageBuffer.h"
+
+// STL
+#include <memory>
+
+class MaskView
+{
+public:
+  /** View 'region' of 'mask'. Throws if the region is not inside the mask's buffered region.*/
+  MaskView(const Mask* const mask, const itk::ImageRegion<2>& region);
+
+  /** View the whole mask.*/
+  explicit MaskView(const Mask* const mask);
+
+  const Mask* GetMask() const;
+
+  /** The viewed region, in mask coordinates.*/
+  const itk::ImageRegion<2>& GetRegion() const;
+
+  /** The region the view covers in its own coordinates, i.e. with its corner at (0,0).*/
+  itk::ImageRegion<2> GetLocalRegion() const;
+
+  itk::Size<2> GetSize() const;
+
+  /** Convert an index relative to the view to an index in the mask.*/
+  itk::Index<2> GetMaskIndex(const itk::Index<2>& viewIndex) const;
+
+  /** Get a view of 'region' (relative to this view), which must be inside this view.*/
+  MaskView GetSubView(const itk::ImageRegion<2>& region) const;
+
+  HoleMaskPixelTypeEnum GetPixel(const itk::Index<2>& viewIndex) const;
+
+  /** Get the mask pixels of row 'row' of the view. The row has GetSize()[0] pixels.*/
+  const HoleMaskPixelTypeEnum* GetRow(const itk::IndexValueType row) const;
+
+  bool IsHole(const itk::Index<2>& viewIndex) const;
+
+  bool IsValid(const itk::Index<2>& viewIndex) const;
+
+  /** Determine if the whole view consists of hole pixels.*/
+  bool IsHole() const;
+
+  /** Determine if the whole view is valid.*/
+  bool IsValid() const;
+
+  bool HasHolePixels() const;
+
+  bool HasValidPixels() const;
+
+  unsigned int CountHolePixels() const;
+
+  unsigned int CountValidPixels() const;
+
+  /** Count the pixels on 'whichSideOfBoundary' of the hole boundary.*/
+  unsigned int CountBoundaryPixels(const HoleMaskPixelTypeEnum& whichSideOfBoundary) const;
+
+  /** Get the runs of 'pixelType' pixels. Spans are relative to the corner of the region,
+    * so they are in view coordinates as they are. */
+  std::shared_ptr<const Mask::SpanListType> GetSpans(const HoleMaskPixelTypeEnum& pixelType) const;
+
+  std::shared_ptr<const Mask::SpanListType> GetHoleSpans() const;
+
+private:
+  const Mask* MaskImage;
+
+  itk::ImageRegion<2> Region;
+};
+
+template <typename TImage>
+class MaskImageView
+{
+public:
+  typedef typename MaskImageBuffer::ImageComponents<TImage>::ComponentType ComponentType;
+
+  /** View 'region' of 'image'. Throws if the region is not inside the image's buffered region.*/
+  MaskImageView(const TImage* const image, const itk::ImageRegion<2>& region);
+
+  const TImage* GetImage() const;
+
+  /** The viewed region, in image coordinates.*/
+  const itk::ImageRegion<2>& GetRegion() const;
+
+  itk::Size<2> GetSize() const;
+
+  /** Convert an index relative to the view to an index in the image.*/
+  itk::Index<2> GetImageIndex(const itk::Index<2>& viewIndex) const;
+
+  typename TImage::PixelType GetPixel(const itk::Index<2>& viewIndex) const;
+
+  unsigned int GetNumberOfComponents() const;
+
+  /** Get the first component of the pixel at 'viewIndex'. The pixels of a row of the view are contiguous.*/
+  const ComponentType* GetComponents(const itk::Index<2>& viewIndex) const;
+
+private:
+  const TImage* Image;
+
+  itk::ImageRegion<2> Region;
+};
+
+#include "MaskView.hpp"
+
+#endif
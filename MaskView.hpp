@@ -0,0 +1,85 @@
+/*=========================================================================
+ *
+ *  Copyright David Doria 2012 daviddoria@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+#ifndef MaskView_HPP
+#define MaskView_HPP
+
+#include "MaskView.h" // Appease syntax parser
+
+// STL
+#include <sstream>
+#include <stdexcept>
+
+template <typename TImage>
+MaskImageView<TImage>::MaskImageView(const TImage* const image, const itk::ImageRegion<2>& region) :
+  Image(image), Region(region)
+{
+  if(!image->GetBufferedRegion().IsInside(region))
+  {
+    std::stringstream ss;
+    ss << "MaskImageView: region " << region << " is not inside the image " << image->GetBufferedRegion();
+    throw std::runtime_error(ss.str());
+  }
+}
+
+template <typename TImage>
+const TImage* MaskImageView<TImage>::GetImage() const
+{
+  return this->Image;
+}
+
+template <typename TImage>
+const itk::ImageRegion<2>& MaskImageView<TImage>::GetRegion() const
+{
+  return this->Region;
+}
+
+template <typename TImage>
+itk::Size<2> MaskImageView<TImage>::GetSize() const
+{
+  return this->Region.GetSize();
+}
+
+template <typename TImage>
+itk::Index<2> MaskImageView<TImage>::GetImageIndex(const itk::Index<2>& viewIndex) const
+{
+  itk::Index<2> imageIndex = {{this->Region.GetIndex()[0] + viewIndex[0], this->Region.GetIndex()[1] + viewIndex[1]}};
+  return imageIndex;
+}
+
+template <typename TImage>
+typename TImage::PixelType MaskImageView<TImage>::GetPixel(const itk::Index<2>& viewIndex) const
+{
+  return this->Image->GetPixel(GetImageIndex(viewIndex));
+}
+
+template <typename TImage>
+unsigned int MaskImageView<TImage>::GetNumberOfComponents() const
+{
+  return MaskImageBuffer::ImageComponents<TImage>::GetNumberOfComponents(this->Image);
+}
+
+template <typename TImage>
+const typename MaskImageView<TImage>::ComponentType*
+MaskImageView<TImage>::GetComponents(const itk::Index<2>& viewIndex) const
+{
+  return MaskImageBuffer::GetComponents(this->Image, GetImageIndex(viewIndex));
+}
+
+#endif
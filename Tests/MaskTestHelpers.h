@@ -0,0 +1,33 @@
+#ifndef MaskTestHelpers_H
+#define MaskTestHelpers_H
+
+#include "Mask.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+/** Fixtures shared by the tests. */
+namespace MaskTestHelpers
+{
+
+/** Allocate 'mask' with 'size' (its corner at the origin) and make every pixel valid.*/
+inline void CreateValidMask(Mask* const mask, const itk::Size<2>& size)
+{
+  itk::Index<2> corner = {{0,0}};
+  itk::ImageRegion<2> region(corner, size);
+  mask->SetRegions(region);
+  mask->Allocate();
+  mask->FillBuffer(HoleMaskPixelTypeEnum::VALID);
+  mask->Modified();
+}
+
+/** Make the pixels of the rectangle at 'holeCorner' with 'holeSize' holes.*/
+inline void AddHole(Mask* const mask, const itk::Index<2>& holeCorner, const itk::Size<2>& holeSize)
+{
+  ITKHelpers::SetRegionToConstant(mask, itk::ImageRegion<2>(holeCorner, holeSize), HoleMaskPixelTypeEnum::HOLE);
+  mask->Modified();
+}
+
+} // end namespace
+
+#endif
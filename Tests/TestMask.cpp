@@ -1,14 +1,29 @@
 #include "Mask.h"
+#include "MaskTestHelpers.h"
+
+// STL
+#include <limits>
 
 // Submodules
 #include <ITKHelpers/ITKHelpers.h>
 
 static bool TestFindBoundaryInRegion();
+static bool TestNearestValidPixelMap();
+static bool TestValidPatchCenterMap();
+static bool TestHoleSpans();
+static bool TestModifiedRegion();
+
+// Test helpers
+static void CreateMask(Mask* const mask);
 
 int main()
 {
   bool allPass = true;
   allPass &= TestFindBoundaryInRegion();
+  allPass &= TestNearestValidPixelMap();
+  allPass &= TestValidPatchCenterMap();
+  allPass &= TestHoleSpans();
+  allPass &= TestModifiedRegion();
 
   if(allPass)
   {
@@ -22,93 +37,273 @@ int main()
 
 bool TestFindBoundaryInRegion()
 {
-//  // Test with 255=valid
-//  {
-//    Mask::Pointer mask = Mask::New();
-//    itk::Index<2> corner = {{0,0}};
-//    itk::Size<2> size = {{100,100}};
-//    itk::ImageRegion<2> imageRegion(corner, size);
-//    mask->SetRegions(imageRegion);
-//    mask->Allocate();
-
-//    mask->FillBuffer(HoleMaskPixelTypeEnum::VALID);
-
-//    itk::ImageRegionIterator<Mask> maskIterator(mask, mask->GetLargestPossibleRegion());
-
-//    while(!maskIterator.IsAtEnd())
-//    {
-//      if(maskIterator.GetIndex()[0] > 50 && maskIterator.GetIndex()[0] < 70 &&
-//         maskIterator.GetIndex()[1] > 50 && maskIterator.GetIndex()[1] < 70)
-//      {
-//        maskIterator.Set(HoleMaskPixelTypeEnum::HOLE);
-//      }
-
-//      ++maskIterator;
-//    }
-
-//    ITKHelpers::WriteImage(mask.GetPointer(), "mask_A.png");
-
-//    itk::Index<2> regionCorner = {{40,40}};
-//    itk::Size<2> regionSize = {{20,20}};
-//    itk::ImageRegion<2> queryRegion(regionCorner, regionSize);
-
-//    {
-//    Mask::BoundaryImageType::Pointer boundaryImage = Mask::BoundaryImageType::New();
-//    mask->CreateBoundaryImageInRegion(queryRegion, boundaryImage, HoleMaskPixelTypeEnum::VALID, 255);
-//    ITKHelpers::WriteImage(boundaryImage.GetPointer(), "boundary_A_valid.png");
-//    }
-
-//    {
-//    Mask::BoundaryImageType::Pointer boundaryImage = Mask::BoundaryImageType::New();
-//    mask->CreateBoundaryImageInRegion(queryRegion, boundaryImage, HoleMaskPixelTypeEnum::HOLE, 255);
-//    ITKHelpers::WriteImage(boundaryImage.GetPointer(), "boundary_A_hole.png");
-//    }
-//  }
-
-//  // Test with 255=hole
-//  {
-//    Mask::Pointer mask = Mask::New();
-//    itk::Index<2> corner = {{0,0}};
-//    itk::Size<2> size = {{100,100}};
-//    itk::ImageRegion<2> imageRegion(corner, size);
-//    mask->SetRegions(imageRegion);
-//    mask->Allocate();
-
-//    mask->FillBuffer(HoleMaskPixelTypeEnum::VALID);
-
-//    itk::ImageRegionIterator<Mask> maskIterator(mask, mask->GetLargestPossibleRegion());
-
-//    while(!maskIterator.IsAtEnd())
-//    {
-//      if(maskIterator.GetIndex()[0] > 50 && maskIterator.GetIndex()[0] < 70 &&
-//         maskIterator.GetIndex()[1] > 50 && maskIterator.GetIndex()[1] < 70)
-//      {
-//        maskIterator.Set(HoleMaskPixelTypeEnum::HOLE);
-//      }
-
-//      ++maskIterator;
-//    }
-
-//    ITKHelpers::WriteImage(mask.GetPointer(), "mask_B.png");
-
-//    itk::Index<2> regionCorner = {{40,40}};
-//    itk::Size<2> regionSize = {{20,20}};
-//    itk::ImageRegion<2> queryRegion(regionCorner, regionSize);
-
-//    {
-//    Mask::BoundaryImageType::Pointer boundaryImage = Mask::BoundaryImageType::New();
-//    mask->CreateBoundaryImageInRegion(queryRegion, boundaryImage, HoleMaskPixelTypeEnum::VALID, 255);
-//    ITKHelpers::WriteImage(boundaryImage.GetPointer(), "boundary_B_valid.png");
-//    }
-
-//    {
-//    Mask::BoundaryImageType::Pointer boundaryImage = Mask::BoundaryImageType::New();
-//    mask->CreateBoundaryImageInRegion(queryRegion, boundaryImage, HoleMaskPixelTypeEnum::HOLE, 255);
-//    ITKHelpers::WriteImage(boundaryImage.GetPointer(), "boundary_B_hole.png");
-//    }
-//  }
-
-//  return true;
-
-  return false;
+  // A square hole covering [51, 69] in both dimensions, and a query region [40, 59] that contains its
+  // top left corner.
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,100}});
+  MaskTestHelpers::AddHole(mask, {{51,51}}, {{19,19}});
+
+  itk::Index<2> regionCorner = {{40,40}};
+  itk::Size<2> regionSize = {{20,20}};
+  itk::ImageRegion<2> queryRegion(regionCorner, regionSize);
+
+  // The hole side of the boundary is the first row and column of the hole inside the region.
+  std::vector<itk::Index<2> > holeBoundary = mask->FindBoundaryPixelsInRegion(queryRegion, HoleMaskPixelTypeEnum::HOLE);
+  if(holeBoundary.size() != 17)
+  {
+    std::cerr << "Found " << holeBoundary.size() << " hole boundary pixels, expected 17." << std::endl;
+    return false;
+  }
+  for(const itk::Index<2>& pixel : holeBoundary)
+  {
+    if(!queryRegion.IsInside(pixel) || !mask->IsHole(pixel) || (pixel[0] != 51 && pixel[1] != 51))
+    {
+      std::cerr << "Pixel " << pixel << " is not on the hole side of the boundary." << std::endl;
+      return false;
+    }
+  }
+
+  // The valid side is the row and column just outside the hole (the corner pixel only touches the hole
+  // diagonally, so it depends on the connectivity).
+  std::vector<itk::Index<2> > validBoundary =
+      mask->FindBoundaryPixelsInRegion(queryRegion, HoleMaskPixelTypeEnum::VALID);
+  if(validBoundary.size() != 18 && validBoundary.size() != 19)
+  {
+    std::cerr << "Found " << validBoundary.size() << " valid boundary pixels, expected 18 or 19." << std::endl;
+    return false;
+  }
+  for(const itk::Index<2>& pixel : validBoundary)
+  {
+    if(!queryRegion.IsInside(pixel) || !mask->IsValid(pixel) || (pixel[0] != 50 && pixel[1] != 50))
+    {
+      std::cerr << "Pixel " << pixel << " is not on the valid side of the boundary." << std::endl;
+      return false;
+    }
+  }
+
+  if(mask->CountBoundaryPixels(queryRegion, HoleMaskPixelTypeEnum::HOLE) != holeBoundary.size())
+  {
+    std::cerr << "CountBoundaryPixels does not match FindBoundaryPixelsInRegion." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestNearestValidPixelMap()
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  // Compare the feature transform against a brute force search over all of the valid pixels.
+  std::vector<itk::Index<2> > validPixels = mask->GetValidPixels();
+
+  itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(mask, mask->GetLargestPossibleRegion());
+  while(!maskIterator.IsAtEnd())
+  {
+    itk::Index<2> pixel = maskIterator.GetIndex();
+
+    itk::OffsetValueType closestDistance = std::numeric_limits<itk::OffsetValueType>::max();
+    for(unsigned int i = 0; i < validPixels.size(); ++i)
+    {
+      itk::Offset<2> difference = validPixels[i] - pixel;
+      closestDistance = std::min(closestDistance, difference[0] * difference[0] + difference[1] * difference[1]);
+    }
+
+    itk::Index<2> nearestValidPixel;
+    if(!mask->FindNearestValidPixel(pixel, nearestValidPixel) || !mask->IsValid(nearestValidPixel))
+    {
+      std::cerr << "No valid pixel found for " << pixel << std::endl;
+      return false;
+    }
+
+    itk::Offset<2> difference = nearestValidPixel - pixel;
+    if(difference[0] * difference[0] + difference[1] * difference[1] != closestDistance)
+    {
+      std::cerr << "Nearest valid pixel of " << pixel << " is " << nearestValidPixel
+                << " but it should be at squared distance " << closestDistance << std::endl;
+      return false;
+    }
+
+    ++maskIterator;
+  }
+
+  // Modifying the mask must invalidate the cached map.
+  itk::Index<2> holePixel = {{30,30}};
+  mask->SetValid(holePixel);
+  itk::Index<2> nearestValidPixel;
+  mask->FindNearestValidPixel(holePixel, nearestValidPixel);
+  if(nearestValidPixel != holePixel)
+  {
+    std::cerr << "The nearest valid pixel map was not updated after the mask changed." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestValidPatchCenterMap()
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  const unsigned int patchRadius = 3;
+
+  // Count the fully valid patches by checking every patch that fits in the image.
+  unsigned int expectedNumberOfPatches = 0;
+  itk::Index<2> firstValidCenter = {{-1,-1}};
+  itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(mask, mask->GetLargestPossibleRegion());
+  while(!maskIterator.IsAtEnd())
+  {
+    itk::ImageRegion<2> region = ITKHelpers::GetRegionInRadiusAroundPixel(maskIterator.GetIndex(), patchRadius);
+    if(mask->GetLargestPossibleRegion().IsInside(region) && mask->IsValid(region))
+    {
+      if(expectedNumberOfPatches == 0)
+      {
+        firstValidCenter = maskIterator.GetIndex();
+      }
+      expectedNumberOfPatches++;
+    }
+    ++maskIterator;
+  }
+
+  if(mask->CountValidPatches(patchRadius) != expectedNumberOfPatches)
+  {
+    std::cerr << "CountValidPatches returned " << mask->CountValidPatches(patchRadius)
+              << " but there are " << expectedNumberOfPatches << " valid patches." << std::endl;
+    return false;
+  }
+
+  if(mask->FindFirstValidPatch(patchRadius) !=
+     ITKHelpers::GetRegionInRadiusAroundPixel(firstValidCenter, patchRadius))
+  {
+    std::cerr << "FindFirstValidPatch did not return the first valid patch." << std::endl;
+    return false;
+  }
+
+  // Making the whole mask valid must be reflected in the cached map.
+  mask->SetValid(mask->GetLargestPossibleRegion());
+  itk::Size<2> size = mask->GetLargestPossibleRegion().GetSize();
+  if(mask->CountValidPatches(patchRadius) != (size[0] - 2 * patchRadius) * (size[1] - 2 * patchRadius))
+  {
+    std::cerr << "The valid patch center map was not updated after the mask changed." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestHoleSpans()
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  itk::Index<2> corner = {{5,3}};
+  itk::Size<2> size = {{30,25}};
+  itk::ImageRegion<2> region(corner, size);
+
+  // Every hole pixel in the region must be in exactly one span, and every span pixel must be a hole.
+  std::shared_ptr<const Mask::SpanListType> holeSpans = mask->GetHoleSpans(region);
+  unsigned int numberOfSpanPixels = 0;
+  for(unsigned int spanId = 0; spanId < holeSpans->size(); ++spanId)
+  {
+    const Mask::Span& span = (*holeSpans)[spanId];
+    for(itk::SizeValueType i = 0; i < span.Length; ++i)
+    {
+      itk::Index<2> pixel = {{corner[0] + span.X + static_cast<itk::IndexValueType>(i), corner[1] + span.Y}};
+      if(!mask->IsHole(pixel))
+      {
+        std::cerr << "Span pixel " << pixel << " is not a hole." << std::endl;
+        return false;
+      }
+    }
+    numberOfSpanPixels += span.Length;
+  }
+
+  if(numberOfSpanPixels != mask->CountHolePixels(region))
+  {
+    std::cerr << "The hole spans cover " << numberOfSpanPixels << " pixels but there are "
+              << mask->CountHolePixels(region) << " hole pixels in the region." << std::endl;
+    return false;
+  }
+
+  // Looking up more regions than the cache holds drops the least recently used span lists, not the
+  // ones that are still in use.
+  for(itk::IndexValueType y = 0; y < 30; ++y)
+  {
+    for(itk::IndexValueType x = 0; x < 40; ++x)
+    {
+      for(itk::SizeValueType width = 1; width <= 4; ++width)
+      {
+        itk::Index<2> otherCorner = {{x, y}};
+        itk::Size<2> otherSize = {{width, 10}};
+        mask->GetHoleSpans(itk::ImageRegion<2>(otherCorner, otherSize));
+      }
+      if(mask->GetHoleSpans(region) != holeSpans)
+      {
+        std::cerr << "The hole spans of a region in use were dropped from the cache." << std::endl;
+        return false;
+      }
+    }
+  }
+
+  // The cached spans must be dropped when the mask changes.
+  mask->SetValid(region);
+  if(!mask->GetHoleSpans(region)->empty())
+  {
+    std::cerr << "The hole spans were not updated after the mask changed." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestModifiedRegion()
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+  mask->AcknowledgeModifiedRegion();
+
+  if(mask->HasModifiedRegion())
+  {
+    std::cerr << "The modified region was not cleared." << std::endl;
+    return false;
+  }
+
+  // The recorded region is the bounding box of the changes, cropped to the mask.
+  itk::Index<2> pixel = {{3,4}};
+  mask->SetHole(pixel);
+  itk::Index<2> corner = {{40,30}};
+  itk::Size<2> size = {{20,20}};
+  mask->MarkModifiedRegion(itk::ImageRegion<2>(corner, size));
+
+  itk::Index<2> expectedCorner = {{3,4}};
+  itk::Size<2> expectedSize = {{47,36}};
+  if(!mask->HasModifiedRegion() || mask->GetModifiedRegion() != itk::ImageRegion<2>(expectedCorner, expectedSize))
+  {
+    std::cerr << "Wrong modified region " << mask->GetModifiedRegion() << std::endl;
+    return false;
+  }
+
+  mask->AcknowledgeModifiedRegion();
+  if(mask->HasModifiedRegion() || mask->GetModifiedRegion().GetNumberOfPixels() != 0)
+  {
+    std::cerr << "The modified region was not acknowledged." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////
+////// Test Helpers ////
+////////////////////////
+
+void CreateMask(Mask* const mask)
+{
+  // An irregular hole: a rectangle and a cross that overlap.
+  MaskTestHelpers::CreateValidMask(mask, {{50,40}});
+  MaskTestHelpers::AddHole(mask, {{11,6}}, {{24,14}});
+  MaskTestHelpers::AddHole(mask, {{21,19}}, {{19,13}});
+  MaskTestHelpers::AddHole(mask, {{24,16}}, {{13,19}});
 }
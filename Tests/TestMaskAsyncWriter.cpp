@@ -0,0 +1,215 @@
+#include "Mask.h"
+#include "MaskAsyncWriter.h"
+
+// ITK
+#include "itkVectorImage.h"
+
+// STL
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+static bool TestBlock();
+static bool TestDropNewest();
+static bool TestDropOldest();
+static bool TestFlushRethrows();
+
+/** Holds the writer's thread inside a write until Open() is called.*/
+class Gate
+{
+public:
+  void Wait()
+  {
+    std::unique_lock<std::mutex> lock(this->GateMutex);
+    this->Waiting = true;
+    this->Changed.notify_all();
+    this->Changed.wait(lock, [this]{ return this->IsOpen; });
+  }
+
+  /** Wait until a write is blocked in Wait().*/
+  void WaitForWaiter()
+  {
+    std::unique_lock<std::mutex> lock(this->GateMutex);
+    this->Changed.wait(lock, [this]{ return this->Waiting; });
+  }
+
+  void Open()
+  {
+    std::lock_guard<std::mutex> lock(this->GateMutex);
+    this->IsOpen = true;
+    this->Changed.notify_all();
+  }
+
+private:
+  std::mutex GateMutex;
+  std::condition_variable Changed;
+  bool Waiting = false;
+  bool IsOpen = false;
+};
+
+int main()
+{
+  bool allPass = true;
+  allPass &= TestBlock();
+  allPass &= TestDropNewest();
+  allPass &= TestDropOldest();
+  allPass &= TestFlushRethrows();
+
+  if(allPass)
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
+
+bool TestBlock()
+{
+  // With a short queue, every write still happens, in order.
+  MaskAsyncWriter writer(2, MaskAsyncWriter::QueuePolicyEnum::BLOCK);
+  std::vector<int> written;
+  for(int i = 0; i < 100; ++i)
+  {
+    if(!writer.Enqueue([&written, i]{ written.push_back(i); }))
+    {
+      std::cerr << "TestBlock: write " << i << " was dropped." << std::endl;
+      return false;
+    }
+  }
+  writer.Flush();
+
+  for(int i = 0; i < 100; ++i)
+  {
+    if(static_cast<int>(written.size()) != 100 || written[i] != i)
+    {
+      std::cerr << "TestBlock: the writes did not all happen in order." << std::endl;
+      return false;
+    }
+  }
+
+  return writer.GetNumberOfDroppedWrites() == 0;
+}
+
+bool TestDropNewest()
+{
+  MaskAsyncWriter writer(3, MaskAsyncWriter::QueuePolicyEnum::DROP_NEWEST);
+
+  Gate gate;
+  std::vector<int> written;
+  writer.Enqueue([&gate]{ gate.Wait(); });
+  gate.WaitForWaiter();
+
+  // The first three fill the queue, the rest are dropped.
+  for(int i = 0; i < 10; ++i)
+  {
+    const bool queued = writer.Enqueue([&written, i]{ written.push_back(i); });
+    if(queued != (i < 3))
+    {
+      std::cerr << "TestDropNewest: write " << i << " was " << (queued ? "queued" : "dropped") << std::endl;
+      return false;
+    }
+  }
+
+  // A dropped region write must not snapshot the region first. The mask is not allocated, so
+  // snapshotting would throw.
+  typedef itk::VectorImage<float, 2> ImageType;
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{10,10}};
+  itk::ImageRegion<2> region(corner, size);
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->SetNumberOfComponentsPerPixel(3);
+  image->Allocate();
+  Mask::Pointer unallocatedMask = Mask::New();
+  ImageType::PixelType holeColor(3);
+  holeColor.Fill(0);
+  try
+  {
+    if(writer.WriteMaskedRegion(image.GetPointer(), unallocatedMask.GetPointer(), region, "Dropped.mha", holeColor))
+    {
+      std::cerr << "TestDropNewest: the region write should have been dropped." << std::endl;
+      return false;
+    }
+  }
+  catch(const std::exception& error)
+  {
+    std::cerr << "TestDropNewest: the region was snapshotted before being dropped: " << error.what() << std::endl;
+    return false;
+  }
+
+  gate.Open();
+  writer.Flush();
+
+  if(written != std::vector<int>{0, 1, 2} || writer.GetNumberOfDroppedWrites() != 8)
+  {
+    std::cerr << "TestDropNewest: wrong writes." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestDropOldest()
+{
+  MaskAsyncWriter writer(3, MaskAsyncWriter::QueuePolicyEnum::DROP_OLDEST);
+
+  Gate gate;
+  std::vector<int> written;
+  writer.Enqueue([&gate]{ gate.Wait(); });
+  gate.WaitForWaiter();
+
+  // Only the last three are left in the queue.
+  for(int i = 0; i < 10; ++i)
+  {
+    if(!writer.Enqueue([&written, i]{ written.push_back(i); }))
+    {
+      std::cerr << "TestDropOldest: the newest write was dropped." << std::endl;
+      return false;
+    }
+  }
+
+  gate.Open();
+  writer.Flush();
+
+  if(written != std::vector<int>{7, 8, 9} || writer.GetNumberOfDroppedWrites() != 7)
+  {
+    std::cerr << "TestDropOldest: wrong writes." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestFlushRethrows()
+{
+  MaskAsyncWriter writer;
+  std::atomic<int> numberOfWrites(0);
+  writer.Enqueue([]{ throw std::runtime_error("first"); });
+  writer.Enqueue([]{ throw std::runtime_error("second"); });
+  writer.Enqueue([&numberOfWrites]{ numberOfWrites++; });
+
+  try
+  {
+    writer.Flush();
+    std::cerr << "TestFlushRethrows: Flush() did not throw." << std::endl;
+    return false;
+  }
+  catch(const std::runtime_error& error)
+  {
+    if(std::string(error.what()) != "first")
+    {
+      std::cerr << "TestFlushRethrows: Flush() threw " << error.what() << std::endl;
+      return false;
+    }
+  }
+
+  // The failed writes do not stop the later ones, and the error is only reported once.
+  writer.Flush();
+
+  return numberOfWrites == 1;
+}
@@ -0,0 +1,237 @@
+#include "Mask.h"
+#include "MaskGenerator.h"
+
+// STL
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+static bool TestDeterminism();
+static bool TestBatch();
+static bool TestHoleFraction();
+static bool TestShapeTypes();
+static bool TestNoHoles();
+
+// Test helpers
+static bool SameMasks(const Mask* const maskA, const Mask* const maskB);
+
+int main()
+{
+  bool allPass = true;
+  allPass &= TestDeterminism();
+  allPass &= TestBatch();
+  allPass &= TestHoleFraction();
+  allPass &= TestShapeTypes();
+  allPass &= TestNoHoles();
+
+  if(allPass)
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
+
+bool TestDeterminism()
+{
+  itk::Size<2> size = {{200,150}};
+  MaskGenerator generator(2012);
+  generator.SetSize(size);
+
+  Mask::Pointer mask = Mask::New();
+  generator.Generate(7, mask);
+  if(mask->GetLargestPossibleRegion().GetSize() != size)
+  {
+    std::cerr << "Generated mask has size " << mask->GetLargestPossibleRegion().GetSize()
+              << " but should be " << size << std::endl;
+    return false;
+  }
+
+  // The same seed and mask id must give the same mask, even from another generator.
+  MaskGenerator otherGenerator(2012);
+  otherGenerator.SetSize(size);
+  Mask::Pointer sameMask = Mask::New();
+  otherGenerator.Generate(7, sameMask);
+  if(!SameMasks(mask, sameMask))
+  {
+    std::cerr << "The same seed and mask id gave different masks." << std::endl;
+    return false;
+  }
+
+  Mask::Pointer differentMask = Mask::New();
+  generator.Generate(8, differentMask);
+  if(SameMasks(mask, differentMask))
+  {
+    std::cerr << "Different mask ids gave the same mask." << std::endl;
+    return false;
+  }
+
+  // Regenerating into an existing mask must overwrite all of it.
+  generator.Generate(7, differentMask);
+  if(!SameMasks(mask, differentMask))
+  {
+    std::cerr << "Regenerating into an existing mask did not reproduce the mask." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestBatch()
+{
+  itk::Size<2> size = {{128,128}};
+  MaskGenerator generator(5);
+  generator.SetSize(size);
+
+  const unsigned int numberOfMasks = 16;
+  std::vector<Mask::Pointer> masks(numberOfMasks);
+  std::vector<Mask*> maskPointers(numberOfMasks);
+  for(unsigned int maskId = 0; maskId < numberOfMasks; ++maskId)
+  {
+    masks[maskId] = Mask::New();
+    maskPointers[maskId] = masks[maskId];
+  }
+  generator.Generate(100, maskPointers);
+
+  for(unsigned int maskId = 0; maskId < numberOfMasks; ++maskId)
+  {
+    Mask::Pointer mask = Mask::New();
+    generator.Generate(100 + maskId, mask);
+    if(!SameMasks(mask, masks[maskId]))
+    {
+      std::cerr << "Batch mask " << maskId << " differs from the mask generated on its own." << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool TestHoleFraction()
+{
+  itk::Size<2> size = {{256,256}};
+  const float holeFractions[] = {0.05f, 0.2f, 0.4f};
+  for(const float holeFraction : holeFractions)
+  {
+    MaskGenerator generator(1);
+    generator.SetSize(size);
+    generator.SetHoleFraction(holeFraction);
+    generator.SetNumberOfComponents(2, 6);
+
+    const unsigned int numberOfMasks = 50;
+    float totalFraction = 0.0f;
+    Mask::Pointer mask = Mask::New();
+    for(unsigned int maskId = 0; maskId < numberOfMasks; ++maskId)
+    {
+      generator.Generate(maskId, mask);
+      totalFraction += static_cast<float>(mask->CountHolePixels()) /
+                       static_cast<float>(mask->GetLargestPossibleRegion().GetNumberOfPixels());
+    }
+
+    const float meanFraction = totalFraction / static_cast<float>(numberOfMasks);
+    if(meanFraction < 0.7f * holeFraction || meanFraction > 1.3f * holeFraction)
+    {
+      std::cerr << "Mean hole fraction " << meanFraction << " is too far from the target "
+                << holeFraction << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool TestShapeTypes()
+{
+  const MaskGenerator::ShapeTypeEnum shapeTypes[] = {MaskGenerator::ShapeTypeEnum::STROKE,
+                                                     MaskGenerator::ShapeTypeEnum::BLOB,
+                                                     MaskGenerator::ShapeTypeEnum::RECTANGLE,
+                                                     MaskGenerator::ShapeTypeEnum::SCRATCH};
+  for(const MaskGenerator::ShapeTypeEnum shapeType : shapeTypes)
+  {
+    MaskGenerator generator(3);
+    for(const MaskGenerator::ShapeTypeEnum otherShapeType : shapeTypes)
+    {
+      generator.SetShapeWeight(otherShapeType, otherShapeType == shapeType ? 1.0f : 0.0f);
+    }
+
+    Mask::Pointer mask = Mask::New();
+    generator.Generate(0, mask);
+    if(mask->CountHolePixels() == 0)
+    {
+      std::cerr << "Shape type " << static_cast<int>(shapeType) << " drew no holes." << std::endl;
+      return false;
+    }
+  }
+
+  // A single rectangle covers about the requested area, less whatever falls outside the mask.
+  MaskGenerator generator(4);
+  generator.SetShapeWeight(MaskGenerator::ShapeTypeEnum::STROKE, 0.0f);
+  generator.SetShapeWeight(MaskGenerator::ShapeTypeEnum::BLOB, 0.0f);
+  generator.SetShapeWeight(MaskGenerator::ShapeTypeEnum::SCRATCH, 0.0f);
+  generator.SetNumberOfComponents(1, 1);
+  generator.SetHoleFraction(0.01f);
+
+  Mask::Pointer mask = Mask::New();
+  generator.Generate(0, mask);
+  const float area = 0.01f * static_cast<float>(mask->GetLargestPossibleRegion().GetNumberOfPixels());
+  if(mask->CountHolePixels() > 1.1f * area)
+  {
+    std::cerr << "A single rectangle covered " << mask->CountHolePixels() << " pixels but should cover about "
+              << area << std::endl;
+    return false;
+  }
+
+  // Disabling every shape type must be reported rather than producing an empty mask.
+  generator.SetShapeWeight(MaskGenerator::ShapeTypeEnum::RECTANGLE, 0.0f);
+  try
+  {
+    generator.Generate(0, mask);
+    std::cerr << "Generating with every shape weight 0 should throw." << std::endl;
+    return false;
+  }
+  catch(const std::runtime_error&)
+  {
+  }
+
+  return true;
+}
+
+bool TestNoHoles()
+{
+  MaskGenerator generator(6);
+  generator.SetHoleFraction(0.0f);
+
+  Mask::Pointer mask = Mask::New();
+  generator.Generate(0, mask);
+  if(mask->CountHolePixels() != 0)
+  {
+    std::cerr << "A hole fraction of 0 should give a mask without holes." << std::endl;
+    return false;
+  }
+
+  if(mask->GetModifiedRegion() != mask->GetLargestPossibleRegion())
+  {
+    std::cerr << "Generating a mask should mark all of it as modified." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////
+////// Test Helpers ////
+////////////////////////
+
+bool SameMasks(const Mask* const maskA, const Mask* const maskB)
+{
+  if(maskA->GetLargestPossibleRegion() != maskB->GetLargestPossibleRegion())
+  {
+    return false;
+  }
+
+  const itk::SizeValueType numberOfPixels = maskA->GetLargestPossibleRegion().GetNumberOfPixels();
+  return std::equal(maskA->GetBufferPointer(), maskA->GetBufferPointer() + numberOfPixels,
+                    maskB->GetBufferPointer());
+}
@@ -0,0 +1,276 @@
+#include "Mask.h"
+#include "MaskHolePipeline.h"
+#include "MaskOperations.h"
+#include "MaskParallel.h"
+#include "MaskTestHelpers.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// ITK
+#include "itkImageRegionIterator.h"
+#include "itkVectorImage.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+
+typedef itk::Image<float, 2> ScalarImageType;
+typedef itk::Image<unsigned char, 2> UnsignedCharImageType;
+typedef itk::Image<int, 2> IntImageType;
+typedef itk::VectorImage<float, 2> VectorImageType;
+
+static bool TestChain();
+static bool TestRounding();
+static bool TestVectorNoise();
+static bool TestSet();
+static bool TestWideIntegers();
+
+// Test helpers
+static void CreateMask(Mask* const mask);
+template <typename TImage>
+static void CreateImage(TImage* const image);
+static void CreateImage(VectorImageType* const image);
+
+int main()
+{
+  bool allPass = true;
+  allPass &= TestChain();
+  allPass &= TestRounding();
+  allPass &= TestVectorNoise();
+  allPass &= TestSet();
+  allPass &= TestWideIntegers();
+
+  if(allPass)
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
+
+bool TestChain()
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  ScalarImageType::Pointer image = ScalarImageType::New();
+  CreateImage(image.GetPointer());
+
+  ScalarImageType::Pointer original = ScalarImageType::New();
+  ITKHelpers::DeepCopy(image.GetPointer(), original.GetPointer());
+
+  MaskOperations::InHole(image.GetPointer(), mask.GetPointer()).Add(20.0f).Clip(30.0f, 200.0f).Scale(0.5f).Apply();
+
+  itk::ImageRegionConstIteratorWithIndex<ScalarImageType> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    float expected = original->GetPixel(imageIterator.GetIndex());
+    if(mask->IsHole(imageIterator.GetIndex()))
+    {
+      expected = std::min(std::max(expected + 20.0f, 30.0f), 200.0f) * 0.5f;
+    }
+
+    if(imageIterator.Get() != expected)
+    {
+      std::cerr << "Chain: wrong value at " << imageIterator.GetIndex() << ": " << imageIterator.Get()
+                << " should be " << expected << std::endl;
+      return false;
+    }
+    ++imageIterator;
+  }
+
+  return true;
+}
+
+bool TestRounding()
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  // The result is rounded, and values above 255 are clamped rather than wrapped.
+  UnsignedCharImageType::Pointer image = UnsignedCharImageType::New();
+  CreateImage(image.GetPointer());
+  UnsignedCharImageType::Pointer original = UnsignedCharImageType::New();
+  ITKHelpers::DeepCopy(image.GetPointer(), original.GetPointer());
+
+  MaskOperations::InHole(image.GetPointer(), mask.GetPointer()).Add(100.5f).Apply();
+
+  itk::ImageRegionConstIteratorWithIndex<UnsignedCharImageType> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    unsigned char expected = original->GetPixel(imageIterator.GetIndex());
+    if(mask->IsHole(imageIterator.GetIndex()))
+    {
+      expected = static_cast<unsigned char>(std::min(std::round(expected + 100.5f), 255.0f));
+    }
+
+    if(imageIterator.Get() != expected)
+    {
+      std::cerr << "Rounding: wrong value at " << imageIterator.GetIndex() << std::endl;
+      return false;
+    }
+    ++imageIterator;
+  }
+
+  return true;
+}
+
+bool TestVectorNoise()
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  std::vector<VectorImageType::Pointer> images;
+  for(unsigned int numberOfThreads = 1; numberOfThreads <= 4; numberOfThreads += 3)
+  {
+    VectorImageType::Pointer image = VectorImageType::New();
+    CreateImage(image.GetPointer());
+
+    MaskRandomState randomState(2012);
+    MaskHolePipeline<VectorImageType> pipeline(image.GetPointer(), mask.GetPointer());
+    pipeline.Fill(10.0f).Noise(2.0f, randomState);
+    pipeline.SetNumberOfThreads(numberOfThreads);
+    pipeline.Apply();
+    images.push_back(image);
+  }
+
+  itk::ImageRegionConstIteratorWithIndex<VectorImageType> imageIterator(images[0], images[0]->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    const VectorImageType::PixelType pixel = imageIterator.Get();
+    if(pixel != images[1]->GetPixel(imageIterator.GetIndex()))
+    {
+      std::cerr << "VectorNoise: different results for 1 and 4 threads at " << imageIterator.GetIndex() << std::endl;
+      return false;
+    }
+
+    if(mask->IsHole(imageIterator.GetIndex()) &&
+       (pixel[0] < 9.0f || pixel[0] >= 11.0f || pixel[1] != pixel[0] || pixel[2] != pixel[0]))
+    {
+      std::cerr << "VectorNoise: wrong noise at " << imageIterator.GetIndex() << ": " << pixel << std::endl;
+      return false;
+    }
+    ++imageIterator;
+  }
+
+  return true;
+}
+
+bool TestSet()
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  VectorImageType::Pointer image = VectorImageType::New();
+  CreateImage(image.GetPointer());
+  VectorImageType::Pointer original = VectorImageType::New();
+  ITKHelpers::DeepCopy(image.GetPointer(), original.GetPointer());
+
+  VectorImageType::PixelType value(3);
+  value[0] = 1.0f;
+  value[1] = 2.0f;
+  value[2] = 3.0f;
+  MaskOperations::SetHolePixelsToConstant(image.GetPointer(), value, mask.GetPointer());
+
+  itk::ImageRegionConstIteratorWithIndex<VectorImageType> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    const VectorImageType::PixelType expected =
+        mask->IsHole(imageIterator.GetIndex()) ? value : original->GetPixel(imageIterator.GetIndex());
+    if(imageIterator.Get() != expected)
+    {
+      std::cerr << "Set: wrong value at " << imageIterator.GetIndex() << std::endl;
+      return false;
+    }
+    ++imageIterator;
+  }
+
+  return true;
+}
+
+bool TestWideIntegers()
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  // Neither value is representable as a float, so these only pass if the stages run in double
+  // and the final set is copied directly.
+  IntImageType::Pointer image = IntImageType::New();
+  CreateImage(image.GetPointer());
+  MaskOperations::InHole(image.GetPointer(), mask.GetPointer()).Set(16777217).Add(1.0f).Apply();
+
+  IntImageType::Pointer constantImage = IntImageType::New();
+  CreateImage(constantImage.GetPointer());
+  MaskOperations::SetHolePixelsToConstant(constantImage.GetPointer(), 2147483647, mask.GetPointer());
+
+  itk::ImageRegionConstIteratorWithIndex<IntImageType> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    if(mask->IsHole(imageIterator.GetIndex()) &&
+       (imageIterator.Get() != 16777218 || constantImage->GetPixel(imageIterator.GetIndex()) != 2147483647))
+    {
+      std::cerr << "WideIntegers: wrong value at " << imageIterator.GetIndex() << ": " << imageIterator.Get()
+                << " and " << constantImage->GetPixel(imageIterator.GetIndex()) << std::endl;
+      return false;
+    }
+    ++imageIterator;
+  }
+
+  return true;
+}
+
+////////////////////////
+////// Test Helpers ////
+////////////////////////
+
+void CreateMask(Mask* const mask)
+{
+  // Two holes, one of them running off the right edge, so rows have several spans.
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{10,5}}, {{20,30}});
+  MaskTestHelpers::AddHole(mask, {{70,20}}, {{30,25}});
+}
+
+template <typename TImage>
+void CreateImage(TImage* const image)
+{
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{100,50}};
+  itk::ImageRegion<2> imageRegion(corner, size);
+  image->SetRegions(imageRegion);
+  image->Allocate();
+
+  itk::ImageRegionIterator<TImage> imageIterator(image, imageRegion);
+  while(!imageIterator.IsAtEnd())
+  {
+    const itk::Index<2> index = imageIterator.GetIndex();
+    imageIterator.Set((index[0] * 37 + index[1] * 11) % 251);
+    ++imageIterator;
+  }
+}
+
+void CreateImage(VectorImageType* const image)
+{
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{100,50}};
+  itk::ImageRegion<2> imageRegion(corner, size);
+  image->SetRegions(imageRegion);
+  image->SetNumberOfComponentsPerPixel(3);
+  image->Allocate();
+
+  itk::ImageRegionIterator<VectorImageType> imageIterator(image, imageRegion);
+  while(!imageIterator.IsAtEnd())
+  {
+    const itk::Index<2> index = imageIterator.GetIndex();
+    VectorImageType::PixelType pixel(3);
+    for(unsigned int component = 0; component < 3; ++component)
+    {
+      pixel[component] = 0.25f * ((index[0] * 37 + index[1] * 11 + component * 53) % 251);
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+}
@@ -0,0 +1,206 @@
+#include "Mask.h"
+#include "MaskInstrumentation.h"
+#include "MaskTestHelpers.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// STL
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+static bool TestNestedOperations();
+static bool TestThreads();
+static bool TestReset();
+static bool TestMaskOperations();
+static bool TestWriteSnapshot();
+
+int main()
+{
+  bool allPass = true;
+  allPass &= TestNestedOperations();
+  allPass &= TestThreads();
+  allPass &= TestReset();
+  allPass &= TestMaskOperations();
+  allPass &= TestWriteSnapshot();
+
+  if(allPass)
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
+
+bool TestNestedOperations()
+{
+  MaskInstrumentation::Reset();
+
+  {
+    MaskInstrumentation::ScopedOperation outer("Test::Outer");
+    MaskInstrumentation::AddPixelsVisited(10);
+    {
+      MaskInstrumentation::ScopedOperation inner("Test::Inner");
+      MaskInstrumentation::AddPixelsVisited(5);
+      MaskInstrumentation::AddBytesAllocated(64);
+    }
+    MaskInstrumentation::AddBytesAllocated(32);
+  }
+
+  // Outside of any operation, this is not recorded.
+  MaskInstrumentation::AddPixelsVisited(1000);
+
+  MaskInstrumentation::SnapshotType snapshot = MaskInstrumentation::GetSnapshot();
+  if(snapshot.size() != 2)
+  {
+    std::cerr << "There should be 2 operations in the snapshot but there are " << snapshot.size() << std::endl;
+    return false;
+  }
+
+  const MaskInstrumentation::OperationCounters& outer = snapshot["Test::Outer"];
+  const MaskInstrumentation::OperationCounters& inner = snapshot["Test::Inner"];
+  if(outer.NumberOfCalls != 1 || outer.PixelsVisited != 10 || outer.BytesAllocated != 32)
+  {
+    std::cerr << "Outer operation: " << outer.NumberOfCalls << " calls, " << outer.PixelsVisited << " pixels, "
+              << outer.BytesAllocated << " bytes but should be 1, 10, 32." << std::endl;
+    return false;
+  }
+
+  if(inner.NumberOfCalls != 1 || inner.PixelsVisited != 5 || inner.BytesAllocated != 64)
+  {
+    std::cerr << "Inner operation: " << inner.NumberOfCalls << " calls, " << inner.PixelsVisited << " pixels, "
+              << inner.BytesAllocated << " bytes but should be 1, 5, 64." << std::endl;
+    return false;
+  }
+
+  // Times are inclusive.
+  if(outer.Seconds < inner.Seconds)
+  {
+    std::cerr << "The outer operation took less time than the inner one." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestThreads()
+{
+  MaskInstrumentation::Reset();
+
+  // The threads exit before the snapshot, so their counters must have been kept.
+  const unsigned int numberOfThreads = 4;
+  const unsigned int numberOfCalls = 100;
+  std::vector<std::thread> threads;
+  for(unsigned int threadId = 0; threadId < numberOfThreads; ++threadId)
+  {
+    threads.push_back(std::thread([numberOfCalls]
+                                  {
+                                    for(unsigned int callId = 0; callId < numberOfCalls; ++callId)
+                                    {
+                                      MaskInstrumentation::ScopedOperation operation("Test::Threaded");
+                                      MaskInstrumentation::AddPixelsVisited(2);
+                                    }
+                                  }));
+  }
+  for(std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  MaskInstrumentation::SnapshotType snapshot = MaskInstrumentation::GetSnapshot();
+  const MaskInstrumentation::OperationCounters& counters = snapshot["Test::Threaded"];
+  if(counters.NumberOfCalls != numberOfThreads * numberOfCalls ||
+     counters.PixelsVisited != 2 * numberOfThreads * numberOfCalls)
+  {
+    std::cerr << "Threaded operation: " << counters.NumberOfCalls << " calls and " << counters.PixelsVisited
+              << " pixels but should be " << numberOfThreads * numberOfCalls << " and "
+              << 2 * numberOfThreads * numberOfCalls << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestReset()
+{
+  {
+    MaskInstrumentation::ScopedOperation operation("Test::BeforeReset");
+  }
+
+  MaskInstrumentation::Reset();
+  if(!MaskInstrumentation::GetSnapshot().empty())
+  {
+    std::cerr << "The snapshot should be empty after Reset()." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestMaskOperations()
+{
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{40,30}};
+  itk::ImageRegion<2> region(corner, size);
+
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, size);
+  itk::Size<2> holeSize = {{5,4}};
+  MaskTestHelpers::AddHole(mask, {{10,10}}, holeSize);
+
+  MaskInstrumentation::Reset();
+  mask->CountHolePixels();
+  MaskInstrumentation::SnapshotType snapshot = MaskInstrumentation::GetSnapshot();
+
+  if(!MaskInstrumentation::IsEnabled())
+  {
+    // Without MASK_ENABLE_INSTRUMENTATION the operations record nothing.
+    if(!snapshot.empty())
+    {
+      std::cerr << "Operations were recorded without MASK_ENABLE_INSTRUMENTATION." << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // CountHolePixels() forwards to CountHolePixels(region), and one call is recorded once.
+  if(snapshot["Mask::CountHolePixels"].NumberOfCalls != 1)
+  {
+    std::cerr << "CountHolePixels: " << snapshot["Mask::CountHolePixels"].NumberOfCalls
+              << " calls recorded, expected 1." << std::endl;
+    return false;
+  }
+
+  const MaskInstrumentation::OperationCounters& getHolePixels = snapshot["Mask::GetHolePixelsInRegion"];
+  if(getHolePixels.NumberOfCalls != 1 || getHolePixels.PixelsVisited != region.GetNumberOfPixels() ||
+     getHolePixels.BytesAllocated < holeSize[0] * holeSize[1] * sizeof(itk::Index<2>))
+  {
+    std::cerr << "GetHolePixelsInRegion: " << getHolePixels.NumberOfCalls << " calls, "
+              << getHolePixels.PixelsVisited << " pixels, " << getHolePixels.BytesAllocated << " bytes." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestWriteSnapshot()
+{
+  MaskInstrumentation::Reset();
+  {
+    MaskInstrumentation::ScopedOperation operation("Test::Written");
+  }
+
+  std::stringstream output;
+  MaskInstrumentation::WriteSnapshot(MaskInstrumentation::GetSnapshot(), output);
+  if(output.str().find("Test::Written") == std::string::npos)
+  {
+    std::cerr << "The written snapshot does not contain the operation:" << std::endl << output.str();
+    return false;
+  }
+
+  return true;
+}
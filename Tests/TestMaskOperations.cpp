@@ -1,14 +1,28 @@
 #include "Mask.h"
 #include "MaskOperations.h"
+#include "MaskTestHelpers.h"
 
 // Submodules
 #include <ITKHelpers/ITKHelpers.h>
 
+// STL
+#include <algorithm>
+#include <cmath>
+
 static bool TestComputeHoleBoundingBox();
 static bool TestInterpolateHole();
 static bool TestMaskedBlur();
+static bool TestMaskedBlurVectorImage();
 static bool TestFindMinimumValueInMaskedRegion();
 static bool TestFindMaximumValueInMaskedRegion();
+static bool TestFillHoleWithNearestValidPixel();
+static bool TestFindPixelsAcrossHole();
+static bool TestInterpolateHoleAlongRows();
+static bool TestInterpolateLinesThroughHole();
+static bool TestCopySelfPatchIntoHoleOfTargetRegion();
+static bool TestComputeLocalMaskedMoments();
+static bool TestComputeLocalMaskedMomentsLargeValues();
+static bool TestAverageNeighborValues();
 
 // Test helpers
 template <typename TImage>
@@ -23,10 +37,24 @@ int main()
   allPass &= TestComputeHoleBoundingBox();
 
   allPass &= TestMaskedBlur();
+  allPass &= TestMaskedBlurVectorImage();
 
   allPass &= TestFindMinimumValueInMaskedRegion();
   allPass &= TestFindMaximumValueInMaskedRegion();
 
+  allPass &= TestFillHoleWithNearestValidPixel();
+
+  allPass &= TestFindPixelsAcrossHole();
+
+  allPass &= TestInterpolateHoleAlongRows();
+  allPass &= TestInterpolateLinesThroughHole();
+
+  allPass &= TestCopySelfPatchIntoHoleOfTargetRegion();
+
+  allPass &= TestComputeLocalMaskedMoments();
+  allPass &= TestComputeLocalMaskedMomentsLargeValues();
+  allPass &= TestAverageNeighborValues();
+
   if(allPass)
   {
     return EXIT_SUCCESS;
@@ -138,6 +166,70 @@ bool TestMaskedBlur()
   return true;
 }
 
+bool TestMaskedBlurVectorImage()
+{
+  // Blurring a multi-component image must give the same result as blurring each component by itself.
+  typedef itk::Image<float, 2> ScalarImageType;
+  const unsigned int numberOfComponents = 3;
+  std::vector<ScalarImageType::Pointer> componentImages(numberOfComponents);
+  for(unsigned int component = 0; component < numberOfComponents; ++component)
+  {
+    componentImages[component] = ScalarImageType::New();
+    CreateImage(componentImages[component].GetPointer());
+  }
+
+  typedef itk::VectorImage<float, 2> VectorImageType;
+  VectorImageType::Pointer image = VectorImageType::New();
+  image->SetRegions(componentImages[0]->GetLargestPossibleRegion());
+  image->SetNumberOfComponentsPerPixel(numberOfComponents);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<VectorImageType> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    VectorImageType::PixelType pixel(numberOfComponents);
+    for(unsigned int component = 0; component < numberOfComponents; ++component)
+    {
+      pixel[component] = componentImages[component]->GetPixel(imageIterator.GetIndex());
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  const float blurVariance = 2.0f;
+  VectorImageType::Pointer output = VectorImageType::New();
+  MaskOperations::MaskedBlur(image.GetPointer(), mask, blurVariance, output.GetPointer());
+
+  // Blurring in place must not read pixels that were already overwritten.
+  MaskOperations::MaskedBlur(image.GetPointer(), mask, blurVariance, image.GetPointer());
+
+  for(unsigned int component = 0; component < numberOfComponents; ++component)
+  {
+    ScalarImageType::Pointer blurredComponent = ScalarImageType::New();
+    MaskOperations::MaskedBlur(componentImages[component].GetPointer(), mask, blurVariance,
+                               blurredComponent.GetPointer());
+
+    itk::ImageRegionConstIteratorWithIndex<ScalarImageType> blurredIterator(blurredComponent,
+                                                                           blurredComponent->GetLargestPossibleRegion());
+    while(!blurredIterator.IsAtEnd())
+    {
+      const itk::Index<2> index = blurredIterator.GetIndex();
+      if(std::abs(output->GetPixel(index)[component] - blurredIterator.Get()) > 1e-3 ||
+         std::abs(image->GetPixel(index)[component] - blurredIterator.Get()) > 1e-3)
+      {
+        std::cerr << "MaskedBlur: component " << component << " of the vector image is wrong at " << index << std::endl;
+        return false;
+      }
+      ++blurredIterator;
+    }
+  }
+
+  return true;
+}
+
 bool TestFindMaximumValueInMaskedRegion()
 {
   // Scalar
@@ -244,6 +336,475 @@ bool TestFindMinimumValueInMaskedRegion()
   return true;
 }
 
+bool TestFillHoleWithNearestValidPixel()
+{
+  typedef itk::Image<int, 2> ImageType;
+  ImageType::Pointer image = ImageType::New();
+  CreateImage(image.GetPointer());
+
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  // The hole is every column >= 70, so each hole pixel should get the value of column 69 in its row.
+  ImageType::Pointer original = ImageType::New();
+  ITKHelpers::DeepCopy(image.GetPointer(), original.GetPointer());
+
+  MaskOperations::FillHoleWithNearestValidPixel(image.GetPointer(), mask);
+
+  itk::ImageRegionConstIteratorWithIndex<ImageType> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    itk::Index<2> index = imageIterator.GetIndex();
+    itk::Index<2> expectedSource = index;
+    expectedSource[0] = std::min<itk::IndexValueType>(index[0], 69);
+
+    if(imageIterator.Get() != original->GetPixel(expectedSource))
+    {
+      std::cerr << "FillHoleWithNearestValidPixel: wrong value at " << index << std::endl;
+      return false;
+    }
+    ++imageIterator;
+  }
+
+  return true;
+}
+
+bool TestFindPixelsAcrossHole()
+{
+  // A hole that does not touch the image border, so every walk into it has an exit.
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,100}});
+  MaskTestHelpers::AddHole(mask, {{30,40}}, {{30,25}});
+
+  std::vector<itk::Index<2> > queryPixels;
+  std::vector<ITKHelpers::FloatVector2Type> directions;
+  for(itk::IndexValueType x = 29; x <= 60; ++x)
+  {
+    for(unsigned int directionId = 0; directionId < 8; ++directionId)
+    {
+      const float angle = directionId * 3.14159265f / 8.0f;
+      ITKHelpers::FloatVector2Type direction;
+      direction[0] = std::cos(angle);
+      direction[1] = std::sin(angle);
+
+      itk::Index<2> queryPixel = {{x, 39}};
+      queryPixels.push_back(queryPixel);
+      directions.push_back(direction);
+    }
+  }
+
+  std::vector<itk::Index<2> > pixelsAcrossHole;
+  std::vector<MaskOperations::AcrossHoleStatusEnum> statuses;
+  MaskOperations::FindPixelsAcrossHole(queryPixels, directions, mask, pixelsAcrossHole, statuses);
+
+  for(unsigned int queryId = 0; queryId < queryPixels.size(); ++queryId)
+  {
+    itk::Index<2> expected = MaskOperations::FindPixelAcrossHole(queryPixels[queryId], directions[queryId], mask);
+    if(statuses[queryId] != MaskOperations::AcrossHoleStatusEnum::FOUND || pixelsAcrossHole[queryId] != expected)
+    {
+      std::cerr << "FindPixelsAcrossHole from " << queryPixels[queryId] << " along " << directions[queryId]
+                << " found " << pixelsAcrossHole[queryId] << " but FindPixelAcrossHole found " << expected << std::endl;
+      return false;
+    }
+  }
+
+  // A hole pixel is not a valid query, and a hole that extends to the border has no exit.
+  Mask::Pointer borderMask = Mask::New();
+  CreateMask(borderMask);
+
+  std::vector<itk::Index<2> > badQueryPixels(2);
+  badQueryPixels[0][0] = 80;
+  badQueryPixels[0][1] = 50;
+  badQueryPixels[1][0] = 69;
+  badQueryPixels[1][1] = 50;
+  std::vector<ITKHelpers::FloatVector2Type> badDirections(2);
+  badDirections[0][0] = 1.0f;
+  badDirections[0][1] = 0.0f;
+  badDirections[1] = badDirections[0];
+
+  MaskOperations::FindPixelsAcrossHole(badQueryPixels, badDirections, borderMask, pixelsAcrossHole, statuses);
+  if(statuses[0] != MaskOperations::AcrossHoleStatusEnum::INVALID_QUERY ||
+     statuses[1] != MaskOperations::AcrossHoleStatusEnum::NO_EXIT)
+  {
+    std::cerr << "FindPixelsAcrossHole did not report the invalid query and the missing exit." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestInterpolateHoleAlongRows()
+{
+  // Both linear and cubic interpolation reproduce a linear ramp exactly, along rows (axis 0) and columns (axis 1).
+  for(unsigned int testId = 0; testId < 4; ++testId)
+  {
+    MaskOperations::LineInterpolationEnum interpolation = (testId % 2 == 0) ?
+          MaskOperations::LineInterpolationEnum::LINEAR : MaskOperations::LineInterpolationEnum::CUBIC;
+    const unsigned int axis = testId / 2;
+
+    Mask::Pointer mask = Mask::New();
+    MaskTestHelpers::CreateValidMask(mask, {{100,100}});
+    itk::Index<2> holeCorner = {{20,30}};
+    itk::Size<2> holeSize = {{40,20}};
+    MaskTestHelpers::AddHole(mask, holeCorner, holeSize);
+    const itk::ImageRegion<2> region = mask->GetLargestPossibleRegion();
+
+    typedef itk::Image<float, 2> ImageType;
+    ImageType::Pointer image = ImageType::New();
+    image->SetRegions(region);
+    image->Allocate();
+
+    itk::ImageRegionIteratorWithIndex<ImageType> imageIterator(image, region);
+    while(!imageIterator.IsAtEnd())
+    {
+      imageIterator.Set(mask->IsHole(imageIterator.GetIndex()) ? 0.0f : 2.0f * imageIterator.GetIndex()[axis] + 3.0f);
+      ++imageIterator;
+    }
+
+    mask->AcknowledgeModifiedRegion();
+    if(axis == 0)
+    {
+      MaskOperations::InterpolateHoleAlongRows(image.GetPointer(), mask.GetPointer(), interpolation);
+    }
+    else
+    {
+      MaskOperations::InterpolateHoleAlongColumns(image.GetPointer(), mask.GetPointer(), interpolation);
+    }
+
+    if(mask->GetModifiedRegion() != itk::ImageRegion<2>(holeCorner, holeSize))
+    {
+      std::cerr << "InterpolateHoleAlong axis " << axis << " recorded modified region "
+                << mask->GetModifiedRegion() << std::endl;
+      return false;
+    }
+
+    if(mask->CountHolePixels() != 0)
+    {
+      std::cerr << "InterpolateHoleAlong axis " << axis << " left " << mask->CountHolePixels()
+                << " hole pixels." << std::endl;
+      return false;
+    }
+
+    imageIterator.GoToBegin();
+    while(!imageIterator.IsAtEnd())
+    {
+      if(std::abs(imageIterator.Get() - (2.0f * imageIterator.GetIndex()[axis] + 3.0f)) > 1e-3f)
+      {
+        std::cerr << "InterpolateHoleAlong axis " << axis << ": wrong value " << imageIterator.Get() << " at "
+                  << imageIterator.GetIndex() << std::endl;
+        return false;
+      }
+      ++imageIterator;
+    }
+  }
+
+  return true;
+}
+
+bool TestInterpolateLinesThroughHole()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,100}});
+  const itk::ImageRegion<2> region = mask->GetLargestPossibleRegion();
+
+  // Two holes, so the first line crosses the hole twice.
+  MaskTestHelpers::AddHole(mask, {{20,40}}, {{20,20}});
+  MaskTestHelpers::AddHole(mask, {{60,40}}, {{20,20}});
+
+  typedef itk::Image<float, 2> ImageType;
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+
+  // A ramp along the first line, so the filled values (including the widened band) can be checked.
+  itk::ImageRegionIteratorWithIndex<ImageType> imageIterator(image, region);
+  while(!imageIterator.IsAtEnd())
+  {
+    imageIterator.Set(mask->IsHole(imageIterator.GetIndex()) ? 0.0f : 2.0f * imageIterator.GetIndex()[0] + 3.0f);
+    ++imageIterator;
+  }
+
+  std::vector<std::pair<itk::Index<2>, itk::Index<2> > > lines;
+  itk::Index<2> start = {{5,50}};
+  itk::Index<2> end = {{95,50}};
+  lines.push_back(std::make_pair(start, end));
+  start[0] = 30;
+  start[1] = 5;
+  end[0] = 30;
+  end[1] = 95;
+  lines.push_back(std::make_pair(start, end));
+
+  std::vector<MaskOperations::LineHoleInterval> intervals;
+  MaskOperations::FindHoleIntervalsAlongLine(mask, lines[0].first, lines[0].second, intervals);
+  if(intervals.size() != 2)
+  {
+    std::cerr << "FindHoleIntervalsAlongLine found " << intervals.size() << " intervals instead of 2." << std::endl;
+    return false;
+  }
+
+  const unsigned int lineThickness = 1;
+  mask->AcknowledgeModifiedRegion();
+  MaskOperations::InterpolateLinesThroughHole(image.GetPointer(), mask.GetPointer(), lines,
+                                              MaskOperations::LineInterpolationEnum::LINEAR, lineThickness);
+
+  // The first line fills x = 20..79 of rows 49..51, and the second line fills x = 29..31 of rows 40..59.
+  itk::Index<2> filledCorner = {{20,40}};
+  itk::Size<2> filledSize = {{60,20}};
+  if(mask->GetModifiedRegion() != itk::ImageRegion<2>(filledCorner, filledSize))
+  {
+    std::cerr << "InterpolateLinesThroughHole recorded modified region " << mask->GetModifiedRegion() << std::endl;
+    return false;
+  }
+
+  for(itk::IndexValueType x = 5; x <= 95; ++x)
+  {
+    for(itk::IndexValueType y = 49; y <= 51; ++y)
+    {
+      itk::Index<2> pixel = {{x, y}};
+      if(!mask->IsValid(pixel) || std::abs(image->GetPixel(pixel) - (2.0f * x + 3.0f)) > 1e-3f)
+      {
+        std::cerr << "InterpolateLinesThroughHole: wrong value " << image->GetPixel(pixel) << " at " << pixel
+                  << std::endl;
+        return false;
+      }
+    }
+  }
+
+  itk::Index<2> secondLinePixel = {{30,45}};
+  if(!mask->IsValid(secondLinePixel))
+  {
+    std::cerr << "InterpolateLinesThroughHole did not fill the second line." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestCopySelfPatchIntoHoleOfTargetRegion()
+{
+  typedef itk::Image<int, 2> ImageType;
+  ImageType::Pointer image = ImageType::New();
+  CreateImage(image.GetPointer());
+
+  ImageType::Pointer original = ImageType::New();
+  ITKHelpers::DeepCopy(image.GetPointer(), original.GetPointer());
+
+  // The hole is every column >= 70. The source region overlaps the target region, up and to the left of it,
+  // so the copy must not read pixels it has already written.
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  itk::Index<2> sourceCorner = {{60,20}};
+  itk::Index<2> targetCorner = {{63,22}};
+  itk::Size<2> patchSize = {{15,15}};
+  itk::ImageRegion<2> sourceRegion(sourceCorner, patchSize);
+  itk::ImageRegion<2> targetRegion(targetCorner, patchSize);
+
+  MaskOperations::CopySelfPatchIntoHoleOfTargetRegion(image.GetPointer(), mask, sourceRegion, targetRegion);
+
+  itk::ImageRegionConstIteratorWithIndex<ImageType> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    itk::Index<2> index = imageIterator.GetIndex();
+    int expected = original->GetPixel(index);
+    if(targetRegion.IsInside(index) && mask->IsHole(index))
+    {
+      expected = original->GetPixel(index + (sourceCorner - targetCorner));
+    }
+
+    if(imageIterator.Get() != expected)
+    {
+      std::cerr << "CopySelfPatchIntoHoleOfTargetRegion: wrong value at " << index << std::endl;
+      return false;
+    }
+    ++imageIterator;
+  }
+
+  return true;
+}
+
+bool TestComputeLocalMaskedMoments()
+{
+  typedef itk::Image<float, 2> ImageType;
+  ImageType::Pointer image = ImageType::New();
+  CreateImage(image.GetPointer());
+
+  // Add a hole inside the valid part, so some windows straddle two holes.
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+  itk::Index<2> holeCorner = {{20,30}};
+  itk::Size<2> holeSize = {{12,9}};
+  ITKHelpers::SetRegionToConstant(mask.GetPointer(), itk::ImageRegion<2>(holeCorner, holeSize),
+                                  HoleMaskPixelTypeEnum::HOLE);
+
+  // The region touches the image border, so the windows near it are clipped.
+  const unsigned int radius = 4;
+  itk::Index<2> regionCorner = {{0,25}};
+  itk::Size<2> regionSize = {{80,30}};
+  itk::ImageRegion<2> region(regionCorner, regionSize);
+
+  MaskOperations::LocalCountImageType::Pointer countImage = MaskOperations::LocalCountImageType::New();
+  MaskOperations::LocalMomentImageType::Pointer meanImage = MaskOperations::LocalMomentImageType::New();
+  MaskOperations::LocalMomentImageType::Pointer varianceImage = MaskOperations::LocalMomentImageType::New();
+  MaskOperations::ComputeLocalMaskedMoments(image.GetPointer(), mask, radius, region, countImage.GetPointer(),
+                                            meanImage.GetPointer(), varianceImage.GetPointer());
+
+  if(countImage->GetLargestPossibleRegion() != region || meanImage->GetNumberOfComponentsPerPixel() != 1)
+  {
+    std::cerr << "ComputeLocalMaskedMoments: the outputs were not allocated over the region." << std::endl;
+    return false;
+  }
+
+  itk::ImageRegionConstIteratorWithIndex<MaskOperations::LocalCountImageType> countIterator(countImage, region);
+  while(!countIterator.IsAtEnd())
+  {
+    itk::ImageRegion<2> window = ITKHelpers::GetRegionInRadiusAroundPixel(countIterator.GetIndex(), radius);
+    window.Crop(image->GetLargestPossibleRegion());
+
+    unsigned int count = 0;
+    double sum = 0;
+    double squaredSum = 0;
+    itk::ImageRegionConstIteratorWithIndex<ImageType> imageIterator(image, window);
+    while(!imageIterator.IsAtEnd())
+    {
+      if(mask->IsValid(imageIterator.GetIndex()))
+      {
+        count++;
+        sum += imageIterator.Get();
+        squaredSum += imageIterator.Get() * imageIterator.Get();
+      }
+      ++imageIterator;
+    }
+
+    const double mean = (count == 0) ? 0 : sum / count;
+    const double variance = (count == 0) ? 0 : squaredSum / count - mean * mean;
+    if(countIterator.Get() != count ||
+       std::abs(meanImage->GetPixel(countIterator.GetIndex())[0] - mean) > 1e-3 ||
+       std::abs(varianceImage->GetPixel(countIterator.GetIndex())[0] - variance) > 1e-2)
+    {
+      std::cerr << "ComputeLocalMaskedMoments: wrong moments at " << countIterator.GetIndex() << std::endl;
+      return false;
+    }
+    ++countIterator;
+  }
+
+  return true;
+}
+
+bool TestComputeLocalMaskedMomentsLargeValues()
+{
+  // A checkerboard of 1e7 and 1e7 + 1. E[x^2] is about 1e14, so computing E[x^2] - E[x]^2 directly would lose
+  // the variance (about 0.25) to rounding.
+  typedef itk::Image<float, 2> ImageType;
+  ImageType::Pointer image = ImageType::New();
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{40,30}};
+  itk::ImageRegion<2> region(corner, size);
+  image->SetRegions(region);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> imageIterator(image, region);
+  while(!imageIterator.IsAtEnd())
+  {
+    imageIterator.Set(1e7f + static_cast<float>((imageIterator.GetIndex()[0] + imageIterator.GetIndex()[1]) % 2));
+    ++imageIterator;
+  }
+
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, size);
+  MaskTestHelpers::AddHole(mask, {{10,10}}, {{7,5}});
+
+  const unsigned int radius = 2;
+  MaskOperations::LocalMomentImageType::Pointer varianceImage = MaskOperations::LocalMomentImageType::New();
+  MaskOperations::ComputeLocalMaskedMoments(image.GetPointer(), mask, radius, nullptr, nullptr,
+                                            varianceImage.GetPointer());
+
+  itk::ImageRegionConstIteratorWithIndex<MaskOperations::LocalMomentImageType> varianceIterator(varianceImage, region);
+  while(!varianceIterator.IsAtEnd())
+  {
+    itk::ImageRegion<2> window = ITKHelpers::GetRegionInRadiusAroundPixel(varianceIterator.GetIndex(), radius);
+    window.Crop(region);
+
+    // The fraction of the valid pixels that are 1e7 + 1.
+    unsigned int count = 0;
+    unsigned int numberOfOnes = 0;
+    itk::ImageRegionConstIteratorWithIndex<ImageType> windowIterator(image, window);
+    while(!windowIterator.IsAtEnd())
+    {
+      if(mask->IsValid(windowIterator.GetIndex()))
+      {
+        count++;
+        numberOfOnes += (windowIterator.GetIndex()[0] + windowIterator.GetIndex()[1]) % 2;
+      }
+      ++windowIterator;
+    }
+
+    const double fraction = (count == 0) ? 0 : static_cast<double>(numberOfOnes) / count;
+    const double variance = fraction * (1 - fraction);
+    if(std::abs(varianceIterator.Get()[0] - variance) > 1e-3)
+    {
+      std::cerr << "ComputeLocalMaskedMoments: variance " << varianceIterator.Get()[0] << " at "
+                << varianceIterator.GetIndex() << ", expected " << variance << std::endl;
+      return false;
+    }
+    ++varianceIterator;
+  }
+
+  return true;
+}
+
+bool TestAverageNeighborValues()
+{
+  typedef itk::Image<float, 2> ImageType;
+  ImageType::Pointer image = ImageType::New();
+  CreateImage(image.GetPointer());
+
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+  itk::Index<2> holeCorner = {{20,30}};
+  itk::Size<2> holeSize = {{12,9}};
+  ITKHelpers::SetRegionToConstant(mask.GetPointer(), itk::ImageRegion<2>(holeCorner, holeSize),
+                                  HoleMaskPixelTypeEnum::HOLE);
+
+  itk::Index<2> regionCorner = {{10,0}};
+  itk::Size<2> regionSize = {{90,45}};
+  itk::ImageRegion<2> region(regionCorner, regionSize);
+
+  ImageType::Pointer averages = ImageType::New();
+  MaskOperations::AverageNeighborValues(image.GetPointer(), mask, HoleMaskPixelTypeEnum::VALID, region,
+                                        averages.GetPointer());
+
+  ImageType::Pointer boundaryAverages = ImageType::New();
+  MaskOperations::AverageNeighborValues(image.GetPointer(), mask, HoleMaskPixelTypeEnum::VALID, region,
+                                        boundaryAverages.GetPointer(), true);
+
+  std::vector<itk::Index<2> > boundaryPixels = mask->FindBoundaryPixelsInRegion(region, HoleMaskPixelTypeEnum::HOLE);
+
+  itk::ImageRegionConstIteratorWithIndex<ImageType> averageIterator(averages, region);
+  while(!averageIterator.IsAtEnd())
+  {
+    const itk::Index<2> index = averageIterator.GetIndex();
+    bool hasValidNeighbor = false;
+    std::vector<itk::Index<2> > neighbors = ITKHelpers::Get8NeighborsInRegion(image->GetLargestPossibleRegion(), index);
+    for(unsigned int i = 0; i < neighbors.size(); ++i)
+    {
+      hasValidNeighbor |= mask->IsValid(neighbors[i]);
+    }
+
+    const float expected = hasValidNeighbor ?
+          MaskOperations::AverageValidNeighborValue(image.GetPointer(), mask, index) : 0.0f;
+    const float expectedOnBoundary = std::count(boundaryPixels.begin(), boundaryPixels.end(), index) ? expected : 0.0f;
+    if(std::abs(averageIterator.Get() - expected) > 1e-3 ||
+       std::abs(boundaryAverages->GetPixel(index) - expectedOnBoundary) > 1e-3)
+    {
+      std::cerr << "AverageNeighborValues: wrong average at " << index << std::endl;
+      return false;
+    }
+    ++averageIterator;
+  }
+
+  return true;
+}
 
 ////////////////////////
 ////// Test Helpers ////
@@ -0,0 +1,307 @@
+#include "Mask.h"
+#include "MaskPatchDistance.h"
+#include "MaskTestHelpers.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// ITK
+#include "itkImageRegionIterator.h"
+#include "itkVectorImage.h"
+
+// STL
+#include <cmath>
+
+typedef itk::Image<float, 2> FloatImageType;
+typedef itk::Image<unsigned char, 2> UnsignedCharImageType;
+typedef itk::Image<int, 2> IntImageType;
+typedef itk::VectorImage<float, 2> VectorImageType;
+
+static bool TestScalarImages();
+static bool TestVectorImage();
+static bool TestWideIntegerImage();
+static bool TestTargetMasks();
+static bool TestEarlyTermination();
+
+// Test helpers
+template <typename TImage>
+static void CreateImage(TImage* const image);
+
+static void CreateImage(VectorImageType* const image);
+
+template <typename TImage>
+static bool CheckDistances(const TImage* const image, const Mask* const mask,
+                           const itk::ImageRegion<2>& targetRegion, const itk::ImageRegion<2>& sourceRegion);
+
+int main()
+{
+  bool allPass = true;
+  allPass &= TestScalarImages();
+  allPass &= TestVectorImage();
+  allPass &= TestWideIntegerImage();
+  allPass &= TestTargetMasks();
+  allPass &= TestEarlyTermination();
+
+  if(allPass)
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
+
+/** Regions of several widths (so both the vector and the remainder parts of the kernels are used)
+  * overlapping the hole.*/
+static std::vector<itk::ImageRegion<2> > GetTargetRegions()
+{
+  std::vector<itk::ImageRegion<2> > targetRegions;
+  for(unsigned int patchRadius = 1; patchRadius <= 6; ++patchRadius)
+  {
+    itk::Index<2> center = {{38 + static_cast<itk::IndexValueType>(patchRadius), 22}};
+    targetRegions.push_back(ITKHelpers::GetRegionInRadiusAroundPixel(center, patchRadius));
+  }
+  return targetRegions;
+}
+
+bool TestScalarImages()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  FloatImageType::Pointer floatImage = FloatImageType::New();
+  CreateImage(floatImage.GetPointer());
+
+  UnsignedCharImageType::Pointer unsignedCharImage = UnsignedCharImageType::New();
+  CreateImage(unsignedCharImage.GetPointer());
+
+  for(const itk::ImageRegion<2>& targetRegion : GetTargetRegions())
+  {
+    itk::Index<2> sourceCorner = {{3, 7}};
+    itk::ImageRegion<2> sourceRegion(sourceCorner, targetRegion.GetSize());
+    if(!CheckDistances(floatImage.GetPointer(), mask, targetRegion, sourceRegion) ||
+       !CheckDistances(unsignedCharImage.GetPointer(), mask, targetRegion, sourceRegion))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool TestVectorImage()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  VectorImageType::Pointer image = VectorImageType::New();
+  CreateImage(image.GetPointer());
+
+  for(const itk::ImageRegion<2>& targetRegion : GetTargetRegions())
+  {
+    itk::Index<2> sourceCorner = {{60, 31}};
+    itk::ImageRegion<2> sourceRegion(sourceCorner, targetRegion.GetSize());
+    if(!CheckDistances(image.GetPointer(), mask, targetRegion, sourceRegion))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool TestWideIntegerImage()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  // Values above 2^24 are not exact in float, so this checks that the target values are packed as double.
+  IntImageType::Pointer image = IntImageType::New();
+  CreateImage(image.GetPointer());
+  itk::ImageRegionIterator<IntImageType> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    imageIterator.Set(imageIterator.Get() + 16777216);
+    ++imageIterator;
+  }
+
+  for(const itk::ImageRegion<2>& targetRegion : GetTargetRegions())
+  {
+    itk::Index<2> sourceCorner = {{3, 7}};
+    itk::ImageRegion<2> sourceRegion(sourceCorner, targetRegion.GetSize());
+    if(!CheckDistances(image.GetPointer(), mask, targetRegion, sourceRegion))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool TestTargetMasks()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  FloatImageType::Pointer image = FloatImageType::New();
+  CreateImage(image.GetPointer());
+
+  itk::Index<2> targetCenter = {{42, 21}};
+  itk::ImageRegion<2> targetRegion = ITKHelpers::GetRegionInRadiusAroundPixel(targetCenter, 4);
+  itk::Index<2> sourceCorner = {{10, 10}};
+  itk::ImageRegion<2> sourceRegion(sourceCorner, targetRegion.GetSize());
+
+  // The valid pixels of the target region as a byte mask and as an offset list.
+  std::vector<unsigned char> targetPixelMask;
+  itk::ImageRegionConstIterator<Mask> maskIterator(mask, targetRegion);
+  while(!maskIterator.IsAtEnd())
+  {
+    targetPixelMask.push_back(mask->IsValid(maskIterator.GetIndex()));
+    ++maskIterator;
+  }
+
+  std::vector<itk::Offset<2> > targetOffsets = mask->GetValidOffsetsInRegion(targetRegion);
+
+  MaskPatchDistance<FloatImageType> maskDistance(image, mask, targetRegion);
+  MaskPatchDistance<FloatImageType> pixelMaskDistance(image, targetRegion, targetPixelMask);
+  MaskPatchDistance<FloatImageType> offsetDistance(image, targetRegion, targetOffsets);
+
+  const double expected = maskDistance.ComputeSSD(image, sourceRegion);
+  if(pixelMaskDistance.GetNumberOfComparedPixels() != maskDistance.GetNumberOfComparedPixels() ||
+     offsetDistance.GetNumberOfComparedPixels() != maskDistance.GetNumberOfComparedPixels() ||
+     pixelMaskDistance.ComputeSSD(image, sourceRegion) != expected ||
+     offsetDistance.ComputeSSD(image, sourceRegion) != expected)
+  {
+    std::cerr << "The pixel mask and offset list target masks should give the same distance as the Mask." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestEarlyTermination()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  FloatImageType::Pointer image = FloatImageType::New();
+  CreateImage(image.GetPointer());
+
+  itk::Index<2> targetCenter = {{20, 20}};
+  itk::ImageRegion<2> targetRegion = ITKHelpers::GetRegionInRadiusAroundPixel(targetCenter, 5);
+  itk::Index<2> sourceCorner = {{70, 5}};
+  itk::ImageRegion<2> sourceRegion(sourceCorner, targetRegion.GetSize());
+
+  MaskPatchDistance<FloatImageType> patchDistance(image, mask, targetRegion);
+  const double distance = patchDistance.ComputeSSD(image, sourceRegion);
+  const double bound = distance / 4;
+  const double boundedDistance = patchDistance.ComputeSSD(image, sourceRegion, bound);
+  if(!(boundedDistance > bound) || !(boundedDistance < distance))
+  {
+    std::cerr << "The bounded distance " << boundedDistance << " should exceed the bound " << bound
+              << " and stop before the full distance " << distance << std::endl;
+    return false;
+  }
+
+  if(patchDistance.ComputeSSD(image, sourceRegion, distance) != distance)
+  {
+    std::cerr << "A bound equal to the distance should not terminate early." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////
+////// Test Helpers ////
+////////////////////////
+
+template <typename TImage>
+void CreateImage(TImage* const image)
+{
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{100,50}};
+  itk::ImageRegion<2> imageRegion(corner, size);
+  image->SetRegions(imageRegion);
+  image->Allocate();
+
+  itk::ImageRegionIterator<TImage> imageIterator(image, imageRegion);
+  while(!imageIterator.IsAtEnd())
+  {
+    const itk::Index<2> index = imageIterator.GetIndex();
+    imageIterator.Set((index[0] * 37 + index[1] * 11) % 251);
+    ++imageIterator;
+  }
+}
+
+void CreateImage(VectorImageType* const image)
+{
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{100,50}};
+  itk::ImageRegion<2> imageRegion(corner, size);
+  image->SetRegions(imageRegion);
+  image->SetNumberOfComponentsPerPixel(3);
+  image->Allocate();
+
+  itk::ImageRegionIterator<VectorImageType> imageIterator(image, imageRegion);
+  while(!imageIterator.IsAtEnd())
+  {
+    const itk::Index<2> index = imageIterator.GetIndex();
+    VectorImageType::PixelType pixel(3);
+    for(unsigned int component = 0; component < 3; ++component)
+    {
+      pixel[component] = 0.5f * ((index[0] * 37 + index[1] * 11 + component * 53) % 251);
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+}
+
+template <typename TImage>
+bool CheckDistances(const TImage* const image, const Mask* const mask,
+                    const itk::ImageRegion<2>& targetRegion, const itk::ImageRegion<2>& sourceRegion)
+{
+  // Compute the distances directly.
+  double expectedSSD = 0;
+  double expectedSAD = 0;
+  const unsigned int numberOfComponents = image->GetNumberOfComponentsPerPixel();
+  itk::ImageRegionConstIterator<TImage> targetIterator(image, targetRegion);
+  itk::ImageRegionConstIterator<TImage> sourceIterator(image, sourceRegion);
+  while(!targetIterator.IsAtEnd())
+  {
+    if(mask->IsValid(targetIterator.GetIndex()))
+    {
+      const typename TImage::InternalPixelType* targetValues =
+          image->GetBufferPointer() + image->ComputeOffset(targetIterator.GetIndex()) * numberOfComponents;
+      const typename TImage::InternalPixelType* sourceValues =
+          image->GetBufferPointer() + image->ComputeOffset(sourceIterator.GetIndex()) * numberOfComponents;
+      for(unsigned int component = 0; component < numberOfComponents; ++component)
+      {
+        const double difference = static_cast<double>(sourceValues[component]) - targetValues[component];
+        expectedSSD += difference * difference;
+        expectedSAD += std::abs(difference);
+      }
+    }
+    ++targetIterator;
+    ++sourceIterator;
+  }
+
+  MaskPatchDistance<TImage> patchDistance(image, mask, targetRegion);
+  const double ssd = patchDistance.ComputeSSD(image, sourceRegion);
+  const double sad = patchDistance.Compute(PatchDistanceEnum::SAD, image, sourceRegion);
+  if(std::abs(ssd - expectedSSD) > 1e-5 * expectedSSD || std::abs(sad - expectedSAD) > 1e-5 * expectedSAD)
+  {
+    std::cerr << "Distances for target " << targetRegion << " and source " << sourceRegion
+              << " are SSD " << ssd << " and SAD " << sad
+              << ", expected " << expectedSSD << " and " << expectedSAD << std::endl;
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,243 @@
+#include "Mask.h"
+#include "MaskPatchMatch.h"
+#include "MaskTestHelpers.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// ITK
+#include "itkImageRegionIterator.h"
+
+typedef itk::Image<float, 2> ImageType;
+
+static bool TestFieldIsValid();
+static bool TestIndependentOfThreads();
+static bool TestIterationsImproveField();
+static bool TestWarmStart();
+
+// Test helpers
+static void CreateImage(ImageType* const image);
+static double TotalDistance(const MaskPatchMatch<ImageType>& patchMatch);
+
+int main()
+{
+  bool allPass = true;
+  allPass &= TestFieldIsValid();
+  allPass &= TestIndependentOfThreads();
+  allPass &= TestIterationsImproveField();
+  allPass &= TestWarmStart();
+
+  if(allPass)
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
+
+bool TestFieldIsValid()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  ImageType::Pointer image = ImageType::New();
+  CreateImage(image);
+
+  const unsigned int patchRadius = 3;
+  MaskPatchMatch<ImageType> patchMatch(image.GetPointer(), mask, patchRadius);
+  patchMatch.SetRandomState(MaskRandomState(7));
+  patchMatch.SetNumberOfIterations(3);
+  if(patchMatch.Compute() != 3)
+  {
+    std::cerr << "Compute() should run all iterations without a time budget." << std::endl;
+    return false;
+  }
+
+  // The hole is 20x10 at (40,20), so the patches overlapping it are centered in a 26x16 region at (37,17).
+  itk::Index<2> expectedCorner = {{37, 17}};
+  itk::Size<2> expectedSize = {{26, 16}};
+  if(patchMatch.GetTargetRegion() != itk::ImageRegion<2>(expectedCorner, expectedSize))
+  {
+    std::cerr << "Wrong target region " << patchMatch.GetTargetRegion() << std::endl;
+    return false;
+  }
+
+  itk::ImageRegionConstIteratorWithIndex<Mask> targetIterator(mask, patchMatch.GetTargetRegion());
+  while(!targetIterator.IsAtEnd())
+  {
+    const itk::Index<2> targetCenter = targetIterator.GetIndex();
+    const itk::ImageRegion<2> sourcePatch = patchMatch.GetSourcePatch(targetCenter);
+    if(!mask->GetLargestPossibleRegion().IsInside(sourcePatch) || !mask->IsValid(sourcePatch))
+    {
+      std::cerr << "Source patch " << sourcePatch << " is not fully valid." << std::endl;
+      return false;
+    }
+
+    MaskPatchDistance<ImageType> patchDistance(image, mask, ITKHelpers::GetRegionInRadiusAroundPixel(targetCenter, patchRadius));
+    if(patchDistance.ComputeSSD(image, sourcePatch) != patchMatch.GetDistance(targetCenter))
+    {
+      std::cerr << "The stored distance of " << targetCenter << " does not match its source patch." << std::endl;
+      return false;
+    }
+    ++targetIterator;
+  }
+
+  return true;
+}
+
+bool TestIndependentOfThreads()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  ImageType::Pointer image = ImageType::New();
+  CreateImage(image);
+
+  MaskPatchMatch<ImageType> singleThreaded(image.GetPointer(), mask, 2);
+  singleThreaded.SetRandomState(MaskRandomState(11));
+  singleThreaded.SetNumberOfThreads(1);
+  singleThreaded.Compute();
+
+  MaskPatchMatch<ImageType> multiThreaded(image.GetPointer(), mask, 2);
+  multiThreaded.SetRandomState(MaskRandomState(11));
+  multiThreaded.SetNumberOfThreads(4);
+  multiThreaded.Compute();
+
+  itk::ImageRegionConstIteratorWithIndex<Mask> targetIterator(mask, singleThreaded.GetTargetRegion());
+  while(!targetIterator.IsAtEnd())
+  {
+    if(singleThreaded.GetSourceCenter(targetIterator.GetIndex()) != multiThreaded.GetSourceCenter(targetIterator.GetIndex()))
+    {
+      std::cerr << "The fields computed with 1 and 4 threads differ at " << targetIterator.GetIndex() << std::endl;
+      return false;
+    }
+    ++targetIterator;
+  }
+
+  return true;
+}
+
+bool TestIterationsImproveField()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  ImageType::Pointer image = ImageType::New();
+  CreateImage(image);
+
+  MaskPatchMatch<ImageType> patchMatch(image.GetPointer(), mask, 2);
+  patchMatch.SetRandomState(MaskRandomState(3));
+  patchMatch.Initialize();
+  const double initialDistance = TotalDistance(patchMatch);
+
+  patchMatch.SetNumberOfIterations(4);
+  patchMatch.Compute();
+  const double finalDistance = TotalDistance(patchMatch);
+
+  // The image repeats every 10 pixels, so perfect matches exist and propagation spreads them quickly.
+  if(!(finalDistance < 0.1 * initialDistance))
+  {
+    std::cerr << "The total distance only went from " << initialDistance << " to " << finalDistance << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestWarmStart()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  ImageType::Pointer image = ImageType::New();
+  CreateImage(image);
+
+  MaskPatchMatch<ImageType> patchMatch(image.GetPointer(), mask, 2);
+  patchMatch.SetRandomState(MaskRandomState(5));
+  patchMatch.Compute();
+  const double distanceBefore = TotalDistance(patchMatch);
+
+  // Grow the hole over part of the image that source patches were taken from.
+  itk::Index<2> newHoleCorner = {{0, 0}};
+  itk::Size<2> newHoleSize = {{30, 50}};
+  ITKHelpers::SetRegionToConstant(mask.GetPointer(), itk::ImageRegion<2>(newHoleCorner, newHoleSize),
+                                  HoleMaskPixelTypeEnum::HOLE);
+  mask->Modified();
+
+  MaskPatchMatch<ImageType> warmStarted(image.GetPointer(), mask, 2, patchMatch.GetTargetRegion());
+  warmStarted.SetRandomState(MaskRandomState(5));
+  warmStarted.Initialize(patchMatch);
+
+  itk::ImageRegionConstIteratorWithIndex<Mask> targetIterator(mask, warmStarted.GetTargetRegion());
+  while(!targetIterator.IsAtEnd())
+  {
+    const itk::Index<2> targetCenter = targetIterator.GetIndex();
+    const itk::ImageRegion<2> sourcePatch = warmStarted.GetSourcePatch(targetCenter);
+    if(!mask->IsValid(sourcePatch))
+    {
+      std::cerr << "Warm start kept the source patch " << sourcePatch << " that is no longer valid." << std::endl;
+      return false;
+    }
+    if(mask->IsValid(patchMatch.GetSourcePatch(targetCenter)) &&
+       sourcePatch != patchMatch.GetSourcePatch(targetCenter))
+    {
+      std::cerr << "Warm start replaced the still valid source patch of " << targetCenter << std::endl;
+      return false;
+    }
+    ++targetIterator;
+  }
+
+  // The previous field is still mostly good, so it should stay far better than a random one.
+  MaskPatchMatch<ImageType> coldStarted(image.GetPointer(), mask, 2, patchMatch.GetTargetRegion());
+  coldStarted.SetRandomState(MaskRandomState(5));
+  coldStarted.Initialize();
+  if(!(TotalDistance(warmStarted) < TotalDistance(coldStarted)) || !(distanceBefore < TotalDistance(coldStarted)))
+  {
+    std::cerr << "The warm started field should be better than a random one." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////
+////// Test Helpers ////
+////////////////////////
+
+void CreateImage(ImageType* const image)
+{
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{100,50}};
+  itk::ImageRegion<2> imageRegion(corner, size);
+  image->SetRegions(imageRegion);
+  image->Allocate();
+
+  itk::ImageRegionIterator<ImageType> imageIterator(image, imageRegion);
+  while(!imageIterator.IsAtEnd())
+  {
+    const itk::Index<2> index = imageIterator.GetIndex();
+    imageIterator.Set((index[0] % 10) * 10 + (index[1] % 10));
+    ++imageIterator;
+  }
+}
+
+double TotalDistance(const MaskPatchMatch<ImageType>& patchMatch)
+{
+  double totalDistance = 0;
+  const itk::ImageRegion<2> targetRegion = patchMatch.GetTargetRegion();
+  for(itk::IndexValueType y = targetRegion.GetIndex()[1]; y < targetRegion.GetUpperIndex()[1] + 1; ++y)
+  {
+    for(itk::IndexValueType x = targetRegion.GetIndex()[0]; x < targetRegion.GetUpperIndex()[0] + 1; ++x)
+    {
+      itk::Index<2> targetCenter = {{x, y}};
+      totalDistance += patchMatch.GetDistance(targetCenter);
+    }
+  }
+  return totalDistance;
+}
@@ -0,0 +1,257 @@
+#include "Mask.h"
+#include "MaskOperations.h"
+#include "MaskPatchSampler.h"
+#include "MaskRandomState.h"
+#include "MaskTestHelpers.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// STL
+#include <cstdlib>
+#include <map>
+
+static bool TestDrawValidPatches();
+static bool TestDrawHolePatches();
+static bool TestEmptySampler();
+static bool TestCachedSampler();
+static bool TestCachedRegionSampler();
+
+int main()
+{
+  bool allPass = true;
+  allPass &= TestDrawValidPatches();
+  allPass &= TestDrawHolePatches();
+  allPass &= TestEmptySampler();
+  allPass &= TestCachedSampler();
+  allPass &= TestCachedRegionSampler();
+
+  if(allPass)
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
+
+bool TestDrawValidPatches()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  const unsigned int patchRadius = 2;
+  itk::Index<2> searchCorner = {{5,5}};
+  itk::Size<2> searchSize = {{80,30}};
+  itk::ImageRegion<2> searchRegion(searchCorner, searchSize);
+
+  MaskPatchSampler sampler(mask, HoleMaskPixelTypeEnum::VALID, patchRadius, searchRegion);
+
+  std::vector<itk::ImageRegion<2> > allPatches =
+      MaskOperations::GetAllFullyValidRegions(mask, searchRegion, patchRadius);
+  if(sampler.GetNumberOfPatches() != allPatches.size())
+  {
+    std::cerr << "Sampler has " << sampler.GetNumberOfPatches() << " patches but there are "
+              << allPatches.size() << " valid patches in the search region." << std::endl;
+    return false;
+  }
+
+  for(unsigned int i = 0; i < 1000; ++i)
+  {
+    itk::ImageRegion<2> patch = sampler.DrawPatch();
+    if(!searchRegion.IsInside(patch) || !mask->IsValid(patch))
+    {
+      std::cerr << "Drew a patch that is not valid or not in the search region: " << patch << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool TestDrawHolePatches()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  const unsigned int patchRadius = 4;
+  MaskPatchSampler sampler(mask, HoleMaskPixelTypeEnum::HOLE, patchRadius);
+
+  // The hole is a 20x10 rectangle, so there are (20 - 8) * (10 - 8) hole patches of radius 4.
+  if(sampler.GetNumberOfPatches() != 12 * 2)
+  {
+    std::cerr << "Sampler has " << sampler.GetNumberOfPatches() << " hole patches, expected 24." << std::endl;
+    return false;
+  }
+
+  // Every patch is equally likely, so with a fixed seed each of the 24 patches is drawn close to
+  // 1000 times in 24000 draws (the standard deviation is about 31).
+  MaskRandomState randomState(2012);
+  const unsigned int numberOfDraws = 24000;
+  std::map<std::pair<itk::IndexValueType, itk::IndexValueType>, unsigned int> drawCounts;
+  for(unsigned int i = 0; i < numberOfDraws; ++i)
+  {
+    itk::ImageRegion<2> patch = sampler.DrawPatch(randomState);
+    if(!mask->IsHole(patch))
+    {
+      std::cerr << "Drew a patch that is not entirely hole: " << patch << std::endl;
+      return false;
+    }
+    drawCounts[std::make_pair(patch.GetIndex()[0], patch.GetIndex()[1])]++;
+  }
+
+  if(drawCounts.size() != sampler.GetNumberOfPatches())
+  {
+    std::cerr << "Only " << drawCounts.size() << " of the hole patches were ever drawn." << std::endl;
+    return false;
+  }
+
+  const int expectedCount = numberOfDraws / 24;
+  for(std::map<std::pair<itk::IndexValueType, itk::IndexValueType>, unsigned int>::const_iterator iterator =
+        drawCounts.begin(); iterator != drawCounts.end(); ++iterator)
+  {
+    if(std::abs(static_cast<int>(iterator->second) - expectedCount) > 150)
+    {
+      std::cerr << "The patch with corner (" << iterator->first.first << ", " << iterator->first.second
+                << ") was drawn " << iterator->second << " times, expected about " << expectedCount << "." << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool TestEmptySampler()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  // The hole is only 10 pixels tall, so there are no hole patches of radius 5.
+  MaskPatchSampler sampler(mask, HoleMaskPixelTypeEnum::HOLE, 5);
+  if(!sampler.IsEmpty())
+  {
+    std::cerr << "Sampler should be empty." << std::endl;
+    return false;
+  }
+
+  if(MaskOperations::RandomRegionInsideHole(mask, 5).GetNumberOfPixels() != 0)
+  {
+    std::cerr << "RandomRegionInsideHole should return an empty region." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestCachedSampler()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{40,30}});
+  MaskTestHelpers::AddHole(mask, {{10,10}}, {{12,12}});
+
+  // The sampler is built once per radius and reused until the mask is modified.
+  std::shared_ptr<const MaskPatchSampler> sampler = mask->GetPatchSampler(HoleMaskPixelTypeEnum::HOLE, 3);
+  if(mask->GetPatchSampler(HoleMaskPixelTypeEnum::HOLE, 3) != sampler)
+  {
+    std::cerr << "GetPatchSampler should return the cached sampler." << std::endl;
+    return false;
+  }
+
+  // A 12x12 hole has 6 * 6 hole patches of radius 3.
+  if(sampler->GetNumberOfPatches() != 36)
+  {
+    std::cerr << "Sampler has " << sampler->GetNumberOfPatches() << " hole patches, expected 36." << std::endl;
+    return false;
+  }
+
+  MaskTestHelpers::AddHole(mask, {{10,10}}, {{20,12}});
+  std::shared_ptr<const MaskPatchSampler> modifiedSampler = mask->GetPatchSampler(HoleMaskPixelTypeEnum::HOLE, 3);
+  if(modifiedSampler == sampler || modifiedSampler->GetNumberOfPatches() != 14 * 6)
+  {
+    std::cerr << "GetPatchSampler should rebuild the sampler after the mask is modified." << std::endl;
+    return false;
+  }
+
+  MaskRandomState randomState(2012);
+  for(unsigned int i = 0; i < 100; ++i)
+  {
+    itk::ImageRegion<2> patch = MaskOperations::RandomRegionInsideHole(mask, 3, randomState);
+    if(!mask->IsHole(patch))
+    {
+      std::cerr << "RandomRegionInsideHole drew a patch that is not entirely hole: " << patch << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool TestCachedRegionSampler()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{40,30}});
+  MaskTestHelpers::AddHole(mask, {{10,10}}, {{12,12}});
+
+  const unsigned int patchRadius = 2;
+  itk::Index<2> searchCorner = {{0,0}};
+  itk::Size<2> searchSize = {{20,30}};
+  itk::ImageRegion<2> searchRegion(searchCorner, searchSize);
+
+  // The sampler of a region is built once and reused until the mask is modified.
+  std::shared_ptr<const MaskPatchSampler> sampler =
+      mask->GetPatchSampler(HoleMaskPixelTypeEnum::VALID, patchRadius, searchRegion);
+  if(mask->GetPatchSampler(HoleMaskPixelTypeEnum::VALID, patchRadius, searchRegion) != sampler)
+  {
+    std::cerr << "GetPatchSampler should return the cached sampler of the region." << std::endl;
+    return false;
+  }
+
+  if(sampler->GetNumberOfPatches() !=
+     MaskOperations::GetAllFullyValidRegions(mask, searchRegion, patchRadius).size())
+  {
+    std::cerr << "Region sampler has " << sampler->GetNumberOfPatches() << " patches, expected "
+              << MaskOperations::GetAllFullyValidRegions(mask, searchRegion, patchRadius).size() << std::endl;
+    return false;
+  }
+
+  itk::Index<2> otherCorner = {{20,0}};
+  itk::ImageRegion<2> otherRegion(otherCorner, searchSize);
+  if(mask->GetPatchSampler(HoleMaskPixelTypeEnum::VALID, patchRadius, otherRegion) == sampler)
+  {
+    std::cerr << "GetPatchSampler should not share a sampler between regions." << std::endl;
+    return false;
+  }
+
+  MaskRandomState randomState(2012);
+  for(unsigned int i = 0; i < 100; ++i)
+  {
+    itk::ImageRegion<2> patch = MaskOperations::GetRandomValidPatchInRegion(mask, searchRegion, patchRadius,
+                                                                            randomState);
+    if(!searchRegion.IsInside(patch) || !mask->IsValid(patch))
+    {
+      std::cerr << "GetRandomValidPatchInRegion drew an invalid patch: " << patch << std::endl;
+      return false;
+    }
+  }
+
+  MaskTestHelpers::AddHole(mask, {{0,0}}, {{20,30}});
+  std::shared_ptr<const MaskPatchSampler> modifiedSampler =
+      mask->GetPatchSampler(HoleMaskPixelTypeEnum::VALID, patchRadius, searchRegion);
+  if(modifiedSampler == sampler || !modifiedSampler->IsEmpty())
+  {
+    std::cerr << "GetPatchSampler should rebuild the region sampler after the mask is modified." << std::endl;
+    return false;
+  }
+
+  if(MaskOperations::GetRandomValidPatchInRegion(mask, searchRegion, patchRadius).GetNumberOfPixels() != 0)
+  {
+    std::cerr << "GetRandomValidPatchInRegion should return an empty region when the region is all hole." << std::endl;
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,160 @@
+#include "Mask.h"
+#include "MaskOperations.h"
+#include "MaskPatchSearch.h"
+#include "MaskTestHelpers.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// ITK
+#include "itkImageRegionIterator.h"
+
+// STL
+#include <algorithm>
+
+typedef itk::Image<float, 2> ImageType;
+
+static bool TestMatchesBruteForce();
+static bool TestFewerCandidatesThanK();
+
+// Test helpers
+static void CreateImage(ImageType* const image);
+
+int main()
+{
+  bool allPass = true;
+  allPass &= TestMatchesBruteForce();
+  allPass &= TestFewerCandidatesThanK();
+
+  if(allPass)
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
+
+bool TestMatchesBruteForce()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  ImageType::Pointer image = ImageType::New();
+  CreateImage(image);
+
+  const unsigned int patchRadius = 3;
+  const unsigned int k = 5;
+  std::vector<itk::ImageRegion<2> > targetRegions;
+  for(itk::IndexValueType x = 38; x < 64; x += 5)
+  {
+    itk::Index<2> targetCenter = {{x, 19}};
+    targetRegions.push_back(ITKHelpers::GetRegionInRadiusAroundPixel(targetCenter, patchRadius));
+  }
+
+  itk::Index<2> searchCorner = {{0, 0}};
+  itk::Size<2> searchSize = {{70, 40}};
+  itk::ImageRegion<2> searchRegion(searchCorner, searchSize);
+
+  const std::vector<itk::ImageRegion<2> > sourceRegions =
+      MaskOperations::GetAllFullyValidRegions(mask, searchRegion, patchRadius);
+
+  for(unsigned int numberOfThreads = 1; numberOfThreads <= 4; numberOfThreads *= 2)
+  {
+    std::vector<MaskPatchSearch::MatchListType> matches =
+        MaskPatchSearch::FindBestSourcePatches(image.GetPointer(), mask, targetRegions, searchRegion, k,
+                                               PatchDistanceEnum::SSD, numberOfThreads);
+
+    for(unsigned int targetId = 0; targetId < targetRegions.size(); ++targetId)
+    {
+      // Compare every source patch without a bound, keeping the first of equally distant patches.
+      MaskPatchDistance<ImageType> patchDistance(image, mask, targetRegions[targetId]);
+      std::vector<MaskPatchSearch::Match> allMatches;
+      for(const itk::ImageRegion<2>& sourceRegion : sourceRegions)
+      {
+        MaskPatchSearch::Match match;
+        match.Region = sourceRegion;
+        match.Distance = patchDistance.ComputeSSD(image, sourceRegion);
+        allMatches.push_back(match);
+      }
+      std::stable_sort(allMatches.begin(), allMatches.end(),
+                       [](const MaskPatchSearch::Match& a, const MaskPatchSearch::Match& b)
+                       {
+                         return a.Distance < b.Distance;
+                       });
+
+      if(matches[targetId].size() != k)
+      {
+        std::cerr << "Found " << matches[targetId].size() << " matches, expected " << k << std::endl;
+        return false;
+      }
+
+      for(unsigned int matchId = 0; matchId < k; ++matchId)
+      {
+        if(matches[targetId][matchId].Region != allMatches[matchId].Region ||
+           matches[targetId][matchId].Distance != allMatches[matchId].Distance)
+        {
+          std::cerr << "With " << numberOfThreads << " threads, match " << matchId << " of target "
+                    << targetRegions[targetId] << " is " << matches[targetId][matchId].Region
+                    << " at " << matches[targetId][matchId].Distance << ", expected "
+                    << allMatches[matchId].Region << " at " << allMatches[matchId].Distance << std::endl;
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+bool TestFewerCandidatesThanK()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  ImageType::Pointer image = ImageType::New();
+  CreateImage(image);
+
+  // A 6x5 search region holds exactly two patches of radius 2.
+  itk::Index<2> searchCorner = {{10, 10}};
+  itk::Size<2> searchSize = {{6, 5}};
+  itk::ImageRegion<2> searchRegion(searchCorner, searchSize);
+
+  itk::Index<2> targetCenter = {{41, 21}};
+  std::vector<itk::ImageRegion<2> > targetRegions(1, ITKHelpers::GetRegionInRadiusAroundPixel(targetCenter, 2));
+
+  std::vector<MaskPatchSearch::MatchListType> matches =
+      MaskPatchSearch::FindBestSourcePatches(image.GetPointer(), mask, targetRegions, searchRegion, 10);
+  if(matches.size() != 1 || matches[0].size() != 2 || matches[0][0].Distance > matches[0][1].Distance)
+  {
+    std::cerr << "Expected the only 2 source patches, best first." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////
+////// Test Helpers ////
+////////////////////////
+
+void CreateImage(ImageType* const image)
+{
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{100,50}};
+  itk::ImageRegion<2> imageRegion(corner, size);
+  image->SetRegions(imageRegion);
+  image->Allocate();
+
+  // A pattern that repeats every 10 pixels, so there are many ties between the source patches.
+  itk::ImageRegionIterator<ImageType> imageIterator(image, imageRegion);
+  while(!imageIterator.IsAtEnd())
+  {
+    const itk::Index<2> index = imageIterator.GetIndex();
+    imageIterator.Set((index[0] % 10) * 3 + (index[1] % 5));
+    ++imageIterator;
+  }
+}
@@ -0,0 +1,202 @@
+#include "Mask.h"
+#include "MaskOperations.h"
+#include "MaskParallel.h"
+#include "MaskRandomState.h"
+#include "MaskTestHelpers.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// STL
+#include <cstring>
+
+static bool TestKnownAnswers();
+static bool TestUniformFloats();
+static bool TestUniformInteger();
+static bool TestSplit();
+static bool TestAddNoiseInHole();
+static bool TestRandomValidRegion();
+
+int main()
+{
+  bool allPass = true;
+  allPass &= TestKnownAnswers();
+  allPass &= TestUniformFloats();
+  allPass &= TestUniformInteger();
+  allPass &= TestSplit();
+  allPass &= TestAddNoiseInHole();
+  allPass &= TestRandomValidRegion();
+
+  if(allPass)
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
+
+bool TestKnownAnswers()
+{
+  // The Philox4x32-10 known answer for a zero key and counter.
+  MaskRandomState randomState(0, 0);
+  const uint32_t expected[4] = {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8};
+  for(unsigned int i = 0; i < 4; ++i)
+  {
+    if(randomState.NextUInt32() != expected[i])
+    {
+      std::cerr << "Output " << i << " does not match the Philox4x32-10 known answer." << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool TestUniformFloats()
+{
+  // The batched (possibly SIMD) path must match the one-at-a-time values exactly, for any alignment.
+  MaskRandomState randomState(1234, 5);
+  for(uint64_t firstPosition = 0; firstPosition < 8; ++firstPosition)
+  {
+    std::vector<float> values(53);
+    randomState.GetUniformFloats(firstPosition, values.size(), values.data());
+    for(unsigned int i = 0; i < values.size(); ++i)
+    {
+      const float expected = MaskRandomState::ToUniformFloat(randomState.GetUInt32(firstPosition + i));
+      if(std::memcmp(&expected, &values[i], sizeof(float)) != 0 || values[i] < 0.0f || values[i] >= 1.0f)
+      {
+        std::cerr << "GetUniformFloats value " << i << " from position " << firstPosition
+                  << " is " << values[i] << " but should be " << expected << std::endl;
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool TestUniformInteger()
+{
+  MaskRandomState randomState(42);
+  std::vector<unsigned int> histogram(7, 0);
+  for(unsigned int i = 0; i < 7000; ++i)
+  {
+    uint64_t value = randomState.NextUniformInteger(3, 9);
+    if(value < 3 || value > 9)
+    {
+      std::cerr << "NextUniformInteger returned " << value << ", which is not in [3, 9]." << std::endl;
+      return false;
+    }
+    histogram[value - 3]++;
+  }
+
+  for(unsigned int i = 0; i < histogram.size(); ++i)
+  {
+    if(histogram[i] < 800 || histogram[i] > 1200)
+    {
+      std::cerr << "NextUniformInteger drew " << i + 3 << " " << histogram[i] << " times out of 7000." << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool TestSplit()
+{
+  MaskRandomState parent1(7);
+  MaskRandomState parent2(7);
+
+  MaskRandomState child1 = parent1.Split();
+  MaskRandomState child2 = parent2.Split();
+  MaskRandomState sibling = parent1.Split();
+
+  if(child1.GetStream() != child2.GetStream() || child1.NextUInt64() != child2.NextUInt64())
+  {
+    std::cerr << "Splitting the same state twice should give the same stream." << std::endl;
+    return false;
+  }
+
+  if(child1.GetStream() == sibling.GetStream())
+  {
+    std::cerr << "Consecutive splits should give different streams." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestAddNoiseInHole()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  typedef itk::Image<float, 2> ImageType;
+
+  std::vector<ImageType::Pointer> images;
+  for(unsigned int numberOfThreads = 1; numberOfThreads <= 4; numberOfThreads += 3)
+  {
+    ImageType::Pointer image = ImageType::New();
+    image->SetRegions(mask->GetLargestPossibleRegion());
+    image->Allocate();
+    image->FillBuffer(10.0f);
+
+    MaskParallel::SetNumberOfThreads(numberOfThreads);
+    MaskRandomState randomState(2012);
+    MaskOperations::AddNoiseInHole(image.GetPointer(), mask.GetPointer(), 2.0f, randomState);
+    images.push_back(image);
+  }
+  MaskParallel::SetNumberOfThreads(0);
+
+  itk::ImageRegionConstIteratorWithIndex<ImageType> iterator(images[0], images[0]->GetLargestPossibleRegion());
+  while(!iterator.IsAtEnd())
+  {
+    const float value = iterator.Get();
+    if(value != images[1]->GetPixel(iterator.GetIndex()))
+    {
+      std::cerr << "AddNoiseInHole gave different results for 1 and 4 threads at " << iterator.GetIndex() << std::endl;
+      return false;
+    }
+
+    if(mask->IsValid(iterator.GetIndex()) && value != 10.0f)
+    {
+      std::cerr << "AddNoiseInHole changed valid pixel " << iterator.GetIndex() << std::endl;
+      return false;
+    }
+
+    if(mask->IsHole(iterator.GetIndex()) && (value < 9.0f || value >= 11.0f))
+    {
+      std::cerr << "AddNoiseInHole noise at " << iterator.GetIndex() << " is out of range: " << value << std::endl;
+      return false;
+    }
+    ++iterator;
+  }
+
+  return true;
+}
+
+bool TestRandomValidRegion()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  MaskRandomState randomState1(99);
+  MaskRandomState randomState2(99);
+  for(unsigned int i = 0; i < 20; ++i)
+  {
+    itk::ImageRegion<2> region1 = MaskOperations::RandomValidRegion(mask, 3, randomState1);
+    itk::ImageRegion<2> region2 = MaskOperations::RandomValidRegion(mask, 3, randomState2);
+    if(region1 != region2 || !mask->IsValid(region1))
+    {
+      std::cerr << "RandomValidRegion with the same seed should give the same valid regions: "
+                << region1 << " " << region2 << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,332 @@
+#include "Mask.h"
+#include "MaskOperations.h"
+#include "MaskRegionStatistics.h"
+#include "MaskTestHelpers.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// ITK
+#include "itkImageRegionIterator.h"
+#include "itkVectorImage.h"
+
+// STL
+#include <cmath>
+
+typedef itk::Image<float, 2> ScalarImageType;
+typedef itk::VectorImage<float, 2> VectorImageType;
+
+static bool TestScalarStatistics();
+static bool TestVectorStatistics();
+static bool TestAccumulate();
+static bool TestNonZero();
+
+// Test helpers
+static void CreateImage(ScalarImageType* const image);
+static void CreateImage(VectorImageType* const image);
+static bool IsClose(const double value, const double expected);
+
+int main()
+{
+  bool allPass = true;
+  allPass &= TestScalarStatistics();
+  allPass &= TestVectorStatistics();
+  allPass &= TestAccumulate();
+  allPass &= TestNonZero();
+
+  if(allPass)
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
+
+bool TestScalarStatistics()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  ScalarImageType::Pointer image = ScalarImageType::New();
+  CreateImage(image.GetPointer());
+
+  itk::Index<2> regionCorner = {{30,15}};
+  itk::Size<2> regionSize = {{25,10}};
+  itk::ImageRegion<2> region(regionCorner, regionSize);
+
+  // Compute the statistics of the valid pixels directly.
+  itk::SizeValueType count = 0;
+  double sum = 0;
+  double minimum = 0;
+  double maximum = 0;
+  itk::Index<2> minimumIndex = regionCorner;
+  itk::Index<2> maximumIndex = regionCorner;
+  itk::ImageRegionConstIteratorWithIndex<ScalarImageType> imageIterator(image, region);
+  while(!imageIterator.IsAtEnd())
+  {
+    if(mask->IsValid(imageIterator.GetIndex()))
+    {
+      const double value = imageIterator.Get();
+      if(count == 0 || value < minimum)
+      {
+        minimum = value;
+        minimumIndex = imageIterator.GetIndex();
+      }
+      if(count == 0 || value > maximum)
+      {
+        maximum = value;
+        maximumIndex = imageIterator.GetIndex();
+      }
+      sum += value;
+      count++;
+    }
+    ++imageIterator;
+  }
+  const double mean = sum / count;
+
+  double squaredDeviations = 0;
+  imageIterator.GoToBegin();
+  while(!imageIterator.IsAtEnd())
+  {
+    if(mask->IsValid(imageIterator.GetIndex()))
+    {
+      squaredDeviations += (imageIterator.Get() - mean) * (imageIterator.Get() - mean);
+    }
+    ++imageIterator;
+  }
+
+  MaskRegionStatistics<ScalarImageType> statistics;
+  statistics.Compute(image, mask, region, HoleMaskPixelTypeEnum::VALID);
+  if(statistics.GetCount() != count || statistics.GetMinimum() != minimum || statistics.GetMaximum() != maximum ||
+     statistics.GetMinimumIndex() != minimumIndex || statistics.GetMaximumIndex() != maximumIndex ||
+     !IsClose(statistics.GetMean(), mean) || !IsClose(statistics.GetVariance(), squaredDeviations / count))
+  {
+    std::cerr << "Scalar statistics are wrong: count " << statistics.GetCount() << " (expected " << count
+              << "), min " << statistics.GetMinimum() << " (" << minimum << "), max " << statistics.GetMaximum()
+              << " (" << maximum << "), mean " << statistics.GetMean() << " (" << mean << "), variance "
+              << statistics.GetVariance() << " (" << squaredDeviations / count << ")" << std::endl;
+    return false;
+  }
+
+  float maxValue = 0;
+  MaskOperations::FindMaximumValueInMaskedRegion(image.GetPointer(), mask, region, HoleMaskPixelTypeEnum::VALID,
+                                                 maxValue);
+  if(maxValue != maximum)
+  {
+    std::cerr << "FindMaximumValueInMaskedRegion found " << maxValue << ", expected " << maximum << std::endl;
+    return false;
+  }
+
+  // Statistics that were not requested are not available.
+  MaskRegionStatistics<ScalarImageType> minimumOnly(MaskRegionStatistics<ScalarImageType>::MINIMUM);
+  minimumOnly.Compute(image, mask, region, HoleMaskPixelTypeEnum::VALID);
+  try
+  {
+    minimumOnly.GetMean();
+    std::cerr << "GetMean() should throw when the mean was not requested." << std::endl;
+    return false;
+  }
+  catch(std::runtime_error&)
+  {
+  }
+
+  return minimumOnly.GetMinimum() == minimum;
+}
+
+bool TestVectorStatistics()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  VectorImageType::Pointer image = VectorImageType::New();
+  CreateImage(image.GetPointer());
+
+  itk::Index<2> regionCorner = {{35,18}};
+  itk::Size<2> regionSize = {{30,14}};
+  itk::ImageRegion<2> region(regionCorner, regionSize);
+
+  MaskRegionStatistics<VectorImageType> statistics;
+  statistics.Compute(image, mask, region, HoleMaskPixelTypeEnum::HOLE);
+
+  for(unsigned int component = 0; component < image->GetNumberOfComponentsPerPixel(); ++component)
+  {
+    itk::SizeValueType count = 0;
+    double sum = 0;
+    double squaredSum = 0;
+    double maximum = 0;
+    itk::ImageRegionConstIteratorWithIndex<VectorImageType> imageIterator(image, region);
+    while(!imageIterator.IsAtEnd())
+    {
+      if(mask->IsHole(imageIterator.GetIndex()))
+      {
+        const double value = imageIterator.Get()[component];
+        maximum = (count == 0) ? value : std::max(maximum, value);
+        sum += value;
+        squaredSum += value * value;
+        count++;
+      }
+      ++imageIterator;
+    }
+
+    const double mean = sum / count;
+    if(statistics.GetCount() != count || statistics.GetMaximum(component) != maximum ||
+       !IsClose(statistics.GetMean(component), mean) ||
+       !IsClose(statistics.GetVariance(component), squaredSum / count - mean * mean))
+    {
+      std::cerr << "Statistics of component " << component << " are wrong." << std::endl;
+      return false;
+    }
+  }
+
+  VectorImageType::PixelType mean;
+  statistics.GetMean(mean);
+  // The pixel components are floats, so compare against the rounded mean.
+  if(mean.GetSize() != image->GetNumberOfComponentsPerPixel() ||
+     mean[1] != static_cast<float>(statistics.GetMean(1)))
+  {
+    std::cerr << "GetMean(pixel) did not set every component." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestAccumulate()
+{
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, {{100,50}});
+  MaskTestHelpers::AddHole(mask, {{40,20}}, {{20,10}});
+
+  ScalarImageType::Pointer image = ScalarImageType::New();
+  CreateImage(image.GetPointer());
+
+  // Accumulating the two halves of a region gives the statistics of the whole region.
+  itk::Index<2> topCorner = {{10,10}};
+  itk::Size<2> halfSize = {{60,12}};
+  itk::Index<2> bottomCorner = {{10,22}};
+  itk::Size<2> wholeSize = {{60,24}};
+
+  MaskRegionStatistics<ScalarImageType> halves;
+  halves.Accumulate(image, mask, itk::ImageRegion<2>(topCorner, halfSize), HoleMaskPixelTypeEnum::VALID);
+  halves.Accumulate(image, mask, itk::ImageRegion<2>(bottomCorner, halfSize), HoleMaskPixelTypeEnum::VALID);
+
+  MaskRegionStatistics<ScalarImageType> whole;
+  whole.Compute(image, mask, itk::ImageRegion<2>(topCorner, wholeSize), HoleMaskPixelTypeEnum::VALID);
+
+  if(halves.GetCount() != whole.GetCount() || halves.GetMinimum() != whole.GetMinimum() ||
+     halves.GetMaximumIndex() != whole.GetMaximumIndex() || !IsClose(halves.GetMean(), whole.GetMean()) ||
+     !IsClose(halves.GetVariance(), whole.GetVariance()))
+  {
+    std::cerr << "Accumulating two halves should match computing the whole region." << std::endl;
+    return false;
+  }
+
+  // Compute() starts over.
+  halves.Compute(image, mask, itk::ImageRegion<2>(topCorner, halfSize), HoleMaskPixelTypeEnum::VALID);
+  if(halves.GetCount() >= whole.GetCount())
+  {
+    std::cerr << "Compute() should reset the accumulated statistics." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestNonZero()
+{
+  ScalarImageType::Pointer image = ScalarImageType::New();
+  CreateImage(image.GetPointer());
+
+  // Zero everything but a small block that contains the highest value of the image.
+  itk::Index<2> blockCorner = {{90,45}};
+  itk::Size<2> blockSize = {{5,3}};
+  itk::ImageRegion<2> block(blockCorner, blockSize);
+  itk::ImageRegionIterator<ScalarImageType> imageIterator(image, image->GetLargestPossibleRegion());
+  float highestValue = 0;
+  itk::Index<2> highestIndex = blockCorner;
+  while(!imageIterator.IsAtEnd())
+  {
+    if(!block.IsInside(imageIterator.GetIndex()))
+    {
+      imageIterator.Set(0);
+    }
+    else if(imageIterator.Get() > highestValue)
+    {
+      highestValue = imageIterator.Get();
+      highestIndex = imageIterator.GetIndex();
+    }
+    ++imageIterator;
+  }
+
+  float maxValue = 0;
+  itk::Index<2> maxIndex = MaskOperations::FindHighestValueInNonZero(image.GetPointer(), maxValue);
+  if(maxValue != highestValue || maxIndex != highestIndex)
+  {
+    std::cerr << "FindHighestValueInNonZero found " << maxValue << " at " << maxIndex << ", expected "
+              << highestValue << " at " << highestIndex << std::endl;
+    return false;
+  }
+
+  MaskRegionStatistics<ScalarImageType> statistics(MaskRegionStatistics<ScalarImageType>::MINIMUM);
+  statistics.AccumulateNonZero(image, image->GetLargestPossibleRegion());
+  if(statistics.GetCount() > block.GetNumberOfPixels() || !(statistics.GetMinimum() > 0))
+  {
+    std::cerr << "AccumulateNonZero should only see the non-zero block." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////
+////// Test Helpers ////
+////////////////////////
+
+void CreateImage(ScalarImageType* const image)
+{
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{100,50}};
+  itk::ImageRegion<2> imageRegion(corner, size);
+  image->SetRegions(imageRegion);
+  image->Allocate();
+
+  itk::ImageRegionIterator<ScalarImageType> imageIterator(image, imageRegion);
+  while(!imageIterator.IsAtEnd())
+  {
+    const itk::Index<2> index = imageIterator.GetIndex();
+    imageIterator.Set(1 + (index[0] * 37 + index[1] * 11) % 251);
+    ++imageIterator;
+  }
+}
+
+void CreateImage(VectorImageType* const image)
+{
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{100,50}};
+  itk::ImageRegion<2> imageRegion(corner, size);
+  image->SetRegions(imageRegion);
+  image->SetNumberOfComponentsPerPixel(3);
+  image->Allocate();
+
+  itk::ImageRegionIterator<VectorImageType> imageIterator(image, imageRegion);
+  while(!imageIterator.IsAtEnd())
+  {
+    const itk::Index<2> index = imageIterator.GetIndex();
+    VectorImageType::PixelType pixel(3);
+    for(unsigned int component = 0; component < 3; ++component)
+    {
+      pixel[component] = 0.25f * ((index[0] * 37 + index[1] * 11 + component * 53) % 251);
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+}
+
+bool IsClose(const double value, const double expected)
+{
+  return std::abs(value - expected) <= 1e-9 * std::max(1.0, std::abs(expected));
+}
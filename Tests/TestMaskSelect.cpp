@@ -0,0 +1,266 @@
+#include "Mask.h"
+#include "MaskOperations.h"
+#include "MaskSelect.h"
+
+// ITK
+#include "itkImageRegionIterator.h"
+#include "itkRGBPixel.h"
+#include "itkVectorImage.h"
+
+// STL
+#include <cstdlib>
+#include <vector>
+
+static bool TestKernels();
+template <typename TImage>
+static bool TestSelect(const unsigned int numberOfComponents);
+template <typename TImage>
+static bool TestFill(const typename TImage::PixelType& pixel, const unsigned int numberOfComponents);
+static bool TestApplyToImage();
+
+// Test helpers
+static void CreateMask(Mask* const mask);
+template <typename TImage>
+static void CreateImage(TImage* const image, const unsigned int numberOfComponents, const int seed);
+
+int main()
+{
+  bool allPass = true;
+  allPass &= TestKernels();
+
+  allPass &= TestSelect<itk::Image<unsigned char, 2> >(1);
+  allPass &= TestSelect<itk::Image<short, 2> >(1);
+  allPass &= TestSelect<itk::Image<float, 2> >(1);
+  allPass &= TestSelect<itk::Image<double, 2> >(1);
+  allPass &= TestSelect<itk::Image<itk::RGBPixel<unsigned char>, 2> >(3);
+  allPass &= TestSelect<itk::VectorImage<float, 2> >(5);
+
+  allPass &= TestFill<itk::Image<unsigned char, 2> >(200, 1);
+
+  itk::RGBPixel<unsigned char> red;
+  red[0] = 255;
+  red[1] = 0;
+  red[2] = 0;
+  allPass &= TestFill<itk::Image<itk::RGBPixel<unsigned char>, 2> >(red, 3);
+
+  itk::VariableLengthVector<double> vectorPixel(2);
+  vectorPixel[0] = 1.5;
+  vectorPixel[1] = -2.0;
+  allPass &= TestFill<itk::VectorImage<double, 2> >(vectorPixel, 2);
+
+  allPass &= TestApplyToImage();
+
+  if(allPass)
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
+
+bool TestKernels()
+{
+  // Every pixel size and length, so the vector loops and their scalar tails are both covered.
+  const HoleMaskPixelTypeEnum values[] = {HoleMaskPixelTypeEnum::HOLE, HoleMaskPixelTypeEnum::VALID,
+                                          HoleMaskPixelTypeEnum::UNDETERMINED};
+  for(std::size_t pixelSize = 1; pixelSize <= 12; ++pixelSize)
+  {
+    for(std::size_t numberOfPixels = 0; numberOfPixels <= 40; ++numberOfPixels)
+    {
+      std::vector<HoleMaskPixelTypeEnum> mask(numberOfPixels);
+      std::vector<unsigned char> first(numberOfPixels * pixelSize);
+      std::vector<unsigned char> second(numberOfPixels * pixelSize);
+      for(std::size_t pixelId = 0; pixelId < numberOfPixels; ++pixelId)
+      {
+        mask[pixelId] = values[rand() % 3];
+      }
+      for(std::size_t byteId = 0; byteId < first.size(); ++byteId)
+      {
+        first[byteId] = static_cast<unsigned char>(rand());
+        second[byteId] = static_cast<unsigned char>(rand());
+      }
+
+      std::vector<unsigned char> selection(numberOfPixels * pixelSize);
+      MaskSelectKernels::ExpandSelection(mask.data(), HoleMaskPixelTypeEnum::HOLE, numberOfPixels, pixelSize,
+                                         selection.data());
+      std::vector<unsigned char> output(numberOfPixels * pixelSize);
+      MaskSelectKernels::SelectBytes(selection.data(), first.data(), second.data(), output.data(), output.size());
+
+      for(std::size_t byteId = 0; byteId < output.size(); ++byteId)
+      {
+        const bool isHole = (mask[byteId / pixelSize] == HoleMaskPixelTypeEnum::HOLE);
+        if(selection[byteId] != (isHole ? 0xFF : 0) || output[byteId] != (isHole ? first[byteId] : second[byteId]))
+        {
+          std::cerr << "Kernels: wrong byte " << byteId << " for pixel size " << pixelSize << " and "
+                    << numberOfPixels << " pixels." << std::endl;
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+template <typename TImage>
+bool TestSelect(const unsigned int numberOfComponents)
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  typename TImage::Pointer first = TImage::New();
+  CreateImage(first.GetPointer(), numberOfComponents, 1);
+  typename TImage::Pointer second = TImage::New();
+  CreateImage(second.GetPointer(), numberOfComponents, 2);
+  typename TImage::Pointer output = TImage::New();
+  CreateImage(output.GetPointer(), numberOfComponents, 3);
+
+  // Shifted regions, so the mask row and the image rows start at different offsets.
+  itk::Index<2> maskCorner = {{3,2}};
+  itk::Index<2> imageCorner = {{0,7}};
+  itk::Size<2> size = {{1100,30}};
+  itk::ImageRegion<2> maskRegion(maskCorner, size);
+  itk::ImageRegion<2> imageRegion(imageCorner, size);
+  MaskSelect::Select(mask.GetPointer(), maskRegion, HoleMaskPixelTypeEnum::HOLE, first.GetPointer(),
+                     second.GetPointer(), output.GetPointer(), imageRegion);
+
+  typename TImage::Pointer original = TImage::New();
+  CreateImage(original.GetPointer(), numberOfComponents, 3);
+
+  itk::ImageRegionConstIteratorWithIndex<TImage> outputIterator(output, output->GetLargestPossibleRegion());
+  while(!outputIterator.IsAtEnd())
+  {
+    const itk::Index<2> index = outputIterator.GetIndex();
+    typename TImage::PixelType expected = original->GetPixel(index);
+    if(imageRegion.IsInside(index))
+    {
+      const bool isHole = mask->IsHole(index + (maskCorner - imageCorner));
+      expected = isHole ? first->GetPixel(index) : second->GetPixel(index);
+    }
+
+    if(outputIterator.Get() != expected)
+    {
+      std::cerr << "Select: wrong pixel at " << index << std::endl;
+      return false;
+    }
+    ++outputIterator;
+  }
+
+  return true;
+}
+
+template <typename TImage>
+bool TestFill(const typename TImage::PixelType& pixel, const unsigned int numberOfComponents)
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  typename TImage::Pointer image = TImage::New();
+  CreateImage(image.GetPointer(), numberOfComponents, 4);
+  typename TImage::Pointer original = TImage::New();
+  CreateImage(original.GetPointer(), numberOfComponents, 4);
+
+  MaskSelect::Fill(mask.GetPointer(), HoleMaskPixelTypeEnum::VALID, pixel, image.GetPointer());
+
+  itk::ImageRegionConstIteratorWithIndex<TImage> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    const itk::Index<2> index = imageIterator.GetIndex();
+    const typename TImage::PixelType expected = mask->IsValid(index) ? pixel : original->GetPixel(index);
+    if(imageIterator.Get() != expected)
+    {
+      std::cerr << "Fill: wrong pixel at " << index << std::endl;
+      return false;
+    }
+    ++imageIterator;
+  }
+
+  return true;
+}
+
+bool TestApplyToImage()
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  typedef itk::Image<float, 2> ImageType;
+  ImageType::Pointer image = ImageType::New();
+  CreateImage(image.GetPointer(), 1, 5);
+  ImageType::Pointer input = ImageType::New();
+  CreateImage(input.GetPointer(), 1, 6);
+  ImageType::Pointer original = ImageType::New();
+  CreateImage(original.GetPointer(), 1, 5);
+
+  MaskOperations::CopyInValidRegion(input.GetPointer(), image.GetPointer(), mask.GetPointer());
+  mask->ApplyToImage(image.GetPointer(), -1.0f);
+
+  itk::ImageRegionConstIteratorWithIndex<ImageType> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    const itk::Index<2> index = imageIterator.GetIndex();
+    float expected = original->GetPixel(index);
+    if(mask->IsValid(index))
+    {
+      expected = input->GetPixel(index);
+    }
+    else if(mask->IsHole(index))
+    {
+      expected = -1.0f;
+    }
+
+    if(imageIterator.Get() != expected)
+    {
+      std::cerr << "ApplyToImage: wrong pixel at " << index << std::endl;
+      return false;
+    }
+    ++imageIterator;
+  }
+
+  return true;
+}
+
+////////////////////////
+////// Test Helpers ////
+////////////////////////
+
+void CreateMask(Mask* const mask)
+{
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{1103,40}};
+  itk::ImageRegion<2> region(corner, size);
+  mask->SetRegions(region);
+  mask->Allocate();
+
+  // A noisy mask with all three values, so every block mixes selected and unselected pixels.
+  itk::ImageRegionIterator<Mask> maskIterator(mask, region);
+  while(!maskIterator.IsAtEnd())
+  {
+    const int value = rand() % 5;
+    maskIterator.Set(value < 2 ? HoleMaskPixelTypeEnum::HOLE :
+                     (value < 4 ? HoleMaskPixelTypeEnum::VALID : HoleMaskPixelTypeEnum::UNDETERMINED));
+    ++maskIterator;
+  }
+  mask->Modified();
+}
+
+template <typename TImage>
+void CreateImage(TImage* const image, const unsigned int numberOfComponents, const int seed)
+{
+  typedef typename MaskImageBuffer::ImageComponents<TImage>::ComponentType ComponentType;
+
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{1103,40}};
+  itk::ImageRegion<2> region(corner, size);
+  image->SetRegions(region);
+  image->SetNumberOfComponentsPerPixel(numberOfComponents);
+  image->Allocate();
+
+  ComponentType* const buffer = MaskImageBuffer::ImageComponents<TImage>::GetComponentBuffer(image);
+  const std::size_t numberOfValues = region.GetNumberOfPixels() * numberOfComponents;
+  for(std::size_t valueId = 0; valueId < numberOfValues; ++valueId)
+  {
+    buffer[valueId] = static_cast<ComponentType>((valueId * 31 + seed * 17) % 101);
+  }
+}
@@ -0,0 +1,229 @@
+#include "Mask.h"
+#include "MaskOperations.h"
+#include "MaskTrace.h"
+#include "MaskTestHelpers.h"
+
+// Submodules
+#include <ITKHelpers/ITKHelpers.h>
+
+// STL
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static bool TestStopped();
+static bool TestEvents();
+static bool TestRingBuffer();
+static bool TestClear();
+static bool TestMaskOperations();
+
+// Test helpers
+static std::string WriteTrace();
+static unsigned int CountOccurrences(const std::string& text, const std::string& pattern);
+
+int main()
+{
+  bool allPass = true;
+  allPass &= TestStopped();
+  allPass &= TestEvents();
+  allPass &= TestRingBuffer();
+  allPass &= TestClear();
+  allPass &= TestMaskOperations();
+
+  if(allPass)
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
+
+bool TestStopped()
+{
+  MaskTrace::Clear();
+  MaskTrace::Stop();
+  {
+    MaskTrace::ScopedEvent event("Test::Stopped");
+  }
+
+  if(WriteTrace().find("Test::Stopped") != std::string::npos)
+  {
+    std::cerr << "An event was recorded while tracing was stopped." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestEvents()
+{
+  MaskTrace::Clear();
+  MaskTrace::Start();
+  {
+    MaskTrace::ScopedEvent outer("Test::Outer");
+    MaskTrace::ScopedEvent inner("Test::Inner");
+  }
+
+  const unsigned int numberOfThreads = 2;
+  const unsigned int numberOfEvents = 10;
+  std::vector<std::thread> threads;
+  for(unsigned int threadId = 0; threadId < numberOfThreads; ++threadId)
+  {
+    threads.push_back(std::thread([numberOfEvents]
+                                  {
+                                    for(unsigned int eventId = 0; eventId < numberOfEvents; ++eventId)
+                                    {
+                                      MaskTrace::ScopedEvent event("Test::Threaded");
+                                    }
+                                  }));
+  }
+  for(std::thread& thread : threads)
+  {
+    thread.join();
+  }
+  MaskTrace::Stop();
+
+  const std::string trace = WriteTrace();
+  if(trace.find("\"traceEvents\"") == std::string::npos)
+  {
+    std::cerr << "The trace has no traceEvents array:" << std::endl << trace;
+    return false;
+  }
+
+  if(CountOccurrences(trace, "\"Test::Outer\"") != 2 || CountOccurrences(trace, "\"Test::Inner\"") != 2)
+  {
+    std::cerr << "The nested events should each have a begin and an end event:" << std::endl << trace;
+    return false;
+  }
+
+  if(CountOccurrences(trace, "\"Test::Threaded\"") != 2 * numberOfThreads * numberOfEvents)
+  {
+    std::cerr << "There should be " << 2 * numberOfThreads * numberOfEvents << " threaded events but there are "
+              << CountOccurrences(trace, "\"Test::Threaded\"") << std::endl;
+    return false;
+  }
+
+  if(CountOccurrences(trace, "\"ph\": \"B\"") != CountOccurrences(trace, "\"ph\": \"E\""))
+  {
+    std::cerr << "The begin and end events do not match:" << std::endl << trace;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestRingBuffer()
+{
+  MaskTrace::Clear();
+
+  // Only the newest events of a thread are kept, and the trace never starts with an unmatched end event.
+  const std::size_t capacity = MaskTrace::GetBufferCapacity();
+  MaskTrace::SetBufferCapacity(9);
+  MaskTrace::Start();
+  std::thread thread([]
+                     {
+                       for(unsigned int eventId = 0; eventId < 100; ++eventId)
+                       {
+                         MaskTrace::ScopedEvent event("Test::Overflow");
+                       }
+                     });
+  thread.join();
+  MaskTrace::Stop();
+  MaskTrace::SetBufferCapacity(capacity);
+
+  const std::string trace = WriteTrace();
+  const unsigned int numberOfBegins = CountOccurrences(trace, "\"ph\": \"B\"");
+  const unsigned int numberOfEnds = CountOccurrences(trace, "\"ph\": \"E\"");
+  if(CountOccurrences(trace, "\"Test::Overflow\"") != 8 || numberOfBegins != numberOfEnds)
+  {
+    std::cerr << "The overflowed buffer should give 4 complete events:" << std::endl << trace;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestClear()
+{
+  MaskTrace::Start();
+  {
+    MaskTrace::ScopedEvent event("Test::Cleared");
+  }
+  MaskTrace::Stop();
+  MaskTrace::Clear();
+
+  if(WriteTrace().find("Test::Cleared") != std::string::npos)
+  {
+    std::cerr << "Clear() did not discard the recorded events." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestMaskOperations()
+{
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{50,40}};
+  itk::ImageRegion<2> region(corner, size);
+
+  typedef itk::Image<float, 2> ImageType;
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+  image->FillBuffer(1.0f);
+
+  Mask::Pointer mask = Mask::New();
+  MaskTestHelpers::CreateValidMask(mask, region.GetSize());
+  MaskTestHelpers::AddHole(mask, {{20,15}}, {{10,10}});
+
+  MaskTrace::Clear();
+  MaskTrace::Start();
+  ImageType::Pointer output = ImageType::New();
+  MaskOperations::MaskedBlur(image.GetPointer(), mask.GetPointer(), 2.0f, output.GetPointer());
+  MaskTrace::Stop();
+
+  const std::string trace = WriteTrace();
+  const char* const expectedNames[] = {"\"MaskOperations::MaskedBlur\"",
+                                       "\"MaskOperations::MaskedBlurInRegion\"",
+                                       "\"MaskOperations::MaskedBlurInRegion: horizontal pass\"",
+                                       "\"MaskOperations::MaskedBlurInRegion: vertical pass\""};
+  for(const char* const expectedName : expectedNames)
+  {
+    const bool found = trace.find(expectedName) != std::string::npos;
+    if(found != MaskTrace::IsEnabled())
+    {
+      std::cerr << expectedName << (found ? " was traced without" : " was not traced with")
+                << " MASK_ENABLE_TRACING." << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+////////////////////////
+////// Test Helpers ////
+////////////////////////
+
+std::string WriteTrace()
+{
+  std::stringstream trace;
+  MaskTrace::WriteChromeTrace(trace);
+  return trace.str();
+}
+
+unsigned int CountOccurrences(const std::string& text, const std::string& pattern)
+{
+  unsigned int count = 0;
+  for(std::size_t position = text.find(pattern); position != std::string::npos;
+      position = text.find(pattern, position + pattern.size()))
+  {
+    count++;
+  }
+  return count;
+}
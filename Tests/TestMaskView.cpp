@@ -0,0 +1,250 @@
+#include "Mask.h"
+#include "MaskOperations.h"
+#include "MaskView.h"
+
+// ITK
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkVectorImage.h"
+
+// STL
+#include <cstdlib>
+
+static bool TestMaskView();
+static bool TestMaskImageView();
+static bool TestExtractMaskedRegion();
+
+// Test helpers
+static void CreateMask(Mask* const mask);
+
+int main()
+{
+  bool allPass = true;
+  allPass &= TestMaskView();
+  allPass &= TestMaskImageView();
+  allPass &= TestExtractMaskedRegion();
+
+  if(allPass)
+  {
+    return EXIT_SUCCESS;
+  }
+  else
+  {
+    return EXIT_FAILURE;
+  }
+}
+
+bool TestMaskView()
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  itk::Index<2> corner = {{13,7}};
+  itk::Size<2> size = {{40,21}};
+  itk::ImageRegion<2> region(corner, size);
+  MaskView view(mask, region);
+
+  if(view.GetLocalRegion().GetIndex()[0] != 0 || view.GetLocalRegion().GetIndex()[1] != 0 ||
+     view.GetSize() != size)
+  {
+    std::cerr << "MaskView: wrong local region " << view.GetLocalRegion() << std::endl;
+    return false;
+  }
+
+  itk::ImageRegionConstIteratorWithIndex<Mask> maskIterator(mask, region);
+  while(!maskIterator.IsAtEnd())
+  {
+    const itk::Index<2> maskIndex = maskIterator.GetIndex();
+    const itk::Index<2> viewIndex = {{maskIndex[0] - corner[0], maskIndex[1] - corner[1]}};
+    if(view.GetMaskIndex(viewIndex) != maskIndex || view.GetPixel(viewIndex) != maskIterator.Get() ||
+       view.GetRow(viewIndex[1])[viewIndex[0]] != maskIterator.Get() ||
+       view.IsHole(viewIndex) != mask->IsHole(maskIndex) || view.IsValid(viewIndex) != mask->IsValid(maskIndex))
+    {
+      std::cerr << "MaskView: wrong pixel at " << viewIndex << std::endl;
+      return false;
+    }
+    ++maskIterator;
+  }
+
+  if(view.CountHolePixels() != mask->CountHolePixels(region) ||
+     view.CountValidPixels() != mask->CountValidPixels(region) ||
+     view.CountBoundaryPixels(HoleMaskPixelTypeEnum::HOLE) !=
+       mask->CountBoundaryPixels(region, HoleMaskPixelTypeEnum::HOLE) ||
+     view.HasHolePixels() != mask->HasHolePixels(region) || view.HasValidPixels() != mask->HasValidPixels(region) ||
+     view.IsHole() != mask->IsHole(region) || view.IsValid() != mask->IsValid(region))
+  {
+    std::cerr << "MaskView: the counts do not match the mask's." << std::endl;
+    return false;
+  }
+
+  // The spans are relative to the corner of the view.
+  std::shared_ptr<const Mask::SpanListType> spans = view.GetHoleSpans();
+  unsigned int numberOfSpanPixels = 0;
+  for(std::size_t spanId = 0; spanId < spans->size(); ++spanId)
+  {
+    const Mask::Span& span = (*spans)[spanId];
+    for(itk::SizeValueType i = 0; i < span.Length; ++i)
+    {
+      const itk::Index<2> viewIndex = {{span.X + static_cast<itk::IndexValueType>(i), span.Y}};
+      if(!view.IsHole(viewIndex))
+      {
+        std::cerr << "MaskView: span pixel " << viewIndex << " is not a hole pixel." << std::endl;
+        return false;
+      }
+    }
+    numberOfSpanPixels += span.Length;
+  }
+
+  if(numberOfSpanPixels != view.CountHolePixels())
+  {
+    std::cerr << "MaskView: the spans do not cover the hole." << std::endl;
+    return false;
+  }
+
+  // A view of a view is a view of the combined region of the mask.
+  itk::Index<2> subCorner = {{5,3}};
+  itk::Size<2> subSize = {{10,10}};
+  MaskView subView = view.GetSubView(itk::ImageRegion<2>(subCorner, subSize));
+  const itk::Index<2> expectedCorner = {{corner[0] + subCorner[0], corner[1] + subCorner[1]}};
+  if(subView.GetRegion() != itk::ImageRegion<2>(expectedCorner, subSize))
+  {
+    std::cerr << "MaskView: wrong sub view region " << subView.GetRegion() << std::endl;
+    return false;
+  }
+
+  // Regions outside the mask are rejected.
+  try
+  {
+    itk::Index<2> outsideCorner = {{90,0}};
+    MaskView outsideView(mask, itk::ImageRegion<2>(outsideCorner, size));
+    std::cerr << "MaskView: a region outside the mask was accepted." << std::endl;
+    return false;
+  }
+  catch(const std::runtime_error&)
+  {
+  }
+
+  return true;
+}
+
+bool TestMaskImageView()
+{
+  typedef itk::VectorImage<float, 2> ImageType;
+  ImageType::Pointer image = ImageType::New();
+  itk::Index<2> imageCorner = {{0,0}};
+  itk::Size<2> imageSize = {{100,50}};
+  image->SetRegions(itk::ImageRegion<2>(imageCorner, imageSize));
+  image->SetNumberOfComponentsPerPixel(3);
+  image->Allocate();
+
+  itk::ImageRegionIterator<ImageType> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    ImageType::PixelType pixel(3);
+    pixel[0] = imageIterator.GetIndex()[0];
+    pixel[1] = imageIterator.GetIndex()[1];
+    pixel[2] = rand() % 100;
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+
+  itk::Index<2> corner = {{13,7}};
+  itk::Size<2> size = {{40,21}};
+  MaskImageView<ImageType> view(image, itk::ImageRegion<2>(corner, size));
+
+  const itk::Index<2> viewIndex = {{4,9}};
+  const itk::Index<2> imageIndex = {{17,16}};
+  const float* components = view.GetComponents(viewIndex);
+  if(view.GetImageIndex(viewIndex) != imageIndex || view.GetNumberOfComponents() != 3 ||
+     components[0] != 17 || components[1] != 16 || components[2] != image->GetPixel(imageIndex)[2] ||
+     view.GetPixel(viewIndex) != image->GetPixel(imageIndex))
+  {
+    std::cerr << "MaskImageView: wrong pixel at " << viewIndex << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool TestExtractMaskedRegion()
+{
+  Mask::Pointer mask = Mask::New();
+  CreateMask(mask);
+
+  typedef itk::VectorImage<unsigned char, 2> ImageType;
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(mask->GetLargestPossibleRegion());
+  image->SetNumberOfComponentsPerPixel(3);
+  image->Allocate();
+
+  itk::ImageRegionIterator<ImageType> imageIterator(image, image->GetLargestPossibleRegion());
+  while(!imageIterator.IsAtEnd())
+  {
+    ImageType::PixelType pixel(3);
+    for(unsigned int component = 0; component < 3; ++component)
+    {
+      pixel[component] = rand() % 255;
+    }
+    imageIterator.Set(pixel);
+    ++imageIterator;
+  }
+
+  ImageType::PixelType holeColor(3);
+  holeColor[0] = 255;
+  holeColor[1] = 0;
+  holeColor[2] = 255;
+
+  itk::Index<2> corner = {{31,12}};
+  itk::Size<2> size = {{57,30}};
+  itk::ImageRegion<2> region(corner, size);
+
+  ImageType::Pointer output = ImageType::New();
+  MaskOperations::ExtractMaskedRegion(image.GetPointer(), mask, region, holeColor, output.GetPointer());
+
+  itk::Index<2> zeroCorner = {{0,0}};
+  if(output->GetLargestPossibleRegion() != itk::ImageRegion<2>(zeroCorner, size))
+  {
+    std::cerr << "ExtractMaskedRegion: wrong output region " << output->GetLargestPossibleRegion() << std::endl;
+    return false;
+  }
+
+  itk::ImageRegionConstIteratorWithIndex<ImageType> outputIterator(output, output->GetLargestPossibleRegion());
+  while(!outputIterator.IsAtEnd())
+  {
+    const itk::Index<2> imageIndex = {{outputIterator.GetIndex()[0] + corner[0],
+                                       outputIterator.GetIndex()[1] + corner[1]}};
+    const ImageType::PixelType expected = mask->IsHole(imageIndex) ? holeColor : image->GetPixel(imageIndex);
+    if(outputIterator.Get() != expected)
+    {
+      std::cerr << "ExtractMaskedRegion: wrong pixel at " << outputIterator.GetIndex() << std::endl;
+      return false;
+    }
+    ++outputIterator;
+  }
+
+  return true;
+}
+
+////////////////////////
+////// Test Helpers ////
+////////////////////////
+
+void CreateMask(Mask* const mask)
+{
+  itk::Index<2> corner = {{0,0}};
+  itk::Size<2> size = {{100,50}};
+  itk::ImageRegion<2> region(corner, size);
+  mask->SetRegions(region);
+  mask->Allocate();
+
+  itk::ImageRegionIterator<Mask> maskIterator(mask, region);
+  while(!maskIterator.IsAtEnd())
+  {
+    const itk::Index<2> index = maskIterator.GetIndex();
+    const bool inHole = (index[0] - 50) * (index[0] - 50) + (index[1] - 25) * (index[1] - 25) < 300 ||
+                        rand() % 13 == 0;
+    maskIterator.Set(inHole ? HoleMaskPixelTypeEnum::HOLE : HoleMaskPixelTypeEnum::VALID);
+    ++maskIterator;
+  }
+  mask->Modified();
+}